@@ -30,7 +30,7 @@
 #include "utils/common/common.h"
 #include "utils/lookup/vl_lookup.h"
 #include "utils/metadata/meta_data.h"
-#include "utils_cache.h" /* for uc_get_rate() */
+#include "utils_cache.h" /* for uc_get_rate_buffer() */
 #include "utils_subst.h"
 
 #define AGG_MATCHES_ALL(str) (strcmp("/.*/", str) == 0)
@@ -292,8 +292,8 @@ static int agg_instance_update(agg_instance_t *inst, /* {{{ */
     return EINVAL;
   }
 
-  gauge_t *rate = uc_get_rate(ds, vl);
-  if (rate == NULL) {
+  gauge_t rate[1];
+  if (uc_get_rate_buffer(ds, vl, rate) != 0) {
     char ident[6 * DATA_MAX_NAME_LEN];
     FORMAT_VL(ident, sizeof(ident), vl);
     ERROR("aggregation plugin: Unable to read the current rate of \"%s\".",
@@ -301,10 +301,8 @@ static int agg_instance_update(agg_instance_t *inst, /* {{{ */
     return ENOENT;
   }
 
-  if (isnan(rate[0])) {
-    sfree(rate);
+  if (isnan(rate[0]))
     return 0;
-  }
 
   pthread_mutex_lock(&inst->lock);
 
@@ -319,7 +317,6 @@ static int agg_instance_update(agg_instance_t *inst, /* {{{ */
 
   pthread_mutex_unlock(&inst->lock);
 
-  sfree(rate);
   return 0;
 } /* }}} int agg_instance_update */
 
@@ -186,12 +186,19 @@ struct cpu_state_s {
   value_to_rate_state_t conv;
   gauge_t rate;
   bool has_value;
+  /* Prepared series of the "cpu" and "percent" types, created on first use. */
+  plugin_series_t *derive_series;
+  plugin_series_t *percent_series;
 };
 typedef struct cpu_state_s cpu_state_t;
 
 static cpu_state_t *cpu_states;
 static size_t cpu_states_num; /* #cpu_states allocated */
 
+/* Prepared series of the aggregate over all CPUs and of the number of CPUs. */
+static plugin_series_t *global_percent_series[COLLECTD_CPU_STATE_MAX];
+static plugin_series_t *num_cpu_series;
+
 /* Highest CPU number in the current iteration. Used by the dispatch logic to
  * determine how many CPUs there were. Reset to 0 by cpu_reset(). */
 static size_t global_cpu_num;
@@ -324,22 +331,32 @@ static int init(void) {
   return 0;
 } /* int init */
 
-static void submit_value(int cpu_num, int cpu_state, const char *type,
-                         value_t value) {
-  value_list_t vl = VALUE_LIST_INIT;
+static cpu_state_t *get_cpu_state(size_t cpu_num, size_t state);
+
+/* Dispatches `value' using the prepared series stored in `series', creating it
+ * first if necessary. */
+static void submit_value(plugin_series_t **series, int cpu_num, int cpu_state,
+                         const char *type, value_t value) {
+  if (*series == NULL) {
+    value_list_t vl = VALUE_LIST_INIT;
 
-  vl.values = &value;
-  vl.values_len = 1;
+    vl.values_len = 1;
 
-  sstrncpy(vl.plugin, "cpu", sizeof(vl.plugin));
-  sstrncpy(vl.type, type, sizeof(vl.type));
-  sstrncpy(vl.type_instance, cpu_state_names[cpu_state],
-           sizeof(vl.type_instance));
+    sstrncpy(vl.plugin, "cpu", sizeof(vl.plugin));
+    sstrncpy(vl.type, type, sizeof(vl.type));
+    sstrncpy(vl.type_instance, cpu_state_names[cpu_state],
+             sizeof(vl.type_instance));
+
+    if (cpu_num >= 0) {
+      snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%i", cpu_num);
+    }
 
-  if (cpu_num >= 0) {
-    snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%i", cpu_num);
+    *series = plugin_series_create(&vl);
+    if (*series == NULL)
+      return;
   }
-  plugin_dispatch_values(&vl);
+
+  plugin_series_dispatch(*series, &value, 0);
 }
 
 static void submit_percent(int cpu_num, int cpu_state, gauge_t value) {
@@ -349,11 +366,19 @@ static void submit_percent(int cpu_num, int cpu_state, gauge_t value) {
   if (isnan(value))
     return;
 
-  submit_value(cpu_num, cpu_state, "percent", (value_t){.gauge = value});
+  plugin_series_t **series = &global_percent_series[cpu_state];
+  if (cpu_num >= 0)
+    series = &get_cpu_state((size_t)cpu_num, (size_t)cpu_state)->percent_series;
+
+  submit_value(series, cpu_num, cpu_state, "percent",
+               (value_t){.gauge = value});
 }
 
 static void submit_derive(int cpu_num, int cpu_state, derive_t value) {
-  submit_value(cpu_num, cpu_state, "cpu", (value_t){.derive = value});
+  cpu_state_t *s = get_cpu_state((size_t)cpu_num, (size_t)cpu_state);
+
+  submit_value(&s->derive_series, cpu_num, cpu_state, "cpu",
+               (value_t){.derive = value});
 }
 
 /* Takes the zero-index number of a CPU and makes sure that the module-global
@@ -493,15 +518,20 @@ static void cpu_commit_one(int cpu_num, /* {{{ */
 /* Commits the number of cores */
 static void cpu_commit_num_cpu(gauge_t value) /* {{{ */
 {
-  value_list_t vl = VALUE_LIST_INIT;
+  if (num_cpu_series == NULL) {
+    value_list_t vl = VALUE_LIST_INIT;
+
+    vl.values_len = 1;
 
-  vl.values = &(value_t){.gauge = value};
-  vl.values_len = 1;
+    sstrncpy(vl.plugin, "cpu", sizeof(vl.plugin));
+    sstrncpy(vl.type, "count", sizeof(vl.type));
 
-  sstrncpy(vl.plugin, "cpu", sizeof(vl.plugin));
-  sstrncpy(vl.type, "count", sizeof(vl.type));
+    num_cpu_series = plugin_series_create(&vl);
+    if (num_cpu_series == NULL)
+      return;
+  }
 
-  plugin_dispatch_values(&vl);
+  plugin_series_dispatch(num_cpu_series, &(value_t){.gauge = value}, 0);
 } /* }}} void cpu_commit_num_cpu */
 
 /* Resets the internal aggregation. This is called by the read callback after
@@ -907,8 +937,28 @@ static int cpu_read(void) {
   return 0;
 }
 
+static int cpu_shutdown(void) /* {{{ */
+{
+  for (size_t i = 0; i < cpu_states_num; i++) {
+    plugin_series_destroy(cpu_states[i].derive_series);
+    plugin_series_destroy(cpu_states[i].percent_series);
+  }
+  sfree(cpu_states);
+  cpu_states_num = 0;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(global_percent_series); i++) {
+    plugin_series_destroy(global_percent_series[i]);
+    global_percent_series[i] = NULL;
+  }
+  plugin_series_destroy(num_cpu_series);
+  num_cpu_series = NULL;
+
+  return 0;
+} /* }}} int cpu_shutdown */
+
 void module_register(void) {
   plugin_register_init("cpu", init);
   plugin_register_config("cpu", cpu_config, config_keys, config_keys_num);
   plugin_register_read("cpu", cpu_read);
+  plugin_register_shutdown("cpu", cpu_shutdown);
 } /* void module_register */
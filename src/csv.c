@@ -41,7 +41,8 @@ static int value_list_to_string(char *buffer, int buffer_len,
                                 const data_set_t *ds, const value_list_t *vl) {
   int offset;
   int status;
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
+  bool have_rates = false;
 
   assert(0 == strcmp(ds->type, vl->type));
 
@@ -56,21 +57,20 @@ static int value_list_to_string(char *buffer, int buffer_len,
     if ((ds->ds[i].type != DS_TYPE_COUNTER) &&
         (ds->ds[i].type != DS_TYPE_GAUGE) &&
         (ds->ds[i].type != DS_TYPE_DERIVE) &&
-        (ds->ds[i].type != DS_TYPE_ABSOLUTE)) {
-      sfree(rates);
+        (ds->ds[i].type != DS_TYPE_ABSOLUTE))
       return -1;
-    }
 
     if (ds->ds[i].type == DS_TYPE_GAUGE) {
       status = snprintf(buffer + offset, buffer_len - offset, ",%lf",
                         vl->values[i].gauge);
     } else if (store_rates != 0) {
-      if (rates == NULL)
-        rates = uc_get_rate(ds, vl);
-      if (rates == NULL) {
-        WARNING("csv plugin: "
-                "uc_get_rate failed.");
-        return -1;
+      if (!have_rates) {
+        if (uc_get_rate_buffer(ds, vl, rates) != 0) {
+          WARNING("csv plugin: "
+                  "uc_get_rate_buffer failed.");
+          return -1;
+        }
+        have_rates = true;
       }
       status = snprintf(buffer + offset, buffer_len - offset, ",%lf", rates[i]);
     } else if (ds->ds[i].type == DS_TYPE_COUNTER) {
@@ -84,15 +84,12 @@ static int value_list_to_string(char *buffer, int buffer_len,
                         vl->values[i].absolute);
     }
 
-    if ((status < 1) || (status >= (buffer_len - offset))) {
-      sfree(rates);
+    if ((status < 1) || (status >= (buffer_len - offset)))
       return -1;
-    }
 
     offset += status;
   } /* for ds->ds_num */
 
-  sfree(rates);
   return 0;
 } /* int value_list_to_string */
 
@@ -107,10 +107,15 @@ static cf_global_option_t cf_global_options[] = {
     {"FQDNLookup", NULL, 0, "true"},
     {"Interval", NULL, 0, NULL},
     {"ReadThreads", NULL, 0, "5"},
+    {"ReadThreadsAffinity", NULL, 0, NULL},
+    {"ReadScheduler", NULL, 0, "Heap"},
+    {"AlignRead", NULL, 0, "false"},
     {"WriteThreads", NULL, 0, "5"},
+    {"WriteBatchSize", NULL, 0, "64"},
     {"WriteQueueLimitHigh", NULL, 0, NULL},
     {"WriteQueueLimitLow", NULL, 0, NULL},
     {"Timeout", NULL, 0, "2"},
+    {"CacheHistory", NULL, 0, "Plain"},
     {"AutoLoadPlugin", NULL, 0, "false"},
     {"CollectInternalStats", NULL, 0, "false"},
     {"PreCacheChain", NULL, 0, "PreCache"},
@@ -32,6 +32,16 @@
 #include "utils/common/common.h"
 #include "utils_complain.h"
 
+/* Number of rules per chain whose identifier-only match results are cached. */
+#define FC_MEMO_RULES_MAX 64
+/* Initial number of buckets of a chain's cache. */
+#define FC_MEMO_BUCKETS_INIT 256
+/* Default number of series cached per chain, see the "MatchCacheSize"
+ * option. */
+#define FC_MEMO_ENTRIES_MAX 65536
+/* Number of locks the hit and miss counters of a chain are spread over. */
+#define FC_MEMO_STATS_NUM 16
+
 /*
  * Data types
  */
@@ -43,6 +53,8 @@ struct fc_match_s {
   char name[DATA_MAX_NAME_LEN];
   match_proc_t proc;
   void *user_data;
+  /* Set by fc_chain_compile(). */
+  bool identifier_only;
   fc_match_t *next;
 }; /* }}} */
 
@@ -54,6 +66,8 @@ struct fc_target_s {
   char name[DATA_MAX_NAME_LEN];
   void *user_data;
   target_proc_t proc;
+  /* Set by fc_chain_compile(). */
+  bool keeps_identifier;
   fc_target_t *next;
 }; /* }}} */
 
@@ -64,18 +78,62 @@ struct fc_rule_s {
   char name[DATA_MAX_NAME_LEN];
   fc_match_t *matches;
   fc_target_t *targets;
+  /* Bit in fc_memo_entry_t.results holding the combined result of the
+   * identifier-only matches, or -1 if they are not cached. */
+  int memo_bit;
   fc_rule_t *next;
 }; /* }}} */
 
+/* Cached match results of one series. */
+struct fc_memo_entry_s;
+typedef struct fc_memo_entry_s fc_memo_entry_t; /* {{{ */
+struct fc_memo_entry_s {
+  uint32_t hash;
+  uint64_t results;
+  fc_memo_entry_t *next;
+  /* Host, plugin, plugin instance, type and type instance, each terminated
+   * by a null byte. */
+  char identifier[];
+}; /* }}} */
+
+/* Hit and miss counters of a chain's cache. Each series is always counted in
+ * the same one, so threads handling different series rarely contend. */
+typedef struct {
+  pthread_mutex_t lock;
+  uint64_t hits;
+  uint64_t misses;
+} fc_memo_stats_t;
+
 /* List of chains, used for `chain_list_head' */
 struct fc_chain_s /* {{{ */
 {
   char name[DATA_MAX_NAME_LEN];
   fc_rule_t *rules;
   fc_target_t *targets;
+
+  /* Hash table of cached match results, keyed by the identifier a value list
+   * has when it reaches a rule. Protected by `memo_lock', which lookups only
+   * take for reading. Holds at most `memo_entries_max' entries. */
+  pthread_rwlock_t memo_lock;
+  int memo_rules_num;
+  size_t memo_entries_max;
+  fc_memo_entry_t **memo;
+  size_t memo_size;
+  size_t memo_num;
+  fc_memo_stats_t memo_stats[FC_MEMO_STATS_NUM];
+
   fc_chain_t *next;
 }; /* }}} */
 
+/* User data of the built-in target "jump". */
+struct fc_jump_s;
+typedef struct fc_jump_s fc_jump_t; /* {{{ */
+struct fc_jump_s {
+  char *chain_name;
+  /* Resolved by fc_chain_compile(). */
+  fc_chain_t *chain;
+}; /* }}} */
+
 /* Writer configuration. */
 struct fc_writer_s;
 typedef struct fc_writer_s fc_writer_t; /* {{{ */
@@ -146,6 +204,26 @@ static void fc_free_rules(fc_rule_t *r) /* {{{ */
   free(r);
 } /* }}} void fc_free_rules */
 
+/* Frees the entries of bucket `i'. Must be called with `memo_lock' held for
+ * writing. */
+static void fc_memo_clear_bucket(fc_chain_t *c, size_t i) /* {{{ */
+{
+  fc_memo_entry_t *e = c->memo[i];
+  while (e != NULL) {
+    fc_memo_entry_t *next = e->next;
+    free(e);
+    c->memo_num--;
+    e = next;
+  }
+  c->memo[i] = NULL;
+} /* }}} void fc_memo_clear_bucket */
+
+static void fc_memo_clear(fc_chain_t *c) /* {{{ */
+{
+  for (size_t i = 0; i < c->memo_size; i++)
+    fc_memo_clear_bucket(c, i);
+} /* }}} void fc_memo_clear */
+
 static void fc_free_chains(fc_chain_t *c) /* {{{ */
 {
   if (c == NULL)
@@ -154,6 +232,12 @@ static void fc_free_chains(fc_chain_t *c) /* {{{ */
   fc_free_rules(c->rules);
   fc_free_targets(c->targets);
 
+  fc_memo_clear(c);
+  free(c->memo);
+  pthread_rwlock_destroy(&c->memo_lock);
+  for (size_t i = 0; i < FC_MEMO_STATS_NUM; i++)
+    pthread_mutex_destroy(&c->memo_stats[i].lock);
+
   if (c->next != NULL)
     fc_free_chains(c->next);
 
@@ -178,6 +262,214 @@ static char *fc_strdup(const char *orig) /* {{{ */
   return dest;
 } /* }}} char *fc_strdup */
 
+/*
+ * Cache of match results.
+ *
+ * Matches which only look at the identifier of a value list, e.g. the regex
+ * match without "MetaData", return the same result for every value of a
+ * series. For each chain, the combined result of these matches is stored per
+ * rule and per series, so that a stable set of series only runs them once.
+ * Matches depending on the values, the time or the meta data still run for
+ * every value list.
+ */
+static uint32_t fc_memo_hash(const value_list_t *vl) /* {{{ */
+{
+  const char *fields[] = {vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance};
+  /* FNV-1a */
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    /* Includes the terminating null byte to separate the fields. */
+    const char *c = fields[i];
+    do {
+      hash ^= (uint8_t)*c;
+      hash *= 16777619u;
+    } while (*c++ != 0);
+  }
+
+  return hash;
+} /* }}} uint32_t fc_memo_hash */
+
+static bool fc_memo_equal(const fc_memo_entry_t *e, /* {{{ */
+                          const value_list_t *vl) {
+  const char *fields[] = {vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance};
+  const char *ptr = e->identifier;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    if (strcmp(ptr, fields[i]) != 0)
+      return false;
+    ptr += strlen(ptr) + 1;
+  }
+
+  return true;
+} /* }}} bool fc_memo_equal */
+
+/* Returns true and stores the cached results in `ret_results' if the series
+ * of `vl' is known. */
+static bool fc_memo_lookup(fc_chain_t *c, const value_list_t *vl, /* {{{ */
+                           uint32_t hash, uint64_t *ret_results) {
+  bool found = false;
+
+  pthread_rwlock_rdlock(&c->memo_lock);
+  for (fc_memo_entry_t *e = c->memo[hash & (c->memo_size - 1)]; e != NULL;
+       e = e->next) {
+    if ((e->hash == hash) && fc_memo_equal(e, vl)) {
+      *ret_results = e->results;
+      found = true;
+      break;
+    }
+  }
+  pthread_rwlock_unlock(&c->memo_lock);
+
+  fc_memo_stats_t *stats = c->memo_stats + (hash % FC_MEMO_STATS_NUM);
+  pthread_mutex_lock(&stats->lock);
+  if (found)
+    stats->hits++;
+  else
+    stats->misses++;
+  pthread_mutex_unlock(&stats->lock);
+
+  return found;
+} /* }}} bool fc_memo_lookup */
+
+/* Sums up the hit and miss counters of `c'. */
+static void fc_memo_stats(fc_chain_t *c, uint64_t *hits, /* {{{ */
+                          uint64_t *misses) {
+  for (size_t i = 0; i < FC_MEMO_STATS_NUM; i++) {
+    pthread_mutex_lock(&c->memo_stats[i].lock);
+    *hits += c->memo_stats[i].hits;
+    *misses += c->memo_stats[i].misses;
+    pthread_mutex_unlock(&c->memo_stats[i].lock);
+  }
+} /* }}} void fc_memo_stats */
+
+/* Makes room for one more entry by discarding the entries of one bucket: the
+ * bucket of `hash' if it has any, else the next one that has. Since the
+ * table holds about one entry per bucket, most cached results are kept even
+ * if there are more series than fit. Must be called with `memo_lock' held
+ * for writing and a non-empty table. */
+static void fc_memo_evict(fc_chain_t *c, uint32_t hash) /* {{{ */
+{
+  size_t i = hash & (c->memo_size - 1);
+
+  while (c->memo[i] == NULL)
+    i = (i + 1) & (c->memo_size - 1);
+
+  fc_memo_clear_bucket(c, i);
+} /* }}} void fc_memo_evict */
+
+/* Doubles the number of buckets. Must be called with `memo_lock' held for
+ * writing. */
+static void fc_memo_grow(fc_chain_t *c) /* {{{ */
+{
+  size_t size = 2 * c->memo_size;
+  fc_memo_entry_t **memo = calloc(size, sizeof(*memo));
+  if (memo == NULL)
+    return;
+
+  for (size_t i = 0; i < c->memo_size; i++) {
+    fc_memo_entry_t *e = c->memo[i];
+    while (e != NULL) {
+      fc_memo_entry_t *next = e->next;
+      e->next = memo[e->hash & (size - 1)];
+      memo[e->hash & (size - 1)] = e;
+      e = next;
+    }
+  }
+
+  free(c->memo);
+  c->memo = memo;
+  c->memo_size = size;
+} /* }}} void fc_memo_grow */
+
+static void fc_memo_insert(fc_chain_t *c, const value_list_t *vl, /* {{{ */
+                           uint32_t hash, uint64_t results) {
+  const char *fields[] = {vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance};
+  size_t lengths[STATIC_ARRAY_SIZE(fields)];
+  size_t size = 0;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    lengths[i] = strlen(fields[i]) + 1;
+    size += lengths[i];
+  }
+
+  fc_memo_entry_t *e = malloc(sizeof(*e) + size);
+  if (e == NULL)
+    return;
+  e->hash = hash;
+  e->results = results;
+
+  char *ptr = e->identifier;
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    memcpy(ptr, fields[i], lengths[i]);
+    ptr += lengths[i];
+  }
+
+  pthread_rwlock_wrlock(&c->memo_lock);
+
+  /* Another thread may have added the series in the meantime. */
+  fc_memo_entry_t **bucket = &c->memo[hash & (c->memo_size - 1)];
+  for (fc_memo_entry_t *other = *bucket; other != NULL; other = other->next) {
+    if ((other->hash == hash) && fc_memo_equal(other, vl)) {
+      pthread_rwlock_unlock(&c->memo_lock);
+      free(e);
+      return;
+    }
+  }
+
+  if (c->memo_num >= c->memo_entries_max)
+    fc_memo_evict(c, hash);
+  else if ((c->memo_num >= c->memo_size) &&
+           (c->memo_size < c->memo_entries_max))
+    fc_memo_grow(c);
+
+  bucket = &c->memo[hash & (c->memo_size - 1)];
+  e->next = *bucket;
+  *bucket = e;
+  c->memo_num++;
+
+  pthread_rwlock_unlock(&c->memo_lock);
+} /* }}} void fc_memo_insert */
+
+/* Returns the combined results of the identifier-only matches of all cached
+ * rules of `c' for the current identifier of `vl'. */
+static uint64_t fc_memo_get(const data_set_t *ds, /* {{{ */
+                            const value_list_t *vl, fc_chain_t *c) {
+  uint32_t hash = fc_memo_hash(vl);
+  uint64_t results = 0;
+
+  if (fc_memo_lookup(c, vl, hash, &results))
+    return results;
+
+  for (fc_rule_t *rule = c->rules; rule != NULL; rule = rule->next) {
+    if (rule->memo_bit < 0)
+      continue;
+
+    fc_match_t *match;
+    for (match = rule->matches; match != NULL; match = match->next) {
+      if (!match->identifier_only)
+        continue;
+
+      int status =
+          (*match->proc.match)(ds, vl, /* meta = */ NULL, &match->user_data);
+      if (status < 0) {
+        WARNING("fc_process_chain (%s): A match failed.", c->name);
+        break;
+      } else if (status != FC_MATCH_MATCHES)
+        break;
+    }
+
+    if (match == NULL)
+      results |= (uint64_t)1 << rule->memo_bit;
+  }
+
+  fc_memo_insert(c, vl, hash, results);
+  return results;
+} /* }}} uint64_t fc_memo_get */
+
 /*
  * Configuration.
  *
@@ -396,6 +688,7 @@ static int fc_config_add_rule(fc_chain_t *chain, /* {{{ */
     ERROR("fc_config_add_rule: calloc failed.");
     return -1;
   }
+  rule->memo_bit = -1;
 
   if (ci->values_num == 1) {
     sstrncpy(rule->name, ci->values[0].value.string, sizeof(rule->name));
@@ -476,6 +769,10 @@ static int fc_config_add_chain(const oconfig_item_t *ci) /* {{{ */
       return -1;
     }
     sstrncpy(chain->name, ci->values[0].value.string, sizeof(chain->name));
+    chain->memo_entries_max = FC_MEMO_ENTRIES_MAX;
+    pthread_rwlock_init(&chain->memo_lock, /* attr = */ NULL);
+    for (size_t i = 0; i < FC_MEMO_STATS_NUM; i++)
+      pthread_mutex_init(&chain->memo_stats[i].lock, /* attr = */ NULL);
   }
 
   for (int i = 0; i < ci->children_num; i++) {
@@ -485,7 +782,18 @@ static int fc_config_add_chain(const oconfig_item_t *ci) /* {{{ */
       status = fc_config_add_rule(chain, option);
     else if (strcasecmp("Target", option->key) == 0)
       status = fc_config_add_target(&chain->targets, option);
-    else {
+    else if (strcasecmp("MatchCacheSize", option->key) == 0) {
+      if ((option->values_num != 1) ||
+          (option->values[0].type != OCONFIG_TYPE_NUMBER) ||
+          (option->values[0].value.number < 0)) {
+        WARNING("Filter subsystem: Chain %s: `MatchCacheSize' requires "
+                "exactly one non-negative numeric argument.",
+                chain->name);
+        status = -1;
+      } else {
+        chain->memo_entries_max = (size_t)option->values[0].value.number;
+      }
+    } else {
       WARNING("Filter subsystem: Chain %s: Option `%s' not allowed "
               "inside a <Chain> block.",
               chain->name, option->key);
@@ -549,19 +857,29 @@ static int fc_bit_jump_create(const oconfig_item_t *ci, /* {{{ */
     return -1;
   }
 
-  *user_data = fc_strdup(ci_chain->values[0].value.string);
-  if (*user_data == NULL) {
+  fc_jump_t *jump = calloc(1, sizeof(*jump));
+  if (jump == NULL) {
+    ERROR("fc_bit_jump_create: calloc failed.");
+    return -1;
+  }
+
+  jump->chain_name = fc_strdup(ci_chain->values[0].value.string);
+  if (jump->chain_name == NULL) {
     ERROR("fc_bit_jump_create: fc_strdup failed.");
+    free(jump);
     return -1;
   }
 
+  *user_data = jump;
   return 0;
 } /* }}} int fc_bit_jump_create */
 
 static int fc_bit_jump_destroy(void **user_data) /* {{{ */
 {
-  if (user_data != NULL) {
-    free(*user_data);
+  if ((user_data != NULL) && (*user_data != NULL)) {
+    fc_jump_t *jump = *user_data;
+    free(jump->chain_name);
+    free(jump);
     *user_data = NULL;
   }
 
@@ -573,20 +891,15 @@ static int fc_bit_jump_invoke(const data_set_t *ds, /* {{{ */
                               notification_meta_t __attribute__((unused)) *
                                   *meta,
                               void **user_data) {
-  char *chain_name;
+  fc_jump_t *jump = *user_data;
   fc_chain_t *chain;
   int status;
 
-  chain_name = *user_data;
-
-  for (chain = chain_list_head; chain != NULL; chain = chain->next)
-    if (strcasecmp(chain_name, chain->name) == 0)
-      break;
-
+  chain = jump->chain;
   if (chain == NULL) {
     ERROR("Filter subsystem: Built-in target `jump': There is no chain "
           "named `%s'.",
-          chain_name);
+          jump->chain_name);
     return -1;
   }
 
@@ -615,6 +928,12 @@ fc_bit_return_invoke(const data_set_t __attribute__((unused)) * ds, /* {{{ */
   return FC_TARGET_RETURN;
 } /* }}} int fc_bit_return_invoke */
 
+static bool fc_bit_keeps_identifier(void __attribute__((unused)) *
+                                    user_data) /* {{{ */
+{
+  return true;
+} /* }}} bool fc_bit_keeps_identifier */
+
 static int fc_bit_write_create(const oconfig_item_t *ci, /* {{{ */
                                void **user_data) {
   fc_writer_t *plugin_list = NULL;
@@ -681,6 +1000,38 @@ static int fc_bit_write_destroy(void **user_data) /* {{{ */
   return 0;
 } /* }}} int fc_bit_write_destroy */
 
+/* Reports the status of writing to all plugins, without spamming the logs. */
+static void fc_bit_write_report(int status) /* {{{ */
+{
+  static c_complain_t write_complaint = C_COMPLAIN_INIT_STATIC;
+
+  if (status == ENOENT) {
+    /* in most cases this is a permanent error, so use the complain
+     * mechanism rather than spamming the logs */
+    c_complain(
+        LOG_INFO, &write_complaint,
+        "Filter subsystem: Built-in target `write': Dispatching value to "
+        "all write plugins failed with status %i (ENOENT). "
+        "Most likely this means you didn't load any write plugins.",
+        status);
+
+    plugin_log_available_writers();
+  } else if (status != 0) {
+    /* often, this is a permanent error (e.g. target system unavailable),
+     * so use the complain mechanism rather than spamming the logs */
+    c_complain(
+        LOG_INFO, &write_complaint,
+        "Filter subsystem: Built-in target `write': Dispatching value to "
+        "all write plugins failed with status %i.",
+        status);
+  } else {
+    c_release(LOG_INFO, &write_complaint,
+              "Filter subsystem: "
+              "Built-in target `write': Some write plugin is back to normal "
+              "operation. `write' succeeded.");
+  }
+} /* }}} void fc_bit_write_report */
+
 static int fc_bit_write_invoke(const data_set_t *ds, /* {{{ */
                                value_list_t *vl,
                                notification_meta_t __attribute__((unused)) *
@@ -694,35 +1045,8 @@ static int fc_bit_write_invoke(const data_set_t *ds, /* {{{ */
     plugin_list = *user_data;
 
   if ((plugin_list == NULL) || (plugin_list[0].plugin == NULL)) {
-    static c_complain_t write_complaint = C_COMPLAIN_INIT_STATIC;
-
     status = plugin_write(/* plugin = */ NULL, ds, vl);
-    if (status == ENOENT) {
-      /* in most cases this is a permanent error, so use the complain
-       * mechanism rather than spamming the logs */
-      c_complain(
-          LOG_INFO, &write_complaint,
-          "Filter subsystem: Built-in target `write': Dispatching value to "
-          "all write plugins failed with status %i (ENOENT). "
-          "Most likely this means you didn't load any write plugins.",
-          status);
-
-      plugin_log_available_writers();
-    } else if (status != 0) {
-      /* often, this is a permanent error (e.g. target system unavailable),
-       * so use the complain mechanism rather than spamming the logs */
-      c_complain(
-          LOG_INFO, &write_complaint,
-          "Filter subsystem: Built-in target `write': Dispatching value to "
-          "all write plugins failed with status %i.",
-          status);
-    } else {
-      assert(status == 0);
-      c_release(LOG_INFO, &write_complaint,
-                "Filter subsystem: "
-                "Built-in target `write': Some write plugin is back to normal "
-                "operation. `write' succeeded.");
-    }
+    fc_bit_write_report(status);
   } else {
     for (size_t i = 0; plugin_list[i].plugin != NULL; i++) {
       status = plugin_write(plugin_list[i].plugin, ds, vl);
@@ -764,24 +1088,92 @@ static int fc_init_once(void) /* {{{ */
   tproc.create = NULL;
   tproc.destroy = NULL;
   tproc.invoke = fc_bit_stop_invoke;
+  tproc.keeps_identifier = fc_bit_keeps_identifier;
   fc_register_target("stop", tproc);
 
   memset(&tproc, 0, sizeof(tproc));
   tproc.create = NULL;
   tproc.destroy = NULL;
   tproc.invoke = fc_bit_return_invoke;
+  tproc.keeps_identifier = fc_bit_keeps_identifier;
   fc_register_target("return", tproc);
 
   memset(&tproc, 0, sizeof(tproc));
   tproc.create = fc_bit_write_create;
   tproc.destroy = fc_bit_write_destroy;
   tproc.invoke = fc_bit_write_invoke;
+  tproc.keeps_identifier = fc_bit_keeps_identifier;
   fc_register_target("write", tproc);
 
   done++;
   return 0;
 } /* }}} int fc_init_once */
 
+static void fc_targets_compile(fc_chain_t *chain, /* {{{ */
+                               fc_target_t *targets) {
+  for (fc_target_t *t = targets; t != NULL; t = t->next) {
+    t->keeps_identifier = (t->proc.keeps_identifier != NULL) &&
+                          (*t->proc.keeps_identifier)(t->user_data);
+
+    if (t->proc.invoke == fc_bit_jump_invoke) {
+      fc_jump_t *jump = t->user_data;
+      jump->chain = fc_chain_get_by_name(jump->chain_name);
+      if (jump->chain == NULL)
+        WARNING("Filter subsystem: Chain %s: Built-in target `jump': "
+                "There is no chain named `%s'.",
+                chain->name, jump->chain_name);
+    }
+  }
+} /* }}} void fc_targets_compile */
+
+/* Decides which match results of `chain' are cached and resolves the
+ * targets of jumps. */
+static int fc_chain_compile(fc_chain_t *chain) /* {{{ */
+{
+  chain->memo_rules_num = 0;
+
+  for (fc_rule_t *rule = chain->rules; rule != NULL; rule = rule->next) {
+    bool identifier_only = false;
+
+    for (fc_match_t *m = rule->matches; m != NULL; m = m->next) {
+      m->identifier_only = (m->proc.identifier_only != NULL) &&
+                           (*m->proc.identifier_only)(m->user_data);
+      if (m->identifier_only)
+        identifier_only = true;
+    }
+
+    rule->memo_bit = -1;
+    if (identifier_only && (chain->memo_entries_max > 0) &&
+        (chain->memo_rules_num < FC_MEMO_RULES_MAX))
+      rule->memo_bit = chain->memo_rules_num++;
+  }
+
+  fc_targets_compile(chain, chain->targets);
+  for (fc_rule_t *rule = chain->rules; rule != NULL; rule = rule->next)
+    fc_targets_compile(chain, rule->targets);
+
+  pthread_rwlock_wrlock(&chain->memo_lock);
+  fc_memo_clear(chain);
+  if ((chain->memo_rules_num > 0) && (chain->memo == NULL)) {
+    chain->memo = calloc(FC_MEMO_BUCKETS_INIT, sizeof(*chain->memo));
+    if (chain->memo == NULL) {
+      ERROR("fc_chain_compile: calloc failed.");
+      chain->memo_rules_num = 0;
+    } else {
+      chain->memo_size = FC_MEMO_BUCKETS_INIT;
+    }
+  }
+  if (chain->memo_rules_num == 0) {
+    for (fc_rule_t *rule = chain->rules; rule != NULL; rule = rule->next)
+      rule->memo_bit = -1;
+  }
+  pthread_rwlock_unlock(&chain->memo_lock);
+
+  DEBUG("fc_chain_compile (%s): Caching match results of %i rule(s).",
+        chain->name, chain->memo_rules_num);
+  return 0;
+} /* }}} int fc_chain_compile */
+
 /*
  * Public functions
  */
@@ -865,6 +1257,10 @@ int fc_process_chain(const data_set_t *ds, value_list_t *vl, /* {{{ */
 
   DEBUG("fc_process_chain (chain = %s);", chain->name);
 
+  /* Cached match results for the current identifier of `vl'. */
+  uint64_t memo = 0;
+  bool memo_valid = false;
+
   for (fc_rule_t *rule = chain->rules; rule != NULL; rule = rule->next) {
     fc_match_t *match;
     status = FC_TARGET_CONTINUE;
@@ -874,8 +1270,20 @@ int fc_process_chain(const data_set_t *ds, value_list_t *vl, /* {{{ */
             rule->name);
     }
 
+    if (rule->memo_bit >= 0) {
+      if (!memo_valid) {
+        memo = fc_memo_get(ds, vl, chain);
+        memo_valid = true;
+      }
+      if ((memo & ((uint64_t)1 << rule->memo_bit)) == 0)
+        continue;
+    }
+
     /* N. B.: rule->matches may be NULL. */
     for (match = rule->matches; match != NULL; match = match->next) {
+      if ((rule->memo_bit >= 0) && match->identifier_only)
+        continue;
+
       /* FIXME: Pass the meta-data to match targets here (when implemented). */
       status =
           (*match->proc.match)(ds, vl, /* meta = */ NULL, &match->user_data);
@@ -903,6 +1311,9 @@ int fc_process_chain(const data_set_t *ds, value_list_t *vl, /* {{{ */
       /* FIXME: Pass the meta-data to match targets here (when implemented). */
       status =
           (*target->proc.invoke)(ds, vl, /* meta = */ NULL, &target->user_data);
+      if (!target->keeps_identifier)
+        memo_valid = false;
+
       if (status < 0) {
         WARNING("fc_process_chain (%s): A target failed.", chain->name);
         continue;
@@ -983,6 +1394,33 @@ int fc_default_action(const data_set_t *ds, value_list_t *vl) /* {{{ */
   return fc_bit_write_invoke(ds, vl, NULL, NULL);
 } /* }}} int fc_default_action */
 
+int fc_default_action_batch(const write_batch_entry_t *entries, /* {{{ */
+                            size_t entries_num) {
+  if (entries_num == 0)
+    return FC_TARGET_CONTINUE;
+
+  fc_bit_write_report(plugin_write_batch(/* plugin = */ NULL, entries,
+                                         entries_num));
+
+  return FC_TARGET_CONTINUE;
+} /* }}} int fc_default_action_batch */
+
+void fc_stats(uint64_t *hits, uint64_t *misses) /* {{{ */
+{
+  uint64_t h = 0;
+  uint64_t m = 0;
+
+  for (fc_chain_t *chain = chain_list_head; chain != NULL;
+       chain = chain->next) {
+    fc_memo_stats(chain, &h, &m);
+  }
+
+  if (hits != NULL)
+    *hits = h;
+  if (misses != NULL)
+    *misses = m;
+} /* }}} void fc_stats */
+
 int fc_configure(const oconfig_item_t *ci) /* {{{ */
 {
   fc_init_once();
@@ -997,3 +1435,15 @@ int fc_configure(const oconfig_item_t *ci) /* {{{ */
 
   return -1;
 } /* }}} int fc_configure */
+
+int fc_init(void) /* {{{ */
+{
+  for (fc_chain_t *chain = chain_list_head; chain != NULL;
+       chain = chain->next) {
+    int status = fc_chain_compile(chain);
+    if (status != 0)
+      return status;
+  }
+
+  return 0;
+} /* }}} int fc_init */
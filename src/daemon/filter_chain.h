@@ -46,6 +46,10 @@ struct match_proc_s {
   int (*destroy)(void **user_data);
   int (*match)(const data_set_t *ds, const value_list_t *vl,
                notification_meta_t **meta, void **user_data);
+  /* Optional. Returns true if the result of `match' depends on nothing but
+   * the host, plugin, plugin instance, type and type instance of the value
+   * list. Such results are cached per series. */
+  bool (*identifier_only)(void *user_data);
 };
 typedef struct match_proc_s match_proc_t;
 
@@ -59,6 +63,9 @@ struct target_proc_s {
   int (*destroy)(void **user_data);
   int (*invoke)(const data_set_t *ds, value_list_t *vl,
                 notification_meta_t **meta, void **user_data);
+  /* Optional. Returns true if `invoke' never changes the host, plugin, plugin
+   * instance, type or type instance of the value list. */
+  bool (*keeps_identifier)(void *user_data);
 };
 typedef struct target_proc_s target_proc_t;
 
@@ -94,10 +101,21 @@ fc_chain_t *fc_chain_get_by_name(const char *chain_name);
 int fc_process_chain(const data_set_t *ds, value_list_t *vl, fc_chain_t *chain);
 
 int fc_default_action(const data_set_t *ds, value_list_t *vl);
+/* Same as `fc_default_action', but writes a whole batch of value lists. */
+int fc_default_action_batch(const write_batch_entry_t *entries,
+                            size_t entries_num);
+
+/* Statistics of the per-series caches of match results, summed over all
+ * chains. */
+void fc_stats(uint64_t *hits, uint64_t *misses);
 
 /*
  * Shortcut for global configuration
  */
 int fc_configure(const oconfig_item_t *ci);
 
+/* Compiles all configured chains. Must be called after the configuration has
+ * been read and before the chains are used. */
+int fc_init(void);
+
 #endif /* FILTER_CHAIN_H */
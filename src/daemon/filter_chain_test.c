@@ -0,0 +1,438 @@
+/**
+ * collectd - src/daemon/filter_chain_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "filter_chain.c" /* (sic) */
+
+#include "testing.h"
+
+/* Only used by filter_chain.c if a match or target is not registered. */
+const char *global_option_get(const char *option) { return "false"; }
+
+/* Names of the rules whose "mark" targets ran, separated by commas. */
+static char trace[4096];
+/* Number of calls of the "plugin" and "plugin_uncached" matches. */
+static int plugin_match_calls;
+
+/* The options of the test matches and targets are the string values of their
+ * first child, e.g. <Match "plugin"> Option "cpu" </Match>. */
+static int test_create(const oconfig_item_t *ci, void **user_data) {
+  if ((ci->children_num != 1) || (ci->children[0].values_num != 1) ||
+      (ci->children[0].values[0].type != OCONFIG_TYPE_STRING))
+    return -1;
+
+  *user_data = strdup(ci->children[0].values[0].value.string);
+  return (*user_data == NULL) ? -1 : 0;
+}
+
+static int test_destroy(void **user_data) {
+  sfree(*user_data);
+  return 0;
+}
+
+/* Match "plugin": matches value lists of the configured plugin. */
+static int plugin_match(const data_set_t *ds, const value_list_t *vl,
+                        notification_meta_t **meta, void **user_data) {
+  plugin_match_calls++;
+  return (strcmp(vl->plugin, *user_data) == 0) ? FC_MATCH_MATCHES
+                                                : FC_MATCH_NO_MATCH;
+}
+
+static bool plugin_identifier_only(void *user_data) { return true; }
+
+/* Match "above": matches value lists with a value above the configured one. */
+static int above_match(const data_set_t *ds, const value_list_t *vl,
+                       notification_meta_t **meta, void **user_data) {
+  return (vl->values[0].gauge > atof(*user_data)) ? FC_MATCH_MATCHES
+                                                  : FC_MATCH_NO_MATCH;
+}
+
+/* Target "mark": appends the configured name to `trace'. */
+static int mark_invoke(const data_set_t *ds, value_list_t *vl,
+                       notification_meta_t **meta, void **user_data) {
+  size_t len = strlen(trace);
+  snprintf(trace + len, sizeof(trace) - len, "%s,", (char *)*user_data);
+  return FC_TARGET_CONTINUE;
+}
+
+static bool mark_keeps_identifier(void *user_data) { return true; }
+
+/* Target "rename": sets the plugin of the value list. */
+static int rename_invoke(const data_set_t *ds, value_list_t *vl,
+                         notification_meta_t **meta, void **user_data) {
+  sstrncpy(vl->plugin, *user_data, sizeof(vl->plugin));
+  return FC_TARGET_CONTINUE;
+}
+
+static void test_register(void) {
+  static bool done;
+  if (done)
+    return;
+  done = true;
+
+  fc_init_once();
+
+  fc_register_match("plugin", (match_proc_t){
+                                  .create = test_create,
+                                  .destroy = test_destroy,
+                                  .match = plugin_match,
+                                  .identifier_only = plugin_identifier_only,
+                              });
+  /* Same as "plugin", but never cached. */
+  fc_register_match("plugin_uncached", (match_proc_t){
+                                           .create = test_create,
+                                           .destroy = test_destroy,
+                                           .match = plugin_match,
+                                       });
+  fc_register_match("above", (match_proc_t){
+                                 .create = test_create,
+                                 .destroy = test_destroy,
+                                 .match = above_match,
+                             });
+  fc_register_target("mark", (target_proc_t){
+                                 .create = test_create,
+                                 .destroy = test_destroy,
+                                 .invoke = mark_invoke,
+                                 .keeps_identifier = mark_keeps_identifier,
+                             });
+  fc_register_target("rename", (target_proc_t){
+                                   .create = test_create,
+                                   .destroy = test_destroy,
+                                   .invoke = rename_invoke,
+                               });
+}
+
+/* Returns a config item with the string value `value', if not NULL, and
+ * `children_num' children, which are passed as oconfig_item_t. */
+static oconfig_item_t ci_new(char const *key, char const *value,
+                             int children_num, ...) {
+  oconfig_item_t ci = {.key = strdup(key)};
+
+  if (value != NULL) {
+    ci.values = calloc(1, sizeof(*ci.values));
+    ci.values[0].value.string = strdup(value);
+    ci.values[0].type = OCONFIG_TYPE_STRING;
+    ci.values_num = 1;
+  }
+
+  if (children_num > 0) {
+    va_list ap;
+
+    ci.children = calloc(children_num, sizeof(*ci.children));
+    va_start(ap, children_num);
+    for (int i = 0; i < children_num; i++)
+      ci.children[i] = va_arg(ap, oconfig_item_t);
+    va_end(ap);
+    ci.children_num = children_num;
+  }
+
+  return ci;
+}
+
+/* <Match|Target "name"> Option "argument" </Match|Target> */
+static oconfig_item_t ci_proc(char const *key, char const *name,
+                              char const *argument) {
+  return ci_new(key, name, 1, ci_new("Option", argument, 0));
+}
+
+static int configure(oconfig_item_t ci) {
+  oconfig_item_t *copy = malloc(sizeof(*copy));
+  if (copy == NULL)
+    return -1;
+  *copy = ci;
+
+  int status = fc_configure(copy);
+  oconfig_free(copy);
+  return status;
+}
+
+/* Configures the chain `name' with one rule per `plugin' in `plugins', each
+ * marking value lists of that plugin with the plugin's name. */
+static int configure_plugin_rules(char const *name, char const *match,
+                                  char const **plugins, size_t plugins_num) {
+  oconfig_item_t chain = ci_new("Chain", name, 0);
+
+  chain.children = calloc(plugins_num, sizeof(*chain.children));
+  for (size_t i = 0; i < plugins_num; i++)
+    chain.children[i] =
+        ci_new("Rule", NULL, 2, ci_proc("Match", match, plugins[i]),
+               ci_proc("Target", "mark", plugins[i]));
+  chain.children_num = (int)plugins_num;
+
+  return configure(chain);
+}
+
+/* Runs `chain' for a value list of `plugin' with the value `value' and
+ * returns the trace. */
+static char const *process(char const *chain, char const *plugin,
+                           char const *type_instance, gauge_t value) {
+  value_t v = {.gauge = value};
+  value_list_t vl = {
+      .values = &v,
+      .values_len = 1,
+      .time = TIME_T_TO_CDTIME_T(1),
+      .interval = TIME_T_TO_CDTIME_T(10),
+  };
+  sstrncpy(vl.host, "example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, plugin, sizeof(vl.plugin));
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+  sstrncpy(vl.type_instance, type_instance, sizeof(vl.type_instance));
+
+  trace[0] = 0;
+  fc_process_chain(/* ds = */ NULL, &vl, fc_chain_get_by_name(chain));
+  return trace;
+}
+
+/* Configures the same rules twice, once with the cached "plugin" match and
+ * once with "plugin_uncached". */
+static int configure_memo_chains(char const *cached, char const *uncached) {
+  char const *names[] = {cached, uncached};
+  char const *matches[] = {"plugin", "plugin_uncached"};
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(names); i++) {
+    char const *m = matches[i];
+    oconfig_item_t chain = ci_new(
+        "Chain", names[i], 6,
+        ci_new("Rule", NULL, 2, ci_proc("Match", m, "cpu"),
+               ci_proc("Target", "mark", "cpu")),
+        /* Depends on the value as well as on the identifier. */
+        ci_new("Rule", NULL, 3, ci_proc("Match", m, "cpu"),
+               ci_proc("Match", "above", "10"),
+               ci_proc("Target", "mark", "cpu-high")),
+        /* Changes the identifier for the following rules. */
+        ci_new("Rule", NULL, 3, ci_proc("Match", m, "disk"),
+               ci_proc("Target", "rename", "cpu"),
+               ci_proc("Target", "mark", "renamed")),
+        ci_new("Rule", NULL, 2, ci_proc("Match", m, "cpu"),
+               ci_proc("Target", "mark", "cpu-after")),
+        ci_new("Rule", NULL, 3, ci_proc("Match", m, "memory"),
+               ci_proc("Target", "mark", "memory"),
+               ci_new("Target", "return", 0)),
+        ci_proc("Target", "mark", "default"));
+    if (configure(chain) != 0)
+      return -1;
+  }
+
+  return fc_init();
+}
+
+static uint64_t memo_misses(fc_chain_t *chain) {
+  uint64_t hits = 0, misses = 0;
+  fc_memo_stats(chain, &hits, &misses);
+  return misses;
+}
+
+DEF_TEST(memo_matches_uncached) {
+  char const *plugins[] = {"cpu", "disk", "memory", "other"};
+  gauge_t values[] = {5.0, 20.0};
+
+  test_register();
+  CHECK_ZERO(configure_memo_chains("memo", "memo_uncached"));
+
+  fc_chain_t *chain = fc_chain_get_by_name("memo");
+  CHECK_NOT_NULL(chain);
+  EXPECT_EQ_INT(5, chain->memo_rules_num);
+  EXPECT_EQ_INT(0, fc_chain_get_by_name("memo_uncached")->memo_rules_num);
+
+  for (int round = 0; round < 3; round++) {
+    for (size_t i = 0; i < STATIC_ARRAY_SIZE(plugins); i++) {
+      for (size_t j = 0; j < STATIC_ARRAY_SIZE(values); j++) {
+        char want[sizeof(trace)];
+        sstrncpy(want, process("memo_uncached", plugins[i], "", values[j]),
+                 sizeof(want));
+        EXPECT_EQ_STR(want, process("memo", plugins[i], "", values[j]));
+      }
+    }
+  }
+
+  /* The value dependent match runs for every value list. */
+  EXPECT_EQ_STR("cpu,cpu-after,default,", process("memo", "cpu", "", 5.0));
+  EXPECT_EQ_STR("cpu,cpu-high,cpu-after,default,",
+                process("memo", "cpu", "", 20.0));
+  /* After "rename", the cached results of "disk" no longer apply. */
+  EXPECT_EQ_STR("renamed,cpu-after,default,",
+                process("memo", "disk", "", 20.0));
+  EXPECT_EQ_STR("memory,", process("memo", "memory", "", 5.0));
+  EXPECT_EQ_STR("default,", process("memo", "other", "", 5.0));
+
+  /* Each series only ran the cached matches once. "disk" is looked up again
+   * as "cpu" after the rename. */
+  EXPECT_EQ_UINT64(4, memo_misses(chain));
+  EXPECT_EQ_INT(4, chain->memo_num);
+
+  plugin_match_calls = 0;
+  process("memo", "other", "", 5.0);
+  EXPECT_EQ_INT(0, plugin_match_calls);
+  process("memo_uncached", "other", "", 5.0);
+  EXPECT_EQ_INT(5, plugin_match_calls);
+
+  return 0;
+}
+
+/* Processes the series "0" to "num - 1" in `chain', alternating between the
+ * plugins "other" and "cpu", and checks the results. */
+static int process_series(char const *chain, int num) {
+  for (int i = 0; i < num; i++) {
+    char type_instance[DATA_MAX_NAME_LEN];
+    snprintf(type_instance, sizeof(type_instance), "%d", i);
+    EXPECT_EQ_STR((i % 2) ? "cpu," : "",
+                  process(chain, (i % 2) ? "cpu" : "other", type_instance,
+                          0.0));
+  }
+  return 0;
+}
+
+DEF_TEST(memo_entries_max) {
+  char const *plugins[] = {"cpu"};
+  oconfig_item_t size = ci_new("MatchCacheSize", NULL, 0);
+
+  test_register();
+  CHECK_ZERO(configure_plugin_rules("entries", "plugin", plugins, 1));
+  size.values = calloc(1, sizeof(*size.values));
+  size.values[0] = (oconfig_value_t){.type = OCONFIG_TYPE_NUMBER,
+                                     .value.number = 100};
+  size.values_num = 1;
+  CHECK_ZERO(configure(ci_new("Chain", "entries", 1, size)));
+  CHECK_ZERO(fc_init());
+
+  fc_chain_t *chain = fc_chain_get_by_name("entries");
+  CHECK_NOT_NULL(chain);
+  EXPECT_EQ_INT(100, chain->memo_entries_max);
+
+  CHECK_ZERO(process_series("entries", 100));
+  EXPECT_EQ_INT(100, chain->memo_num);
+  EXPECT_EQ_UINT64(100, memo_misses(chain));
+
+  /* One more series only discards the entries of one bucket. */
+  EXPECT_EQ_STR("cpu,", process("entries", "cpu", "new", 0.0));
+  OK(chain->memo_num <= 100);
+  OK(chain->memo_num > 90);
+
+  /* Most series cached before are still cached. Evaluating the others again
+   * gives the same results. */
+  CHECK_ZERO(process_series("entries", 100));
+  OK(memo_misses(chain) < 101 + 10);
+  EXPECT_EQ_INT(100, chain->memo_num);
+
+  return 0;
+}
+
+DEF_TEST(memo_entries_config) {
+  char const *plugins[] = {"cpu"};
+  oconfig_item_t size = ci_new("MatchCacheSize", NULL, 0);
+
+  test_register();
+  CHECK_ZERO(configure_plugin_rules("entries_off", "plugin", plugins, 1));
+  size.values = calloc(1, sizeof(*size.values));
+  size.values[0] = (oconfig_value_t){.type = OCONFIG_TYPE_NUMBER,
+                                     .value.number = 0};
+  size.values_num = 1;
+  CHECK_ZERO(configure(ci_new("Chain", "entries_off", 1, size)));
+  CHECK_ZERO(fc_init());
+
+  /* A size of zero disables the cache of the chain. */
+  fc_chain_t *chain = fc_chain_get_by_name("entries_off");
+  CHECK_NOT_NULL(chain);
+  EXPECT_EQ_INT(0, chain->memo_rules_num);
+  CHECK_ZERO(process_series("entries_off", 4));
+  EXPECT_EQ_INT(0, chain->memo_num);
+
+  size = ci_new("MatchCacheSize", NULL, 0);
+  size.values = calloc(1, sizeof(*size.values));
+  size.values[0] = (oconfig_value_t){.type = OCONFIG_TYPE_NUMBER,
+                                     .value.number = -1};
+  size.values_num = 1;
+  EXPECT_EQ_INT(-1, configure(ci_new("Chain", "entries_negative", 1, size)));
+
+  return 0;
+}
+
+DEF_TEST(memo_rules_max) {
+  char const *plugins[FC_MEMO_RULES_MAX + 2];
+  char names[FC_MEMO_RULES_MAX + 2][DATA_MAX_NAME_LEN];
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(plugins); i++) {
+    snprintf(names[i], sizeof(names[i]), "p%" PRIsz, i);
+    plugins[i] = names[i];
+  }
+
+  test_register();
+  CHECK_ZERO(configure_plugin_rules("rules", "plugin", plugins,
+                                    STATIC_ARRAY_SIZE(plugins)));
+  CHECK_ZERO(fc_init());
+
+  fc_chain_t *chain = fc_chain_get_by_name("rules");
+  CHECK_NOT_NULL(chain);
+  EXPECT_EQ_INT(FC_MEMO_RULES_MAX, chain->memo_rules_num);
+
+  /* Rules beyond FC_MEMO_RULES_MAX run their matches for every value list. */
+  for (int round = 0; round < 2; round++) {
+    for (size_t i = 0; i < STATIC_ARRAY_SIZE(plugins); i++) {
+      char want[DATA_MAX_NAME_LEN + 1];
+      snprintf(want, sizeof(want), "%s,", plugins[i]);
+      EXPECT_EQ_STR(want, process("rules", plugins[i], "", 0.0));
+    }
+  }
+
+  plugin_match_calls = 0;
+  process("rules", plugins[0], "", 0.0);
+  EXPECT_EQ_INT(2, plugin_match_calls);
+
+  return 0;
+}
+
+DEF_TEST(jump) {
+  test_register();
+
+  /* The chains are jumped to before they are configured. */
+  CHECK_ZERO(configure(ci_new(
+      "Chain", "jump_start", 3,
+      ci_new("Rule", NULL, 2, ci_proc("Match", "plugin", "cpu"),
+             ci_new("Target", "jump", 1, ci_new("Chain", "jump_cpu", 0))),
+      ci_new("Rule", NULL, 2, ci_proc("Match", "plugin", "disk"),
+             ci_new("Target", "jump", 1, ci_new("Chain", "jump_none", 0))),
+      ci_proc("Target", "mark", "start"))));
+  char const *cpu[] = {"cpu"};
+  CHECK_ZERO(configure_plugin_rules("jump_cpu", "plugin", cpu, 1));
+  CHECK_ZERO(fc_init());
+
+  for (int round = 0; round < 2; round++) {
+    EXPECT_EQ_STR("cpu,start,", process("jump_start", "cpu", "", 0.0));
+    /* Jumps to unknown chains fail, and the chain goes on. */
+    EXPECT_EQ_STR("start,", process("jump_start", "disk", "", 0.0));
+  }
+
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(memo_matches_uncached);
+  RUN_TEST(memo_entries_max);
+  RUN_TEST(memo_entries_config);
+  RUN_TEST(memo_rules_max);
+  RUN_TEST(jump);
+
+  END_TEST;
+}
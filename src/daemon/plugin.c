@@ -36,6 +36,10 @@
 #include "utils/avltree/avltree.h"
 #include "utils/common/common.h"
 #include "utils/heap/heap.h"
+#include "utils/latency/latency.h"
+#include "utils/slab/slab.h"
+#include "utils/squeue/squeue.h"
+#include "utils/timer_wheel/timer_wheel.h"
 #include "utils_cache.h"
 #include "utils_complain.h"
 #include "utils_llist.h"
@@ -66,6 +70,16 @@ struct callback_func_s {
 };
 typedef struct callback_func_s callback_func_t;
 
+/* A latency histogram of the daemon's own work, reported as an internal
+ * statistic. Only updated while `record_statistics' is set. */
+struct stats_latency_s {
+  pthread_mutex_t lock;
+  latency_counter_t *latency;
+};
+typedef struct stats_latency_s stats_latency_t;
+#define STATS_LATENCY_INIT                                                     \
+  { .lock = PTHREAD_MUTEX_INITIALIZER, .latency = NULL }
+
 #define RF_SIMPLE 0
 #define RF_COMPLEX 1
 #define RF_REMOVE 65535
@@ -82,9 +96,48 @@ struct read_func_s {
   cdtime_t rf_interval;
   cdtime_t rf_effective_interval;
   cdtime_t rf_next_read;
+  /* Used if the read threads schedule with timer wheels. */
+  timer_wheel_entry_t rf_wheel_entry;
+
+  /* Runtime statistics, reported as internal statistics. */
+  pthread_mutex_t rf_stats_lock;
+  latency_counter_t *rf_latency;
+  cdtime_t rf_last_duration;
+  uint64_t rf_missed;
 };
 typedef struct read_func_s read_func_t;
 
+/* Each read thread has its own heap of read functions. A thread which has
+ * nothing due steals read functions which are due from the heaps of busy
+ * threads, so one slow read function does not delay the others. */
+struct read_thread_s {
+  pthread_t tid;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  /* Protected by `lock'. Depending on the `ReadScheduler' option, either
+   * `heap' or `wheel' holds the read functions. */
+  c_heap_t *heap;
+  timer_wheel_t *wheel;
+  bool busy;
+  bool wakeup;
+};
+typedef struct read_thread_s read_thread_t;
+
+#define WF_SIMPLE 0
+#define WF_BATCH 1
+struct write_func_s {
+/* `write_func_t' "inherits" from `callback_func_t'.
+ * The `wf_super' member MUST be the first one in this structure! */
+#define wf_callback wf_super.cf_callback
+#define wf_udata wf_super.cf_udata
+#define wf_ctx wf_super.cf_ctx
+  callback_func_t wf_super;
+  int wf_type;
+  /* Owned by `write_stats'. */
+  stats_latency_t *wf_stats;
+};
+typedef struct write_func_s write_func_t;
+
 struct cache_event_func_s {
   plugin_cache_event_cb callback;
   char *name;
@@ -93,14 +146,40 @@ struct cache_event_func_s {
 };
 typedef struct cache_event_func_s cache_event_func_t;
 
-struct write_queue_s;
-typedef struct write_queue_s write_queue_t;
+/* Item stored in the write queue. The queue copies this structure into its own
+ * (recycled) nodes, so no allocation is needed per item. */
 struct write_queue_s {
   value_list_t *vl;
   plugin_ctx_t ctx;
-  write_queue_t *next;
+  /* Set for value lists dispatched through a prepared series. These have
+   * already been escaped. */
+  bool prepared;
+  /* Only set while internal statistics are collected. */
+  cdtime_t enqueued;
+};
+typedef struct write_queue_s write_queue_t;
+
+struct plugin_series_s {
+  /* Escaped identifier, interval and meta data; `values' is unused. */
+  value_list_t vl;
+  uint32_t hash;
 };
 
+/* A queued value list and its values in a single allocation, see
+ * plugin_value_list_alloc(). `values_num' is the number of values allocated,
+ * which selects the pool the memory is returned to. */
+typedef struct {
+  value_list_t vl;
+  size_t values_num;
+  value_t values[];
+} queued_value_list_t;
+
+/* Queued value lists with up to this many values are allocated from
+ * per-thread pools, one per number of values. */
+#define VALUE_LIST_POOL_VALUES_MAX 8
+/* Number of free value lists cached per thread and pool. */
+#define VALUE_LIST_POOL_CACHE 32
+
 struct flush_callback_s {
   char *name;
   cdtime_t timeout;
@@ -133,23 +212,31 @@ static char *plugindir;
 #ifndef DEFAULT_MAX_READ_INTERVAL
 #define DEFAULT_MAX_READ_INTERVAL TIME_T_TO_CDTIME_T_STATIC(86400)
 #endif
+/* Upper bound for the time an idle read thread sleeps before it looks for
+ * read functions to steal again. */
+#define READ_STEAL_INTERVAL TIME_T_TO_CDTIME_T_STATIC(1)
+/* Holds the read functions while no read threads are running. */
 static c_heap_t *read_heap;
 static llist_t *read_list;
 static int read_loop = 1;
 static pthread_mutex_t read_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t read_cond = PTHREAD_COND_INITIALIZER;
-static pthread_t *read_threads;
+static read_thread_t *read_threads;
+#define READ_THREADS_CPUS_MAX 1024
 static size_t read_threads_num;
+static size_t read_threads_next;
+static bool read_threads_use_wheel;
+static bool read_align;
 static cdtime_t max_read_interval = DEFAULT_MAX_READ_INTERVAL;
 
-static write_queue_t *write_queue_head;
-static write_queue_t *write_queue_tail;
-static long write_queue_length;
+/* The write queue has one shard per write thread. Value lists are assigned to
+ * a shard by hashing their identifier, so all values of one series are handled
+ * by the same write thread, in order. */
+static squeue_t *write_queue;
+static slab_t *value_list_pools[VALUE_LIST_POOL_VALUES_MAX];
 static bool write_loop = true;
-static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t write_cond = PTHREAD_COND_INITIALIZER;
 static pthread_t *write_threads;
 static size_t write_threads_num;
+static size_t write_batch_size;
 
 static pthread_key_t plugin_ctx_key;
 static bool plugin_ctx_key_initialized;
@@ -160,11 +247,20 @@ static long write_limit_low;
 static pthread_mutex_t statistics_lock = PTHREAD_MUTEX_INITIALIZER;
 static derive_t stats_values_dropped;
 static bool record_statistics;
+/* Histograms of write callbacks by name, protected by `statistics_lock'. They
+ * outlive the write callbacks, so that write threads never see them freed. */
+static c_avl_tree_t *write_stats;
+static stats_latency_t stats_queue_residency = STATS_LATENCY_INIT;
+static stats_latency_t stats_filter_chain = STATS_LATENCY_INIT;
+static stats_latency_t stats_cache_update = STATS_LATENCY_INIT;
 
 /*
  * Static functions
  */
-static int plugin_dispatch_values_internal(value_list_t *vl);
+static int plugin_dispatch_values_internal(value_list_t *vl, bool prepared,
+                                           write_batch_entry_t *batch_entry,
+                                           gauge_t *rates);
+static int plugin_compare_read_func(const void *arg0, const void *arg1);
 
 static const char *plugin_get_dir(void) {
   if (plugindir == NULL)
@@ -173,8 +269,199 @@ static const char *plugin_get_dir(void) {
     return plugindir;
 }
 
-static int plugin_update_internal_statistics(void) { /* {{{ */
-  gauge_t copy_write_queue_length = (gauge_t)write_queue_length;
+static long plugin_write_queue_length(void) /* {{{ */
+{
+  if (write_queue == NULL)
+    return 0;
+
+  return squeue_length(write_queue);
+} /* }}} long plugin_write_queue_length */
+
+static void stats_latency_add(stats_latency_t *s, cdtime_t latency) /* {{{ */
+{
+  pthread_mutex_lock(&s->lock);
+  if (s->latency == NULL)
+    s->latency = latency_counter_create();
+  if (s->latency != NULL)
+    latency_counter_add(s->latency, latency);
+  pthread_mutex_unlock(&s->lock);
+} /* }}} void stats_latency_add */
+
+static void stats_latency_destroy(stats_latency_t *s) /* {{{ */
+{
+  pthread_mutex_lock(&s->lock);
+  latency_counter_destroy(s->latency);
+  s->latency = NULL;
+  pthread_mutex_unlock(&s->lock);
+} /* }}} void stats_latency_destroy */
+
+/* The percentiles and the maximum of a latency histogram. */
+typedef struct {
+  cdtime_t p50;
+  cdtime_t p99;
+  cdtime_t max;
+} stats_latency_summary_t;
+
+static stats_latency_summary_t
+latency_summarize(latency_counter_t *lc, bool reset) /* {{{ */
+{
+  stats_latency_summary_t summary = {0};
+
+  if ((lc == NULL) || (latency_counter_get_num(lc) == 0))
+    return summary;
+
+  summary.p50 = latency_counter_get_percentile(lc, 50.0);
+  summary.p99 = latency_counter_get_percentile(lc, 99.0);
+  summary.max = latency_counter_get_max(lc);
+  /* Percentiles are reported at the end of their histogram bucket, which may
+   * lie beyond the largest sample. */
+  if (summary.p50 > summary.max)
+    summary.p50 = summary.max;
+  if (summary.p99 > summary.max)
+    summary.p99 = summary.max;
+  if (reset)
+    latency_counter_reset(lc);
+
+  return summary;
+} /* }}} stats_latency_summary_t latency_summarize */
+
+static stats_latency_summary_t stats_latency_summarize(stats_latency_t *s,
+                                                       bool reset) /* {{{ */
+{
+  pthread_mutex_lock(&s->lock);
+  stats_latency_summary_t summary = latency_summarize(s->latency, reset);
+  pthread_mutex_unlock(&s->lock);
+
+  return summary;
+} /* }}} stats_latency_summary_t stats_latency_summarize */
+
+static void stats_emit(plugin_stats_cb emit, void *user_data, /* {{{ */
+                       value_list_t *vl, char const *type,
+                       char const *type_instance, value_t value) {
+  vl->values = &value;
+  vl->values_len = 1;
+  sstrncpy(vl->type, type, sizeof(vl->type));
+  sstrncpy(vl->type_instance, type_instance, sizeof(vl->type_instance));
+  (*emit)(vl, user_data);
+} /* }}} void stats_emit */
+
+/* Emits "duration-p50", "duration-p99" and "duration-max" in seconds. Without
+ * any samples, the values are NAN. */
+static void stats_emit_latency(plugin_stats_cb emit, void *user_data, /* {{{ */
+                               value_list_t *vl,
+                               stats_latency_summary_t const *summary) {
+  bool empty = (summary->max == 0);
+  gauge_t p50 = empty ? NAN : CDTIME_T_TO_DOUBLE(summary->p50);
+  gauge_t p99 = empty ? NAN : CDTIME_T_TO_DOUBLE(summary->p99);
+  gauge_t max = empty ? NAN : CDTIME_T_TO_DOUBLE(summary->max);
+
+  stats_emit(emit, user_data, vl, "duration", "p50", (value_t){.gauge = p50});
+  stats_emit(emit, user_data, vl, "duration", "p99", (value_t){.gauge = p99});
+  stats_emit(emit, user_data, vl, "duration", "max", (value_t){.gauge = max});
+} /* }}} void stats_emit_latency */
+
+/* Emits the runtime statistics of all read functions. */
+static void plugin_read_func_statistics(plugin_stats_cb emit, /* {{{ */
+                                        void *user_data, value_list_t *vl,
+                                        bool reset) {
+  typedef struct {
+    char name[DATA_MAX_NAME_LEN];
+    cdtime_t last_duration;
+    stats_latency_summary_t latency;
+    uint64_t missed;
+  } read_func_stats_t;
+
+  pthread_mutex_lock(&read_lock);
+  int stats_num = (read_list != NULL) ? llist_size(read_list) : 0;
+  read_func_stats_t *stats =
+      (stats_num > 0) ? calloc((size_t)stats_num, sizeof(*stats)) : NULL;
+  if (stats == NULL) {
+    pthread_mutex_unlock(&read_lock);
+    return;
+  }
+
+  size_t i = 0;
+  for (llentry_t *le = llist_head(read_list);
+       (le != NULL) && (i < (size_t)stats_num); le = le->next, i++) {
+    read_func_t *rf = le->value;
+
+    sstrncpy(stats[i].name, rf->rf_name, sizeof(stats[i].name));
+
+    pthread_mutex_lock(&rf->rf_stats_lock);
+    stats[i].last_duration = rf->rf_last_duration;
+    stats[i].missed = rf->rf_missed;
+    stats[i].latency = latency_summarize(rf->rf_latency, reset);
+    pthread_mutex_unlock(&rf->rf_stats_lock);
+  }
+  pthread_mutex_unlock(&read_lock);
+
+  for (size_t j = 0; j < i; j++) {
+    snprintf(vl->plugin_instance, sizeof(vl->plugin_instance), "read-%s",
+             stats[j].name);
+
+    /* Read functions : Duration of the last call */
+    stats_emit(
+        emit, user_data, vl, "duration", "last",
+        (value_t){.gauge = CDTIME_T_TO_DOUBLE(stats[j].last_duration)});
+
+    /* Read functions : Duration histogram */
+    stats_emit_latency(emit, user_data, vl, &stats[j].latency);
+
+    /* Read functions : Deadlines missed */
+    stats_emit(emit, user_data, vl, "derive", "missed_deadlines",
+               (value_t){.derive = (derive_t)stats[j].missed});
+  }
+
+  sfree(stats);
+} /* }}} void plugin_read_func_statistics */
+
+/* Emits the runtime statistics of all write functions. */
+static void plugin_write_func_statistics(plugin_stats_cb emit, /* {{{ */
+                                         void *user_data, value_list_t *vl,
+                                         bool reset) {
+  typedef struct {
+    char name[DATA_MAX_NAME_LEN];
+    stats_latency_summary_t latency;
+  } write_func_stats_t;
+
+  pthread_mutex_lock(&statistics_lock);
+  int stats_num = (write_stats != NULL) ? c_avl_size(write_stats) : 0;
+  write_func_stats_t *stats =
+      (stats_num > 0) ? calloc((size_t)stats_num, sizeof(*stats)) : NULL;
+  if (stats == NULL) {
+    pthread_mutex_unlock(&statistics_lock);
+    return;
+  }
+
+  c_avl_iterator_t *iter = c_avl_get_iterator(write_stats);
+  char *name;
+  stats_latency_t *s;
+  size_t i = 0;
+  while ((i < (size_t)stats_num) &&
+         (c_avl_iterator_next(iter, (void *)&name, (void *)&s) == 0)) {
+    sstrncpy(stats[i].name, name, sizeof(stats[i].name));
+    stats[i].latency = stats_latency_summarize(s, reset);
+    i++;
+  }
+  c_avl_iterator_destroy(iter);
+  pthread_mutex_unlock(&statistics_lock);
+
+  for (size_t j = 0; j < i; j++) {
+    snprintf(vl->plugin_instance, sizeof(vl->plugin_instance), "write-%s",
+             stats[j].name);
+
+    /* Write functions : Duration histogram */
+    stats_emit_latency(emit, user_data, vl, &stats[j].latency);
+  }
+
+  sfree(stats);
+} /* }}} void plugin_write_func_statistics */
+
+/* Emits all internal statistics. If `reset' is true, the latency histograms
+ * are reset afterwards, so that each report covers one interval. */
+static void plugin_stats_collect(plugin_stats_cb emit, /* {{{ */
+                                 void *user_data, bool reset) {
+  gauge_t copy_write_queue_length = (gauge_t)plugin_write_queue_length();
 
   /* Initialize `vl' */
   value_list_t vl = VALUE_LIST_INIT;
@@ -185,29 +472,97 @@ static int plugin_update_internal_statistics(void) { /* {{{ */
   sstrncpy(vl.plugin_instance, "write_queue", sizeof(vl.plugin_instance));
 
   /* Write queue : queue length */
-  vl.values = &(value_t){.gauge = copy_write_queue_length};
-  vl.values_len = 1;
-  sstrncpy(vl.type, "queue_length", sizeof(vl.type));
-  vl.type_instance[0] = 0;
-  plugin_dispatch_values(&vl);
+  stats_emit(emit, user_data, &vl, "queue_length", "",
+             (value_t){.gauge = copy_write_queue_length});
 
   /* Write queue : Values dropped (queue length > low limit) */
-  vl.values = &(value_t){.gauge = (gauge_t)stats_values_dropped};
-  vl.values_len = 1;
-  sstrncpy(vl.type, "derive", sizeof(vl.type));
-  sstrncpy(vl.type_instance, "dropped", sizeof(vl.type_instance));
-  plugin_dispatch_values(&vl);
+  stats_emit(emit, user_data, &vl, "derive", "dropped",
+             (value_t){.derive = stats_values_dropped});
+
+  /* Write queue : Nodes recycled / allocated */
+  uint64_t nodes_recycled = 0;
+  uint64_t nodes_allocated = 0;
+  if (write_queue != NULL)
+    squeue_stats(write_queue, &nodes_recycled, &nodes_allocated);
+
+  stats_emit(emit, user_data, &vl, "derive", "nodes_recycled",
+             (value_t){.derive = (derive_t)nodes_recycled});
+  stats_emit(emit, user_data, &vl, "derive", "nodes_allocated",
+             (value_t){.derive = (derive_t)nodes_allocated});
+
+  /* Write queue : Time value lists spent in the queue */
+  stats_latency_summary_t latency =
+      stats_latency_summarize(&stats_queue_residency, reset);
+  stats_emit_latency(emit, user_data, &vl, &latency);
+
+  /* Value list pools */
+  sstrncpy(vl.plugin_instance, "value_list_pool", sizeof(vl.plugin_instance));
+
+  uint64_t pool_hits = 0;
+  uint64_t pool_misses = 0;
+  for (size_t i = 0; i < VALUE_LIST_POOL_VALUES_MAX; i++) {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    if (value_list_pools[i] == NULL)
+      continue;
+
+    slab_stats(value_list_pools[i], &hits, &misses);
+    pool_hits += hits;
+    pool_misses += misses;
+  }
+
+  /* Value list pools : Allocations served from a pool */
+  stats_emit(emit, user_data, &vl, "derive", "hits",
+             (value_t){.derive = (derive_t)pool_hits});
+
+  /* Value list pools : Allocations which had to call malloc(3) */
+  stats_emit(emit, user_data, &vl, "derive", "misses",
+             (value_t){.derive = (derive_t)pool_misses});
 
   /* Cache */
   sstrncpy(vl.plugin_instance, "cache", sizeof(vl.plugin_instance));
 
   /* Cache : Nb entry in cache tree */
-  vl.values = &(value_t){.gauge = (gauge_t)uc_get_size()};
-  vl.values_len = 1;
-  sstrncpy(vl.type, "cache_size", sizeof(vl.type));
-  vl.type_instance[0] = 0;
-  plugin_dispatch_values(&vl);
+  size_t cache_size = uc_get_size();
+  stats_emit(emit, user_data, &vl, "cache_size", "",
+             (value_t){.gauge = (gauge_t)cache_size});
+
+  /* Cache : Bytes allocated per entry */
+  gauge_t cache_memory = NAN;
+  if (cache_size > 0)
+    cache_memory = (gauge_t)uc_get_memory() / (gauge_t)cache_size;
+  stats_emit(emit, user_data, &vl, "bytes", "per_series",
+             (value_t){.gauge = cache_memory});
+
+  /* Cache : Time spent updating the cache */
+  latency = stats_latency_summarize(&stats_cache_update, reset);
+  stats_emit_latency(emit, user_data, &vl, &latency);
+
+  /* Filter chains : Time spent in the pre- and post-cache chains */
+  sstrncpy(vl.plugin_instance, "filter_chain", sizeof(vl.plugin_instance));
+  latency = stats_latency_summarize(&stats_filter_chain, reset);
+  stats_emit_latency(emit, user_data, &vl, &latency);
+
+  uint64_t memo_hits = 0, memo_misses = 0;
+  fc_stats(&memo_hits, &memo_misses);
+  stats_emit(emit, user_data, &vl, "derive", "cache_hits",
+             (value_t){.derive = (derive_t)memo_hits});
+  stats_emit(emit, user_data, &vl, "derive", "cache_misses",
+             (value_t){.derive = (derive_t)memo_misses});
+
+  plugin_read_func_statistics(emit, user_data, &vl, reset);
+  plugin_write_func_statistics(emit, user_data, &vl, reset);
+} /* }}} void plugin_stats_collect */
+
+static void plugin_stats_dispatch(value_list_t const *vl, /* {{{ */
+                                  __attribute__((unused)) void *user_data) {
+  plugin_dispatch_values(vl);
+} /* }}} void plugin_stats_dispatch */
 
+static int plugin_update_internal_statistics(void) { /* {{{ */
+  plugin_stats_collect(plugin_stats_dispatch, /* user_data = */ NULL,
+                       /* reset = */ true);
   return 0;
 } /* }}} int plugin_update_internal_statistics */
 
@@ -229,6 +584,17 @@ static void destroy_callback(callback_func_t *cf) /* {{{ */
   sfree(cf);
 } /* }}} void destroy_callback */
 
+static void read_func_destroy(read_func_t *rf) /* {{{ */
+{
+  if (rf == NULL)
+    return;
+
+  sfree(rf->rf_name);
+  latency_counter_destroy(rf->rf_latency);
+  pthread_mutex_destroy(&rf->rf_stats_lock);
+  destroy_callback((callback_func_t *)rf);
+} /* }}} void read_func_destroy */
+
 static void destroy_all_callbacks(llist_t **list) /* {{{ */
 {
   llentry_t *le;
@@ -264,8 +630,7 @@ static void destroy_read_heap(void) /* {{{ */
     rf = c_heap_get_root(read_heap);
     if (rf == NULL)
       break;
-    sfree(rf->rf_name);
-    destroy_callback((callback_func_t *)rf);
+    read_func_destroy(rf);
   }
 
   c_heap_destroy(read_heap);
@@ -447,156 +812,307 @@ static int plugin_load_file(char const *file, bool global) {
   return 0;
 }
 
-static void *plugin_read_thread(void __attribute__((unused)) * args) {
-  while (read_loop != 0) {
-    read_func_t *rf;
-    plugin_ctx_t old_ctx;
-    cdtime_t start;
-    cdtime_t now;
-    cdtime_t elapsed;
-    int status;
-    int rf_type;
-    int rc;
-
-    /* Get the read function that needs to be read next.
-     * We don't need to hold "read_lock" for the heap, but we need
-     * to call c_heap_get_root() and pthread_cond_wait() in the
-     * same protected block. */
-    pthread_mutex_lock(&read_lock);
-    rf = c_heap_get_root(read_heap);
-    if (rf == NULL) {
-      pthread_cond_wait(&read_cond, &read_lock);
-      pthread_mutex_unlock(&read_lock);
-      continue;
-    }
-    pthread_mutex_unlock(&read_lock);
+/* Returns the first multiple of `interval' at or after `t'. */
+static cdtime_t read_align_time(cdtime_t t, cdtime_t interval) /* {{{ */
+{
+  if (interval == 0)
+    return t;
 
-    if (rf->rf_interval == 0) {
-      /* this should not happen, because the interval is set
-       * for each plugin when loading it
-       * XXX: issue a warning? */
-      rf->rf_interval = plugin_get_interval();
-      rf->rf_effective_interval = rf->rf_interval;
+  return ((t + interval - 1) / interval) * interval;
+} /* }}} cdtime_t read_align_time */
 
-      rf->rf_next_read = cdtime();
-    }
+/* NOTE: You must hold the lock of `t' when calling the read_queue_*_nolock
+ * functions, once the read threads are running. */
+static int read_queue_insert_nolock(read_thread_t *t,
+                                    read_func_t *rf) /* {{{ */
+{
+  if (t->wheel != NULL) {
+    rf->rf_wheel_entry.due = rf->rf_next_read;
+    rf->rf_wheel_entry.data = rf;
+    return timer_wheel_insert(t->wheel, &rf->rf_wheel_entry);
+  }
 
-    /* sleep until this entry is due,
-     * using pthread_cond_timedwait */
-    pthread_mutex_lock(&read_lock);
-    /* In pthread_cond_timedwait, spurious wakeups are possible
-     * (and really happen, at least on NetBSD with > 1 CPU), thus
-     * we need to re-evaluate the condition every time
-     * pthread_cond_timedwait returns. */
-    rc = 0;
-    while ((read_loop != 0) && (cdtime() < rf->rf_next_read) && rc == 0) {
-      rc = pthread_cond_timedwait(&read_cond, &read_lock,
-                                  &CDTIME_T_TO_TIMESPEC(rf->rf_next_read));
-    }
+  return c_heap_insert(t->heap, rf);
+} /* }}} int read_queue_insert_nolock */
 
-    /* Must hold `read_lock' when accessing `rf->rf_type'. */
-    rf_type = rf->rf_type;
-    pthread_mutex_unlock(&read_lock);
+/* Removes and returns a read function which is due at `now'. */
+static read_func_t *read_queue_take_nolock(read_thread_t *t,
+                                           cdtime_t now) /* {{{ */
+{
+  if (t->wheel != NULL)
+    return timer_wheel_get(t->wheel, now);
 
-    /* Check if we're supposed to stop.. This may have interrupted
-     * the sleep, too. */
-    if (read_loop == 0) {
-      /* Insert `rf' again, so it can be free'd correctly */
-      c_heap_insert(read_heap, rf);
-      break;
+  read_func_t *rf = c_heap_peek_root(t->heap);
+  if ((rf == NULL) || (rf->rf_next_read > now))
+    return NULL;
+
+  return c_heap_get_root(t->heap);
+} /* }}} read_func_t *read_queue_take_nolock */
+
+/* Returns the time at which the next read function is due, or zero if there
+ * are none. */
+static cdtime_t read_queue_next_nolock(read_thread_t *t) /* {{{ */
+{
+  if (t->wheel != NULL) {
+    cdtime_t next = 0;
+    if (timer_wheel_next(t->wheel, &next) != 0)
+      return 0;
+    return next;
+  }
+
+  read_func_t *rf = c_heap_peek_root(t->heap);
+  return (rf != NULL) ? rf->rf_next_read : 0;
+} /* }}} cdtime_t read_queue_next_nolock */
+
+/* Wakes up one idle read thread, so that it can steal read functions from
+ * `self'. */
+static void read_thread_notify_idle(read_thread_t *self) /* {{{ */
+{
+  for (size_t i = 1; i < read_threads_num; i++) {
+    size_t index = ((size_t)(self - read_threads) + i) % read_threads_num;
+    read_thread_t *t = read_threads + index;
+
+    pthread_mutex_lock(&t->lock);
+    bool idle = !t->busy;
+    if (idle) {
+      t->wakeup = true;
+      pthread_cond_signal(&t->cond);
     }
+    pthread_mutex_unlock(&t->lock);
 
-    /* The entry has been marked for deletion. The linked list
-     * entry has already been removed by `plugin_unregister_read'.
-     * All we have to do here is free the `read_func_t' and
-     * continue. */
-    if (rf_type == RF_REMOVE) {
-      DEBUG("plugin_read_thread: Destroying the `%s' "
-            "callback.",
-            rf->rf_name);
-      sfree(rf->rf_name);
-      destroy_callback((callback_func_t *)rf);
-      rf = NULL;
-      continue;
+    if (idle)
+      return;
+  }
+} /* }}} void read_thread_notify_idle */
+
+/* Takes a read function which is due from the queue of a busy read thread.
+ * Otherwise, `ret_next' is set to the earliest time at which a read function
+ * of a busy thread becomes due, or left alone if there is none. */
+static read_func_t *read_thread_steal(read_thread_t *self, cdtime_t now,
+                                      cdtime_t *ret_next) /* {{{ */
+{
+  for (size_t i = 1; i < read_threads_num; i++) {
+    size_t index = ((size_t)(self - read_threads) + i) % read_threads_num;
+    read_thread_t *t = read_threads + index;
+    read_func_t *rf = NULL;
+
+    pthread_mutex_lock(&t->lock);
+    if (t->busy) {
+      rf = read_queue_take_nolock(t, now);
+      if (rf == NULL) {
+        cdtime_t next = read_queue_next_nolock(t);
+        if ((next != 0) && (next < *ret_next))
+          *ret_next = next;
+      }
     }
+    pthread_mutex_unlock(&t->lock);
 
-    DEBUG("plugin_read_thread: Handling `%s'.", rf->rf_name);
+    if (rf != NULL)
+      return rf;
+  }
 
-    start = cdtime();
+  return NULL;
+} /* }}} read_func_t *read_thread_steal */
 
-    old_ctx = plugin_set_ctx(rf->rf_ctx);
+/* Calls the read function `rf' and inserts it into the heap of `self'
+ * afterwards. */
+static void read_thread_run(read_thread_t *self, read_func_t *rf) /* {{{ */
+{
+  plugin_ctx_t old_ctx;
+  cdtime_t start;
+  cdtime_t now;
+  cdtime_t elapsed;
+  int status;
+  int rf_type;
 
-    if (rf_type == RF_SIMPLE) {
-      int (*callback)(void);
+  if (rf->rf_interval == 0) {
+    /* this should not happen, because the interval is set
+     * for each plugin when loading it
+     * XXX: issue a warning? */
+    rf->rf_interval = plugin_get_interval();
+    rf->rf_effective_interval = rf->rf_interval;
 
-      callback = rf->rf_callback;
-      status = (*callback)();
-    } else {
-      plugin_read_cb callback;
+    rf->rf_next_read = cdtime();
+  }
 
-      assert(rf_type == RF_COMPLEX);
+  /* Must hold `read_lock' when accessing `rf->rf_type'. */
+  pthread_mutex_lock(&read_lock);
+  rf_type = rf->rf_type;
+  pthread_mutex_unlock(&read_lock);
 
-      callback = rf->rf_callback;
-      status = (*callback)(&rf->rf_udata);
-    }
+  /* The entry has been marked for deletion. The linked list
+   * entry has already been removed by `plugin_unregister_read'.
+   * All we have to do here is free the `read_func_t' and
+   * continue. */
+  if (rf_type == RF_REMOVE) {
+    DEBUG("plugin_read_thread: Destroying the `%s' "
+          "callback.",
+          rf->rf_name);
+    read_func_destroy(rf);
+    return;
+  }
 
-    plugin_set_ctx(old_ctx);
+  DEBUG("plugin_read_thread: Handling `%s'.", rf->rf_name);
 
-    /* If the function signals failure, we will increase the
-     * intervals in which it will be called. */
-    if (status != 0) {
-      rf->rf_effective_interval *= 2;
-      if (rf->rf_effective_interval > max_read_interval)
-        rf->rf_effective_interval = max_read_interval;
+  start = cdtime();
 
-      NOTICE("read-function of plugin `%s' failed. "
-             "Will suspend it for %.3f seconds.",
-             rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_effective_interval));
-    } else {
-      /* Success: Restore the interval, if it was changed. */
-      rf->rf_effective_interval = rf->rf_interval;
-    }
+  old_ctx = plugin_set_ctx(rf->rf_ctx);
 
-    /* update the ``next read due'' field */
-    now = cdtime();
+  if (rf_type == RF_SIMPLE) {
+    int (*callback)(void);
+
+    callback = rf->rf_callback;
+    status = (*callback)();
+  } else {
+    plugin_read_cb callback;
+
+    assert(rf_type == RF_COMPLEX);
+
+    callback = rf->rf_callback;
+    status = (*callback)(&rf->rf_udata);
+  }
+
+  plugin_set_ctx(old_ctx);
+
+  /* If the function signals failure, we will increase the
+   * intervals in which it will be called. */
+  if (status != 0) {
+    rf->rf_effective_interval *= 2;
+    if (rf->rf_effective_interval > max_read_interval)
+      rf->rf_effective_interval = max_read_interval;
+
+    NOTICE("read-function of plugin `%s' failed. "
+           "Will suspend it for %.3f seconds.",
+           rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_effective_interval));
+  } else {
+    /* Success: Restore the interval, if it was changed. */
+    rf->rf_effective_interval = rf->rf_interval;
+  }
+
+  /* update the ``next read due'' field */
+  now = cdtime();
+
+  /* calculate the time spent in the read function */
+  elapsed = (now - start);
 
-    /* calculate the time spent in the read function */
-    elapsed = (now - start);
-
-    if (elapsed > rf->rf_effective_interval)
-      WARNING(
-          "plugin_read_thread: read-function of the `%s' plugin took %.3f "
-          "seconds, which is above its read interval (%.3f seconds). You might "
-          "want to adjust the `Interval' or `ReadThreads' settings.",
-          rf->rf_name, CDTIME_T_TO_DOUBLE(elapsed),
-          CDTIME_T_TO_DOUBLE(rf->rf_effective_interval));
-
-    DEBUG("plugin_read_thread: read-function of the `%s' plugin took "
-          "%.6f seconds.",
-          rf->rf_name, CDTIME_T_TO_DOUBLE(elapsed));
-
-    DEBUG("plugin_read_thread: Effective interval of the "
-          "`%s' plugin is %.3f seconds.",
-          rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_effective_interval));
-
-    /* Calculate the next (absolute) time at which this function
-     * should be called. */
-    rf->rf_next_read += rf->rf_effective_interval;
-
-    /* Check, if `rf_next_read' is in the past. */
-    if (rf->rf_next_read < now) {
-      /* `rf_next_read' is in the past. Insert `now'
-       * so this value doesn't trail off into the
-       * past too much. */
-      rf->rf_next_read = now;
+  if (elapsed > rf->rf_effective_interval)
+    WARNING(
+        "plugin_read_thread: read-function of the `%s' plugin took %.3f "
+        "seconds, which is above its read interval (%.3f seconds). You might "
+        "want to adjust the `Interval' or `ReadThreads' settings.",
+        rf->rf_name, CDTIME_T_TO_DOUBLE(elapsed),
+        CDTIME_T_TO_DOUBLE(rf->rf_effective_interval));
+
+  DEBUG("plugin_read_thread: read-function of the `%s' plugin took "
+        "%.6f seconds.",
+        rf->rf_name, CDTIME_T_TO_DOUBLE(elapsed));
+
+  DEBUG("plugin_read_thread: Effective interval of the "
+        "`%s' plugin is %.3f seconds.",
+        rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_effective_interval));
+
+  /* Calculate the next (absolute) time at which this function
+   * should be called. */
+  rf->rf_next_read += rf->rf_effective_interval;
+
+  /* Check, if `rf_next_read' is in the past. */
+  bool missed = false;
+  if (rf->rf_next_read < now) {
+    /* `rf_next_read' is in the past. Insert `now'
+     * so this value doesn't trail off into the
+     * past too much. */
+    rf->rf_next_read = now;
+    if (read_align)
+      rf->rf_next_read = read_align_time(now, rf->rf_effective_interval);
+    missed = true;
+  }
+
+  pthread_mutex_lock(&rf->rf_stats_lock);
+  if (record_statistics && (rf->rf_latency == NULL))
+    rf->rf_latency = latency_counter_create();
+  if (rf->rf_latency != NULL)
+    latency_counter_add(rf->rf_latency, elapsed);
+  rf->rf_last_duration = elapsed;
+  if (missed)
+    rf->rf_missed++;
+  pthread_mutex_unlock(&rf->rf_stats_lock);
+
+  DEBUG("plugin_read_thread: Next read of the `%s' plugin at %.3f.",
+        rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_next_read));
+
+  /* Re-insert this read function into the queue again. */
+  pthread_mutex_lock(&self->lock);
+  read_queue_insert_nolock(self, rf);
+  pthread_mutex_unlock(&self->lock);
+} /* }}} void read_thread_run */
+
+static void *plugin_read_thread(void *args) {
+  read_thread_t *self = args;
+
+  pthread_mutex_lock(&self->lock);
+  while (read_loop != 0) {
+    cdtime_t now = cdtime();
+    self->wakeup = false;
+
+    read_func_t *rf = read_queue_take_nolock(self, now);
+    if (rf != NULL) {
+      self->busy = true;
+
+      /* If the next read function becomes due before this one is expected to
+       * return, let an idle thread take care of it. */
+      cdtime_t next_read = read_queue_next_nolock(self);
+      pthread_mutex_unlock(&self->lock);
+
+      if (next_read != 0) {
+        pthread_mutex_lock(&rf->rf_stats_lock);
+        cdtime_t expected_end = now + rf->rf_last_duration;
+        pthread_mutex_unlock(&rf->rf_stats_lock);
+
+        if (next_read <= expected_end)
+          read_thread_notify_idle(self);
+      }
+
+      read_thread_run(self, rf);
+
+      pthread_mutex_lock(&self->lock);
+      self->busy = false;
+      continue;
     }
 
-    DEBUG("plugin_read_thread: Next read of the `%s' plugin at %.3f.",
-          rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_next_read));
+    cdtime_t wait_until = now + READ_STEAL_INTERVAL;
+    cdtime_t next_read = read_queue_next_nolock(self);
+    if ((next_read != 0) && (next_read < wait_until))
+      wait_until = next_read;
+    pthread_mutex_unlock(&self->lock);
+
+    /* Nothing is due in our own queue: help out busy threads. */
+    read_func_t *stolen = read_thread_steal(self, now, &wait_until);
+
+    pthread_mutex_lock(&self->lock);
+    if (stolen != NULL) {
+      self->busy = true;
+      pthread_mutex_unlock(&self->lock);
+
+      /* The stolen read function stays with this thread. */
+      read_thread_run(self, stolen);
 
-    /* Re-insert this read function into the heap again. */
-    c_heap_insert(read_heap, rf);
+      pthread_mutex_lock(&self->lock);
+      self->busy = false;
+      continue;
+    }
+
+    /* In pthread_cond_timedwait, spurious wakeups are possible
+     * (and really happen, at least on NetBSD with > 1 CPU), thus
+     * we need to re-evaluate the condition every time
+     * pthread_cond_timedwait returns. */
+    int rc = 0;
+    while ((read_loop != 0) && !self->wakeup && (cdtime() < wait_until) &&
+           (rc == 0)) {
+      rc = pthread_cond_timedwait(&self->cond, &self->lock,
+                                  &CDTIME_T_TO_TIMESPEC(wait_until));
+    }
   } /* while (read_loop) */
+  pthread_mutex_unlock(&self->lock);
 
   pthread_exit(NULL);
   return (void *)0;
@@ -630,36 +1146,165 @@ static void set_thread_name(pthread_t tid, char const *name) {
 #endif
 }
 
+/* Parses a list of CPUs such as "0-3,8" into `cpus'. Returns the number of
+ * CPUs or -1 if the list is invalid. */
+static int parse_cpu_list(char const *list, int *cpus,
+                          size_t cpus_size) /* {{{ */
+{
+  size_t cpus_num = 0;
+  char const *ptr = list;
+
+  while (*ptr != 0) {
+    char *endptr = NULL;
+    errno = 0;
+    long first = strtol(ptr, &endptr, 10);
+    if ((errno != 0) || (endptr == ptr) || (first < 0))
+      return -1;
+
+    long last = first;
+    ptr = endptr;
+    if (*ptr == '-') {
+      ptr++;
+      errno = 0;
+      last = strtol(ptr, &endptr, 10);
+      if ((errno != 0) || (endptr == ptr) || (last < first))
+        return -1;
+      ptr = endptr;
+    }
+
+    for (long cpu = first; cpu <= last; cpu++) {
+      if ((cpus_num >= cpus_size) || (cpu > INT_MAX))
+        return -1;
+      cpus[cpus_num++] = (int)cpu;
+    }
+
+    while (isspace((int)*ptr))
+      ptr++;
+    if (*ptr == ',')
+      ptr++;
+    else if (*ptr != 0)
+      return -1;
+    while (isspace((int)*ptr))
+      ptr++;
+  }
+
+  return (int)cpus_num;
+} /* }}} int parse_cpu_list */
+
+static void set_thread_affinity(pthread_t tid, int cpu) /* {{{ */
+{
+#if HAVE_PTHREAD_SETAFFINITY_NP
+  if (cpu >= CPU_SETSIZE) {
+    ERROR("plugin: CPU %d is out of range for the read thread affinity.", cpu);
+    return;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  int status = pthread_setaffinity_np(tid, sizeof(set), &set);
+  if (status != 0)
+    ERROR("plugin: Setting the CPU affinity of a read thread to CPU %d "
+          "failed: %s",
+          cpu, STRERROR(status));
+#else
+  (void)tid;
+  (void)cpu;
+#endif
+} /* }}} void set_thread_affinity */
+
 static void start_read_threads(size_t num) /* {{{ */
 {
   if (read_threads != NULL)
     return;
 
+  int cpus[READ_THREADS_CPUS_MAX];
+  int cpus_num = 0;
+  char const *affinity = global_option_get("ReadThreadsAffinity");
+  if ((affinity != NULL) && (affinity[0] != 0)) {
+    cpus_num = parse_cpu_list(affinity, cpus, STATIC_ARRAY_SIZE(cpus));
+    if (cpus_num <= 0) {
+      ERROR("plugin: Invalid ReadThreadsAffinity \"%s\". Read threads will "
+            "not be pinned to CPUs.",
+            affinity);
+      cpus_num = 0;
+    }
+#if !HAVE_PTHREAD_SETAFFINITY_NP
+    if (cpus_num > 0)
+      WARNING("plugin: ReadThreadsAffinity is not supported on this system.");
+    cpus_num = 0;
+#endif
+  }
+
+  pthread_mutex_lock(&read_lock);
+
   read_threads = calloc(num, sizeof(*read_threads));
   if (read_threads == NULL) {
+    pthread_mutex_unlock(&read_lock);
     ERROR("plugin: start_read_threads: calloc failed.");
     return;
   }
 
-  read_threads_num = 0;
   for (size_t i = 0; i < num; i++) {
-    int status = pthread_create(read_threads + read_threads_num,
-                                /* attr = */ NULL, plugin_read_thread,
-                                /* arg = */ NULL);
+    read_thread_t *t = read_threads + i;
+
+    if (read_threads_use_wheel)
+      t->wheel = timer_wheel_create(cdtime());
+    else
+      t->heap = c_heap_create(plugin_compare_read_func);
+    if ((t->heap == NULL) && (t->wheel == NULL)) {
+      while (i-- > 0) {
+        c_heap_destroy(read_threads[i].heap);
+        timer_wheel_destroy(read_threads[i].wheel);
+      }
+      sfree(read_threads);
+      pthread_mutex_unlock(&read_lock);
+      ERROR("plugin: start_read_threads: Creating the read queue failed.");
+      return;
+    }
+    pthread_mutex_init(&t->lock, /* attr = */ NULL);
+    pthread_cond_init(&t->cond, /* attr = */ NULL);
+  }
+
+  /* Distribute the read functions registered so far. */
+  read_threads_num = num;
+  read_threads_next = 0;
+  read_func_t *rf;
+  while ((rf = c_heap_get_root(read_heap)) != NULL) {
+    if (read_align)
+      rf->rf_next_read = read_align_time(rf->rf_next_read, rf->rf_interval);
+    read_queue_insert_nolock(read_threads + (read_threads_next % num), rf);
+    read_threads_next++;
+  }
+
+  for (size_t i = 0; i < num; i++) {
+    read_thread_t *t = read_threads + i;
+
+    int status = pthread_create(&t->tid, /* attr = */ NULL,
+                                plugin_read_thread, /* arg = */ t);
     if (status != 0) {
       ERROR("plugin: start_read_threads: pthread_create failed with status %i "
             "(%s).",
             status, STRERROR(status));
-      return;
+      /* Looking busy forever makes the other threads steal the read functions
+       * assigned to this one. */
+      pthread_mutex_lock(&t->lock);
+      t->busy = true;
+      pthread_mutex_unlock(&t->lock);
+      t->tid = (pthread_t)0;
+      continue;
     }
 
     char name[THREAD_NAME_MAX];
-    ssnprintf(name, sizeof(name), "reader#%" PRIu64,
-              (uint64_t)read_threads_num);
-    set_thread_name(read_threads[read_threads_num], name);
+    ssnprintf(name, sizeof(name), "reader#%" PRIu64, (uint64_t)i);
+    set_thread_name(t->tid, name);
 
-    read_threads_num++;
+    if (cpus_num > 0)
+      set_thread_affinity(t->tid, cpus[i % (size_t)cpus_num]);
   } /* for (i) */
+
+  pthread_mutex_unlock(&read_lock);
 } /* }}} void start_read_threads */
 
 static void stop_read_threads(void) {
@@ -670,28 +1315,92 @@ static void stop_read_threads(void) {
 
   pthread_mutex_lock(&read_lock);
   read_loop = 0;
-  DEBUG("plugin: stop_read_threads: Signalling `read_cond'");
-  pthread_cond_broadcast(&read_cond);
+  DEBUG("plugin: stop_read_threads: Signalling the read threads");
+  for (size_t i = 0; i < read_threads_num; i++) {
+    read_thread_t *t = read_threads + i;
+
+    pthread_mutex_lock(&t->lock);
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+  }
   pthread_mutex_unlock(&read_lock);
 
   for (size_t i = 0; i < read_threads_num; i++) {
-    if (pthread_join(read_threads[i], NULL) != 0) {
+    read_thread_t *t = read_threads + i;
+
+    if ((t->tid != (pthread_t)0) && (pthread_join(t->tid, NULL) != 0)) {
       ERROR("plugin: stop_read_threads: pthread_join failed.");
     }
-    read_threads[i] = (pthread_t)0;
+    t->tid = (pthread_t)0;
+  }
+
+  /* Move the read functions back to `read_heap', so they can be free'd
+   * correctly. */
+  pthread_mutex_lock(&read_lock);
+  for (size_t i = 0; i < read_threads_num; i++) {
+    read_thread_t *t = read_threads + i;
+    read_func_t *rf;
+
+    while ((rf = read_queue_take_nolock(t, (cdtime_t)UINT64_MAX)) != NULL)
+      c_heap_insert(read_heap, rf);
+
+    c_heap_destroy(t->heap);
+    timer_wheel_destroy(t->wheel);
+    pthread_cond_destroy(&t->cond);
+    pthread_mutex_destroy(&t->lock);
   }
   sfree(read_threads);
   read_threads_num = 0;
+  pthread_mutex_unlock(&read_lock);
 } /* void stop_read_threads */
 
+static slab_t *plugin_value_list_pool(size_t values_num) /* {{{ */
+{
+  if ((values_num == 0) || (values_num > VALUE_LIST_POOL_VALUES_MAX))
+    return NULL;
+
+  return value_list_pools[values_num - 1];
+} /* }}} slab_t *plugin_value_list_pool */
+
+/* Allocates a copy of `vl_orig' with the values `values' and without meta
+ * data. The value list is taken from the calling thread's pool if possible and
+ * must be freed with plugin_value_list_free(). */
+static value_list_t *
+plugin_value_list_alloc(value_list_t const *vl_orig, /* {{{ */
+                        value_t const *values) {
+  size_t values_num = vl_orig->values_len;
+  slab_t *pool = plugin_value_list_pool(values_num);
+  queued_value_list_t *qvl;
+
+  if (pool != NULL)
+    qvl = slab_alloc(pool);
+  else
+    qvl = malloc(sizeof(*qvl) + values_num * sizeof(qvl->values[0]));
+  if (qvl == NULL)
+    return NULL;
+
+  qvl->vl = *vl_orig;
+  qvl->vl.values = qvl->values;
+  qvl->vl.meta = NULL;
+  qvl->values_num = values_num;
+  memcpy(qvl->values, values, values_num * sizeof(qvl->values[0]));
+
+  return &qvl->vl;
+} /* }}} value_list_t *plugin_value_list_alloc */
+
 static void plugin_value_list_free(value_list_t *vl) /* {{{ */
 {
   if (vl == NULL)
     return;
 
   meta_data_destroy(vl->meta);
-  sfree(vl->values);
-  sfree(vl);
+
+  queued_value_list_t *qvl = (queued_value_list_t *)vl;
+  slab_t *pool = plugin_value_list_pool(qvl->values_num);
+  if (pool != NULL)
+    slab_free(pool, qvl);
+  else
+    free(qvl);
 } /* }}} void plugin_value_list_free */
 
 static value_list_t *
@@ -702,23 +1411,14 @@ plugin_value_list_clone(value_list_t const *vl_orig) /* {{{ */
   if (vl_orig == NULL)
     return NULL;
 
-  vl = malloc(sizeof(*vl));
+  vl = plugin_value_list_alloc(vl_orig, vl_orig->values);
   if (vl == NULL)
     return NULL;
-  memcpy(vl, vl_orig, sizeof(*vl));
 
   if (vl->host[0] == 0)
     sstrncpy(vl->host, hostname_g, sizeof(vl->host));
 
-  vl->values = calloc(vl_orig->values_len, sizeof(*vl->values));
-  if (vl->values == NULL) {
-    plugin_value_list_free(vl);
-    return NULL;
-  }
-  memcpy(vl->values, vl_orig->values,
-         vl_orig->values_len * sizeof(*vl->values));
-
-  vl->meta = meta_data_clone(vl->meta);
+  vl->meta = meta_data_clone(vl_orig->meta);
   if ((vl_orig->meta != NULL) && (vl->meta == NULL)) {
     plugin_value_list_free(vl);
     return NULL;
@@ -734,92 +1434,200 @@ plugin_value_list_clone(value_list_t const *vl_orig) /* {{{ */
   return vl;
 } /* }}} value_list_t *plugin_value_list_clone */
 
-static int plugin_write_enqueue(value_list_t const *vl) /* {{{ */
+/* FNV-1a hash of the identifier, used to select the write queue shard. */
+static uint32_t plugin_value_list_hash(value_list_t const *vl) /* {{{ */
 {
-  write_queue_t *q;
-
-  q = malloc(sizeof(*q));
-  if (q == NULL)
-    return ENOMEM;
-  q->next = NULL;
-
-  q->vl = plugin_value_list_clone(vl);
-  if (q->vl == NULL) {
-    sfree(q);
-    return ENOMEM;
+  char const *fields[] = {vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance};
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    for (char const *c = fields[i]; *c != 0; c++) {
+      hash ^= (uint8_t)*c;
+      hash *= 16777619u;
+    }
+    /* field separator, so that "a"/"bc" and "ab"/"c" differ */
+    hash ^= (uint8_t)'/';
+    hash *= 16777619u;
   }
 
-  /* Store context of caller (read plugin); otherwise, it would not be
-   * available to the write plugins when actually dispatching the
-   * value-list later on. */
-  q->ctx = plugin_get_ctx();
+  return hash;
+} /* }}} uint32_t plugin_value_list_hash */
 
-  pthread_mutex_lock(&write_lock);
+static int plugin_write_enqueue(value_list_t const *vl) /* {{{ */
+{
+  if (write_queue == NULL)
+    return EAGAIN;
 
-  if (write_queue_tail == NULL) {
-    write_queue_head = q;
-    write_queue_tail = q;
-    write_queue_length = 1;
-  } else {
-    write_queue_tail->next = q;
-    write_queue_tail = q;
-    write_queue_length += 1;
+  if (vl->values == NULL) {
+    ERROR("plugin_dispatch_values: Invalid value list "
+          "from plugin %s.",
+          vl->plugin);
+    return EINVAL;
   }
 
-  pthread_cond_signal(&write_cond);
-  pthread_mutex_unlock(&write_lock);
+  write_queue_t q = {
+      .vl = plugin_value_list_clone(vl),
+      /* Store context of caller (read plugin); otherwise, it would not be
+       * available to the write plugins when actually dispatching the
+       * value-list later on. */
+      .ctx = plugin_get_ctx(),
+      .enqueued = record_statistics ? cdtime() : 0,
+  };
+  if (q.vl == NULL)
+    return ENOMEM;
+
+  int status = squeue_push(write_queue, plugin_value_list_hash(q.vl), &q);
+  if (status != 0) {
+    plugin_value_list_free(q.vl);
+    return status;
+  }
 
   return 0;
 } /* }}} int plugin_write_enqueue */
 
-static value_list_t *plugin_write_dequeue(void) /* {{{ */
-{
-  write_queue_t *q;
-  value_list_t *vl;
+static bool plugin_ctx_equal(plugin_ctx_t const *a, /* {{{ */
+                             plugin_ctx_t const *b) {
+  return (a->name == b->name) && (a->interval == b->interval) &&
+         (a->flush_interval == b->flush_interval) &&
+         (a->flush_timeout == b->flush_timeout);
+} /* }}} bool plugin_ctx_equal */
+
+/* Runs the chains and the cache update for `items' and hands the value lists
+ * that end up at the default "write" target to the write plugins in one
+ * batch, together with the rates of each value list. All items must share the
+ * same plugin context. `rates' is grown to hold the rates of all values of the
+ * items. */
+static void plugin_write_items(write_queue_t *items, size_t items_num, /* {{{ */
+                               write_batch_entry_t *entries, gauge_t **rates,
+                               size_t *rates_size) {
+  size_t entries_num = 0;
+  size_t rates_num = 0;
+
+  size_t values_num = 0;
+  for (size_t i = 0; i < items_num; i++)
+    values_num += items[i].vl->values_len;
+
+  if (values_num > *rates_size) {
+    gauge_t *tmp = realloc(*rates, values_num * sizeof(*tmp));
+    if (tmp != NULL) {
+      *rates = tmp;
+      *rates_size = values_num;
+    }
+  }
 
-  pthread_mutex_lock(&write_lock);
+  (void)plugin_set_ctx(items[0].ctx);
 
-  while (write_loop && (write_queue_head == NULL))
-    pthread_cond_wait(&write_cond, &write_lock);
+  for (size_t i = 0; i < items_num; i++) {
+    size_t values_len = items[i].vl->values_len;
+    gauge_t *item_rates = NULL;
+    if (rates_num + values_len <= *rates_size)
+      item_rates = *rates + rates_num;
 
-  if (write_queue_head == NULL) {
-    pthread_mutex_unlock(&write_lock);
-    return NULL;
-  }
+    entries[entries_num].vl = NULL;
+    plugin_dispatch_values_internal(items[i].vl, items[i].prepared,
+                                    entries + entries_num, item_rates);
+    if (entries[entries_num].vl == NULL)
+      continue;
 
-  q = write_queue_head;
-  write_queue_head = q->next;
-  write_queue_length -= 1;
-  if (write_queue_head == NULL) {
-    write_queue_tail = NULL;
-    assert(0 == write_queue_length);
+    bool have_rates = (entries[entries_num].rates != NULL);
+    if (have_rates)
+      rates_num += values_len;
+    entries_num++;
+
+    /* The write callbacks look up the rates of a value list without rates,
+     * e.g. if growing `rates' failed, in the cache. Write it before a later
+     * item of the same series updates the cache entry. */
+    if (!have_rates) {
+      fc_default_action_batch(entries, entries_num);
+      entries_num = 0;
+      rates_num = 0;
+    }
   }
 
-  pthread_mutex_unlock(&write_lock);
+  if (entries_num > 0)
+    fc_default_action_batch(entries, entries_num);
 
-  (void)plugin_set_ctx(q->ctx);
+  for (size_t i = 0; i < items_num; i++)
+    plugin_value_list_free(items[i].vl);
+} /* }}} void plugin_write_items */
 
-  vl = q->vl;
-  sfree(q);
-  return vl;
-} /* }}} value_list_t *plugin_write_dequeue */
-
-static void *plugin_write_thread(void __attribute__((unused)) * args) /* {{{ */
+static void *plugin_write_thread(void *args) /* {{{ */
 {
+  size_t shard = (size_t)(uintptr_t)args;
+
+  write_queue_t *items = calloc(write_batch_size, sizeof(*items));
+  write_batch_entry_t *entries = calloc(write_batch_size, sizeof(*entries));
+  gauge_t *rates = NULL;
+  size_t rates_size = 0;
+  if ((items == NULL) || (entries == NULL)) {
+    ERROR("plugin_write_thread: calloc failed.");
+    sfree(items);
+    sfree(entries);
+    pthread_exit(NULL);
+    return (void *)0;
+  }
+
   while (write_loop) {
-    value_list_t *vl = plugin_write_dequeue();
-    if (vl == NULL)
-      continue;
+    size_t items_num =
+        squeue_pop_batch(write_queue, shard, items, write_batch_size);
+
+    if (record_statistics && (items_num > 0)) {
+      cdtime_t now = cdtime();
+
+      pthread_mutex_lock(&stats_queue_residency.lock);
+      if (stats_queue_residency.latency == NULL)
+        stats_queue_residency.latency = latency_counter_create();
+      for (size_t i = 0; i < items_num; i++) {
+        if ((items[i].enqueued == 0) || (stats_queue_residency.latency == NULL))
+          continue;
+        latency_counter_add(stats_queue_residency.latency,
+                            now - items[i].enqueued);
+      }
+      pthread_mutex_unlock(&stats_queue_residency.lock);
+    }
 
-    plugin_dispatch_values_internal(vl);
+    /* Values dispatched by different read plugins are written separately, so
+     * the write plugins see the right context. */
+    size_t start = 0;
+    for (size_t i = 1; i <= items_num; i++) {
+      if ((i < items_num) && plugin_ctx_equal(&items[start].ctx, &items[i].ctx))
+        continue;
 
-    plugin_value_list_free(vl);
+      plugin_write_items(items + start, i - start, entries, &rates,
+                         &rates_size);
+      start = i;
+    }
   }
 
+  sfree(items);
+  sfree(entries);
+  sfree(rates);
   pthread_exit(NULL);
   return (void *)0;
 } /* }}} void *plugin_write_thread */
 
+/* Removes all remaining value lists from the write queue and returns their
+ * number. */
+static size_t plugin_write_queue_drain(void) /* {{{ */
+{
+  size_t num = 0;
+
+  if (write_queue == NULL)
+    return 0;
+
+  for (size_t i = 0; i < squeue_shards_num(write_queue); i++) {
+    write_queue_t q;
+
+    while (squeue_try_pop(write_queue, i, &q) == 0) {
+      plugin_value_list_free(q.vl);
+      num++;
+    }
+  }
+
+  return num;
+} /* }}} size_t plugin_write_queue_drain */
+
 static void start_write_threads(size_t num) /* {{{ */
 {
   if (write_threads != NULL)
@@ -835,12 +1643,12 @@ static void start_write_threads(size_t num) /* {{{ */
   for (size_t i = 0; i < num; i++) {
     int status = pthread_create(write_threads + write_threads_num,
                                 /* attr = */ NULL, plugin_write_thread,
-                                /* arg = */ NULL);
+                                /* arg = */ (void *)(uintptr_t)i);
     if (status != 0) {
       ERROR("plugin: start_write_threads: pthread_create failed with status %i "
             "(%s).",
             status, STRERROR(status));
-      return;
+      break;
     }
 
     char name[THREAD_NAME_MAX];
@@ -850,11 +1658,21 @@ static void start_write_threads(size_t num) /* {{{ */
 
     write_threads_num++;
   } /* for (i) */
+
+  /* Each thread serves one shard of the write queue. Hand the shards of the
+   * threads that could not be started to the running ones, so no values are
+   * left behind without a consumer. */
+  if ((write_threads_num > 0) && (write_threads_num < num)) {
+    WARNING("plugin: start_write_threads: Only %" PRIsz " of %" PRIsz
+            " write threads are running.",
+            write_threads_num, num);
+    for (size_t i = write_threads_num; i < num; i++)
+      squeue_merge_shard(write_queue, i, i % write_threads_num);
+  }
 } /* }}} void start_write_threads */
 
 static void stop_write_threads(void) /* {{{ */
 {
-  write_queue_t *q;
   size_t i;
 
   if (write_threads == NULL)
@@ -862,11 +1680,9 @@ static void stop_write_threads(void) /* {{{ */
 
   INFO("collectd: Stopping %" PRIsz " write threads.", write_threads_num);
 
-  pthread_mutex_lock(&write_lock);
   write_loop = false;
-  DEBUG("plugin: stop_write_threads: Signalling `write_cond'");
-  pthread_cond_broadcast(&write_cond);
-  pthread_mutex_unlock(&write_lock);
+  DEBUG("plugin: stop_write_threads: Shutting down the write queue");
+  squeue_shutdown(write_queue);
 
   for (i = 0; i < write_threads_num; i++) {
     if (pthread_join(write_threads[i], NULL) != 0) {
@@ -877,20 +1693,7 @@ static void stop_write_threads(void) /* {{{ */
   sfree(write_threads);
   write_threads_num = 0;
 
-  pthread_mutex_lock(&write_lock);
-  i = 0;
-  for (q = write_queue_head; q != NULL;) {
-    write_queue_t *q1 = q;
-    plugin_value_list_free(q->vl);
-    q = q->next;
-    sfree(q1);
-    i++;
-  }
-  write_queue_head = NULL;
-  write_queue_tail = NULL;
-  write_queue_length = 0;
-  pthread_mutex_unlock(&write_lock);
-
+  i = plugin_write_queue_drain();
   if (i > 0) {
     WARNING("plugin: %" PRIsz " value list%s left after shutting down "
             "the write threads.",
@@ -1093,6 +1896,8 @@ static int plugin_insert_read(read_func_t *rf) {
   llentry_t *le;
 
   rf->rf_next_read = cdtime();
+  if (read_align)
+    rf->rf_next_read = read_align_time(rf->rf_next_read, rf->rf_interval);
   rf->rf_effective_interval = rf->rf_interval;
 
   pthread_mutex_lock(&read_lock);
@@ -1131,7 +1936,19 @@ static int plugin_insert_read(read_func_t *rf) {
     return -1;
   }
 
-  status = c_heap_insert(read_heap, rf);
+  if (read_threads_num > 0) {
+    /* Distribute new read functions over the running read threads. */
+    read_thread_t *t = read_threads + (read_threads_next % read_threads_num);
+    read_threads_next++;
+
+    pthread_mutex_lock(&t->lock);
+    status = read_queue_insert_nolock(t, rf);
+    t->wakeup = true;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+  } else {
+    status = c_heap_insert(read_heap, rf);
+  }
   if (status != 0) {
     pthread_mutex_unlock(&read_lock);
     ERROR("plugin_insert_read: c_heap_insert failed.");
@@ -1142,8 +1959,6 @@ static int plugin_insert_read(read_func_t *rf) {
   /* This does not fail. */
   llist_append(read_list, le);
 
-  /* Wake up all the read threads. */
-  pthread_cond_broadcast(&read_cond);
   pthread_mutex_unlock(&read_lock);
   return 0;
 } /* int plugin_insert_read */
@@ -1167,12 +1982,11 @@ EXPORT int plugin_register_read(const char *name, int (*callback)(void)) {
   rf->rf_type = RF_SIMPLE;
   rf->rf_interval = plugin_get_interval();
   rf->rf_ctx.interval = rf->rf_interval;
+  pthread_mutex_init(&rf->rf_stats_lock, /* attr = */ NULL);
 
   status = plugin_insert_read(rf);
-  if (status != 0) {
-    sfree(rf->rf_name);
-    sfree(rf);
-  }
+  if (status != 0)
+    read_func_destroy(rf);
 
   return status;
 } /* int plugin_register_read */
@@ -1210,22 +2024,113 @@ EXPORT int plugin_register_complex_read(const char *group, const char *name,
 
   rf->rf_ctx = plugin_get_ctx();
   rf->rf_ctx.interval = rf->rf_interval;
+  pthread_mutex_init(&rf->rf_stats_lock, /* attr = */ NULL);
 
   status = plugin_insert_read(rf);
-  if (status != 0) {
-    free_userdata(&rf->rf_udata);
-    sfree(rf->rf_name);
-    sfree(rf);
-  }
+  if (status != 0)
+    read_func_destroy(rf);
 
   return status;
 } /* int plugin_register_complex_read */
 
+/* Returns the latency histogram of the write function `name', creating it if
+ * necessary. Returns NULL if it cannot be allocated. */
+static stats_latency_t *plugin_write_stats_get(char const *name) /* {{{ */
+{
+  stats_latency_t *s = NULL;
+
+  pthread_mutex_lock(&statistics_lock);
+
+  if (write_stats == NULL)
+    write_stats = c_avl_create((int (*)(const void *, const void *))strcmp);
+  if (write_stats == NULL) {
+    pthread_mutex_unlock(&statistics_lock);
+    return NULL;
+  }
+
+  if (c_avl_get(write_stats, name, (void *)&s) == 0) {
+    pthread_mutex_unlock(&statistics_lock);
+    return s;
+  }
+
+  char *key = strdup(name);
+  s = calloc(1, sizeof(*s));
+  if ((key == NULL) || (s == NULL) ||
+      (c_avl_insert(write_stats, key, s) != 0)) {
+    sfree(key);
+    sfree(s);
+    pthread_mutex_unlock(&statistics_lock);
+    return NULL;
+  }
+  pthread_mutex_init(&s->lock, /* attr = */ NULL);
+
+  pthread_mutex_unlock(&statistics_lock);
+  return s;
+} /* }}} stats_latency_t *plugin_write_stats_get */
+
+static void plugin_stats_destroy(void) /* {{{ */
+{
+  char *name;
+  stats_latency_t *s;
+
+  pthread_mutex_lock(&statistics_lock);
+  /* `write_stats' is only created once a write callback has been called. */
+  while ((write_stats != NULL) &&
+         (c_avl_pick(write_stats, (void *)&name, (void *)&s) == 0)) {
+    sfree(name);
+    stats_latency_destroy(s);
+    pthread_mutex_destroy(&s->lock);
+    sfree(s);
+  }
+  c_avl_destroy(write_stats);
+  write_stats = NULL;
+  pthread_mutex_unlock(&statistics_lock);
+
+  stats_latency_destroy(&stats_queue_residency);
+  stats_latency_destroy(&stats_filter_chain);
+  stats_latency_destroy(&stats_cache_update);
+} /* }}} void plugin_stats_destroy */
+
+static int create_register_write(const char *name, void *callback, /* {{{ */
+                                 int type, user_data_t const *ud) {
+  if (name == NULL || callback == NULL)
+    return EINVAL;
+
+  write_func_t *wf = calloc(1, sizeof(*wf));
+  if (wf == NULL) {
+    free_userdata(ud);
+    ERROR("plugin: create_register_write: calloc failed.");
+    return ENOMEM;
+  }
+
+  wf->wf_callback = callback;
+  if (ud == NULL) {
+    wf->wf_udata = (user_data_t){
+        .data = NULL,
+        .free_func = NULL,
+    };
+  } else {
+    wf->wf_udata = *ud;
+  }
+
+  wf->wf_ctx = plugin_get_ctx();
+  wf->wf_type = type;
+  wf->wf_stats = plugin_write_stats_get(name);
+
+  return register_callback(&list_write, name, (callback_func_t *)wf);
+} /* }}} int create_register_write */
+
 EXPORT int plugin_register_write(const char *name, plugin_write_cb callback,
                                  user_data_t const *ud) {
-  return create_register_callback(&list_write, name, (void *)callback, ud);
+  return create_register_write(name, (void *)callback, WF_SIMPLE, ud);
 } /* int plugin_register_write */
 
+EXPORT int plugin_register_write_batch(const char *name,
+                                       plugin_write_batch_cb callback,
+                                       user_data_t const *ud) {
+  return create_register_write(name, (void *)callback, WF_BATCH, ud);
+} /* int plugin_register_write_batch */
+
 static int plugin_flush_timeout_callback(user_data_t *ud) {
   flush_callback_t *cb = ud->data;
 
@@ -1635,6 +2540,13 @@ EXPORT int plugin_init_all(void) {
   int ret = 0;
 
   /* Init the value cache */
+  char const *history = global_option_get("CacheHistory");
+  if (strcasecmp("Compressed", history) == 0) {
+    uc_set_history_compression(true);
+  } else if (strcasecmp("Plain", history) != 0) {
+    WARNING("plugin_init_all: Unknown CacheHistory \"%s\". Using \"Plain\".",
+            history);
+  }
   uc_init();
 
   if (IS_TRUE(global_option_get("CollectInternalStats"))) {
@@ -1642,6 +2554,8 @@ EXPORT int plugin_init_all(void) {
     plugin_register_read("collectd", plugin_update_internal_statistics);
   }
 
+  fc_init();
+
   chain_name = global_option_get("PreCacheChain");
   pre_cache_chain = fc_chain_get_by_name(chain_name);
 
@@ -1674,6 +2588,36 @@ EXPORT int plugin_init_all(void) {
     write_threads_num = 5;
   }
 
+  long batch_size = global_option_get_long("WriteBatchSize",
+                                           /* default = */ 64);
+  if (batch_size < 1) {
+    ERROR("WriteBatchSize must be positive.");
+    batch_size = 64;
+  }
+  write_batch_size = (size_t)batch_size;
+
+  /* One shard per write thread. Created before the init callbacks run, since
+   * these may already dispatch values. */
+  if (write_queue == NULL) {
+    write_queue = squeue_create(write_threads_num, sizeof(write_queue_t));
+    if (write_queue == NULL) {
+      ERROR("plugin_init_all: squeue_create failed.");
+      return -1;
+    }
+  }
+
+  /* Without pools, value lists are simply allocated with malloc(3). */
+  for (size_t i = 0; i < VALUE_LIST_POOL_VALUES_MAX; i++) {
+    if (value_list_pools[i] != NULL)
+      continue;
+
+    value_list_pools[i] =
+        slab_create(sizeof(queued_value_list_t) + (i + 1) * sizeof(value_t),
+                    VALUE_LIST_POOL_CACHE);
+    if (value_list_pools[i] == NULL)
+      WARNING("plugin_init_all: slab_create failed.");
+  }
+
   if ((list_init == NULL) && (read_heap == NULL))
     return ret;
 
@@ -1712,6 +2656,15 @@ EXPORT int plugin_init_all(void) {
 
   max_read_interval =
       global_option_get_time("MaxReadInterval", DEFAULT_MAX_READ_INTERVAL);
+  read_align = IS_TRUE(global_option_get("AlignRead"));
+
+  char const *scheduler = global_option_get("ReadScheduler");
+  if (strcasecmp("TimerWheel", scheduler) == 0) {
+    read_threads_use_wheel = true;
+  } else if (strcasecmp("Heap", scheduler) != 0) {
+    WARNING("plugin_init_all: Unknown ReadScheduler \"%s\". Using \"Heap\".",
+            scheduler);
+  }
 
   /* Start read-threads */
   if (read_heap != NULL) {
@@ -1772,51 +2725,78 @@ EXPORT int plugin_read_all_once(void) {
       return_status = -1;
     }
 
-    sfree(rf->rf_name);
-    destroy_callback((void *)rf);
+    read_func_destroy(rf);
   }
 
   return return_status;
 } /* int plugin_read_all_once */
 
-EXPORT int plugin_write(const char *plugin, /* {{{ */
-                        const data_set_t *ds, const value_list_t *vl) {
+/* Calls a write function for a batch of value lists. Write functions without
+ * batch support are called once for each value list. */
+static int plugin_write_func_invoke(write_func_t *wf, /* {{{ */
+                                    const write_batch_entry_t *entries,
+                                    size_t entries_num) {
+  cdtime_t start = record_statistics ? cdtime() : 0;
+  int status = 0;
+
+  /* Lets the callback get the rates of the value lists without a cache
+   * lookup. A write callback may call plugin_write() itself, so the batch of
+   * the outer call is restored afterwards. */
+  const write_batch_entry_t *outer_entries;
+  size_t outer_entries_num;
+  uc_get_write_batch(&outer_entries, &outer_entries_num);
+  uc_set_write_batch(entries, entries_num);
+
+  if (wf->wf_type == WF_BATCH) {
+    plugin_write_batch_cb callback = wf->wf_callback;
+    status = (*callback)(entries, entries_num, &wf->wf_udata);
+  } else {
+    plugin_write_cb callback = wf->wf_callback;
+    for (size_t i = 0; i < entries_num; i++) {
+      int tmp = (*callback)(entries[i].ds, entries[i].vl, &wf->wf_udata);
+      if (tmp != 0)
+        status = tmp;
+    }
+  }
+
+  uc_set_write_batch(outer_entries, outer_entries_num);
+
+  if (record_statistics && (wf->wf_stats != NULL))
+    stats_latency_add(wf->wf_stats, cdtime() - start);
+
+  return status;
+} /* }}} int plugin_write_func_invoke */
+
+EXPORT int plugin_write_batch(const char *plugin, /* {{{ */
+                              const write_batch_entry_t *entries,
+                              size_t entries_num) {
   llentry_t *le;
   int status;
 
-  if (vl == NULL)
+  if ((entries == NULL) || (entries_num == 0))
     return EINVAL;
 
   if (list_write == NULL)
     return ENOENT;
 
-  if (ds == NULL) {
-    ds = plugin_get_ds(vl->type);
-    if (ds == NULL) {
-      ERROR("plugin_write: Unable to lookup type `%s'.", vl->type);
-      return ENOENT;
-    }
-  }
-
   if (plugin == NULL) {
     int success = 0;
     int failure = 0;
 
     le = llist_head(list_write);
     while (le != NULL) {
-      callback_func_t *cf = le->value;
-      plugin_write_cb callback;
+      write_func_t *wf = le->value;
 
       /* Keep the read plugin's interval and flush information but update the
        * plugin name. */
       plugin_ctx_t old_ctx = plugin_get_ctx();
       plugin_ctx_t ctx = old_ctx;
-      ctx.name = cf->cf_ctx.name;
+      ctx.name = wf->wf_ctx.name;
       plugin_set_ctx(ctx);
 
-      DEBUG("plugin: plugin_write: Writing values via %s.", le->key);
-      callback = cf->cf_callback;
-      status = (*callback)(ds, vl, &cf->cf_udata);
+      DEBUG("plugin: plugin_write_batch: Writing %" PRIsz " values via %s.",
+            entries_num, le->key);
+      status = plugin_write_func_invoke(wf, entries, entries_num);
       if (status != 0)
         failure++;
       else
@@ -1832,9 +2812,6 @@ EXPORT int plugin_write(const char *plugin, /* {{{ */
       status = 0;
   } else /* plugin != NULL */
   {
-    callback_func_t *cf;
-    plugin_write_cb callback;
-
     le = llist_head(list_write);
     while (le != NULL) {
       if (strcasecmp(plugin, le->key) == 0)
@@ -1846,19 +2823,49 @@ EXPORT int plugin_write(const char *plugin, /* {{{ */
     if (le == NULL)
       return ENOENT;
 
-    cf = le->value;
-
     /* do not switch plugin context; rather keep the context (interval)
      * information of the calling read plugin */
 
-    DEBUG("plugin: plugin_write: Writing values via %s.", le->key);
-    callback = cf->cf_callback;
-    status = (*callback)(ds, vl, &cf->cf_udata);
+    DEBUG("plugin: plugin_write_batch: Writing %" PRIsz " values via %s.",
+          entries_num, le->key);
+    status = plugin_write_func_invoke(le->value, entries, entries_num);
   }
 
   return status;
+} /* }}} int plugin_write_batch */
+
+EXPORT int plugin_write(const char *plugin, /* {{{ */
+                        const data_set_t *ds, const value_list_t *vl) {
+  if (vl == NULL)
+    return EINVAL;
+
+  if (list_write == NULL)
+    return ENOENT;
+
+  if (ds == NULL) {
+    ds = plugin_get_ds(vl->type);
+    if (ds == NULL) {
+      ERROR("plugin_write: Unable to lookup type `%s'.", vl->type);
+      return ENOENT;
+    }
+  }
+
+  return plugin_write_batch(plugin,
+                            &(write_batch_entry_t){.ds = ds, .vl = vl}, 1);
 } /* }}} int plugin_write */
 
+EXPORT int plugin_stats_read(plugin_stats_cb callback, /* {{{ */
+                             void *user_data) {
+  if (callback == NULL)
+    return EINVAL;
+
+  if (!record_statistics)
+    return ENOTSUP;
+
+  plugin_stats_collect(callback, user_data, /* reset = */ false);
+  return 0;
+} /* }}} int plugin_stats_read */
+
 EXPORT int plugin_flush(const char *plugin, cdtime_t timeout,
                         const char *identifier) {
   llentry_t *le;
@@ -1952,6 +2959,19 @@ EXPORT int plugin_shutdown_all(void) {
   destroy_all_callbacks(&list_shutdown);
   destroy_all_callbacks(&list_log);
 
+  /* Shutdown callbacks may have dispatched more values after the write
+   * threads were stopped. */
+  plugin_write_queue_drain();
+  squeue_destroy(write_queue);
+  write_queue = NULL;
+
+  for (size_t i = 0; i < VALUE_LIST_POOL_VALUES_MAX; i++) {
+    slab_destroy(value_list_pools[i]);
+    value_list_pools[i] = NULL;
+  }
+
+  plugin_stats_destroy();
+
   plugin_free_loaded();
   plugin_free_data_sets();
   return ret;
@@ -2062,38 +3082,18 @@ void plugin_dispatch_cache_event(enum cache_event_type_e event_type,
   return;
 }
 
-static int plugin_dispatch_values_internal(value_list_t *vl) {
-  int status;
-  static c_complain_t no_write_complaint = C_COMPLAIN_INIT_STATIC;
-
-  bool free_meta_data = false;
-
-  assert(vl != NULL);
-
-  /* These fields are initialized by plugin_value_list_clone() if needed: */
-  assert(vl->host[0] != 0);
-  assert(vl->time != 0); /* The time is determined at _enqueue_ time. */
-  assert(vl->interval != 0);
-
-  if (vl->type[0] == 0 || vl->values == NULL || vl->values_len < 1) {
+/* Looks up the data set of `vl', checks that it matches the values and
+ * escapes the identifier. This is done for every value list dispatched with
+ * plugin_dispatch_values() and once per series for prepared series. */
+static int plugin_value_list_prepare(value_list_t *vl, /* {{{ */
+                                     data_set_t const **ret_ds) {
+  if (vl->type[0] == 0 || vl->values_len < 1) {
     ERROR("plugin_dispatch_values: Invalid value list "
           "from plugin %s.",
           vl->plugin);
     return -1;
   }
 
-  /* Free meta data only if the calling function didn't specify any. In
-   * this case matches and targets may add some and the calling function
-   * may not expect (and therefore free) that data. */
-  if (vl->meta == NULL)
-    free_meta_data = true;
-
-  if (list_write == NULL)
-    c_complain_once(LOG_WARNING, &no_write_complaint,
-                    "plugin_dispatch_values: No write callback has been "
-                    "registered. Please load at least one output plugin, "
-                    "if you want the collected data to be stored.");
-
   if (data_sets == NULL) {
     ERROR("plugin_dispatch_values: No data sets registered. "
           "Could the types database be read? Check "
@@ -2112,13 +3112,6 @@ static int plugin_dispatch_values_internal(value_list_t *vl) {
     return -1;
   }
 
-  DEBUG("plugin_dispatch_values: time = %.3f; interval = %.3f; "
-        "host = %s; "
-        "plugin = %s; plugin_instance = %s; "
-        "type = %s; type_instance = %s;",
-        CDTIME_T_TO_DOUBLE(vl->time), CDTIME_T_TO_DOUBLE(vl->interval),
-        vl->host, vl->plugin, vl->plugin_instance, vl->type, vl->type_instance);
-
 #if COLLECT_DEBUG
   assert(0 == strcmp(ds->type, vl->type));
 #else
@@ -2147,31 +3140,129 @@ static int plugin_dispatch_values_internal(value_list_t *vl) {
   escape_slashes(vl->type, sizeof(vl->type));
   escape_slashes(vl->type_instance, sizeof(vl->type_instance));
 
+  *ret_ds = ds;
+  return 0;
+} /* }}} int plugin_value_list_prepare */
+
+/* If `prepared' is true, `vl' belongs to a prepared series and has already been
+ * escaped by plugin_value_list_prepare(). Its data set is still looked up,
+ * because data sets may be replaced or unregistered while the series exists.
+ *
+ * If `batch_entry' is not NULL and the value list would be handed to the
+ * default "write" target, `batch_entry' is filled in instead, so the caller
+ * can write a whole batch of value lists at once. The caller owns the value
+ * list and frees it, including any meta data added by the chains. The rates
+ * computed by the cache update are then stored in `rates', which holds
+ * `vl->values_len' values, and referenced by `batch_entry'. */
+static int plugin_dispatch_values_internal(value_list_t *vl, bool prepared,
+                                           write_batch_entry_t *batch_entry,
+                                           gauge_t *rates) {
+  int status;
+  static c_complain_t no_write_complaint = C_COMPLAIN_INIT_STATIC;
+
+  bool free_meta_data = false;
+
+  assert(vl != NULL);
+
+  /* These fields are initialized by plugin_value_list_clone() if needed: */
+  assert(vl->host[0] != 0);
+  assert(vl->time != 0); /* The time is determined at _enqueue_ time. */
+  assert(vl->interval != 0);
+
+  /* Free meta data only if the calling function didn't specify any. In
+   * this case matches and targets may add some and the calling function
+   * may not expect (and therefore free) that data. */
+  if (vl->meta == NULL)
+    free_meta_data = true;
+
+  if (list_write == NULL)
+    c_complain_once(LOG_WARNING, &no_write_complaint,
+                    "plugin_dispatch_values: No write callback has been "
+                    "registered. Please load at least one output plugin, "
+                    "if you want the collected data to be stored.");
+
+  data_set_t const *ds = NULL;
+  if (prepared) {
+    ds = plugin_get_ds(vl->type);
+    if ((ds == NULL) || (ds->ds_num != vl->values_len)) {
+      char ident[6 * DATA_MAX_NAME_LEN];
+
+      FORMAT_VL(ident, sizeof(ident), vl);
+      ERROR("plugin_dispatch_values: The data set of %s has been removed or "
+            "changed since the series was created.",
+            ident);
+      return -1;
+    }
+  } else if (plugin_value_list_prepare(vl, &ds) != 0)
+    return -1;
+
+  DEBUG("plugin_dispatch_values: time = %.3f; interval = %.3f; "
+        "host = %s; "
+        "plugin = %s; plugin_instance = %s; "
+        "type = %s; type_instance = %s;",
+        CDTIME_T_TO_DOUBLE(vl->time), CDTIME_T_TO_DOUBLE(vl->interval),
+        vl->host, vl->plugin, vl->plugin_instance, vl->type, vl->type_instance);
+
+  cdtime_t start = record_statistics ? cdtime() : 0;
+  cdtime_t chain_time = 0;
+
   if (pre_cache_chain != NULL) {
     status = fc_process_chain(ds, vl, pre_cache_chain);
+    if (record_statistics) {
+      cdtime_t now = cdtime();
+      chain_time += now - start;
+      start = now;
+    }
     if (status < 0) {
       WARNING("plugin_dispatch_values: Running the "
               "pre-cache chain failed with "
               "status %i (%#x).",
               status, status);
-    } else if (status == FC_TARGET_STOP)
+    } else if (status == FC_TARGET_STOP) {
+      if (record_statistics)
+        stats_latency_add(&stats_filter_chain, chain_time);
       return 0;
+    }
   }
 
-  /* Update the value cache */
-  uc_update(ds, vl);
+  /* Update the value cache. Keep the rates for the write callbacks if the
+   * value list goes to them directly. */
+  bool have_rates = false;
+  if ((batch_entry != NULL) && (post_cache_chain == NULL) && (rates != NULL) &&
+      (ds->ds_num == vl->values_len))
+    have_rates = (uc_update_rate(ds, vl, rates) == 0);
+  else
+    uc_update(ds, vl);
+
+  if (record_statistics) {
+    cdtime_t now = cdtime();
+    stats_latency_add(&stats_cache_update, now - start);
+    start = now;
+  }
 
   if (post_cache_chain != NULL) {
     status = fc_process_chain(ds, vl, post_cache_chain);
+    if (record_statistics)
+      chain_time += cdtime() - start;
     if (status < 0) {
       WARNING("plugin_dispatch_values: Running the "
               "post-cache chain failed with "
               "status %i (%#x).",
               status, status);
     }
+  } else if (batch_entry != NULL) {
+    if (record_statistics && (pre_cache_chain != NULL))
+      stats_latency_add(&stats_filter_chain, chain_time);
+    *batch_entry = (write_batch_entry_t){
+        .ds = ds, .vl = vl, .rates = have_rates ? rates : NULL};
+    return 0;
   } else
     fc_default_action(ds, vl);
 
+  if (record_statistics && ((pre_cache_chain != NULL) ||
+                            (post_cache_chain != NULL)))
+    stats_latency_add(&stats_filter_chain, chain_time);
+
   if ((free_meta_data == true) && (vl->meta != NULL)) {
     meta_data_destroy(vl->meta);
     vl->meta = NULL;
@@ -2186,9 +3277,7 @@ static double get_drop_probability(void) /* {{{ */
   long size;
   long wql;
 
-  pthread_mutex_lock(&write_lock);
-  wql = write_queue_length;
-  pthread_mutex_unlock(&write_lock);
+  wql = plugin_write_queue_length();
 
   if (wql < write_limit_low)
     return 0.0;
@@ -2264,6 +3353,106 @@ EXPORT int plugin_dispatch_values(value_list_t const *vl) {
   return 0;
 }
 
+EXPORT plugin_series_t *plugin_series_create(value_list_t const *vl) /* {{{ */
+{
+  if (vl == NULL)
+    return NULL;
+
+  plugin_series_t *s = calloc(1, sizeof(*s));
+  if (s == NULL) {
+    ERROR("plugin_series_create: calloc failed.");
+    return NULL;
+  }
+
+  memcpy(&s->vl, vl, sizeof(s->vl));
+  s->vl.values = NULL;
+  s->vl.meta = NULL;
+
+  if (s->vl.host[0] == 0)
+    sstrncpy(s->vl.host, hostname_g, sizeof(s->vl.host));
+
+  /* Hash the unescaped identifier, like plugin_write_enqueue() does, so value
+   * lists of the series end up in the same write queue shard either way. */
+  s->hash = plugin_value_list_hash(&s->vl);
+
+  data_set_t const *ds;
+  if (plugin_value_list_prepare(&s->vl, &ds) != 0) {
+    sfree(s);
+    return NULL;
+  }
+
+  if (vl->meta != NULL) {
+    s->vl.meta = meta_data_clone(vl->meta);
+    if (s->vl.meta == NULL) {
+      ERROR("plugin_series_create: meta_data_clone failed.");
+      sfree(s);
+      return NULL;
+    }
+  }
+
+  return s;
+} /* }}} plugin_series_t *plugin_series_create */
+
+EXPORT int plugin_series_dispatch(plugin_series_t *s, /* {{{ */
+                                  value_t const *values, cdtime_t time) {
+  if ((s == NULL) || (values == NULL))
+    return EINVAL;
+
+  if (check_drop_value()) {
+    if (record_statistics) {
+      pthread_mutex_lock(&statistics_lock);
+      stats_values_dropped++;
+      pthread_mutex_unlock(&statistics_lock);
+    }
+    return 0;
+  }
+
+  if (write_queue == NULL)
+    return EAGAIN;
+
+  value_list_t *vl = plugin_value_list_alloc(&s->vl, values);
+  if (vl == NULL)
+    return ENOMEM;
+
+  vl->time = (time != 0) ? time : cdtime();
+  if (vl->interval == 0)
+    vl->interval = plugin_get_interval();
+
+  if (s->vl.meta != NULL) {
+    vl->meta = meta_data_clone(s->vl.meta);
+    if (vl->meta == NULL) {
+      plugin_value_list_free(vl);
+      return ENOMEM;
+    }
+  }
+
+  write_queue_t q = {
+      .vl = vl,
+      .ctx = plugin_get_ctx(),
+      .prepared = true,
+      .enqueued = record_statistics ? cdtime() : 0,
+  };
+
+  int status = squeue_push(write_queue, s->hash, &q);
+  if (status != 0) {
+    plugin_value_list_free(q.vl);
+    ERROR("plugin_series_dispatch: squeue_push failed with status %i (%s).",
+          status, STRERROR(status));
+    return status;
+  }
+
+  return 0;
+} /* }}} int plugin_series_dispatch */
+
+EXPORT void plugin_series_destroy(plugin_series_t *s) /* {{{ */
+{
+  if (s == NULL)
+    return;
+
+  meta_data_destroy(s->vl.meta);
+  sfree(s);
+} /* }}} void plugin_series_destroy */
+
 __attribute__((sentinel)) int
 plugin_dispatch_multivalue(value_list_t const *template, /* {{{ */
                            bool store_percentage, int store_type, ...) {
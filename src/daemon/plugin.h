@@ -180,6 +180,20 @@ typedef struct cache_event_s {
   int ret;
 } cache_event_t;
 
+/* A value list and its data set, as passed to batch write callbacks. `rates'
+ * holds the rates computed when the value list updated the cache, or is NULL
+ * if they are not known; see uc_get_rate_buffer(). */
+typedef struct write_batch_entry_s {
+  const data_set_t *ds;
+  const value_list_t *vl;
+  const gauge_t *rates;
+} write_batch_entry_t;
+
+/* A series which has been looked up and validated once, see
+ * `plugin_series_create'. */
+struct plugin_series_s;
+typedef struct plugin_series_s plugin_series_t;
+
 struct plugin_ctx_s {
   char *name;
   cdtime_t interval;
@@ -195,6 +209,10 @@ typedef int (*plugin_init_cb)(void);
 typedef int (*plugin_read_cb)(user_data_t *);
 typedef int (*plugin_write_cb)(const data_set_t *, const value_list_t *,
                                user_data_t *);
+/* "write batch" callback. Receives all value lists a write thread dequeued in
+ * one go. Returns zero on success, non-zero if writing the batch failed. */
+typedef int (*plugin_write_batch_cb)(const write_batch_entry_t *entries,
+                                     size_t entries_num, user_data_t *);
 typedef int (*plugin_flush_cb)(cdtime_t timeout, const char *identifier,
                                user_data_t *);
 /* "missing" callback. Returns less than zero on failure, zero if other
@@ -209,6 +227,7 @@ typedef int (*plugin_cache_event_cb)(cache_event_t *, user_data_t *);
 typedef void (*plugin_log_cb)(int severity, const char *message, user_data_t *);
 typedef int (*plugin_shutdown_cb)(void);
 typedef int (*plugin_notification_cb)(const notification_t *, user_data_t *);
+typedef void (*plugin_stats_cb)(const value_list_t *, void *user_data);
 /*
  * NAME
  *  plugin_set_dir
@@ -284,8 +303,47 @@ int plugin_shutdown_all(void);
 int plugin_write(const char *plugin, const data_set_t *ds,
                  const value_list_t *vl);
 
+/*
+ * NAME
+ *  plugin_write_batch
+ *
+ * DESCRIPTION
+ *  Same as `plugin_write', but hands a batch of value lists to the write
+ *  callbacks. Callbacks registered with `plugin_register_write_batch' are
+ *  called once for the whole batch, callbacks registered with
+ *  `plugin_register_write' are called once per value list.
+ *
+ * ARGUMENTS
+ *  plugin      Name of the plugin. If NULL, the batch is sent to all
+ *              registered write functions.
+ *  entries     Array of data set / value list pairs. The data sets must not be
+ *              NULL.
+ *  entries_num Number of elements in `entries'.
+ *
+ * RETURN VALUE
+ *  Same as `plugin_write'.
+ */
+int plugin_write_batch(const char *plugin, const write_batch_entry_t *entries,
+                       size_t entries_num);
+
 int plugin_flush(const char *plugin, cdtime_t timeout, const char *identifier);
 
+/*
+ * NAME
+ *  plugin_stats_read
+ *
+ * DESCRIPTION
+ *  Calls `callback' once for each of the daemon's internal statistics, i.e.
+ *  the values reported when `CollectInternalStats' is enabled. The value lists
+ *  passed to `callback' are only valid during the call. Unlike the periodic
+ *  report, this does not reset the latency histograms, so their percentiles
+ *  cover the time since the last report.
+ *
+ * RETURN VALUE
+ *  Zero upon success, ENOTSUP if internal statistics are not collected.
+ */
+int plugin_stats_read(plugin_stats_cb callback, void *user_data);
+
 /*
  * The `plugin_register_*' functions are used to make `config', `init',
  * `read', `write' and `shutdown' functions known to the plugin
@@ -305,6 +363,11 @@ int plugin_register_complex_read(const char *group, const char *name,
                                  user_data_t const *user_data);
 int plugin_register_write(const char *name, plugin_write_cb callback,
                           user_data_t const *user_data);
+/* Registers a write callback which receives value lists in batches. Plugins
+ * register either a "write" or a "write batch" callback under one name. */
+int plugin_register_write_batch(const char *name,
+                                plugin_write_batch_cb callback,
+                                user_data_t const *user_data);
 int plugin_register_flush(const char *name, plugin_flush_cb callback,
                           user_data_t const *user_data);
 int plugin_register_missing(const char *name, plugin_missing_cb callback,
@@ -398,6 +461,54 @@ __attribute__((sentinel)) int plugin_dispatch_multivalue(value_list_t const *vl,
                                                          bool store_percentage,
                                                          int store_type, ...);
 
+/*
+ * NAME
+ *  plugin_series_create
+ *
+ * DESCRIPTION
+ *  Prepares the series identified by `vl' for repeated dispatching with
+ *  `plugin_series_dispatch'. The number of values is checked against the
+ *  data set and the identifier is escaped once, here, instead of every time a
+ *  value is dispatched. `vl->values' is ignored, but
+ *  `vl->values_len' must be set. If `vl->interval' is zero, the interval of
+ *  the calling plugin is used when dispatching. Meta data is copied and
+ *  attached to every dispatched value list.
+ *
+ *  Read plugins which report the same series every interval should create
+ *  the series once and keep it around.
+ *
+ * RETURN VALUE
+ *  A plugin_series_t-pointer upon success or NULL upon failure.
+ */
+plugin_series_t *plugin_series_create(value_list_t const *vl);
+
+/*
+ * NAME
+ *  plugin_series_dispatch
+ *
+ * DESCRIPTION
+ *  Dispatches `values' for the prepared series `s'. `values' must hold as
+ *  many values as the data set of the series. If `time' is zero, the current
+ *  time is used. Apart from skipping the validation and escaping, this
+ *  behaves like `plugin_dispatch_values'. Since data sets may be replaced at
+ *  runtime, the data set is still looked up when the values are written.
+ *
+ * RETURN VALUE
+ *  Zero upon success or an errno value upon failure.
+ */
+int plugin_series_dispatch(plugin_series_t *s, value_t const *values,
+                           cdtime_t time);
+
+/*
+ * NAME
+ *  plugin_series_destroy
+ *
+ * DESCRIPTION
+ *  Frees a series created with `plugin_series_create'. Value lists which
+ *  have already been dispatched are not affected.
+ */
+void plugin_series_destroy(plugin_series_t *s);
+
 int plugin_dispatch_missing(const value_list_t *vl);
 void plugin_dispatch_cache_event(enum cache_event_type_e event_type,
                                  unsigned long callbacks_mask, const char *name,
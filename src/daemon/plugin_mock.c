@@ -35,6 +35,7 @@ kstat_ctl_t *kc = NULL;
 #endif /* HAVE_LIBKSTAT */
 
 char *hostname_g = "example.com";
+int timeout_g = 2;
 
 void plugin_set_dir(const char *dir) { /* nop */
 }
@@ -69,6 +70,13 @@ int plugin_register_write(__attribute__((unused)) const char *name,
   return ENOTSUP;
 }
 
+int plugin_register_write_batch(__attribute__((unused)) const char *name,
+                                __attribute__((unused))
+                                plugin_write_batch_cb callback,
+                                __attribute__((unused)) user_data_t const *ud) {
+  return ENOTSUP;
+}
+
 int plugin_register_flush(__attribute__((unused)) const char *name,
                           __attribute__((unused)) plugin_flush_cb callback,
                           __attribute__((unused))
@@ -121,6 +129,37 @@ DECLARE_UNREGISTER(notification)
 
 int plugin_dispatch_values(value_list_t const *vl) { return ENOTSUP; }
 
+plugin_series_t *plugin_series_create(__attribute__((unused))
+                                      value_list_t const *vl) {
+  return NULL;
+}
+
+int plugin_series_dispatch(__attribute__((unused)) plugin_series_t *s,
+                           __attribute__((unused)) value_t const *values,
+                           __attribute__((unused)) cdtime_t time) {
+  return ENOTSUP;
+}
+
+void plugin_series_destroy(__attribute__((unused))
+                           plugin_series_t *s) { /* nop */
+}
+
+int plugin_stats_read(__attribute__((unused)) plugin_stats_cb callback,
+                      __attribute__((unused)) void *user_data) {
+  return ENOTSUP;
+}
+
+int plugin_dispatch_missing(__attribute__((unused)) value_list_t const *vl) {
+  return ENOTSUP;
+}
+
+void plugin_dispatch_cache_event(
+    __attribute__((unused)) enum cache_event_type_e event_type,
+    __attribute__((unused)) unsigned long callbacks_mask,
+    __attribute__((unused)) const char *name,
+    __attribute__((unused)) const value_list_t *vl) { /* nop */
+}
+
 int plugin_dispatch_notification(__attribute__((unused))
                                  const notification_t *notif) {
   return ENOTSUP;
@@ -184,9 +223,35 @@ int plugin_flush(const char *plugin, cdtime_t timeout, const char *identifier) {
   return ENOTSUP;
 }
 
+int plugin_write(__attribute__((unused)) const char *plugin,
+                 __attribute__((unused)) const data_set_t *ds,
+                 __attribute__((unused)) const value_list_t *vl) {
+  return ENOTSUP;
+}
+
+int plugin_write_batch(__attribute__((unused)) const char *plugin,
+                       __attribute__((unused))
+                       const write_batch_entry_t *entries,
+                       __attribute__((unused)) size_t entries_num) {
+  return ENOTSUP;
+}
+
+void plugin_log_available_writers(void) { /* nop */
+}
+
 static data_source_t magic_ds[] = {{"value", DS_TYPE_DERIVE, 0.0, NAN}};
 static data_set_t magic = {"MAGIC", 1, magic_ds};
+/* One data source of each type. */
+static data_source_t magic_mixed_ds[] = {
+    {"gauge", DS_TYPE_GAUGE, NAN, NAN},
+    {"derive", DS_TYPE_DERIVE, NAN, NAN},
+    {"counter", DS_TYPE_COUNTER, 0.0, NAN},
+    {"absolute", DS_TYPE_ABSOLUTE, 0.0, NAN},
+};
+static data_set_t magic_mixed = {"MAGIC_MIXED", 4, magic_mixed_ds};
 const data_set_t *plugin_get_ds(const char *name) {
+  if (strcmp(name, "MAGIC_MIXED") == 0)
+    return &magic_mixed;
   if (strcmp(name, "MAGIC"))
     return NULL;
 
@@ -238,9 +303,3 @@ int plugin_thread_create(__attribute__((unused)) pthread_t *thread,
                          __attribute__((unused)) char const *name) {
   return ENOTSUP;
 }
-
-/* TODO(octo): this function is actually from filter_chain.h, but in order not
- * to tumble down that rabbit hole, we're declaring it here. A better solution
- * would be to hard-code the top-level config keys in daemon/collectd.c to avoid
- * having these references in daemon/configfile.c. */
-int fc_configure(const oconfig_item_t *ci) { return ENOTSUP; }
@@ -29,15 +29,28 @@
 #include "collectd.h"
 
 #include "plugin.h"
-#include "utils/avltree/avltree.h"
 #include "utils/common/common.h"
+#include "utils/gorilla/gorilla.h"
 #include "utils/metadata/meta_data.h"
+#include "utils/timer_wheel/timer_wheel.h"
 #include "utils_cache.h"
 
 #include <assert.h>
 
-typedef struct cache_entry_s {
-  char name[6 * DATA_MAX_NAME_LEN];
+typedef struct cache_entry_s cache_entry_t;
+/* Each entry is a single allocation: the struct is followed by the raw
+ * values, the rates and the name, see cache_alloc(). */
+struct cache_entry_s {
+  char *name;
+  /* Hash of `name', see uc_hash_vl(). */
+  uint32_t hash;
+  /* Lengths of the host, plugin, plugin instance, type and type instance,
+   * so that the identifier can be split without parsing `name'. Each is
+   * shorter than DATA_MAX_NAME_LEN. */
+  uint8_t ident_len[5];
+  /* Next entry in the same hash bucket. */
+  cache_entry_t *next;
+
   size_t values_num;
   gauge_t *values_gauge;
   value_t *values_raw;
@@ -52,6 +65,8 @@ typedef struct cache_entry_s {
   cdtime_t interval;
   int state;
   int hits;
+  /* Time of the newest value sent to other hosts, see uc_set_time_sent(). */
+  cdtime_t time_sent;
 
   /*
    * +-----+-----+-----+-----+-----+-----+-----+-----+-----+----
@@ -65,50 +80,305 @@ typedef struct cache_entry_s {
   gauge_t *history;
   size_t history_index; /* points to the next position to write to. */
   size_t history_length;
+  /* Used instead of `history' with "CacheHistory Compressed". Holds between
+   * `history_length' and twice as many steps, oldest first. */
+  gorilla_t *history_packed;
 
   meta_data_t *meta;
   unsigned long callbacks_mask;
-} cache_entry_t;
+
+  /* Position in the expiry wheel of the shard, see uc_check_timeout(). */
+  timer_wheel_entry_t expiry;
+
+  value_t storage[];
+};
+
+/* The cache is split into shards, each with its own lock and hash table.
+ * Entries are assigned to shards by a hash of their name, so threads updating
+ * different series rarely contend for the same lock.
+ *
+ * The hash can be computed directly from the identifier fields of a value list
+ * and entries can be compared to a value list without formatting its name, so
+ * the hot path (uc_update, uc_get_rate, the meta data functions, ...) never has
+ * to build the name string of a value list that is already in the cache. */
+#define UC_SHARDS_NUM 64
+#define UC_BUCKETS_INIT 64
+
+/* Each shard also keeps its entries in a timer wheel, so that
+ * uc_check_timeout() does not have to look at every entry. uc_update() does not
+ * touch the wheel: an entry stays in it with the time it would have expired at
+ * when it was inserted or last checked. When that time has come, the entry is
+ * either expired or re-inserted with the time it expires at now. */
+typedef struct {
+  pthread_mutex_t lock;
+  cache_entry_t **buckets;
+  size_t buckets_num; /* always a power of two */
+  size_t entries_num;
+  size_t memory; /* bytes allocated for the entries, see cache_memory() */
+  timer_wheel_t *expiry;
+} cache_shard_t;
+
+/* The iterator works on a snapshot of the cache, so that consumers walking
+ * many entries do not hold any lock while doing so. Names and values are
+ * stored in arrays shared by all entries; entries refer to them by offset,
+ * because the arrays are moved while they grow. */
+typedef struct {
+  size_t name;   /* offset into `names' */
+  size_t values; /* offset into `values' */
+  size_t values_num;
+  cdtime_t time;
+  cdtime_t interval;
+  uint8_t ident_len[5]; /* see cache_entry_t */
+} uc_snapshot_entry_t;
 
 struct uc_iter_s {
-  c_avl_iterator_t *iter;
+  uc_snapshot_entry_t *entries;
+  size_t entries_num;
+  size_t entries_size;
 
-  char *name;
-  cache_entry_t *entry;
+  char *names;
+  size_t names_len;
+  size_t names_size;
+
+  value_t *values;
+  size_t values_num;
+  size_t values_size;
+
+  /* Rates, at the same offsets as `values'. */
+  gauge_t *rates;
+  size_t rates_size;
+
+  /* Index of the next entry; `entry' is the current one. */
+  size_t index;
+  uc_snapshot_entry_t *entry;
 };
 
-static c_avl_tree_t *cache_tree;
-static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static cache_shard_t cache_shards[UC_SHARDS_NUM];
+static bool cache_initialized;
+static bool history_compressed;
+
+/* FNV-1a */
+#define UC_HASH_INIT 2166136261u
+
+static uint32_t uc_hash_update(uint32_t hash, const char *str) {
+  for (const unsigned char *c = (const unsigned char *)str; *c != 0; c++) {
+    hash ^= *c;
+    hash *= 16777619u;
+  }
+  return hash;
+} /* uint32_t uc_hash_update */
+
+static uint32_t uc_hash_name(const char *name) {
+  return uc_hash_update(UC_HASH_INIT, name);
+} /* uint32_t uc_hash_name */
+
+/* Returns the same hash as uc_hash_name() would for the name of `vl', without
+ * formatting it. Must be kept in sync with format_name(). */
+static uint32_t uc_hash_vl(const value_list_t *vl) {
+  uint32_t hash = UC_HASH_INIT;
+
+  hash = uc_hash_update(hash, vl->host);
+  hash = uc_hash_update(hash, "/");
+  hash = uc_hash_update(hash, vl->plugin);
+  if (vl->plugin_instance[0] != 0) {
+    hash = uc_hash_update(hash, "-");
+    hash = uc_hash_update(hash, vl->plugin_instance);
+  }
+  hash = uc_hash_update(hash, "/");
+  hash = uc_hash_update(hash, vl->type);
+  if (vl->type_instance[0] != 0) {
+    hash = uc_hash_update(hash, "-");
+    hash = uc_hash_update(hash, vl->type_instance);
+  }
+
+  return hash;
+} /* uint32_t uc_hash_vl */
+
+/* Returns true if `name' is the name of `vl'. Must be kept in sync with
+ * format_name(). */
+static bool uc_name_equal_vl(const char *name, const value_list_t *vl) {
+#define MATCH(str)                                                             \
+  do {                                                                         \
+    size_t l = strlen(str);                                                    \
+    if (strncmp(name, (str), l) != 0)                                          \
+      return false;                                                            \
+    name += l;                                                                 \
+  } while (0)
+
+  MATCH(vl->host);
+  MATCH("/");
+  MATCH(vl->plugin);
+  if (vl->plugin_instance[0] != 0) {
+    MATCH("-");
+    MATCH(vl->plugin_instance);
+  }
+  MATCH("/");
+  MATCH(vl->type);
+  if (vl->type_instance[0] != 0) {
+    MATCH("-");
+    MATCH(vl->type_instance);
+  }
+
+#undef MATCH
+  return name[0] == 0;
+} /* bool uc_name_equal_vl */
+
+static cache_shard_t *cache_shard(uint32_t hash) {
+  return cache_shards + (hash % UC_SHARDS_NUM);
+} /* cache_shard_t *cache_shard */
+
+static cache_entry_t **cache_bucket(cache_shard_t *shard, uint32_t hash) {
+  /* The lower bits select the shard, use the remaining ones for the bucket. */
+  return shard->buckets + ((hash / UC_SHARDS_NUM) & (shard->buckets_num - 1));
+} /* cache_entry_t **cache_bucket */
+
+/* Returns the number of bytes allocated for `ce', not counting meta data. */
+static size_t cache_memory(const cache_entry_t *ce) {
+  size_t ret = sizeof(*ce) +
+               ce->values_num * (sizeof(value_t) + sizeof(gauge_t)) +
+               strlen(ce->name) + 1;
+
+  if (ce->history != NULL)
+    ret += ce->history_length * ce->values_num * sizeof(gauge_t);
+  ret += gorilla_memory(ce->history_packed);
+
+  return ret;
+} /* size_t cache_memory */
+
+/* The following functions must be called with the shard lock held. */
+static cache_entry_t *shard_get(cache_shard_t *shard, uint32_t hash,
+                                const char *name) {
+  for (cache_entry_t *ce = *cache_bucket(shard, hash); ce != NULL;
+       ce = ce->next)
+    if ((ce->hash == hash) && (strcmp(ce->name, name) == 0))
+      return ce;
+
+  return NULL;
+} /* cache_entry_t *shard_get */
+
+static cache_entry_t *shard_get_vl(cache_shard_t *shard, uint32_t hash,
+                                   const value_list_t *vl) {
+  for (cache_entry_t *ce = *cache_bucket(shard, hash); ce != NULL;
+       ce = ce->next)
+    if ((ce->hash == hash) && uc_name_equal_vl(ce->name, vl))
+      return ce;
+
+  return NULL;
+} /* cache_entry_t *shard_get_vl */
+
+static void shard_grow(cache_shard_t *shard) {
+  size_t buckets_num = 2 * shard->buckets_num;
+  cache_entry_t **old_buckets = shard->buckets;
+  size_t old_buckets_num = shard->buckets_num;
+
+  cache_entry_t **buckets = calloc(buckets_num, sizeof(*buckets));
+  if (buckets == NULL) {
+    /* Not fatal, the chains just get longer. */
+    ERROR("utils_cache: shard_grow: calloc failed.");
+    return;
+  }
 
-static int cache_compare(const cache_entry_t *a, const cache_entry_t *b) {
-#if COLLECT_DEBUG
-  assert((a != NULL) && (b != NULL));
-#endif
-  return strcmp(a->name, b->name);
-} /* int cache_compare */
+  shard->buckets = buckets;
+  shard->buckets_num = buckets_num;
 
-static cache_entry_t *cache_alloc(size_t values_num) {
-  cache_entry_t *ce;
+  for (size_t i = 0; i < old_buckets_num; i++) {
+    cache_entry_t *ce = old_buckets[i];
+    while (ce != NULL) {
+      cache_entry_t *next = ce->next;
+      cache_entry_t **bucket = cache_bucket(shard, ce->hash);
+
+      ce->next = *bucket;
+      *bucket = ce;
+      ce = next;
+    }
+  }
 
-  ce = calloc(1, sizeof(*ce));
+  free(old_buckets);
+} /* void shard_grow */
+
+static void shard_insert(cache_shard_t *shard, cache_entry_t *ce) {
+  if (shard->entries_num >= shard->buckets_num)
+    shard_grow(shard);
+
+  cache_entry_t **bucket = cache_bucket(shard, ce->hash);
+  ce->next = *bucket;
+  *bucket = ce;
+  shard->entries_num++;
+  shard->memory += cache_memory(ce);
+} /* void shard_insert */
+
+static cache_entry_t *shard_remove(cache_shard_t *shard, uint32_t hash,
+                                   const char *name) {
+  for (cache_entry_t **ce = cache_bucket(shard, hash); *ce != NULL;
+       ce = &(*ce)->next) {
+    if (((*ce)->hash != hash) || (strcmp((*ce)->name, name) != 0))
+      continue;
+
+    cache_entry_t *ret = *ce;
+    *ce = ret->next;
+    ret->next = NULL;
+    shard->entries_num--;
+    shard->memory -= cache_memory(ret);
+    return ret;
+  }
+
+  return NULL;
+} /* cache_entry_t *shard_remove */
+
+/* Looks up `name' and returns the entry with the shard lock held. If the entry
+ * does not exist, returns NULL without holding the lock. */
+static cache_entry_t *cache_lock_entry(const char *name,
+                                       cache_shard_t **ret_shard) {
+  uint32_t hash = uc_hash_name(name);
+  cache_shard_t *shard = cache_shard(hash);
+
+  pthread_mutex_lock(&shard->lock);
+  cache_entry_t *ce = shard_get(shard, hash, name);
   if (ce == NULL) {
-    ERROR("utils_cache: cache_alloc: calloc failed.");
+    pthread_mutex_unlock(&shard->lock);
     return NULL;
   }
-  ce->values_num = values_num;
 
-  ce->values_gauge = calloc(values_num, sizeof(*ce->values_gauge));
-  ce->values_raw = calloc(values_num, sizeof(*ce->values_raw));
-  if ((ce->values_gauge == NULL) || (ce->values_raw == NULL)) {
-    sfree(ce->values_gauge);
-    sfree(ce->values_raw);
-    sfree(ce);
+  *ret_shard = shard;
+  return ce;
+} /* cache_entry_t *cache_lock_entry */
+
+/* Same as cache_lock_entry(), but looks up the entry of `vl'. */
+static cache_entry_t *cache_lock_entry_vl(const value_list_t *vl,
+                                          cache_shard_t **ret_shard) {
+  uint32_t hash = uc_hash_vl(vl);
+  cache_shard_t *shard = cache_shard(hash);
+
+  pthread_mutex_lock(&shard->lock);
+  cache_entry_t *ce = shard_get_vl(shard, hash, vl);
+  if (ce == NULL) {
+    pthread_mutex_unlock(&shard->lock);
+    return NULL;
+  }
+
+  *ret_shard = shard;
+  return ce;
+} /* cache_entry_t *cache_lock_entry_vl */
+
+static cache_entry_t *cache_alloc(size_t values_num, const char *name) {
+  size_t name_size = strlen(name) + 1;
+  cache_entry_t *ce =
+      calloc(1, sizeof(*ce) + values_num * sizeof(ce->storage[0]) +
+                    values_num * sizeof(*ce->values_gauge) + name_size);
+  if (ce == NULL) {
     ERROR("utils_cache: cache_alloc: calloc failed.");
     return NULL;
   }
+  ce->values_num = values_num;
+
+  ce->values_raw = ce->storage;
+  ce->values_gauge = (gauge_t *)(ce->values_raw + values_num);
+  ce->name = (char *)(ce->values_gauge + values_num);
+  memcpy(ce->name, name, name_size);
 
   ce->history = NULL;
   ce->history_length = 0;
+  ce->history_packed = NULL;
   ce->meta = NULL;
 
   return ce;
@@ -118,9 +388,8 @@ static void cache_free(cache_entry_t *ce) {
   if (ce == NULL)
     return;
 
-  sfree(ce->values_gauge);
-  sfree(ce->values_raw);
   sfree(ce->history);
+  gorilla_destroy(ce->history_packed);
   if (ce->meta != NULL) {
     meta_data_destroy(ce->meta);
     ce->meta = NULL;
@@ -139,24 +408,80 @@ static void uc_check_range(const data_set_t *ds, cache_entry_t *ce) {
   }
 } /* void uc_check_range */
 
-static int uc_insert(const data_set_t *ds, const value_list_t *vl,
-                     const char *key) {
-  /* `cache_lock' has been locked by `uc_update' */
+/* Returns the time at which `ce' expires unless it is updated before. */
+static cdtime_t uc_expiry_time(const cache_entry_t *ce) {
+  return ce->last_update + ce->interval * timeout_g;
+} /* cdtime_t uc_expiry_time */
+
+/* Splits `name' into its fields, whose lengths are given by `ident_len', using
+ * `buffer' which must be at least as long as the name. */
+static void cache_identifier(const char *name, const uint8_t ident_len[5],
+                             char *buffer, identifier_t *ret_ident) {
+  char *fields[5];
+  const char *src = name;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    size_t len = ident_len[i];
+
+    /* The instances are only present in the name if they are not empty. */
+    if (((i == 2) || (i == 4)) && (len == 0)) {
+      fields[i] = buffer;
+      buffer[0] = 0;
+      buffer++;
+      continue;
+    }
 
-  char *key_copy = strdup(key);
-  if (key_copy == NULL) {
-    ERROR("uc_insert: strdup failed.");
-    return -1;
+    memcpy(buffer, src, len);
+    buffer[len] = 0;
+    fields[i] = buffer;
+
+    /* Skip the separator, "/" or "-". */
+    src += len + 1;
+    buffer += len + 1;
   }
 
-  cache_entry_t *ce = cache_alloc(ds->ds_num);
+  *ret_ident = (identifier_t){
+      .host = fields[0],
+      .plugin = fields[1],
+      .plugin_instance = fields[2],
+      .type = fields[3],
+      .type_instance = fields[4],
+  };
+} /* void cache_identifier */
+
+/* Fills in the identifier of `vl' from the fields of `ce', without parsing
+ * the name. */
+static void cache_value_list(const cache_entry_t *ce, value_list_t *vl) {
+  char buffer[6 * DATA_MAX_NAME_LEN];
+  identifier_t ident;
+
+  cache_identifier(ce->name, ce->ident_len, buffer, &ident);
+  sstrncpy(vl->host, ident.host, sizeof(vl->host));
+  sstrncpy(vl->plugin, ident.plugin, sizeof(vl->plugin));
+  sstrncpy(vl->plugin_instance, ident.plugin_instance,
+           sizeof(vl->plugin_instance));
+  sstrncpy(vl->type, ident.type, sizeof(vl->type));
+  sstrncpy(vl->type_instance, ident.type_instance, sizeof(vl->type_instance));
+} /* void cache_value_list */
+
+/* Returns the new entry or NULL on error. */
+static cache_entry_t *uc_insert(cache_shard_t *shard, uint32_t hash,
+                                const data_set_t *ds, const value_list_t *vl,
+                                const char *key) {
+  /* The lock of `shard' has been locked by `uc_update_internal' */
+
+  cache_entry_t *ce = cache_alloc(ds->ds_num, key);
   if (ce == NULL) {
-    sfree(key_copy);
     ERROR("uc_insert: cache_alloc (%" PRIsz ") failed.", ds->ds_num);
-    return -1;
+    return NULL;
   }
 
-  sstrncpy(ce->name, key, sizeof(ce->name));
+  ce->hash = hash;
+  ce->ident_len[0] = (uint8_t)strlen(vl->host);
+  ce->ident_len[1] = (uint8_t)strlen(vl->plugin);
+  ce->ident_len[2] = (uint8_t)strlen(vl->plugin_instance);
+  ce->ident_len[3] = (uint8_t)strlen(vl->type);
+  ce->ident_len[4] = (uint8_t)strlen(vl->type_instance);
 
   for (size_t i = 0; i < ds->ds_num; i++) {
     switch (ds->ds[i].type) {
@@ -187,9 +512,8 @@ static int uc_insert(const data_set_t *ds, const value_list_t *vl,
       /* This shouldn't happen. */
       ERROR("uc_insert: Don't know how to handle data source type %i.",
             ds->ds[i].type);
-      sfree(key_copy);
       cache_free(ce);
-      return -1;
+      return NULL;
     } /* switch (ds->ds[i].type) */
   }   /* for (i) */
 
@@ -205,67 +529,91 @@ static int uc_insert(const data_set_t *ds, const value_list_t *vl,
     ce->meta = meta_data_clone(vl->meta);
   }
 
-  if (c_avl_insert(cache_tree, key_copy, ce) != 0) {
-    sfree(key_copy);
-    ERROR("uc_insert: c_avl_insert failed.");
-    return -1;
-  }
+  shard_insert(shard, ce);
+
+  ce->expiry.due = uc_expiry_time(ce);
+  ce->expiry.data = ce;
+  timer_wheel_insert(shard->expiry, &ce->expiry);
 
   DEBUG("uc_insert: Added %s to the cache.", key);
-  return 0;
-} /* int uc_insert */
+  return ce;
+} /* cache_entry_t *uc_insert */
 
 int uc_init(void) {
-  if (cache_tree == NULL)
-    cache_tree =
-        c_avl_create((int (*)(const void *, const void *))cache_compare);
+  if (cache_initialized)
+    return 0;
+
+  for (size_t i = 0; i < UC_SHARDS_NUM; i++) {
+    cache_shard_t *shard = cache_shards + i;
+
+    pthread_mutex_init(&shard->lock, /* attr = */ NULL);
+    shard->buckets = calloc(UC_BUCKETS_INIT, sizeof(*shard->buckets));
+    if (shard->buckets == NULL) {
+      ERROR("uc_init: calloc failed.");
+      return ENOMEM;
+    }
+    shard->buckets_num = UC_BUCKETS_INIT;
+
+    shard->expiry = timer_wheel_create(cdtime());
+    if (shard->expiry == NULL) {
+      ERROR("uc_init: timer_wheel_create failed.");
+      return ENOMEM;
+    }
+  }
+  cache_initialized = true;
 
   return 0;
 } /* int uc_init */
 
+/* Entries are only removed from the cache by this function, which is only
+ * called by one thread. The expired entries are therefore referenced directly
+ * while no lock is held. */
 int uc_check_timeout(void) {
-  struct {
-    char *key;
-    cdtime_t time;
-    cdtime_t interval;
-    unsigned long callbacks_mask;
-  } *expired = NULL;
+  cache_entry_t **expired = NULL;
   size_t expired_num = 0;
+  size_t expired_size = 0;
 
-  pthread_mutex_lock(&cache_lock);
   cdtime_t now = cdtime();
 
-  /* Build a list of entries to be flushed */
-  c_avl_iterator_t *iter = c_avl_get_iterator(cache_tree);
-  char *key = NULL;
-  cache_entry_t *ce = NULL;
-  while (c_avl_iterator_next(iter, (void *)&key, (void *)&ce) == 0) {
-    /* If the entry is fresh enough, continue. */
-    if ((now - ce->last_update) < (ce->interval * timeout_g))
-      continue;
-
-    void *tmp = realloc(expired, (expired_num + 1) * sizeof(*expired));
-    if (tmp == NULL) {
-      ERROR("uc_check_timeout: realloc failed.");
-      continue;
-    }
-    expired = tmp;
-
-    expired[expired_num].key = strdup(key);
-    expired[expired_num].time = ce->last_time;
-    expired[expired_num].interval = ce->interval;
-    expired[expired_num].callbacks_mask = ce->callbacks_mask;
+  /* Build a list of entries to be flushed. Only one shard is locked at a time,
+   * so writers to the other shards can continue, and only the entries which
+   * are due in the expiry wheel are looked at. */
+  for (size_t i = 0; i < UC_SHARDS_NUM; i++) {
+    cache_shard_t *shard = cache_shards + i;
+    cache_entry_t *ce;
+
+    pthread_mutex_lock(&shard->lock);
+
+    while ((ce = timer_wheel_get(shard->expiry, now)) != NULL) {
+      /* If the entry has been updated since it was inserted, it is not
+       * expired yet. */
+      cdtime_t expiry_time = uc_expiry_time(ce);
+      if (expiry_time > now) {
+        ce->expiry.due = expiry_time;
+        timer_wheel_insert(shard->expiry, &ce->expiry);
+        continue;
+      }
 
-    if (expired[expired_num].key == NULL) {
-      ERROR("uc_check_timeout: strdup failed.");
-      continue;
-    }
+      if (expired_num >= expired_size) {
+        size_t new_size = (expired_size == 0) ? 64 : 2 * expired_size;
+        cache_entry_t **tmp = realloc(expired, new_size * sizeof(*expired));
+        if (tmp == NULL) {
+          ERROR("uc_check_timeout: realloc failed.");
+          /* Try again during the next pass. */
+          ce->expiry.due = now + 1;
+          timer_wheel_insert(shard->expiry, &ce->expiry);
+          break;
+        }
+        expired = tmp;
+        expired_size = new_size;
+      }
 
-    expired_num++;
-  } /* while (c_avl_iterator_next) */
+      expired[expired_num] = ce;
+      expired_num++;
+    } /* while (timer_wheel_get) */
 
-  c_avl_iterator_destroy(iter);
-  pthread_mutex_unlock(&cache_lock);
+    pthread_mutex_unlock(&shard->lock);
+  } /* for (i = 0; i < UC_SHARDS_NUM; i++) */
 
   if (expired_num == 0) {
     sfree(expired);
@@ -278,81 +626,103 @@ int uc_check_timeout(void) {
    * without holding the lock, otherwise we will run into a deadlock if a
    * plugin calls the cache interface. */
   for (size_t i = 0; i < expired_num; i++) {
+    cache_entry_t *ce = expired[i];
+    cache_shard_t *shard = cache_shard(ce->hash);
+
+    pthread_mutex_lock(&shard->lock);
     value_list_t vl = {
-        .time = expired[i].time,
-        .interval = expired[i].interval,
+        .time = ce->last_time,
+        .interval = ce->interval,
     };
+    unsigned long callbacks_mask = ce->callbacks_mask;
+    pthread_mutex_unlock(&shard->lock);
 
-    if (parse_identifier_vl(expired[i].key, &vl) != 0) {
-      ERROR("uc_check_timeout: parse_identifier_vl (\"%s\") failed.",
-            expired[i].key);
-      continue;
-    }
+    /* The name and the lengths of its fields never change. */
+    cache_value_list(ce, &vl);
 
     plugin_dispatch_missing(&vl);
 
-    if (expired[i].callbacks_mask)
-      plugin_dispatch_cache_event(CE_VALUE_EXPIRED, expired[i].callbacks_mask,
-                                  expired[i].key, &vl);
+    if (callbacks_mask)
+      plugin_dispatch_cache_event(CE_VALUE_EXPIRED, callbacks_mask, ce->name,
+                                  &vl);
   } /* for (i = 0; i < expired_num; i++) */
 
   /* Now actually remove all the values from the cache. We don't re-evaluate
    * the timestamp again, so in theory it is possible we remove a value after
    * it is updated here. */
-  pthread_mutex_lock(&cache_lock);
   for (size_t i = 0; i < expired_num; i++) {
-    char *key = NULL;
-    cache_entry_t *value = NULL;
+    cache_entry_t *ce = expired[i];
+    cache_shard_t *shard = cache_shard(ce->hash);
+
+    pthread_mutex_lock(&shard->lock);
+    cache_entry_t *value = shard_remove(shard, ce->hash, ce->name);
+    pthread_mutex_unlock(&shard->lock);
 
-    if (c_avl_remove(cache_tree, expired[i].key, (void *)&key,
-                     (void *)&value) != 0) {
-      ERROR("uc_check_timeout: c_avl_remove (\"%s\") failed.", expired[i].key);
-      sfree(expired[i].key);
+    if (value == NULL) {
+      ERROR("uc_check_timeout: shard_remove (\"%s\") failed.", ce->name);
       continue;
     }
-    sfree(key);
+    assert(value == ce);
     cache_free(value);
-
-    sfree(expired[i].key);
   } /* for (i = 0; i < expired_num; i++) */
-  pthread_mutex_unlock(&cache_lock);
 
   sfree(expired);
   return 0;
 } /* int uc_check_timeout */
 
-int uc_update(const data_set_t *ds, const value_list_t *vl) {
+/* Copies the rates of `ce' to `ret_rates' unless `ret_rates' is NULL or the
+ * entry is missing. Must be called with the lock of the entry's shard held. */
+static bool uc_copy_rate_nolock(const cache_entry_t *ce, gauge_t *ret_rates) {
+  if ((ret_rates == NULL) || (ce->state == STATE_MISSING))
+    return false;
+
+  memcpy(ret_rates, ce->values_gauge, ce->values_num * sizeof(*ret_rates));
+  return true;
+} /* bool uc_copy_rate_nolock */
+
+/* Updates the entry of `vl'. If `ret_rates' is not NULL, the rates of the
+ * entry are copied to it while the entry is locked anyway and
+ * `ret_rates_copied' tells whether that was possible. */
+static int uc_update_internal(const data_set_t *ds, const value_list_t *vl,
+                              gauge_t *ret_rates, bool *ret_rates_copied) {
   char name[6 * DATA_MAX_NAME_LEN];
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("uc_update: FORMAT_VL failed.");
-    return -1;
-  }
-
-  pthread_mutex_lock(&cache_lock);
+  /* The name is only formatted if it is needed, i.e. for new entries, error
+   * messages and cache event callbacks. */
+  uint32_t hash = uc_hash_vl(vl);
+  cache_shard_t *shard = cache_shard(hash);
+  pthread_mutex_lock(&shard->lock);
 
-  cache_entry_t *ce = NULL;
-  int status = c_avl_get(cache_tree, name, (void *)&ce);
-  if (status != 0) /* entry does not yet exist */
+  cache_entry_t *ce = shard_get_vl(shard, hash, vl);
+  if (ce == NULL) /* entry does not yet exist */
   {
-    status = uc_insert(ds, vl, name);
-    pthread_mutex_unlock(&cache_lock);
+    if (FORMAT_VL(name, sizeof(name), vl) != 0) {
+      pthread_mutex_unlock(&shard->lock);
+      ERROR("uc_update: FORMAT_VL failed.");
+      return -1;
+    }
 
-    if (status == 0)
-      plugin_dispatch_cache_event(CE_VALUE_NEW, 0 /* mask */, name, vl);
+    ce = uc_insert(shard, hash, ds, vl, name);
+    if (ce != NULL)
+      *ret_rates_copied = uc_copy_rate_nolock(ce, ret_rates);
+    pthread_mutex_unlock(&shard->lock);
 
-    return status;
+    if (ce == NULL)
+      return -1;
+
+    plugin_dispatch_cache_event(CE_VALUE_NEW, 0 /* mask */, name, vl);
+    return 0;
   }
 
-  assert(ce != NULL);
   assert(ce->values_num == ds->ds_num);
 
   if (ce->last_time >= vl->time) {
-    pthread_mutex_unlock(&cache_lock);
+    cdtime_t last_time = ce->last_time;
+    sstrncpy(name, ce->name, sizeof(name));
+    pthread_mutex_unlock(&shard->lock);
     NOTICE("uc_update: Value too old: name = %s; value time = %.3f; "
            "last cache update = %.3f;",
-           name, CDTIME_T_TO_DOUBLE(vl->time),
-           CDTIME_T_TO_DOUBLE(ce->last_time));
+           name, CDTIME_T_TO_DOUBLE(vl->time), CDTIME_T_TO_DOUBLE(last_time));
     return -1;
   }
 
@@ -387,13 +757,14 @@ int uc_update(const data_set_t *ds, const value_list_t *vl) {
 
     default:
       /* This shouldn't happen. */
-      pthread_mutex_unlock(&cache_lock);
+      pthread_mutex_unlock(&shard->lock);
       ERROR("uc_update: Don't know how to handle data source type %i.",
             ds->ds[i].type);
       return -1;
     } /* switch (ds->ds[i].type) */
 
-    DEBUG("uc_update: %s: ds[%" PRIsz "] = %lf", name, i, ce->values_gauge[i]);
+    DEBUG("uc_update: %s: ds[%" PRIsz "] = %lf", ce->name, i,
+          ce->values_gauge[i]);
   } /* for (i) */
 
   /* Update the history if it exists. */
@@ -406,6 +777,16 @@ int uc_update(const data_set_t *ds, const value_list_t *vl) {
 
     assert(ce->history_length > 0);
     ce->history_index = (ce->history_index + 1) % ce->history_length;
+  } else if (ce->history_packed != NULL) {
+    shard->memory -= gorilla_memory(ce->history_packed);
+
+    if (gorilla_append(ce->history_packed, ce->values_gauge) != 0)
+      ERROR("uc_update: gorilla_append failed.");
+    /* Drop the oldest half, so that encoding again is amortized. */
+    if (gorilla_rows(ce->history_packed) >= 2 * ce->history_length)
+      gorilla_truncate(ce->history_packed, ce->history_length);
+
+    shard->memory += gorilla_memory(ce->history_packed);
   }
 
   /* Prune invalid gauge data */
@@ -415,96 +796,205 @@ int uc_update(const data_set_t *ds, const value_list_t *vl) {
   ce->last_update = cdtime();
   ce->interval = vl->interval;
 
+  *ret_rates_copied = uc_copy_rate_nolock(ce, ret_rates);
+
   /* Check if cache entry has registered callbacks */
   unsigned long callbacks_mask = ce->callbacks_mask;
+  if (callbacks_mask)
+    sstrncpy(name, ce->name, sizeof(name));
 
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->lock);
 
   if (callbacks_mask)
     plugin_dispatch_cache_event(CE_VALUE_UPDATE, callbacks_mask, name, vl);
 
   return 0;
+} /* int uc_update_internal */
+
+int uc_update(const data_set_t *ds, const value_list_t *vl) {
+  bool rates_copied = false;
+  return uc_update_internal(ds, vl, NULL, &rates_copied);
 } /* int uc_update */
 
+int uc_update_rate(const data_set_t *ds, const value_list_t *vl,
+                   gauge_t *ret_rates) {
+  bool rates_copied = false;
+
+  if ((ds == NULL) || (vl == NULL) || (ret_rates == NULL))
+    return EINVAL;
+
+  int status = uc_update_internal(ds, vl, ret_rates, &rates_copied);
+  if (status != 0)
+    return status;
+
+  return rates_copied ? 0 : -1;
+} /* int uc_update_rate */
+
 int uc_set_callbacks_mask(const char *name, unsigned long mask) {
-  pthread_mutex_lock(&cache_lock);
-  cache_entry_t *ce = NULL;
-  int status = c_avl_get(cache_tree, name, (void *)&ce);
-  if (status != 0) { /* Ouch, just created entry disappeared ?! */
+  cache_shard_t *shard = NULL;
+  cache_entry_t *ce = cache_lock_entry(name, &shard);
+  if (ce == NULL) { /* Ouch, just created entry disappeared ?! */
     ERROR("uc_set_callbacks_mask: Couldn't find %s entry!", name);
-    pthread_mutex_unlock(&cache_lock);
     return -1;
   }
   DEBUG("uc_set_callbacks_mask: set mask for \"%s\" to %lu.", name, mask);
   ce->callbacks_mask = mask;
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->lock);
   return 0;
 }
 
-int uc_get_rate_by_name(const char *name, gauge_t **ret_values,
-                        size_t *ret_values_num) {
-  gauge_t *ret = NULL;
-  size_t ret_num = 0;
-  cache_entry_t *ce = NULL;
+/* Copies the rates of `ce' and releases the lock of `shard'. */
+static int uc_copy_rate_unlock(cache_shard_t *shard, cache_entry_t *ce,
+                               gauge_t **ret_values, size_t *ret_values_num) {
   int status = 0;
 
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
-
-    /* remove missing values from getval */
-    if (ce->state == STATE_MISSING) {
-      DEBUG("utils_cache: uc_get_rate_by_name: requested metric \"%s\" is in "
-            "state \"missing\".",
-            name);
+  /* remove missing values from getval */
+  if (ce->state == STATE_MISSING) {
+    DEBUG("utils_cache: uc_get_rate: requested metric \"%s\" is in "
+          "state \"missing\".",
+          ce->name);
+    status = -1;
+  } else {
+    gauge_t *ret = malloc(ce->values_num * sizeof(*ret));
+    if (ret == NULL) {
+      ERROR("utils_cache: uc_get_rate: malloc failed.");
       status = -1;
     } else {
-      ret_num = ce->values_num;
-      ret = malloc(ret_num * sizeof(*ret));
-      if (ret == NULL) {
-        ERROR("utils_cache: uc_get_rate_by_name: malloc failed.");
-        status = -1;
-      } else {
-        memcpy(ret, ce->values_gauge, ret_num * sizeof(gauge_t));
-      }
+      memcpy(ret, ce->values_gauge, ce->values_num * sizeof(gauge_t));
+      *ret_values = ret;
+      *ret_values_num = ce->values_num;
     }
-  } else {
-    DEBUG("utils_cache: uc_get_rate_by_name: No such value: %s", name);
-    status = -1;
   }
 
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->lock);
+  return status;
+} /* int uc_copy_rate_unlock */
+
+int uc_get_rate_by_name(const char *name, gauge_t **ret_values,
+                        size_t *ret_values_num) {
+  cache_shard_t *shard = NULL;
 
-  if (status == 0) {
-    *ret_values = ret;
-    *ret_values_num = ret_num;
+  cache_entry_t *ce = cache_lock_entry(name, &shard);
+  if (ce == NULL) {
+    DEBUG("utils_cache: uc_get_rate_by_name: No such value: %s", name);
+    return -1;
   }
 
-  return status;
+  return uc_copy_rate_unlock(shard, ce, ret_values, ret_values_num);
 } /* gauge_t *uc_get_rate_by_name */
 
-gauge_t *uc_get_rate(const data_set_t *ds, const value_list_t *vl) {
-  char name[6 * DATA_MAX_NAME_LEN];
-  gauge_t *ret = NULL;
-  size_t ret_num = 0;
-  int status;
+/* The value lists a thread is handing to write callbacks, see
+ * uc_set_write_batch(). Allocated once per thread. */
+typedef struct {
+  const write_batch_entry_t *entries;
+  size_t entries_num;
+  /* Index of the entry found last. Write callbacks usually look up the value
+   * lists in order, so the search starts there. */
+  size_t hint;
+} uc_write_batch_t;
+
+static pthread_key_t write_batch_key;
+static pthread_once_t write_batch_once = PTHREAD_ONCE_INIT;
+
+static void uc_write_batch_init(void) {
+  pthread_key_create(&write_batch_key, free);
+} /* void uc_write_batch_init */
+
+void uc_set_write_batch(const write_batch_entry_t *entries,
+                        size_t entries_num) {
+  pthread_once(&write_batch_once, uc_write_batch_init);
+
+  uc_write_batch_t *batch = pthread_getspecific(write_batch_key);
+  if (batch == NULL) {
+    if (entries == NULL)
+      return;
+
+    batch = calloc(1, sizeof(*batch));
+    if (batch == NULL)
+      return;
+    pthread_setspecific(write_batch_key, batch);
+  }
+
+  batch->entries = (entries_num > 0) ? entries : NULL;
+  batch->entries_num = entries_num;
+  batch->hint = 0;
+} /* void uc_set_write_batch */
+
+void uc_get_write_batch(const write_batch_entry_t **ret_entries,
+                        size_t *ret_entries_num) {
+  pthread_once(&write_batch_once, uc_write_batch_init);
+
+  uc_write_batch_t *batch = pthread_getspecific(write_batch_key);
+  *ret_entries = (batch != NULL) ? batch->entries : NULL;
+  *ret_entries_num = (batch != NULL) ? batch->entries_num : 0;
+} /* void uc_get_write_batch */
+
+/* Returns the rates of `vl' computed by uc_update_rate() if `vl' belongs to
+ * the batch being written by this thread. */
+static const gauge_t *uc_write_batch_rates(const data_set_t *ds,
+                                           const value_list_t *vl) {
+  pthread_once(&write_batch_once, uc_write_batch_init);
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("utils_cache: uc_get_rate: FORMAT_VL failed.");
+  uc_write_batch_t *batch = pthread_getspecific(write_batch_key);
+  if ((batch == NULL) || (batch->entries == NULL))
     return NULL;
+
+  for (size_t i = 0; i < batch->entries_num; i++) {
+    size_t index = (batch->hint + i) % batch->entries_num;
+    const write_batch_entry_t *entry = batch->entries + index;
+    if (entry->vl != vl)
+      continue;
+
+    batch->hint = index;
+    if ((entry->rates == NULL) || (entry->ds->ds_num != ds->ds_num))
+      return NULL;
+    return entry->rates;
   }
 
-  status = uc_get_rate_by_name(name, &ret, &ret_num);
-  if (status != 0)
-    return NULL;
+  return NULL;
+} /* const gauge_t *uc_write_batch_rates */
+
+int uc_get_rate_buffer(const data_set_t *ds, const value_list_t *vl,
+                       gauge_t *ret_rates) {
+  if ((ds == NULL) || (vl == NULL) || (ret_rates == NULL))
+    return EINVAL;
+
+  const gauge_t *rates = uc_write_batch_rates(ds, vl);
+  if (rates != NULL) {
+    memcpy(ret_rates, rates, ds->ds_num * sizeof(*ret_rates));
+    return 0;
+  }
+
+  cache_shard_t *shard = NULL;
+  cache_entry_t *ce = cache_lock_entry_vl(vl, &shard);
+  if (ce == NULL)
+    return -1;
 
   /* This is important - the caller has no other way of knowing how many
    * values are returned. */
-  if (ret_num != ds->ds_num) {
-    ERROR("utils_cache: uc_get_rate: ds[%s] has %" PRIsz " values, "
-          "but uc_get_rate_by_name returned %" PRIsz ".",
-          ds->type, ds->ds_num, ret_num);
+  if (ce->values_num != ds->ds_num) {
+    size_t values_num = ce->values_num;
+    pthread_mutex_unlock(&shard->lock);
+    ERROR("utils_cache: uc_get_rate_buffer: ds[%s] has %" PRIsz " values, "
+          "but the cache holds %" PRIsz ".",
+          ds->type, ds->ds_num, values_num);
+    return -1;
+  }
+
+  bool copied = uc_copy_rate_nolock(ce, ret_rates);
+  pthread_mutex_unlock(&shard->lock);
+
+  return copied ? 0 : -1;
+} /* int uc_get_rate_buffer */
+
+gauge_t *uc_get_rate(const data_set_t *ds, const value_list_t *vl) {
+  gauge_t *ret = calloc(ds->ds_num, sizeof(*ret));
+  if (ret == NULL) {
+    ERROR("utils_cache: uc_get_rate: calloc failed.");
+    return NULL;
+  }
+
+  if (uc_get_rate_buffer(ds, vl, ret) != 0) {
     sfree(ret);
     return NULL;
   }
@@ -512,153 +1002,309 @@ gauge_t *uc_get_rate(const data_set_t *ds, const value_list_t *vl) {
   return ret;
 } /* gauge_t *uc_get_rate */
 
-int uc_get_value_by_name(const char *name, value_t **ret_values,
-                         size_t *ret_values_num) {
-  value_t *ret = NULL;
-  size_t ret_num = 0;
-  cache_entry_t *ce = NULL;
+/* Copies the raw values of `ce' and releases the lock of `shard'. */
+static int uc_copy_value_unlock(cache_shard_t *shard, cache_entry_t *ce,
+                                value_t **ret_values, size_t *ret_values_num) {
   int status = 0;
 
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
-
-    /* remove missing values from getval */
-    if (ce->state == STATE_MISSING) {
+  /* remove missing values from getval */
+  if (ce->state == STATE_MISSING) {
+    status = -1;
+  } else {
+    value_t *ret = malloc(ce->values_num * sizeof(*ret));
+    if (ret == NULL) {
+      ERROR("utils_cache: uc_get_value: malloc failed.");
       status = -1;
     } else {
-      ret_num = ce->values_num;
-      ret = malloc(ret_num * sizeof(*ret));
-      if (ret == NULL) {
-        ERROR("utils_cache: uc_get_value_by_name: malloc failed.");
-        status = -1;
-      } else {
-        memcpy(ret, ce->values_raw, ret_num * sizeof(value_t));
-      }
+      memcpy(ret, ce->values_raw, ce->values_num * sizeof(value_t));
+      *ret_values = ret;
+      *ret_values_num = ce->values_num;
     }
-  } else {
-    DEBUG("utils_cache: uc_get_value_by_name: No such value: %s", name);
-    status = -1;
   }
 
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->lock);
+  return status;
+} /* int uc_copy_value_unlock */
+
+int uc_get_value_by_name(const char *name, value_t **ret_values,
+                         size_t *ret_values_num) {
+  cache_shard_t *shard = NULL;
 
-  if (status == 0) {
-    *ret_values = ret;
-    *ret_values_num = ret_num;
+  cache_entry_t *ce = cache_lock_entry(name, &shard);
+  if (ce == NULL) {
+    DEBUG("utils_cache: uc_get_value_by_name: No such value: %s", name);
+    return -1;
   }
 
-  return (status);
+  return uc_copy_value_unlock(shard, ce, ret_values, ret_values_num);
 } /* int uc_get_value_by_name */
 
 value_t *uc_get_value(const data_set_t *ds, const value_list_t *vl) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
   value_t *ret = NULL;
   size_t ret_num = 0;
-  int status;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("utils_cache: uc_get_value: FORMAT_VL failed.");
-    return (NULL);
-  }
+  cache_entry_t *ce = cache_lock_entry_vl(vl, &shard);
+  if (ce == NULL)
+    return NULL;
 
-  status = uc_get_value_by_name(name, &ret, &ret_num);
-  if (status != 0)
-    return (NULL);
+  if (uc_copy_value_unlock(shard, ce, &ret, &ret_num) != 0)
+    return NULL;
 
   /* This is important - the caller has no other way of knowing how many
    * values are returned. */
   if (ret_num != (size_t)ds->ds_num) {
     ERROR("utils_cache: uc_get_value: ds[%s] has %" PRIsz " values, "
-          "but uc_get_value_by_name returned %" PRIsz ".",
+          "but the cache holds %" PRIsz ".",
           ds->type, ds->ds_num, ret_num);
     sfree(ret);
-    return (NULL);
+    return NULL;
   }
 
-  return (ret);
+  return ret;
 } /* value_t *uc_get_value */
 
+size_t uc_get_memory(void) {
+  size_t memory = 0;
+
+  for (size_t i = 0; i < UC_SHARDS_NUM; i++) {
+    pthread_mutex_lock(&cache_shards[i].lock);
+    memory += cache_shards[i].memory;
+    pthread_mutex_unlock(&cache_shards[i].lock);
+  }
+
+  return memory;
+} /* size_t uc_get_memory */
+
+void uc_set_history_compression(bool enable) {
+  history_compressed = enable;
+} /* void uc_set_history_compression */
+
 size_t uc_get_size(void) {
   size_t size_arrays = 0;
 
-  pthread_mutex_lock(&cache_lock);
-  size_arrays = (size_t)c_avl_size(cache_tree);
-  pthread_mutex_unlock(&cache_lock);
+  for (size_t i = 0; i < UC_SHARDS_NUM; i++) {
+    pthread_mutex_lock(&cache_shards[i].lock);
+    size_arrays += cache_shards[i].entries_num;
+    pthread_mutex_unlock(&cache_shards[i].lock);
+  }
 
   return size_arrays;
 }
 
-int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number) {
-  c_avl_iterator_t *iter;
-  char *key;
-  cache_entry_t *value;
+/* Grows `*array' to hold at least `need' elements of `elem_size' bytes. */
+static int uc_snapshot_reserve(void **array, size_t *size, size_t need,
+                               size_t elem_size) {
+  if (need <= *size)
+    return 0;
 
-  char **names = NULL;
-  cdtime_t *times = NULL;
-  size_t number = 0;
-  size_t size_arrays = 0;
+  size_t new_size = (*size == 0) ? 64 : *size;
+  while (new_size < need)
+    new_size *= 2;
 
-  int status = 0;
+  void *tmp = realloc(*array, new_size * elem_size);
+  if (tmp == NULL)
+    return ENOMEM;
+
+  *array = tmp;
+  *size = new_size;
+  return 0;
+} /* int uc_snapshot_reserve */
+
+/* Copies the entries of `shard' to `iter'. Entries in state "missing" are
+ * skipped. Values are only copied if `with_values' is true.
+ * NOTE: You must hold the shard lock when calling this function! */
+static int uc_snapshot_shard_nolock(uc_iter_t *iter, cache_shard_t *shard,
+                                    bool with_values) {
+  int status = uc_snapshot_reserve(
+      (void *)&iter->entries, &iter->entries_size,
+      iter->entries_num + shard->entries_num, sizeof(*iter->entries));
+  if (status != 0)
+    return status;
+
+  for (size_t i = 0; i < shard->buckets_num; i++) {
+    for (cache_entry_t *ce = shard->buckets[i]; ce != NULL; ce = ce->next) {
+      if (ce->state == STATE_MISSING)
+        continue;
+
+      size_t name_size = strlen(ce->name) + 1;
+      status = uc_snapshot_reserve((void *)&iter->names, &iter->names_size,
+                                   iter->names_len + name_size, 1);
+      if ((status == 0) && with_values)
+        status = uc_snapshot_reserve(
+            (void *)&iter->values, &iter->values_size,
+            iter->values_num + ce->values_num, sizeof(*iter->values));
+      if ((status == 0) && with_values)
+        status = uc_snapshot_reserve(
+            (void *)&iter->rates, &iter->rates_size,
+            iter->values_num + ce->values_num, sizeof(*iter->rates));
+      if (status != 0)
+        return status;
+
+      uc_snapshot_entry_t *e = iter->entries + iter->entries_num;
+      *e = (uc_snapshot_entry_t){
+          .name = iter->names_len,
+          .values = iter->values_num,
+          .time = ce->last_time,
+          .interval = ce->interval,
+      };
+      memcpy(e->ident_len, ce->ident_len, sizeof(e->ident_len));
+      memcpy(iter->names + iter->names_len, ce->name, name_size);
+      iter->names_len += name_size;
+
+      if (with_values) {
+        memcpy(iter->values + iter->values_num, ce->values_raw,
+               ce->values_num * sizeof(*iter->values));
+        memcpy(iter->rates + iter->values_num, ce->values_gauge,
+               ce->values_num * sizeof(*iter->rates));
+        e->values_num = ce->values_num;
+        iter->values_num += ce->values_num;
+      }
+
+      iter->entries_num++;
+    } /* for (ce) */
+  }   /* for (i = 0; i < shard->buckets_num; i++) */
+
+  return 0;
+} /* int uc_snapshot_shard_nolock */
+
+/* Removes the entries from index `first' on that `filter' does not accept.
+ * The names and values of the remaining entries are moved down, so the
+ * snapshot only keeps what has been accepted. This is done without holding
+ * any lock, so a slow filter does not hold up updates of the cache. */
+static void uc_snapshot_filter(uc_iter_t *iter, size_t first,
+                               uc_iter_filter_t filter, void *user_data) {
+  if (first >= iter->entries_num)
+    return;
+
+  size_t entries_num = first;
+  size_t names_len = iter->entries[first].name;
+  size_t values_num = iter->entries[first].values;
+
+  for (size_t i = first; i < iter->entries_num; i++) {
+    uc_snapshot_entry_t e = iter->entries[i];
+    char buffer[6 * DATA_MAX_NAME_LEN];
+    identifier_t ident;
+
+    cache_identifier(iter->names + e.name, e.ident_len, buffer, &ident);
+    if (!filter(&ident, user_data))
+      continue;
+
+    size_t name_size = strlen(iter->names + e.name) + 1;
+    memmove(iter->names + names_len, iter->names + e.name, name_size);
+    e.name = names_len;
+    names_len += name_size;
+
+    if (e.values_num > 0) {
+      memmove(iter->values + values_num, iter->values + e.values,
+              e.values_num * sizeof(*iter->values));
+      memmove(iter->rates + values_num, iter->rates + e.values,
+              e.values_num * sizeof(*iter->rates));
+    }
+    e.values = values_num;
+    values_num += e.values_num;
+
+    iter->entries[entries_num++] = e;
+  }
+
+  iter->entries_num = entries_num;
+  iter->names_len = names_len;
+  iter->values_num = values_num;
+} /* void uc_snapshot_filter */
+
+/* Creates a snapshot of the cache. Each shard is locked only while it is
+ * copied, so the snapshot is consistent per shard rather than for the whole
+ * cache. */
+static uc_iter_t *uc_snapshot_create(bool with_values, uc_iter_filter_t filter,
+                                     void *user_data) {
+  uc_iter_t *iter = calloc(1, sizeof(*iter));
+  if (iter == NULL)
+    return NULL;
+
+  for (size_t i = 0; i < UC_SHARDS_NUM; i++) {
+    cache_shard_t *shard = cache_shards + i;
+
+    size_t first = iter->entries_num;
+
+    pthread_mutex_lock(&shard->lock);
+    int status = uc_snapshot_shard_nolock(iter, shard, with_values);
+    pthread_mutex_unlock(&shard->lock);
+
+    if (status != 0) {
+      ERROR("utils_cache: Creating a snapshot of the cache failed.");
+      uc_iterator_destroy(iter);
+      return NULL;
+    }
+
+    if (filter != NULL)
+      uc_snapshot_filter(iter, first, filter, user_data);
+  }
+
+  return iter;
+} /* uc_iter_t *uc_snapshot_create */
+
+typedef struct {
+  char *name;
+  cdtime_t time;
+} uc_name_t;
 
+static int uc_name_compare(const void *a, const void *b) {
+  return strcmp(((const uc_name_t *)a)->name, ((const uc_name_t *)b)->name);
+} /* int uc_name_compare */
+
+int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number) {
   if ((ret_names == NULL) || (ret_number == NULL))
     return -1;
 
-  pthread_mutex_lock(&cache_lock);
+  /* The names are copied without holding any lock. */
+  uc_iter_t *iter = uc_snapshot_create(/* with_values = */ false, NULL, NULL);
+  if (iter == NULL)
+    return ENOMEM;
 
-  size_arrays = (size_t)c_avl_size(cache_tree);
-  if (size_arrays < 1) {
+  size_t number = iter->entries_num;
+  if (number == 0) {
     /* Handle the "no values" case here, to avoid the error message when
      * calloc() returns NULL. */
-    pthread_mutex_unlock(&cache_lock);
+    uc_iterator_destroy(iter);
     return 0;
   }
 
-  names = calloc(size_arrays, sizeof(*names));
-  times = calloc(size_arrays, sizeof(*times));
-  if ((names == NULL) || (times == NULL)) {
+  uc_name_t *entries = calloc(number, sizeof(*entries));
+  char **names = calloc(number, sizeof(*names));
+  cdtime_t *times = calloc(number, sizeof(*times));
+  if ((entries == NULL) || (names == NULL) || (times == NULL)) {
     ERROR("uc_get_names: calloc failed.");
+    uc_iterator_destroy(iter);
+    sfree(entries);
     sfree(names);
     sfree(times);
-    pthread_mutex_unlock(&cache_lock);
     return ENOMEM;
   }
 
-  iter = c_avl_get_iterator(cache_tree);
-  while (c_avl_iterator_next(iter, (void *)&key, (void *)&value) == 0) {
-    /* remove missing values when list values */
-    if (value->state == STATE_MISSING)
-      continue;
-
-    /* c_avl_size does not return a number smaller than the number of elements
-     * returned by c_avl_iterator_next. */
-    assert(number < size_arrays);
-
-    if (ret_times != NULL)
-      times[number] = value->last_time;
-
-    names[number] = strdup(key);
-    if (names[number] == NULL) {
-      status = -1;
-      break;
-    }
-
-    number++;
-  } /* while (c_avl_iterator_next) */
-
-  c_avl_iterator_destroy(iter);
-  pthread_mutex_unlock(&cache_lock);
+  for (size_t i = 0; i < number; i++) {
+    entries[i].name = iter->names + iter->entries[i].name;
+    entries[i].time = iter->entries[i].time;
+  }
 
-  if (status != 0) {
-    for (size_t i = 0; i < number; i++) {
-      sfree(names[i]);
+  /* Entries are spread over the shards; return them sorted by name, like the
+   * single tree used to. */
+  qsort(entries, number, sizeof(*entries), uc_name_compare);
+  for (size_t i = 0; i < number; i++) {
+    names[i] = strdup(entries[i].name);
+    times[i] = entries[i].time;
+    if (names[i] == NULL) {
+      ERROR("uc_get_names: strdup failed.");
+      for (size_t j = 0; j < i; j++)
+        sfree(names[j]);
+      uc_iterator_destroy(iter);
+      sfree(entries);
+      sfree(names);
+      sfree(times);
+      return -1;
     }
-    sfree(names);
-    sfree(times);
-
-    return -1;
   }
+  sfree(entries);
+  uc_iterator_destroy(iter);
 
   *ret_names = names;
   if (ret_times != NULL)
@@ -671,68 +1317,86 @@ int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number) {
 } /* int uc_get_names */
 
 int uc_get_state(const data_set_t *ds, const value_list_t *vl) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
   cache_entry_t *ce = NULL;
   int ret = STATE_ERROR;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("uc_get_state: FORMAT_VL failed.");
-    return STATE_ERROR;
-  }
-
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce != NULL) {
     ret = ce->state;
+    pthread_mutex_unlock(&shard->lock);
   }
 
-  pthread_mutex_unlock(&cache_lock);
-
   return ret;
 } /* int uc_get_state */
 
 int uc_set_state(const data_set_t *ds, const value_list_t *vl, int state) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
   cache_entry_t *ce = NULL;
   int ret = -1;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("uc_set_state: FORMAT_VL failed.");
-    return STATE_ERROR;
-  }
-
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce != NULL) {
     ret = ce->state;
     ce->state = state;
+    pthread_mutex_unlock(&shard->lock);
   }
 
-  pthread_mutex_unlock(&cache_lock);
-
   return ret;
 } /* int uc_set_state */
 
-int uc_get_history_by_name(const char *name, gauge_t *ret_history,
-                           size_t num_steps, size_t num_ds) {
-  cache_entry_t *ce = NULL;
-  int status = 0;
-
-  pthread_mutex_lock(&cache_lock);
-
-  status = c_avl_get(cache_tree, name, (void *)&ce);
-  if (status != 0) {
-    pthread_mutex_unlock(&cache_lock);
-    return -ENOENT;
+/* Copies the compressed history of `ce', newest step first.
+ * NOTE: You must hold the shard lock when calling this function! */
+static void uc_copy_history_packed_nolock(cache_entry_t *ce,
+                                          gauge_t *ret_history,
+                                          size_t num_steps) {
+  size_t num_ds = ce->values_num;
+
+  /* Decoded oldest first, so reverse the order of the steps. */
+  size_t num = gorilla_decode(ce->history_packed, ret_history, num_steps);
+  for (size_t i = 0; i < num / 2; i++) {
+    gauge_t *a = ret_history + i * num_ds;
+    gauge_t *b = ret_history + (num - 1 - i) * num_ds;
+    for (size_t j = 0; j < num_ds; j++) {
+      gauge_t tmp = a[j];
+      a[j] = b[j];
+      b[j] = tmp;
+    }
   }
 
+  for (size_t i = num * num_ds; i < num_steps * num_ds; i++)
+    ret_history[i] = NAN;
+} /* void uc_copy_history_packed_nolock */
+
+/* Copies the history of `ce' and releases the lock of `shard'. */
+static int uc_copy_history_unlock(cache_shard_t *shard, cache_entry_t *ce,
+                                  gauge_t *ret_history, size_t num_steps,
+                                  size_t num_ds) {
   if (((size_t)ce->values_num) != num_ds) {
-    pthread_mutex_unlock(&cache_lock);
+    pthread_mutex_unlock(&shard->lock);
     return -EINVAL;
   }
 
+  /* The storage is chosen when the history is requested for the first time. */
+  if ((ce->history == NULL) && (ce->history_packed == NULL) &&
+      history_compressed) {
+    ce->history_packed = gorilla_create(ce->values_num);
+    if (ce->history_packed == NULL) {
+      pthread_mutex_unlock(&shard->lock);
+      return -ENOMEM;
+    }
+    shard->memory += gorilla_memory(ce->history_packed);
+  }
+
+  if (ce->history_packed != NULL) {
+    if (ce->history_length < num_steps)
+      ce->history_length = num_steps;
+
+    uc_copy_history_packed_nolock(ce, ret_history, num_steps);
+    pthread_mutex_unlock(&shard->lock);
+    return 0;
+  }
+
   /* Check if there are enough values available. If not, increase the buffer
    * size. */
   if (ce->history_length < num_steps) {
@@ -741,7 +1405,7 @@ int uc_get_history_by_name(const char *name, gauge_t *ret_history,
     tmp =
         realloc(ce->history, sizeof(*ce->history) * num_steps * ce->values_num);
     if (tmp == NULL) {
-      pthread_mutex_unlock(&cache_lock);
+      pthread_mutex_unlock(&shard->lock);
       return -ENOMEM;
     }
 
@@ -749,6 +1413,8 @@ int uc_get_history_by_name(const char *name, gauge_t *ret_history,
          i < (num_steps * ce->values_num); i++)
       tmp[i] = NAN;
 
+    shard->memory +=
+        (num_steps - ce->history_length) * ce->values_num * sizeof(*tmp);
     ce->history = tmp;
     ce->history_length = num_steps;
   } /* if (ce->history_length < num_steps) */
@@ -770,131 +1436,127 @@ int uc_get_history_by_name(const char *name, gauge_t *ret_history,
            sizeof(*ret_history) * num_ds);
   }
 
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->lock);
 
   return 0;
+} /* int uc_copy_history_unlock */
+
+int uc_get_history_by_name(const char *name, gauge_t *ret_history,
+                           size_t num_steps, size_t num_ds) {
+  cache_shard_t *shard = NULL;
+
+  cache_entry_t *ce = cache_lock_entry(name, &shard);
+  if (ce == NULL)
+    return -ENOENT;
+
+  return uc_copy_history_unlock(shard, ce, ret_history, num_steps, num_ds);
 } /* int uc_get_history_by_name */
 
 int uc_get_history(const data_set_t *ds, const value_list_t *vl,
                    gauge_t *ret_history, size_t num_steps, size_t num_ds) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("utils_cache: uc_get_history: FORMAT_VL failed.");
-    return -1;
-  }
+  cache_entry_t *ce = cache_lock_entry_vl(vl, &shard);
+  if (ce == NULL)
+    return -ENOENT;
 
-  return uc_get_history_by_name(name, ret_history, num_steps, num_ds);
+  return uc_copy_history_unlock(shard, ce, ret_history, num_steps, num_ds);
 } /* int uc_get_history */
 
 int uc_get_hits(const data_set_t *ds, const value_list_t *vl) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
   cache_entry_t *ce = NULL;
   int ret = STATE_ERROR;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("uc_get_hits: FORMAT_VL failed.");
-    return STATE_ERROR;
-  }
-
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce != NULL) {
     ret = ce->hits;
+    pthread_mutex_unlock(&shard->lock);
   }
 
-  pthread_mutex_unlock(&cache_lock);
-
   return ret;
 } /* int uc_get_hits */
 
 int uc_set_hits(const data_set_t *ds, const value_list_t *vl, int hits) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
   cache_entry_t *ce = NULL;
   int ret = -1;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("uc_set_hits: FORMAT_VL failed.");
-    return STATE_ERROR;
-  }
-
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce != NULL) {
     ret = ce->hits;
     ce->hits = hits;
+    pthread_mutex_unlock(&shard->lock);
   }
 
-  pthread_mutex_unlock(&cache_lock);
-
   return ret;
 } /* int uc_set_hits */
 
 int uc_inc_hits(const data_set_t *ds, const value_list_t *vl, int step) {
-  char name[6 * DATA_MAX_NAME_LEN];
+  cache_shard_t *shard = NULL;
   cache_entry_t *ce = NULL;
   int ret = -1;
 
-  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
-    ERROR("uc_inc_hits: FORMAT_VL failed.");
-    return STATE_ERROR;
-  }
-
-  pthread_mutex_lock(&cache_lock);
-
-  if (c_avl_get(cache_tree, name, (void *)&ce) == 0) {
-    assert(ce != NULL);
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce != NULL) {
     ret = ce->hits;
     ce->hits = ret + step;
+    pthread_mutex_unlock(&shard->lock);
   }
 
-  pthread_mutex_unlock(&cache_lock);
-
   return ret;
 } /* int uc_inc_hits */
 
-/*
- * Iterator interface
- */
-uc_iter_t *uc_get_iterator(void) {
-  uc_iter_t *iter = calloc(1, sizeof(*iter));
-  if (iter == NULL)
-    return NULL;
+int uc_get_time_sent(const value_list_t *vl, cdtime_t *ret_time) {
+  cache_shard_t *shard = NULL;
+  cache_entry_t *ce = NULL;
 
-  pthread_mutex_lock(&cache_lock);
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce == NULL)
+    return ENOENT;
 
-  iter->iter = c_avl_get_iterator(cache_tree);
-  if (iter->iter == NULL) {
-    free(iter);
-    return NULL;
-  }
+  *ret_time = ce->time_sent;
+  pthread_mutex_unlock(&shard->lock);
+  return 0;
+} /* int uc_get_time_sent */
 
-  return iter;
-} /* uc_iter_t *uc_get_iterator */
+int uc_set_time_sent(const value_list_t *vl, cdtime_t time) {
+  cache_shard_t *shard = NULL;
+  cache_entry_t *ce = NULL;
 
-int uc_iterator_next(uc_iter_t *iter, char **ret_name) {
-  int status;
+  ce = cache_lock_entry_vl(vl, &shard);
+  if (ce == NULL)
+    return ENOENT;
 
-  if (iter == NULL)
-    return -1;
+  if (ce->time_sent < time)
+    ce->time_sent = time;
+  pthread_mutex_unlock(&shard->lock);
+  return 0;
+} /* int uc_set_time_sent */
 
-  while ((status = c_avl_iterator_next(iter->iter, (void *)&iter->name,
-                                       (void *)&iter->entry)) == 0) {
-    if (iter->entry->state == STATE_MISSING)
-      continue;
+/*
+ * Iterator interface
+ */
+uc_iter_t *uc_get_iterator(void) {
+  return uc_snapshot_create(/* with_values = */ true, NULL, NULL);
+} /* uc_iter_t *uc_get_iterator */
 
-    break;
-  }
-  if (status != 0) {
-    iter->name = NULL;
-    iter->entry = NULL;
+uc_iter_t *uc_get_iterator_filtered(uc_iter_filter_t filter, void *user_data) {
+  return uc_snapshot_create(/* with_values = */ true, filter, user_data);
+} /* uc_iter_t *uc_get_iterator_filtered */
+
+int uc_iterator_next(uc_iter_t *iter, char **ret_name) {
+  if ((iter == NULL) || (iter->index >= iter->entries_num)) {
+    if (iter != NULL)
+      iter->entry = NULL;
     return -1;
   }
 
+  iter->entry = iter->entries + iter->index;
+  iter->index++;
+
   if (ret_name != NULL)
-    *ret_name = iter->name;
+    *ret_name = iter->names + iter->entry->name;
 
   return 0;
 } /* int uc_iterator_next */
@@ -903,17 +1565,22 @@ void uc_iterator_destroy(uc_iter_t *iter) {
   if (iter == NULL)
     return;
 
-  c_avl_iterator_destroy(iter->iter);
-  pthread_mutex_unlock(&cache_lock);
-
+  free(iter->entries);
+  free(iter->names);
+  free(iter->values);
+  free(iter->rates);
   free(iter);
 } /* void uc_iterator_destroy */
 
+size_t uc_iterator_size(uc_iter_t *iter) {
+  return (iter == NULL) ? 0 : iter->entries_num;
+} /* size_t uc_iterator_size */
+
 int uc_iterator_get_time(uc_iter_t *iter, cdtime_t *ret_time) {
   if ((iter == NULL) || (iter->entry == NULL) || (ret_time == NULL))
     return -1;
 
-  *ret_time = iter->entry->last_time;
+  *ret_time = iter->entry->time;
   return 0;
 } /* int uc_iterator_get_name */
 
@@ -922,18 +1589,28 @@ int uc_iterator_get_values(uc_iter_t *iter, value_t **ret_values,
   if ((iter == NULL) || (iter->entry == NULL) || (ret_values == NULL) ||
       (ret_num == NULL))
     return -1;
-  *ret_values =
-      calloc(iter->entry->values_num, sizeof(*iter->entry->values_raw));
+  *ret_values = calloc(iter->entry->values_num, sizeof(**ret_values));
   if (*ret_values == NULL)
     return -1;
-  for (size_t i = 0; i < iter->entry->values_num; ++i)
-    (*ret_values)[i] = iter->entry->values_raw[i];
+  memcpy(*ret_values, iter->values + iter->entry->values,
+         iter->entry->values_num * sizeof(**ret_values));
 
   *ret_num = iter->entry->values_num;
 
   return 0;
 } /* int uc_iterator_get_values */
 
+int uc_iterator_get_rates(uc_iter_t *iter, gauge_t const **ret_rates,
+                          size_t *ret_num) {
+  if ((iter == NULL) || (iter->entry == NULL) || (ret_rates == NULL) ||
+      (ret_num == NULL))
+    return -1;
+
+  *ret_rates = iter->rates + iter->entry->values;
+  *ret_num = iter->entry->values_num;
+  return 0;
+} /* int uc_iterator_get_rates */
+
 int uc_iterator_get_interval(uc_iter_t *iter, cdtime_t *ret_interval) {
   if ((iter == NULL) || (iter->entry == NULL) || (ret_interval == NULL))
     return -1;
@@ -946,7 +1623,18 @@ int uc_iterator_get_meta(uc_iter_t *iter, meta_data_t **ret_meta) {
   if ((iter == NULL) || (iter->entry == NULL) || (ret_meta == NULL))
     return -1;
 
-  *ret_meta = meta_data_clone(iter->entry->meta);
+  /* Meta data is not part of the snapshot, since few entries have any and
+   * cloning it for all entries would be expensive. Look the entry up again
+   * instead; it may have expired since the snapshot was taken. */
+  cache_shard_t *shard = NULL;
+  cache_entry_t *ce = cache_lock_entry(iter->names + iter->entry->name, &shard);
+  if (ce == NULL) {
+    *ret_meta = NULL;
+    return 0;
+  }
+
+  *ret_meta = meta_data_clone(ce->meta);
+  pthread_mutex_unlock(&shard->lock);
 
   return 0;
 } /* int uc_iterator_get_meta */
@@ -954,34 +1642,23 @@ int uc_iterator_get_meta(uc_iter_t *iter, meta_data_t **ret_meta) {
 /*
  * Meta data interface
  */
-/* XXX: This function will acquire `cache_lock' but will not free it! */
-static meta_data_t *uc_get_meta(const value_list_t *vl) /* {{{ */
-{
-  char name[6 * DATA_MAX_NAME_LEN];
-  cache_entry_t *ce = NULL;
-  int status;
+/* XXX: This function will acquire the lock of the entry's shard but will not
+ * free it! The shard is returned in `ret_shard'. */
+static meta_data_t *uc_get_meta(const value_list_t *vl, /* {{{ */
+                                cache_shard_t **ret_shard) {
+  cache_shard_t *shard = NULL;
 
-  status = FORMAT_VL(name, sizeof(name), vl);
-  if (status != 0) {
-    ERROR("utils_cache: uc_get_meta: FORMAT_VL failed.");
-    return NULL;
-  }
-
-  pthread_mutex_lock(&cache_lock);
-
-  status = c_avl_get(cache_tree, name, (void *)&ce);
-  if (status != 0) {
-    pthread_mutex_unlock(&cache_lock);
+  cache_entry_t *ce = cache_lock_entry_vl(vl, &shard);
+  if (ce == NULL)
     return NULL;
-  }
-  assert(ce != NULL);
 
   if (ce->meta == NULL)
     ce->meta = meta_data_create();
 
   if (ce->meta == NULL)
-    pthread_mutex_unlock(&cache_lock);
+    pthread_mutex_unlock(&shard->lock);
 
+  *ret_shard = shard;
   return ce->meta;
 } /* }}} meta_data_t *uc_get_meta */
 
@@ -989,13 +1666,14 @@ static meta_data_t *uc_get_meta(const value_list_t *vl) /* {{{ */
  * shorter.. */
 #define UC_WRAP(wrap_function)                                                 \
   {                                                                            \
+    cache_shard_t *shard;                                                      \
     meta_data_t *meta;                                                         \
     int status;                                                                \
-    meta = uc_get_meta(vl);                                                    \
+    meta = uc_get_meta(vl, &shard);                                            \
     if (meta == NULL)                                                          \
       return -1;                                                               \
     status = wrap_function(meta, key);                                         \
-    pthread_mutex_unlock(&cache_lock);                                         \
+    pthread_mutex_unlock(&shard->lock);                                        \
     return status;                                                             \
   }
 int uc_meta_data_exists(const value_list_t *vl, const char *key)
@@ -1015,13 +1693,14 @@ int uc_meta_data_exists(const value_list_t *vl, const char *key)
  * two argumetns. */
 #define UC_WRAP(wrap_function)                                                 \
   {                                                                            \
+    cache_shard_t *shard;                                                      \
     meta_data_t *meta;                                                         \
     int status;                                                                \
-    meta = uc_get_meta(vl);                                                    \
+    meta = uc_get_meta(vl, &shard);                                            \
     if (meta == NULL)                                                          \
       return -1;                                                               \
     status = wrap_function(meta, key, value);                                  \
-    pthread_mutex_unlock(&cache_lock);                                         \
+    pthread_mutex_unlock(&shard->lock);                                        \
     return status;                                                             \
   }
         int uc_meta_data_add_string(const value_list_t *vl, const char *key,
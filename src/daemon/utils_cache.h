@@ -40,14 +40,82 @@
 int uc_init(void);
 int uc_check_timeout(void);
 int uc_update(const data_set_t *ds, const value_list_t *vl);
+
+/*
+ * NAME
+ *   uc_update_rate
+ *
+ * DESCRIPTION
+ *   Like uc_update(), but also copies the rates of the entry, as returned by
+ *   uc_get_rate(), to `ret_rates' without looking the entry up again.
+ *   `ret_rates' must hold `ds->ds_num' values.
+ *
+ * RETURN VALUE
+ *   Zero if the cache has been updated and the rates have been copied,
+ *   non-zero otherwise.
+ */
+int uc_update_rate(const data_set_t *ds, const value_list_t *vl,
+                   gauge_t *ret_rates);
+
 int uc_get_rate_by_name(const char *name, gauge_t **ret_values,
                         size_t *ret_values_num);
 gauge_t *uc_get_rate(const data_set_t *ds, const value_list_t *vl);
+
+/*
+ * NAME
+ *   uc_get_rate_buffer
+ *
+ * DESCRIPTION
+ *   Like uc_get_rate(), but stores the rates in `ret_rates', which must hold
+ *   `ds->ds_num' values, instead of returning an allocated array. If `vl' is
+ *   being handed to write callbacks by this thread, the rates computed when
+ *   it updated the cache are used, see uc_set_write_batch().
+ *
+ * RETURN VALUE
+ *   Zero on success, non-zero if `vl' is not in the cache, is missing or has
+ *   a different number of values.
+ */
+int uc_get_rate_buffer(const data_set_t *ds, const value_list_t *vl,
+                       gauge_t *ret_rates);
+
+/*
+ * NAME
+ *   uc_set_write_batch
+ *
+ * DESCRIPTION
+ *   Announces the value lists this thread is about to hand to write
+ *   callbacks. Entries with `rates' set are answered by uc_get_rate_buffer()
+ *   without a cache lookup. Called by the daemon around the write callbacks;
+ *   pass NULL to clear.
+ */
+void uc_set_write_batch(const write_batch_entry_t *entries,
+                        size_t entries_num);
+
+/*
+ * NAME
+ *   uc_get_write_batch
+ *
+ * DESCRIPTION
+ *   Returns the value lists announced with uc_set_write_batch() by this
+ *   thread, so that nested writes can restore them when they are done.
+ */
+void uc_get_write_batch(const write_batch_entry_t **ret_entries,
+                        size_t *ret_entries_num);
 int uc_get_value_by_name(const char *name, value_t **ret_values,
                          size_t *ret_values_num);
 value_t *uc_get_value(const data_set_t *ds, const value_list_t *vl);
 
 size_t uc_get_size(void);
+
+/*
+ * NAME
+ *   uc_get_memory
+ *
+ * RETURN VALUE
+ *   The number of bytes allocated for the cache entries, including their
+ *   history but not their meta data.
+ */
+size_t uc_get_memory(void);
 int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number);
 
 int uc_get_state(const data_set_t *ds, const value_list_t *vl);
@@ -56,8 +124,38 @@ int uc_get_hits(const data_set_t *ds, const value_list_t *vl);
 int uc_set_hits(const data_set_t *ds, const value_list_t *vl, int hits);
 int uc_inc_hits(const data_set_t *ds, const value_list_t *vl, int step);
 
+/*
+ * NAME
+ *   uc_set_time_sent, uc_get_time_sent
+ *
+ * DESCRIPTION
+ *   Keep track of the newest value of a series which has been sent to other
+ *   hosts, so that write plugins can recognize their own values when they are
+ *   received again (e.g. by a forwarding proxy) without storing meta data for
+ *   each value. uc_set_time_sent() only ever moves the time forward. The time
+ *   is zero until it is set for the first time.
+ *
+ * RETURN VALUE
+ *   Zero on success, ENOENT if the series is not in the cache.
+ */
+int uc_set_time_sent(const value_list_t *vl, cdtime_t time);
+int uc_get_time_sent(const value_list_t *vl, cdtime_t *ret_time);
+
 int uc_set_callbacks_mask(const char *name, unsigned long callbacks_mask);
 
+/*
+ * NAME
+ *   uc_set_history_compression
+ *
+ * DESCRIPTION
+ *   Selects how the history of an entry is stored once it has been requested
+ *   with uc_get_history() for the first time. Compressed history typically
+ *   takes a few bits per value instead of eight bytes, but requesting it has to
+ *   decode all stored steps. Disabled by default; entries which already have
+ *   a history keep their storage.
+ */
+void uc_set_history_compression(bool enable);
+
 int uc_get_history(const data_set_t *ds, const value_list_t *vl,
                    gauge_t *ret_history, size_t num_steps, size_t num_ds);
 int uc_get_history_by_name(const char *name, gauge_t *ret_history,
@@ -74,14 +172,32 @@ typedef struct uc_iter_s uc_iter_t;
  *   uc_get_iterator
  *
  * DESCRIPTION
- *   Create an iterator for the cache. It will hold the cache lock until it's
- *   destroyed.
+ *   Create an iterator for the cache. The names, times, intervals and values
+ *   of all entries are copied when the iterator is created, one shard at a
+ *   time, so walking the iterator does not block updates of the cache.
+ *   Entries are not returned in any particular order.
  *
  * RETURN VALUE
  *   An iterator object on success or NULL else.
  */
 uc_iter_t *uc_get_iterator(void);
 
+/*
+ * NAME
+ *   uc_get_iterator_filtered
+ *
+ * DESCRIPTION
+ *   Like uc_get_iterator(), but only entries for which `filter' returns true
+ *   are part of the snapshot. The identifier passed to `filter' is only valid
+ *   during the call. `filter' is called after the entries of each shard have
+ *   been copied, without holding any lock of the cache.
+ *
+ * RETURN VALUE
+ *   An iterator object on success or NULL else.
+ */
+typedef bool (*uc_iter_filter_t)(const identifier_t *ident, void *user_data);
+uc_iter_t *uc_get_iterator_filtered(uc_iter_filter_t filter, void *user_data);
+
 /*
  * NAME
  *   uc_iterator_next
@@ -92,9 +208,9 @@ uc_iter_t *uc_get_iterator(void);
  *
  * PARAMETERS
  *   `iter'     The iterator object to advance.
- *   `ret_name' Optional pointer to a string where to store the name. If not
- *              NULL, the returned value is a copy of the value and has to be
- *              freed by the caller.
+ *   `ret_name' Optional pointer to a string where to store the name. The
+ *              string belongs to the iterator and is valid until the
+ *              iterator is destroyed.
  *
  * RETURN VALUE
  *   Zero upon success or non-zero if the iterator ie NULL or no further
@@ -103,14 +219,24 @@ uc_iter_t *uc_get_iterator(void);
 int uc_iterator_next(uc_iter_t *iter, char **ret_name);
 void uc_iterator_destroy(uc_iter_t *iter);
 
+/* Return the number of entries in the snapshot of the iterator. */
+size_t uc_iterator_size(uc_iter_t *iter);
+
 /* Return the timestamp of the value at the current position. */
 int uc_iterator_get_time(uc_iter_t *iter, cdtime_t *ret_time);
 /* Return the (raw) value at the current position. */
 int uc_iterator_get_values(uc_iter_t *iter, value_t **ret_values,
                            size_t *ret_num);
+/* Return the rates, as returned by uc_get_rate(), of the value at the current
+ * position. The array belongs to the iterator and is valid until the iterator
+ * is destroyed. */
+int uc_iterator_get_rates(uc_iter_t *iter, gauge_t const **ret_rates,
+                          size_t *ret_num);
 /* Return the interval of the value at the current position. */
 int uc_iterator_get_interval(uc_iter_t *iter, cdtime_t *ret_interval);
-/* Return the metadata for the value at the current position. */
+/* Return the metadata for the value at the current position. Meta data is
+ * not part of the snapshot; it is looked up when this function is called and
+ * NULL if the entry has expired since. */
 int uc_iterator_get_meta(uc_iter_t *iter, meta_data_t **ret_meta);
 
 /*
@@ -0,0 +1,188 @@
+/**
+ * collectd - src/daemon/utils_cache_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures uc_update() throughput with 1 to 64 threads. Each thread updates
+ * its own set of series, like the write threads do, so any slowdown with more
+ * threads is caused by contention inside the cache.
+ *
+ * Then, with four threads, compares the ways a writer with "StoreRates" gets
+ * the rates of the value list that has just updated the cache: uc_get_rate(),
+ * which allocates an array per value, uc_get_rate_buffer() and
+ * uc_update_rate(), which updates and returns the rates in one lookup.
+ *
+ * Usage: bench_daemon_utils_cache [series per thread] [rounds] */
+
+#include "collectd.h"
+
+#include "utils/common/common.h"
+#include "utils_cache.h"
+
+#include <pthread.h>
+
+static data_source_t bench_dsrc[] = {{"value", DS_TYPE_DERIVE, 0.0, NAN}};
+static data_set_t bench_ds = {"bench", STATIC_ARRAY_SIZE(bench_dsrc),
+                              bench_dsrc};
+
+typedef enum {
+  BENCH_UPDATE,
+  BENCH_GET_RATE,
+  BENCH_GET_RATE_BUFFER,
+  BENCH_UPDATE_RATE,
+} bench_mode_t;
+
+static char const *bench_mode_names[] = {
+    "uc_update", "+uc_get_rate", "+uc_get_rate_buffer", "uc_update_rate"};
+
+typedef struct {
+  size_t index;
+  long series;
+  long rounds;
+  long round_offset;
+  bench_mode_t mode;
+  long allocations;
+} bench_thread_t;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+static void *updater(void *arg) {
+  bench_thread_t *t = arg;
+  value_t v = {.derive = 0};
+  value_list_t vl = {
+      .values = &v,
+      .values_len = 1,
+      .interval = TIME_T_TO_CDTIME_T(10),
+  };
+
+  sstrncpy(vl.host, "bench.example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "bench", sizeof(vl.plugin));
+  snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%" PRIsz,
+           t->index);
+  sstrncpy(vl.type, "bench", sizeof(vl.type));
+
+  for (long r = 0; r < t->rounds; r++) {
+    vl.time = TIME_T_TO_CDTIME_T(t->round_offset + r + 1);
+    for (long i = 0; i < t->series; i++) {
+      snprintf(vl.type_instance, sizeof(vl.type_instance), "%ld", i);
+      v.derive = (derive_t)(r * 10);
+
+      gauge_t rates[1];
+      switch (t->mode) {
+      case BENCH_UPDATE:
+        uc_update(&bench_ds, &vl);
+        break;
+      case BENCH_GET_RATE: {
+        uc_update(&bench_ds, &vl);
+        gauge_t *r = uc_get_rate(&bench_ds, &vl);
+        if (r != NULL)
+          t->allocations++;
+        sfree(r);
+      } break;
+      case BENCH_GET_RATE_BUFFER:
+        uc_update(&bench_ds, &vl);
+        uc_get_rate_buffer(&bench_ds, &vl, rates);
+        break;
+      case BENCH_UPDATE_RATE:
+        uc_update_rate(&bench_ds, &vl, rates);
+        break;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/* Returns the number of values per second. The number of arrays allocated by
+ * uc_get_rate() is stored in "ret_allocations", if not NULL. */
+static double run(size_t threads_num, long series, long rounds,
+                  long round_offset, bench_mode_t mode, long *ret_allocations) {
+  bench_thread_t threads[threads_num];
+  pthread_t tids[threads_num];
+
+  double start = now_seconds();
+
+  for (size_t i = 0; i < threads_num; i++) {
+    threads[i] = (bench_thread_t){
+        .index = i,
+        .series = series,
+        .rounds = rounds,
+        .round_offset = round_offset,
+        .mode = mode,
+    };
+    pthread_create(tids + i, NULL, updater, threads + i);
+  }
+  for (size_t i = 0; i < threads_num; i++)
+    pthread_join(tids[i], NULL);
+
+  double elapsed = now_seconds() - start;
+
+  if (ret_allocations != NULL) {
+    *ret_allocations = 0;
+    for (size_t i = 0; i < threads_num; i++)
+      *ret_allocations += threads[i].allocations;
+  }
+
+  return ((double)(series * rounds * (long)threads_num)) / elapsed;
+}
+
+int main(int argc, char **argv) {
+  long series = 1000;
+  long rounds = 20;
+  if (argc > 1)
+    series = atol(argv[1]);
+  if (argc > 2)
+    rounds = atol(argv[2]);
+
+  uc_init();
+
+  printf("%8s %16s\n", "threads", "updates [op/s]");
+  long round_offset = 0;
+  for (size_t n = 1; n <= 64; n *= 2) {
+    /* Start with a round that only inserts the series so that the measured
+     * rounds are updates of existing entries. */
+    run(n, series, 1, round_offset, BENCH_UPDATE, NULL);
+    double rate = run(n, series, rounds, round_offset + 1, BENCH_UPDATE, NULL);
+    round_offset += rounds + 1;
+
+    printf("%8" PRIsz " %16.0f\n", n, rate);
+  }
+
+  printf("\n%-20s %16s %18s\n", "4 threads", "values [op/s]",
+         "allocations/value");
+  for (bench_mode_t mode = BENCH_UPDATE; mode <= BENCH_UPDATE_RATE; mode++) {
+    long allocations = 0;
+    double rate = run(4, series, rounds, round_offset, mode, &allocations);
+    round_offset += rounds;
+
+    printf("%-20s %16.0f %18.2f\n", bench_mode_names[mode], rate,
+           (double)allocations / (double)(4 * series * rounds));
+  }
+
+  return 0;
+}
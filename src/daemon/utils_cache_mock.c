@@ -35,6 +35,12 @@ gauge_t *uc_get_rate(__attribute__((unused)) data_set_t const *ds,
   return NULL;
 }
 
+int uc_get_rate_buffer(__attribute__((unused)) data_set_t const *ds,
+                       __attribute__((unused)) value_list_t const *vl,
+                       __attribute__((unused)) gauge_t *ret_rates) {
+  return ENOTSUP;
+}
+
 int uc_get_rate_by_name(const char *name, gauge_t **ret_values,
                         size_t *ret_values_num) {
   return ENOTSUP;
@@ -49,6 +55,31 @@ int uc_get_value_by_name(const char *name, value_t **ret_values,
   return ENOTSUP;
 }
 
+uc_iter_t *uc_get_iterator_filtered(uc_iter_filter_t filter, void *user_data) {
+  errno = ENOTSUP;
+  return NULL;
+}
+
+int uc_iterator_next(uc_iter_t *iter, char **ret_name) { return -1; }
+
+void uc_iterator_destroy(uc_iter_t *iter) { /* nop */
+}
+
+size_t uc_iterator_size(uc_iter_t *iter) { return 0; }
+
+int uc_iterator_get_time(uc_iter_t *iter, cdtime_t *ret_time) { return -1; }
+
+int uc_iterator_get_rates(uc_iter_t *iter, gauge_t const **ret_rates,
+                          size_t *ret_num) {
+  return -1;
+}
+
+int uc_get_time_sent(const value_list_t *vl, cdtime_t *ret_time) {
+  return ENOENT;
+}
+
+int uc_set_time_sent(const value_list_t *vl, cdtime_t time) { return 0; }
+
 int uc_meta_data_get_signed_int(const value_list_t *vl, const char *key,
                                 int64_t *value) {
   return -ENOENT;
@@ -0,0 +1,422 @@
+/**
+ * collectd - src/daemon/utils_cache_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "collectd.h"
+#include "utils/common/common.h"
+
+#include "testing.h"
+#include "utils_cache.h"
+
+/* Provided by libplugin_mock, which is built with -DMOCK_TIME. */
+extern cdtime_t cdtime_mock;
+
+static data_source_t test_dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+static data_set_t test_ds = {"gauge", STATIC_ARRAY_SIZE(test_dsrc), test_dsrc};
+
+static value_list_t make_vl(char const *plugin_instance,
+                            char const *type_instance, value_t *v,
+                            cdtime_t t) {
+  value_list_t vl = {
+      .values = v,
+      .values_len = 1,
+      .time = t,
+      .interval = TIME_T_TO_CDTIME_T(10),
+  };
+  sstrncpy(vl.host, "example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "test", sizeof(vl.plugin));
+  sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+  sstrncpy(vl.type_instance, type_instance, sizeof(vl.type_instance));
+  return vl;
+}
+
+DEF_TEST(update_and_lookup) {
+  struct {
+    char const *plugin_instance;
+    char const *type_instance;
+    char const *name;
+  } cases[] = {
+      {"", "", "example.com/test/gauge"},
+      {"a", "", "example.com/test-a/gauge"},
+      {"", "b", "example.com/test/gauge-b"},
+      {"a", "b", "example.com/test-a/gauge-b"},
+  };
+
+  CHECK_ZERO(uc_init());
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cases); i++) {
+    value_t v = {.gauge = (gauge_t)i};
+    value_list_t vl = make_vl(cases[i].plugin_instance,
+                              cases[i].type_instance, &v,
+                              TIME_T_TO_CDTIME_T(1));
+    CHECK_ZERO(uc_update(&test_ds, &vl));
+  }
+  EXPECT_EQ_INT(STATIC_ARRAY_SIZE(cases), uc_get_size());
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cases); i++) {
+    value_t v = {.gauge = 10.0 + (gauge_t)i};
+    value_list_t vl = make_vl(cases[i].plugin_instance,
+                              cases[i].type_instance, &v,
+                              TIME_T_TO_CDTIME_T(2));
+
+    /* Updating an existing entry must not create a new one. */
+    CHECK_ZERO(uc_update(&test_ds, &vl));
+    EXPECT_EQ_INT(STATIC_ARRAY_SIZE(cases), uc_get_size());
+
+    /* Lookups by value list and by name must find the same entry. */
+    gauge_t *rate = uc_get_rate(&test_ds, &vl);
+    CHECK_NOT_NULL(rate);
+    EXPECT_EQ_DOUBLE(10.0 + (gauge_t)i, rate[0]);
+    sfree(rate);
+
+    size_t rate_num = 0;
+    CHECK_ZERO(uc_get_rate_by_name(cases[i].name, &rate, &rate_num));
+    EXPECT_EQ_INT(1, rate_num);
+    EXPECT_EQ_DOUBLE(10.0 + (gauge_t)i, rate[0]);
+    sfree(rate);
+
+    /* Values that are not newer than the cached ones are rejected. */
+    EXPECT_EQ_INT(-1, uc_update(&test_ds, &vl));
+  }
+
+  value_t v = {.gauge = 0};
+  value_list_t vl = make_vl("does not", "exist", &v, TIME_T_TO_CDTIME_T(1));
+  EXPECT_EQ_PTR(NULL, uc_get_rate(&test_ds, &vl));
+
+  return 0;
+}
+
+DEF_TEST(update_rate) {
+  data_source_t dsrc[] = {{"value", DS_TYPE_DERIVE, 0.0, NAN}};
+  data_set_t ds = {"derive", STATIC_ARRAY_SIZE(dsrc), dsrc};
+  value_t v = {.derive = 100};
+  value_list_t vl = make_vl("update_rate", "", &v, TIME_T_TO_CDTIME_T(10));
+  sstrncpy(vl.type, ds.type, sizeof(vl.type));
+  gauge_t rate[1] = {0.0};
+
+  CHECK_ZERO(uc_init());
+  EXPECT_EQ_INT(-1, uc_get_rate_buffer(&ds, &vl, rate));
+
+  /* New entries have no rate yet. */
+  CHECK_ZERO(uc_update_rate(&ds, &vl, rate));
+  EXPECT_EQ_INT(1, isnan(rate[0]) ? 1 : 0);
+
+  v.derive = 200;
+  vl.time = TIME_T_TO_CDTIME_T(20);
+  CHECK_ZERO(uc_update_rate(&ds, &vl, rate));
+  EXPECT_EQ_DOUBLE(10.0, rate[0]);
+  rate[0] = 0.0;
+  CHECK_ZERO(uc_get_rate_buffer(&ds, &vl, rate));
+  EXPECT_EQ_DOUBLE(10.0, rate[0]);
+
+  /* Values that are not newer than the cached ones are rejected. */
+  EXPECT_EQ_INT(-1, uc_update_rate(&ds, &vl, rate));
+
+  /* Value lists being written use the rates of their batch entry. */
+  gauge_t batch_rate[1] = {42.0};
+  write_batch_entry_t entry = {.ds = &ds, .vl = &vl, .rates = batch_rate};
+  value_list_t other = vl;
+
+  uc_set_write_batch(&entry, 1);
+  CHECK_ZERO(uc_get_rate_buffer(&ds, &vl, rate));
+  EXPECT_EQ_DOUBLE(42.0, rate[0]);
+  CHECK_ZERO(uc_get_rate_buffer(&ds, &other, rate));
+  EXPECT_EQ_DOUBLE(10.0, rate[0]);
+
+  /* A nested write restores the batch of the outer one. */
+  const write_batch_entry_t *outer_entries;
+  size_t outer_entries_num;
+  uc_get_write_batch(&outer_entries, &outer_entries_num);
+  EXPECT_EQ_PTR((void *)&entry, (void *)outer_entries);
+  EXPECT_EQ_INT(1, outer_entries_num);
+  uc_set_write_batch(&(write_batch_entry_t){.ds = &ds, .vl = &other}, 1);
+  uc_set_write_batch(outer_entries, outer_entries_num);
+  CHECK_ZERO(uc_get_rate_buffer(&ds, &vl, rate));
+  EXPECT_EQ_DOUBLE(42.0, rate[0]);
+
+  uc_set_write_batch(NULL, 0);
+  CHECK_ZERO(uc_get_rate_buffer(&ds, &vl, rate));
+  EXPECT_EQ_DOUBLE(10.0, rate[0]);
+
+  /* Missing entries are updated, but have no rates. */
+  uc_set_state(&ds, &vl, STATE_MISSING);
+  EXPECT_EQ_INT(-1, uc_get_rate_buffer(&ds, &vl, rate));
+  v.derive = 400;
+  vl.time = TIME_T_TO_CDTIME_T(30);
+  EXPECT_EQ_INT(-1, uc_update_rate(&ds, &vl, rate));
+  uc_set_state(&ds, &vl, STATE_OKAY);
+  CHECK_ZERO(uc_get_rate_buffer(&ds, &vl, rate));
+  EXPECT_EQ_DOUBLE(20.0, rate[0]);
+
+  return 0;
+}
+
+DEF_TEST(time_sent) {
+  value_t v = {.gauge = 1.0};
+  value_list_t vl = make_vl("sent", "", &v, TIME_T_TO_CDTIME_T(5));
+  cdtime_t t = 1;
+
+  CHECK_ZERO(uc_init());
+  EXPECT_EQ_INT(ENOENT, uc_set_time_sent(&vl, vl.time));
+  EXPECT_EQ_INT(ENOENT, uc_get_time_sent(&vl, &t));
+
+  CHECK_ZERO(uc_update(&test_ds, &vl));
+  CHECK_ZERO(uc_get_time_sent(&vl, &t));
+  EXPECT_EQ_UINT64(0, t);
+
+  CHECK_ZERO(uc_set_time_sent(&vl, vl.time));
+  CHECK_ZERO(uc_get_time_sent(&vl, &t));
+  EXPECT_EQ_UINT64(vl.time, t);
+
+  /* The time never moves backwards. */
+  CHECK_ZERO(uc_set_time_sent(&vl, TIME_T_TO_CDTIME_T(3)));
+  CHECK_ZERO(uc_get_time_sent(&vl, &t));
+  EXPECT_EQ_UINT64(vl.time, t);
+
+  return 0;
+}
+
+DEF_TEST(names_and_iterator) {
+  char **names = NULL;
+  cdtime_t *times = NULL;
+  size_t names_num = 0;
+
+  CHECK_ZERO(uc_get_names(&names, &times, &names_num));
+  EXPECT_EQ_INT(uc_get_size(), names_num);
+
+  /* Names are returned sorted, even though the cache is sharded. */
+  for (size_t i = 0; i < names_num; i++) {
+    if (i > 0)
+      OK(strcmp(names[i - 1], names[i]) < 0);
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(2), times[i]);
+  }
+  for (size_t i = 0; i < names_num; i++)
+    sfree(names[i]);
+  sfree(names);
+  sfree(times);
+
+  uc_iter_t *iter = uc_get_iterator();
+  CHECK_NOT_NULL(iter);
+
+  size_t iter_num = 0;
+  char *name = NULL;
+  while (uc_iterator_next(iter, &name) == 0) {
+    CHECK_NOT_NULL(name);
+    iter_num++;
+
+    cdtime_t t = 0;
+    CHECK_ZERO(uc_iterator_get_time(iter, &t));
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(2), t);
+  }
+  uc_iterator_destroy(iter);
+  EXPECT_EQ_INT(uc_get_size(), iter_num);
+
+  return 0;
+}
+
+static bool filter_plugin_instance(const identifier_t *ident,
+                                   void *user_data) {
+  char name[6 * DATA_MAX_NAME_LEN];
+  value_list_t vl = {0};
+
+  /* Filters run without a lock of the cache held, so this must not block. */
+  if (uc_get_size() == 0)
+    return false;
+
+  /* The fields must add up to the name of the entry. */
+  sstrncpy(vl.host, ident->host, sizeof(vl.host));
+  sstrncpy(vl.plugin, ident->plugin, sizeof(vl.plugin));
+  sstrncpy(vl.plugin_instance, ident->plugin_instance,
+           sizeof(vl.plugin_instance));
+  sstrncpy(vl.type, ident->type, sizeof(vl.type));
+  sstrncpy(vl.type_instance, ident->type_instance, sizeof(vl.type_instance));
+  if ((FORMAT_VL(name, sizeof(name), &vl) != 0) ||
+      (strncmp("example.com/test", name, strlen("example.com/test")) != 0))
+    return false;
+
+  return strcmp(ident->plugin_instance, user_data) == 0;
+}
+
+DEF_TEST(iterator_filtered) {
+  char *name = NULL;
+  uc_iter_t *iter = uc_get_iterator_filtered(filter_plugin_instance, "a");
+  CHECK_NOT_NULL(iter);
+  EXPECT_EQ_INT(2, uc_iterator_size(iter));
+
+  size_t iter_num = 0;
+  while (uc_iterator_next(iter, &name) == 0) {
+    gauge_t const *rates = NULL;
+    size_t rates_num = 0;
+
+    OK(strncmp("example.com/test-a/gauge", name, 24) == 0);
+    CHECK_ZERO(uc_iterator_get_rates(iter, &rates, &rates_num));
+    EXPECT_EQ_INT(1, rates_num);
+    OK(rates[0] >= 10.0);
+    iter_num++;
+  }
+  uc_iterator_destroy(iter);
+  EXPECT_EQ_INT(2, iter_num);
+
+  /* Entries without plugin instance. */
+  iter = uc_get_iterator_filtered(filter_plugin_instance, "");
+  CHECK_NOT_NULL(iter);
+  EXPECT_EQ_INT(2, uc_iterator_size(iter));
+  uc_iterator_destroy(iter);
+
+  return 0;
+}
+
+DEF_TEST(iterator_snapshot) {
+  size_t size = uc_get_size();
+  uc_iter_t *iter = uc_get_iterator();
+  CHECK_NOT_NULL(iter);
+
+  /* The iterator holds no lock, so the cache can be updated meanwhile. The
+   * iterator still returns the entries and values it was created with. */
+  value_t v = {.gauge = 100.0};
+  value_list_t vl = make_vl("a", "b", &v, TIME_T_TO_CDTIME_T(3));
+  CHECK_ZERO(uc_update(&test_ds, &vl));
+  vl = make_vl("snapshot", "", &v, TIME_T_TO_CDTIME_T(3));
+  CHECK_ZERO(uc_update(&test_ds, &vl));
+  EXPECT_EQ_INT(size + 1, uc_get_size());
+
+  size_t iter_num = 0;
+  char *name = NULL;
+  while (uc_iterator_next(iter, &name) == 0) {
+    value_t *values = NULL;
+    size_t values_num = 0;
+    cdtime_t t = 0;
+
+    OK(strcmp("example.com/test-snapshot/gauge", name) != 0);
+    CHECK_ZERO(uc_iterator_get_time(iter, &t));
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(2), t);
+    CHECK_ZERO(uc_iterator_get_values(iter, &values, &values_num));
+    EXPECT_EQ_INT(1, values_num);
+    OK(values[0].gauge < 100.0);
+    sfree(values);
+    iter_num++;
+  }
+  uc_iterator_destroy(iter);
+  EXPECT_EQ_INT(size, iter_num);
+
+  return 0;
+}
+
+DEF_TEST(check_timeout) {
+  /* With an interval of 10 seconds and "Timeout 2", entries expire after 20
+   * seconds without update. */
+  cdtime_t start = cdtime_mock;
+  value_t v = {.gauge = 1.0};
+  value_list_t vl = make_vl("timeout", "", &v, TIME_T_TO_CDTIME_T(5));
+
+  CHECK_ZERO(uc_init());
+  CHECK_ZERO(uc_update(&test_ds, &vl));
+  OK(uc_get_size() > 1);
+
+  cdtime_mock = start + TIME_T_TO_CDTIME_T(15);
+  CHECK_ZERO(uc_check_timeout());
+  OK(uc_get_size() > 1);
+
+  vl.time = TIME_T_TO_CDTIME_T(15);
+  CHECK_ZERO(uc_update(&test_ds, &vl));
+
+  /* Only the updated entry survives. */
+  cdtime_mock = start + TIME_T_TO_CDTIME_T(25);
+  CHECK_ZERO(uc_check_timeout());
+  EXPECT_EQ_INT(1, uc_get_size());
+  cdtime_t t = 1;
+  CHECK_ZERO(uc_get_time_sent(&vl, &t));
+
+  cdtime_mock = start + TIME_T_TO_CDTIME_T(36);
+  CHECK_ZERO(uc_check_timeout());
+  EXPECT_EQ_INT(0, uc_get_size());
+
+  cdtime_mock = start;
+  return 0;
+}
+
+DEF_TEST(history) {
+  value_t v = {.gauge = 0};
+  value_list_t plain = make_vl("history", "plain", &v, 0);
+  value_list_t packed = make_vl("history", "packed", &v, 0);
+  gauge_t want[4];
+  gauge_t got[4];
+
+  CHECK_ZERO(uc_init());
+  EXPECT_EQ_INT(0, uc_get_memory());
+
+  CHECK_ZERO(uc_update(&test_ds, &plain));
+  CHECK_ZERO(uc_get_history(&test_ds, &plain, want, 4, 1));
+  size_t memory = uc_get_memory();
+  OK(memory > 0);
+
+  uc_set_history_compression(true);
+  CHECK_ZERO(uc_update(&test_ds, &packed));
+  CHECK_ZERO(uc_get_history(&test_ds, &packed, got, 4, 1));
+  OK(uc_get_memory() > memory);
+  for (size_t i = 0; i < 4; i++) {
+    OK(isnan(want[i]));
+    OK(isnan(got[i]));
+  }
+
+  /* Both storages return the same, newest value first. */
+  for (size_t t = 1; t <= 100; t++) {
+    v.gauge = (gauge_t)(t / 10);
+    plain.time = packed.time = TIME_T_TO_CDTIME_T(t);
+    CHECK_ZERO(uc_update(&test_ds, &plain));
+    CHECK_ZERO(uc_update(&test_ds, &packed));
+  }
+  CHECK_ZERO(uc_get_history(&test_ds, &plain, want, 4, 1));
+  CHECK_ZERO(uc_get_history(&test_ds, &packed, got, 4, 1));
+  for (size_t i = 0; i < 4; i++)
+    EXPECT_EQ_DOUBLE(want[i], got[i]);
+  EXPECT_EQ_DOUBLE(10.0, got[0]);
+  EXPECT_EQ_DOUBLE(9.0, got[3]);
+
+  /* Memory is released when the entries expire. */
+  uc_set_history_compression(false);
+  cdtime_t start = cdtime_mock;
+  cdtime_mock = start + TIME_T_TO_CDTIME_T(100);
+  CHECK_ZERO(uc_check_timeout());
+  EXPECT_EQ_INT(0, uc_get_size());
+  EXPECT_EQ_INT(0, uc_get_memory());
+
+  cdtime_mock = start;
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(update_and_lookup);
+  RUN_TEST(names_and_iterator);
+  RUN_TEST(iterator_filtered);
+  RUN_TEST(iterator_snapshot);
+  RUN_TEST(time_sent);
+  RUN_TEST(check_timeout);
+  RUN_TEST(history);
+  RUN_TEST(update_rate);
+
+  END_TEST;
+}
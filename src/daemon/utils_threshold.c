@@ -36,6 +36,8 @@
  * Exported symbols
  * {{{ */
 c_avl_tree_t *threshold_tree = NULL;
+/* Protects `threshold_tree' and the type index and per-series memo that
+ * threshold_search() builds from it. */
 pthread_mutex_t threshold_lock = PTHREAD_MUTEX_INITIALIZER;
 /* }}} */
 
@@ -63,52 +65,338 @@ threshold_t *threshold_get(const char *hostname, const char *plugin,
     return NULL;
 } /* }}} threshold_t *threshold_get */
 
+/*
+ * Threshold index
+ *
+ * threshold_search() used to format and look up up to twelve names for every
+ * value list. Instead, thresholds are indexed by type: for each type, the
+ * index records which combinations of host, plugin, plugin instance and type
+ * instance are set by some threshold, so that lookups which cannot succeed
+ * are skipped. The resulting threshold, or the lack of one, is memorized per
+ * series until the set of thresholds changes. Both are protected by
+ * `threshold_lock'.
+ */
+#define TH_HOST 0x01
+#define TH_PLUGIN 0x02
+#define TH_PLUGIN_INSTANCE 0x04
+#define TH_TYPE_INSTANCE 0x08
+
+/* Initial number of buckets of the series memo. The memo grows to at most
+ * TH_MEMO_ENTRIES_MAX entries; when it is full, it is cleared, so that series
+ * which went away do not occupy it forever. */
+#define TH_MEMO_BUCKETS_INIT 1024
+#define TH_MEMO_ENTRIES_MAX 2097152
+
+/* The order in which threshold_search() looks for thresholds: the fields
+ * which have to match, from the most to the least specific threshold. */
+static const unsigned int threshold_cascade[] = {
+    TH_HOST | TH_PLUGIN | TH_PLUGIN_INSTANCE | TH_TYPE_INSTANCE,
+    TH_HOST | TH_PLUGIN | TH_PLUGIN_INSTANCE,
+    TH_HOST | TH_PLUGIN | TH_TYPE_INSTANCE,
+    TH_HOST | TH_PLUGIN,
+    TH_HOST | TH_TYPE_INSTANCE,
+    TH_HOST,
+    TH_PLUGIN | TH_PLUGIN_INSTANCE | TH_TYPE_INSTANCE,
+    TH_PLUGIN | TH_PLUGIN_INSTANCE,
+    TH_PLUGIN | TH_TYPE_INSTANCE,
+    TH_PLUGIN,
+    TH_TYPE_INSTANCE,
+    0,
+};
+
+struct th_type_s;
+typedef struct th_type_s th_type_t;
+struct th_type_s {
+  uint32_t hash;
+  /* Bit (1 << fields) is set if a threshold of this type sets exactly the
+   * TH_* `fields'. */
+  uint16_t patterns;
+  th_type_t *next;
+  char type[DATA_MAX_NAME_LEN];
+};
+
+struct th_memo_entry_s;
+typedef struct th_memo_entry_s th_memo_entry_t;
+struct th_memo_entry_s {
+  uint32_t hash;
+  /* NULL if no threshold applies to the series. */
+  threshold_t *th;
+  th_memo_entry_t *next;
+  /* Host, plugin, plugin instance, type and type instance, each terminated
+   * by a null byte. */
+  char identifier[];
+};
+
+static th_type_t **th_types;
+static size_t th_types_size;
+/* Number of entries in `threshold_tree' when the index was built. */
+static int th_index_size = -1;
+
+static th_memo_entry_t **th_memo;
+static size_t th_memo_size;
+static size_t th_memo_num;
+
+static uint32_t th_hash_update(uint32_t hash, const char *str) { /* {{{ */
+  /* FNV-1a, including the terminating null byte to separate the fields. */
+  do {
+    hash ^= (uint8_t)*str;
+    hash *= 16777619u;
+  } while (*str++ != 0);
+
+  return hash;
+} /* }}} uint32_t th_hash_update */
+
+static unsigned int th_fields(const char *host, const char *plugin, /* {{{ */
+                              const char *plugin_instance,
+                              const char *type_instance) {
+  unsigned int fields = 0;
+
+  if (host[0] != 0)
+    fields |= TH_HOST;
+  if (plugin[0] != 0)
+    fields |= TH_PLUGIN;
+  if (plugin_instance[0] != 0)
+    fields |= TH_PLUGIN_INSTANCE;
+  if (type_instance[0] != 0)
+    fields |= TH_TYPE_INSTANCE;
+
+  return fields;
+} /* }}} unsigned int th_fields */
+
+static th_type_t *th_type_get(const char *type, uint32_t hash) { /* {{{ */
+  if (th_types == NULL)
+    return NULL;
+
+  for (th_type_t *t = th_types[hash & (th_types_size - 1)]; t != NULL;
+       t = t->next)
+    if ((t->hash == hash) && (strcmp(t->type, type) == 0))
+      return t;
+
+  return NULL;
+} /* }}} th_type_t *th_type_get */
+
+static void th_memo_clear(void) { /* {{{ */
+  for (size_t i = 0; i < th_memo_size; i++) {
+    th_memo_entry_t *e = th_memo[i];
+    while (e != NULL) {
+      th_memo_entry_t *next = e->next;
+      free(e);
+      e = next;
+    }
+    th_memo[i] = NULL;
+  }
+  th_memo_num = 0;
+} /* }}} void th_memo_clear */
+
+static void th_index_clear(void) { /* {{{ */
+  for (size_t i = 0; i < th_types_size; i++) {
+    th_type_t *t = th_types[i];
+    while (t != NULL) {
+      th_type_t *next = t->next;
+      free(t);
+      t = next;
+    }
+  }
+  sfree(th_types);
+  th_types_size = 0;
+  th_index_size = -1;
+
+  th_memo_clear();
+} /* }}} void th_index_clear */
+
+/* Builds the type index from `threshold_tree'. Thresholds are only ever added,
+ * so a change of the tree's size is a change of the configuration. */
+static int th_index_build(void) { /* {{{ */
+  int size = c_avl_size(threshold_tree);
+
+  th_index_clear();
+
+  th_types_size = 16;
+  while (th_types_size < (size_t)size)
+    th_types_size *= 2;
+  th_types = calloc(th_types_size, sizeof(*th_types));
+  if (th_types == NULL) {
+    th_types_size = 0;
+    return ENOMEM;
+  }
+
+  c_avl_iterator_t *iter = c_avl_get_iterator(threshold_tree);
+  if (iter == NULL) {
+    th_index_clear();
+    return ENOMEM;
+  }
+
+  threshold_t *th;
+  char *name;
+  while (c_avl_iterator_next(iter, (void *)&name, (void *)&th) == 0) {
+    uint32_t hash = th_hash_update(2166136261u, th->type);
+    th_type_t *t = th_type_get(th->type, hash);
+    if (t == NULL) {
+      t = calloc(1, sizeof(*t));
+      if (t == NULL) {
+        c_avl_iterator_destroy(iter);
+        th_index_clear();
+        return ENOMEM;
+      }
+      t->hash = hash;
+      sstrncpy(t->type, th->type, sizeof(t->type));
+      t->next = th_types[hash & (th_types_size - 1)];
+      th_types[hash & (th_types_size - 1)] = t;
+    }
+
+    t->patterns |= 1 << th_fields(th->host, th->plugin, th->plugin_instance,
+                                  th->type_instance);
+  }
+  c_avl_iterator_destroy(iter);
+
+  if (th_memo == NULL) {
+    th_memo = calloc(TH_MEMO_BUCKETS_INIT, sizeof(*th_memo));
+    if (th_memo == NULL) {
+      th_index_clear();
+      return ENOMEM;
+    }
+    th_memo_size = TH_MEMO_BUCKETS_INIT;
+  }
+
+  th_index_size = size;
+  return 0;
+} /* }}} int th_index_build */
+
+static uint32_t th_memo_hash(const value_list_t *vl) { /* {{{ */
+  uint32_t hash = 2166136261u;
+
+  hash = th_hash_update(hash, vl->host);
+  hash = th_hash_update(hash, vl->plugin);
+  hash = th_hash_update(hash, vl->plugin_instance);
+  hash = th_hash_update(hash, vl->type);
+  return th_hash_update(hash, vl->type_instance);
+} /* }}} uint32_t th_memo_hash */
+
+static bool th_memo_equal(const th_memo_entry_t *e, /* {{{ */
+                          const value_list_t *vl) {
+  const char *fields[] = {vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance};
+  const char *ptr = e->identifier;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    if (strcmp(ptr, fields[i]) != 0)
+      return false;
+    ptr += strlen(ptr) + 1;
+  }
+
+  return true;
+} /* }}} bool th_memo_equal */
+
+/* Doubles the number of buckets of the memo. */
+static void th_memo_grow(void) { /* {{{ */
+  size_t size = 2 * th_memo_size;
+  th_memo_entry_t **memo = calloc(size, sizeof(*memo));
+  if (memo == NULL)
+    return;
+
+  for (size_t i = 0; i < th_memo_size; i++) {
+    th_memo_entry_t *e = th_memo[i];
+    while (e != NULL) {
+      th_memo_entry_t *next = e->next;
+      e->next = memo[e->hash & (size - 1)];
+      memo[e->hash & (size - 1)] = e;
+      e = next;
+    }
+  }
+
+  free(th_memo);
+  th_memo = memo;
+  th_memo_size = size;
+} /* }}} void th_memo_grow */
+
+static void th_memo_insert(const value_list_t *vl, uint32_t hash, /* {{{ */
+                           threshold_t *th) {
+  const char *fields[] = {vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance};
+  size_t lengths[STATIC_ARRAY_SIZE(fields)];
+  size_t size = 0;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    lengths[i] = strlen(fields[i]) + 1;
+    size += lengths[i];
+  }
+
+  th_memo_entry_t *e = malloc(sizeof(*e) + size);
+  if (e == NULL)
+    return;
+  e->hash = hash;
+  e->th = th;
+
+  char *ptr = e->identifier;
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(fields); i++) {
+    memcpy(ptr, fields[i], lengths[i]);
+    ptr += lengths[i];
+  }
+
+  if (th_memo_num >= TH_MEMO_ENTRIES_MAX)
+    th_memo_clear();
+  else if (th_memo_num >= th_memo_size)
+    th_memo_grow();
+
+  e->next = th_memo[hash & (th_memo_size - 1)];
+  th_memo[hash & (th_memo_size - 1)] = e;
+  th_memo_num++;
+} /* }}} void th_memo_insert */
+
+/* Looks up the thresholds in the order of `threshold_cascade', skipping
+ * combinations of fields no threshold of the type uses. */
+static threshold_t *th_resolve(const value_list_t *vl, /* {{{ */
+                               const th_type_t *t) {
+  unsigned int fields = th_fields(vl->host, vl->plugin, vl->plugin_instance,
+                                  vl->type_instance);
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(threshold_cascade); i++) {
+    unsigned int want = threshold_cascade[i];
+    if ((t->patterns & (1 << (want & fields))) == 0)
+      continue;
+
+    threshold_t *th = threshold_get(
+        (want & TH_HOST) ? vl->host : "", (want & TH_PLUGIN) ? vl->plugin : "",
+        (want & TH_PLUGIN_INSTANCE) ? vl->plugin_instance : NULL, vl->type,
+        (want & TH_TYPE_INSTANCE) ? vl->type_instance : NULL);
+    if (th != NULL)
+      return th;
+  }
+
+  return NULL;
+} /* }}} threshold_t *th_resolve */
+
 /*
  * threshold_t *threshold_search
  *
  * Searches for a threshold configuration using all the possible variations of
  * "Host", "Plugin" and "Type" blocks. Returns NULL if no threshold could be
- * found.
- * XXX: This is likely the least efficient function in collectd.
+ * found. Must be called with `threshold_lock' held.
  */
 threshold_t *threshold_search(const value_list_t *vl) { /* {{{ */
-  threshold_t *th;
+  if ((threshold_tree == NULL) || (c_avl_size(threshold_tree) == 0))
+    return NULL;
 
-  if ((th = threshold_get(vl->host, vl->plugin, vl->plugin_instance, vl->type,
-                          vl->type_instance)) != NULL)
-    return th;
-  else if ((th = threshold_get(vl->host, vl->plugin, vl->plugin_instance,
-                               vl->type, NULL)) != NULL)
-    return th;
-  else if ((th = threshold_get(vl->host, vl->plugin, NULL, vl->type,
-                               vl->type_instance)) != NULL)
-    return th;
-  else if ((th = threshold_get(vl->host, vl->plugin, NULL, vl->type, NULL)) !=
-           NULL)
-    return th;
-  else if ((th = threshold_get(vl->host, "", NULL, vl->type,
-                               vl->type_instance)) != NULL)
-    return th;
-  else if ((th = threshold_get(vl->host, "", NULL, vl->type, NULL)) != NULL)
-    return th;
-  else if ((th = threshold_get("", vl->plugin, vl->plugin_instance, vl->type,
-                               vl->type_instance)) != NULL)
-    return th;
-  else if ((th = threshold_get("", vl->plugin, vl->plugin_instance, vl->type,
-                               NULL)) != NULL)
-    return th;
-  else if ((th = threshold_get("", vl->plugin, NULL, vl->type,
-                               vl->type_instance)) != NULL)
-    return th;
-  else if ((th = threshold_get("", vl->plugin, NULL, vl->type, NULL)) != NULL)
-    return th;
-  else if ((th = threshold_get("", "", NULL, vl->type, vl->type_instance)) !=
-           NULL)
-    return th;
-  else if ((th = threshold_get("", "", NULL, vl->type, NULL)) != NULL)
-    return th;
+  if ((c_avl_size(threshold_tree) != th_index_size) &&
+      (th_index_build() != 0)) {
+    ERROR("threshold_search: Building the threshold index failed.");
+    return NULL;
+  }
 
-  return NULL;
+  uint32_t type_hash = th_hash_update(2166136261u, vl->type);
+  const th_type_t *t = th_type_get(vl->type, type_hash);
+  if (t == NULL)
+    return NULL;
+
+  uint32_t hash = th_memo_hash(vl);
+  for (th_memo_entry_t *e = th_memo[hash & (th_memo_size - 1)]; e != NULL;
+       e = e->next)
+    if ((e->hash == hash) && th_memo_equal(e, vl))
+      return e->th;
+
+  threshold_t *th = th_resolve(vl, t);
+  th_memo_insert(vl, hash, th);
+  return th;
 } /* }}} threshold_t *threshold_search */
 
 int ut_search_threshold(const value_list_t *vl, /* {{{ */
@@ -118,7 +406,6 @@ int ut_search_threshold(const value_list_t *vl, /* {{{ */
   if (vl == NULL)
     return EINVAL;
 
-  /* Is this lock really necessary? */
   pthread_mutex_lock(&threshold_lock);
   t = threshold_search(vl);
   if (t == NULL) {
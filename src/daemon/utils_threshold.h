@@ -56,6 +56,9 @@ threshold_t *threshold_get(const char *hostname, const char *plugin,
                            const char *plugin_instance, const char *type,
                            const char *type_instance);
 
+/* Returns the most specific threshold matching `vl' or NULL. The result is
+ * memorized per series until entries are added to `threshold_tree'; entries
+ * must not be removed from it. Must be called with `threshold_lock' held. */
 threshold_t *threshold_search(const value_list_t *vl);
 
 int ut_search_threshold(const value_list_t *vl, threshold_t *ret_threshold);
@@ -0,0 +1,189 @@
+/**
+ * collectd - src/daemon/utils_threshold_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures threshold_search() with 10,000 thresholds spread over 100 types
+ * and 1,000,000 series: the lookup it replaced, the first lookup of each
+ * series, which fills the memo, and subsequent lookups. The results of the
+ * indexed lookup are compared to those of the old lookup.
+ *
+ * Usage: bench_daemon_utils_threshold [rounds] */
+
+#include "collectd.h"
+
+#include "utils/avltree/avltree.h"
+#include "utils/common/common.h"
+#include "utils_threshold.h"
+
+#define BENCH_HOSTS 1000
+#define BENCH_PLUGINS 10
+#define BENCH_TYPES 100
+
+static char bench_hosts[BENCH_HOSTS][DATA_MAX_NAME_LEN];
+static char bench_plugins[BENCH_PLUGINS][DATA_MAX_NAME_LEN];
+static char bench_types[BENCH_TYPES][DATA_MAX_NAME_LEN];
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+static void add_threshold(char const *host, char const *plugin,
+                          char const *type) {
+  threshold_t *th = calloc(1, sizeof(*th));
+  char name[6 * DATA_MAX_NAME_LEN];
+
+  sstrncpy(th->host, host, sizeof(th->host));
+  sstrncpy(th->plugin, plugin, sizeof(th->plugin));
+  sstrncpy(th->type, type, sizeof(th->type));
+  th->warning_max = 42.0;
+
+  format_name(name, sizeof(name), host, plugin, NULL, type, NULL);
+  c_avl_insert(threshold_tree, strdup(name), th);
+}
+
+/* The lookup threshold_search() implemented before it was indexed. */
+static threshold_t *legacy_search(const value_list_t *vl) {
+  threshold_t *th;
+
+  if ((th = threshold_get(vl->host, vl->plugin, vl->plugin_instance, vl->type,
+                          vl->type_instance)) != NULL)
+    return th;
+  else if ((th = threshold_get(vl->host, vl->plugin, vl->plugin_instance,
+                               vl->type, NULL)) != NULL)
+    return th;
+  else if ((th = threshold_get(vl->host, vl->plugin, NULL, vl->type,
+                               vl->type_instance)) != NULL)
+    return th;
+  else if ((th = threshold_get(vl->host, vl->plugin, NULL, vl->type, NULL)) !=
+           NULL)
+    return th;
+  else if ((th = threshold_get(vl->host, "", NULL, vl->type,
+                               vl->type_instance)) != NULL)
+    return th;
+  else if ((th = threshold_get(vl->host, "", NULL, vl->type, NULL)) != NULL)
+    return th;
+  else if ((th = threshold_get("", vl->plugin, vl->plugin_instance, vl->type,
+                               vl->type_instance)) != NULL)
+    return th;
+  else if ((th = threshold_get("", vl->plugin, vl->plugin_instance, vl->type,
+                               NULL)) != NULL)
+    return th;
+  else if ((th = threshold_get("", vl->plugin, NULL, vl->type,
+                               vl->type_instance)) != NULL)
+    return th;
+  else if ((th = threshold_get("", vl->plugin, NULL, vl->type, NULL)) != NULL)
+    return th;
+  else if ((th = threshold_get("", "", NULL, vl->type, vl->type_instance)) !=
+           NULL)
+    return th;
+  else if ((th = threshold_get("", "", NULL, vl->type, NULL)) != NULL)
+    return th;
+
+  return NULL;
+}
+
+/* Looks up the threshold of every series once and returns the number of
+ * series with a threshold. If "check" is true, the result is compared to the
+ * old lookup and mismatches are counted in "ret_mismatches". */
+static size_t run(bool legacy, bool check, size_t *ret_mismatches) {
+  value_list_t vl = VALUE_LIST_INIT;
+  size_t found = 0;
+
+  for (size_t h = 0; h < BENCH_HOSTS; h++) {
+    sstrncpy(vl.host, bench_hosts[h], sizeof(vl.host));
+    for (size_t p = 0; p < BENCH_PLUGINS; p++) {
+      sstrncpy(vl.plugin, bench_plugins[p], sizeof(vl.plugin));
+      for (size_t t = 0; t < BENCH_TYPES; t++) {
+        sstrncpy(vl.type, bench_types[t], sizeof(vl.type));
+
+        pthread_mutex_lock(&threshold_lock);
+        threshold_t *th = legacy ? legacy_search(&vl) : threshold_search(&vl);
+        if (check && (th != legacy_search(&vl)))
+          (*ret_mismatches)++;
+        pthread_mutex_unlock(&threshold_lock);
+
+        if (th != NULL)
+          found++;
+      }
+    }
+  }
+
+  return found;
+}
+
+int main(int argc, char **argv) {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 5;
+  size_t series = BENCH_HOSTS * BENCH_PLUGINS * BENCH_TYPES;
+
+  for (size_t i = 0; i < BENCH_HOSTS; i++)
+    snprintf(bench_hosts[i], sizeof(bench_hosts[i]), "host%03zu.example.com",
+             i);
+  for (size_t i = 0; i < BENCH_PLUGINS; i++)
+    snprintf(bench_plugins[i], sizeof(bench_plugins[i]), "plugin%zu", i);
+  for (size_t i = 0; i < BENCH_TYPES; i++)
+    snprintf(bench_types[i], sizeof(bench_types[i]), "type%zu", i);
+
+  /* Per type: one default, 10 per plugin, 50 per host and 39 per host and
+   * plugin. */
+  threshold_tree = c_avl_create((int (*)(const void *, const void *))strcmp);
+  for (size_t t = 0; t < BENCH_TYPES; t++) {
+    add_threshold("", "", bench_types[t]);
+    for (size_t i = 0; i < 10; i++)
+      add_threshold("", bench_plugins[i], bench_types[t]);
+    for (size_t i = 0; i < 50; i++)
+      add_threshold(bench_hosts[i], "", bench_types[t]);
+    for (size_t i = 0; i < 39; i++)
+      add_threshold(bench_hosts[50 + i], bench_plugins[i % BENCH_PLUGINS],
+                    bench_types[t]);
+  }
+  printf("%d thresholds, %zu series\n", c_avl_size(threshold_tree), series);
+
+  double start = now_seconds();
+  size_t found = run(/* legacy = */ true, /* check = */ false, NULL);
+  double elapsed = now_seconds() - start;
+  printf("%-8s %10.0f lookups/s (%zu found)\n", "legacy",
+         (double)series / elapsed, found);
+
+  start = now_seconds();
+  found = run(/* legacy = */ false, /* check = */ false, NULL);
+  elapsed = now_seconds() - start;
+  printf("%-8s %10.0f lookups/s (%zu found)\n", "cold",
+         (double)series / elapsed, found);
+
+  start = now_seconds();
+  for (int r = 0; r < rounds; r++)
+    found = run(/* legacy = */ false, /* check = */ false, NULL);
+  elapsed = now_seconds() - start;
+  printf("%-8s %10.0f lookups/s (%zu found)\n", "warm",
+         (double)series * rounds / elapsed, found);
+
+  size_t mismatches = 0;
+  run(/* legacy = */ false, /* check = */ true, &mismatches);
+  printf("%zu mismatches\n", mismatches);
+
+  return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/**
+ * collectd - src/daemon/utils_threshold_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "collectd.h"
+#include "utils/avltree/avltree.h"
+#include "utils/common/common.h"
+
+#include "testing.h"
+#include "utils_threshold.h"
+
+static threshold_t *test_add(char const *host, char const *plugin,
+                             char const *plugin_instance, char const *type,
+                             char const *type_instance) {
+  threshold_t *th = calloc(1, sizeof(*th));
+  char name[6 * DATA_MAX_NAME_LEN];
+
+  if (th == NULL)
+    return NULL;
+  sstrncpy(th->host, host, sizeof(th->host));
+  sstrncpy(th->plugin, plugin, sizeof(th->plugin));
+  sstrncpy(th->plugin_instance, plugin_instance, sizeof(th->plugin_instance));
+  sstrncpy(th->type, type, sizeof(th->type));
+  sstrncpy(th->type_instance, type_instance, sizeof(th->type_instance));
+
+  format_name(name, sizeof(name), host, plugin, plugin_instance, type,
+              type_instance);
+  if (c_avl_insert(threshold_tree, strdup(name), th) != 0) {
+    sfree(th);
+    return NULL;
+  }
+  return th;
+}
+
+/* The lookup threshold_search() implemented before it was indexed. */
+static threshold_t *legacy_search(const value_list_t *vl) {
+  struct {
+    bool host;
+    bool plugin;
+    bool plugin_instance;
+    bool type_instance;
+  } cascade[] = {
+      {true, true, true, true},    {true, true, true, false},
+      {true, true, false, true},   {true, true, false, false},
+      {true, false, false, true},  {true, false, false, false},
+      {false, true, true, true},   {false, true, true, false},
+      {false, true, false, true},  {false, true, false, false},
+      {false, false, false, true}, {false, false, false, false},
+  };
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cascade); i++) {
+    threshold_t *th = threshold_get(
+        cascade[i].host ? vl->host : "", cascade[i].plugin ? vl->plugin : "",
+        cascade[i].plugin_instance ? vl->plugin_instance : NULL, vl->type,
+        cascade[i].type_instance ? vl->type_instance : NULL);
+    if (th != NULL)
+      return th;
+  }
+
+  return NULL;
+}
+
+static value_list_t make_vl(char const *host, char const *plugin,
+                            char const *plugin_instance, char const *type,
+                            char const *type_instance) {
+  value_list_t vl = VALUE_LIST_INIT;
+
+  sstrncpy(vl.host, host, sizeof(vl.host));
+  sstrncpy(vl.plugin, plugin, sizeof(vl.plugin));
+  sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
+  sstrncpy(vl.type, type, sizeof(vl.type));
+  sstrncpy(vl.type_instance, type_instance, sizeof(vl.type_instance));
+  return vl;
+}
+
+DEF_TEST(search) {
+  char const *hosts[] = {"", "a", "b", "c"};
+  char const *plugins[] = {"", "cpu", "other"};
+  char const *plugin_instances[] = {"", "0", "1"};
+  char const *types[] = {"cpu", "df", "memory"};
+  char const *type_instances[] = {"", "idle", "user", "system", "used"};
+
+  threshold_tree = c_avl_create((int (*)(const void *, const void *))strcmp);
+  CHECK_NOT_NULL(threshold_tree);
+
+  CHECK_NOT_NULL(test_add("", "", "", "cpu", ""));
+  CHECK_NOT_NULL(test_add("", "", "", "cpu", "idle"));
+  CHECK_NOT_NULL(test_add("", "cpu", "", "cpu", ""));
+  CHECK_NOT_NULL(test_add("", "cpu", "0", "cpu", "user"));
+  CHECK_NOT_NULL(test_add("a", "", "", "cpu", ""));
+  CHECK_NOT_NULL(test_add("a", "cpu", "", "cpu", "system"));
+  CHECK_NOT_NULL(test_add("b", "cpu", "1", "cpu", ""));
+  CHECK_NOT_NULL(test_add("", "", "", "df", "used"));
+
+  /* Twice, so that the second round is answered by the memo. */
+  for (int round = 0; round < 2; round++) {
+    for (size_t h = 0; h < STATIC_ARRAY_SIZE(hosts); h++)
+      for (size_t p = 0; p < STATIC_ARRAY_SIZE(plugins); p++)
+        for (size_t pi = 0; pi < STATIC_ARRAY_SIZE(plugin_instances); pi++)
+          for (size_t t = 0; t < STATIC_ARRAY_SIZE(types); t++)
+            for (size_t ti = 0; ti < STATIC_ARRAY_SIZE(type_instances); ti++) {
+              value_list_t vl = make_vl(hosts[h], plugins[p],
+                                        plugin_instances[pi], types[t],
+                                        type_instances[ti]);
+              EXPECT_EQ_PTR(legacy_search(&vl), threshold_search(&vl));
+            }
+  }
+
+  /* Adding a threshold invalidates the memorized results. */
+  value_list_t vl = make_vl("c", "cpu", "", "cpu", "");
+  threshold_t *th = threshold_search(&vl);
+  CHECK_NOT_NULL(th);
+  EXPECT_EQ_STR("cpu", th->plugin);
+
+  threshold_t *host_th = test_add("c", "", "", "cpu", "");
+  CHECK_NOT_NULL(host_th);
+  EXPECT_EQ_PTR(host_th, threshold_search(&vl));
+
+  vl = make_vl("c", "memory", "", "memory", "");
+  EXPECT_EQ_PTR(NULL, threshold_search(&vl));
+  threshold_t *memory_th = test_add("", "", "", "memory", "");
+  CHECK_NOT_NULL(memory_th);
+  EXPECT_EQ_PTR(memory_th, threshold_search(&vl));
+
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(search);
+
+  END_TEST;
+}
@@ -24,6 +24,7 @@
 #include "collectd.h"
 
 #include "plugin.h"
+#include "utils/avltree/avltree.h"
 #include "utils/common/common.h"
 #include "utils/ignorelist/ignorelist.h"
 
@@ -292,7 +293,118 @@ static int disk_init(void) {
   return 0;
 } /* int disk_init */
 
+static char const *disk_types[] = {
+    "disk_octets",  "disk_ops",     "disk_time",
+    "disk_merged",  "disk_io_time", "pending_operations",
+};
+
+/* Prepared series of one disk, created on first use. */
+typedef struct {
+  char *name;
+  plugin_series_t *series[STATIC_ARRAY_SIZE(disk_types)];
+  cdtime_t last_read;
+} disk_series_t;
+
+static c_avl_tree_t *disk_series_tree;
+static cdtime_t disk_read_time;
+
+static void disk_series_free(disk_series_t *entry) /* {{{ */
+{
+  if (entry == NULL)
+    return;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(entry->series); i++)
+    plugin_series_destroy(entry->series[i]);
+  sfree(entry->name);
+  sfree(entry);
+} /* }}} void disk_series_free */
+
+static plugin_series_t *disk_series_get(char const *plugin_instance, /* {{{ */
+                                        char const *type, size_t values_len) {
+  size_t type_index;
+  for (type_index = 0; type_index < STATIC_ARRAY_SIZE(disk_types);
+       type_index++)
+    if (strcmp(type, disk_types[type_index]) == 0)
+      break;
+  assert(type_index < STATIC_ARRAY_SIZE(disk_types));
+
+  if (disk_series_tree == NULL) {
+    disk_series_tree =
+        c_avl_create((int (*)(const void *, const void *))strcmp);
+    if (disk_series_tree == NULL)
+      return NULL;
+  }
+
+  disk_series_t *entry = NULL;
+  if (c_avl_get(disk_series_tree, plugin_instance, (void *)&entry) != 0) {
+    entry = calloc(1, sizeof(*entry));
+    if (entry == NULL)
+      return NULL;
+    entry->name = strdup(plugin_instance);
+    if ((entry->name == NULL) ||
+        (c_avl_insert(disk_series_tree, entry->name, entry) != 0)) {
+      disk_series_free(entry);
+      return NULL;
+    }
+  }
+  entry->last_read = disk_read_time;
+
+  if (entry->series[type_index] == NULL) {
+    value_list_t vl = VALUE_LIST_INIT;
+
+    vl.values_len = values_len;
+    sstrncpy(vl.plugin, "disk", sizeof(vl.plugin));
+    sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
+    sstrncpy(vl.type, type, sizeof(vl.type));
+
+    entry->series[type_index] = plugin_series_create(&vl);
+  }
+
+  return entry->series[type_index];
+} /* }}} plugin_series_t *disk_series_get */
+
+/* Frees the series of all disks which have not been reported since `since'. */
+static void disk_series_expire(cdtime_t since) /* {{{ */
+{
+  char **names = NULL;
+  size_t names_num = 0;
+
+  if (disk_series_tree == NULL)
+    return;
+
+  c_avl_iterator_t *iter = c_avl_get_iterator(disk_series_tree);
+  char *name;
+  disk_series_t *entry;
+  while (c_avl_iterator_next(iter, (void *)&name, (void *)&entry) == 0) {
+    if (entry->last_read >= since)
+      continue;
+
+    char **tmp = realloc(names, (names_num + 1) * sizeof(*names));
+    if (tmp == NULL)
+      break;
+    names = tmp;
+    names[names_num++] = name;
+  }
+  c_avl_iterator_destroy(iter);
+
+  for (size_t i = 0; i < names_num; i++) {
+    if (c_avl_remove(disk_series_tree, names[i], NULL, (void *)&entry) == 0)
+      disk_series_free(entry);
+  }
+  sfree(names);
+} /* }}} void disk_series_expire */
+
 static int disk_shutdown(void) {
+  if (disk_series_tree != NULL) {
+    char *name;
+    disk_series_t *entry;
+
+    while (c_avl_pick(disk_series_tree, (void *)&name, (void *)&entry) == 0)
+      disk_series_free(entry);
+    c_avl_destroy(disk_series_tree);
+    disk_series_tree = NULL;
+  }
+
 #if KERNEL_LINUX
 #if HAVE_LIBUDEV_H
   if (handle_udev != NULL)
@@ -304,51 +416,43 @@ static int disk_shutdown(void) {
 
 static void disk_submit(const char *plugin_instance, const char *type,
                         derive_t read, derive_t write) {
-  value_list_t vl = VALUE_LIST_INIT;
   value_t values[] = {
       {.derive = read},
       {.derive = write},
   };
 
-  vl.values = values;
-  vl.values_len = STATIC_ARRAY_SIZE(values);
-  sstrncpy(vl.plugin, "disk", sizeof(vl.plugin));
-  sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
-  sstrncpy(vl.type, type, sizeof(vl.type));
+  plugin_series_t *s =
+      disk_series_get(plugin_instance, type, STATIC_ARRAY_SIZE(values));
+  if (s == NULL)
+    return;
 
-  plugin_dispatch_values(&vl);
+  plugin_series_dispatch(s, values, 0);
 } /* void disk_submit */
 
 #if KERNEL_FREEBSD || (HAVE_SYSCTL && KERNEL_NETBSD) || KERNEL_LINUX
 static void submit_io_time(char const *plugin_instance, derive_t io_time,
                            derive_t weighted_time) {
-  value_list_t vl = VALUE_LIST_INIT;
   value_t values[] = {
       {.derive = io_time},
       {.derive = weighted_time},
   };
 
-  vl.values = values;
-  vl.values_len = STATIC_ARRAY_SIZE(values);
-  sstrncpy(vl.plugin, "disk", sizeof(vl.plugin));
-  sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
-  sstrncpy(vl.type, "disk_io_time", sizeof(vl.type));
+  plugin_series_t *s = disk_series_get(plugin_instance, "disk_io_time",
+                                       STATIC_ARRAY_SIZE(values));
+  if (s == NULL)
+    return;
 
-  plugin_dispatch_values(&vl);
+  plugin_series_dispatch(s, values, 0);
 } /* void submit_io_time */
 #endif /* KERNEL_FREEBSD || (HAVE_SYSCTL && KERNEL_NETBSD) || KERNEL_LINUX */
 
 #if KERNEL_FREEBSD || KERNEL_LINUX
 static void submit_in_progress(char const *disk_name, gauge_t in_progress) {
-  value_list_t vl = VALUE_LIST_INIT;
-
-  vl.values = &(value_t){.gauge = in_progress};
-  vl.values_len = 1;
-  sstrncpy(vl.plugin, "disk", sizeof(vl.plugin));
-  sstrncpy(vl.plugin_instance, disk_name, sizeof(vl.plugin_instance));
-  sstrncpy(vl.type, "pending_operations", sizeof(vl.type));
+  plugin_series_t *s = disk_series_get(disk_name, "pending_operations", 1);
+  if (s == NULL)
+    return;
 
-  plugin_dispatch_values(&vl);
+  plugin_series_dispatch(s, &(value_t){.gauge = in_progress}, 0);
 }
 #endif /* KERNEL_FREEBSD || KERNEL_LINUX */
 
@@ -424,6 +528,10 @@ static signed long long dict_get_value(CFDictionaryRef dict, const char *key) {
 #endif /* HAVE_IOKIT_IOKITLIB_H */
 
 static int disk_read(void) {
+  /* Disks which were not reported by the last read are gone. */
+  disk_series_expire(disk_read_time);
+  disk_read_time = cdtime();
+
 #if HAVE_IOKIT_IOKITLIB_H
   io_registry_entry_t disk;
   io_registry_entry_t disk_child;
@@ -25,6 +25,7 @@
 #include "collectd.h"
 
 #include "plugin.h"
+#include "utils/avltree/avltree.h"
 #include "utils/common/common.h"
 #include "utils/ignorelist/ignorelist.h"
 
@@ -158,9 +159,110 @@ static int interface_init(void) {
 } /* int interface_init */
 #endif /* HAVE_LIBKSTAT */
 
+static char const *if_types[] = {
+    "if_octets",
+    "if_packets",
+    "if_errors",
+    "if_dropped",
+};
+
+/* Prepared series of one interface, created on first use. */
+typedef struct {
+  char *name;
+  plugin_series_t *series[STATIC_ARRAY_SIZE(if_types)];
+  cdtime_t last_read;
+} if_series_t;
+
+static c_avl_tree_t *if_series_tree;
+static cdtime_t if_read_time;
+
+static void if_series_free(if_series_t *entry) /* {{{ */
+{
+  if (entry == NULL)
+    return;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(entry->series); i++)
+    plugin_series_destroy(entry->series[i]);
+  sfree(entry->name);
+  sfree(entry);
+} /* }}} void if_series_free */
+
+static plugin_series_t *if_series_get(char const *dev, /* {{{ */
+                                      char const *type) {
+  size_t type_index;
+  for (type_index = 0; type_index < STATIC_ARRAY_SIZE(if_types); type_index++)
+    if (strcmp(type, if_types[type_index]) == 0)
+      break;
+  assert(type_index < STATIC_ARRAY_SIZE(if_types));
+
+  if (if_series_tree == NULL) {
+    if_series_tree = c_avl_create((int (*)(const void *, const void *))strcmp);
+    if (if_series_tree == NULL)
+      return NULL;
+  }
+
+  if_series_t *entry = NULL;
+  if (c_avl_get(if_series_tree, dev, (void *)&entry) != 0) {
+    entry = calloc(1, sizeof(*entry));
+    if (entry == NULL)
+      return NULL;
+    entry->name = strdup(dev);
+    if ((entry->name == NULL) ||
+        (c_avl_insert(if_series_tree, entry->name, entry) != 0)) {
+      if_series_free(entry);
+      return NULL;
+    }
+  }
+  entry->last_read = if_read_time;
+
+  if (entry->series[type_index] == NULL) {
+    value_list_t vl = VALUE_LIST_INIT;
+
+    vl.values_len = 2;
+    sstrncpy(vl.plugin, "interface", sizeof(vl.plugin));
+    sstrncpy(vl.plugin_instance, dev, sizeof(vl.plugin_instance));
+    sstrncpy(vl.type, type, sizeof(vl.type));
+
+    entry->series[type_index] = plugin_series_create(&vl);
+  }
+
+  return entry->series[type_index];
+} /* }}} plugin_series_t *if_series_get */
+
+/* Frees the series of all interfaces which have not been reported since
+ * `since'. */
+static void if_series_expire(cdtime_t since) /* {{{ */
+{
+  char **names = NULL;
+  size_t names_num = 0;
+
+  if (if_series_tree == NULL)
+    return;
+
+  c_avl_iterator_t *iter = c_avl_get_iterator(if_series_tree);
+  char *name;
+  if_series_t *entry;
+  while (c_avl_iterator_next(iter, (void *)&name, (void *)&entry) == 0) {
+    if (entry->last_read >= since)
+      continue;
+
+    char **tmp = realloc(names, (names_num + 1) * sizeof(*names));
+    if (tmp == NULL)
+      break;
+    names = tmp;
+    names[names_num++] = name;
+  }
+  c_avl_iterator_destroy(iter);
+
+  for (size_t i = 0; i < names_num; i++) {
+    if (c_avl_remove(if_series_tree, names[i], NULL, (void *)&entry) == 0)
+      if_series_free(entry);
+  }
+  sfree(names);
+} /* }}} void if_series_expire */
+
 static void if_submit(const char *dev, const char *type, derive_t rx,
                       derive_t tx) {
-  value_list_t vl = VALUE_LIST_INIT;
   value_t values[] = {
       {.derive = rx},
       {.derive = tx},
@@ -169,16 +271,18 @@ static void if_submit(const char *dev, const char *type, derive_t rx,
   if (ignorelist_match(ignorelist, dev) != 0)
     return;
 
-  vl.values = values;
-  vl.values_len = STATIC_ARRAY_SIZE(values);
-  sstrncpy(vl.plugin, "interface", sizeof(vl.plugin));
-  sstrncpy(vl.plugin_instance, dev, sizeof(vl.plugin_instance));
-  sstrncpy(vl.type, type, sizeof(vl.type));
+  plugin_series_t *s = if_series_get(dev, type);
+  if (s == NULL)
+    return;
 
-  plugin_dispatch_values(&vl);
+  plugin_series_dispatch(s, values, 0);
 } /* void if_submit */
 
 static int interface_read(void) {
+  /* Interfaces which were not reported by the last read are gone. */
+  if_series_expire(if_read_time);
+  if_read_time = cdtime();
+
 #if KERNEL_LINUX
   FILE *fh;
   char buffer[1024];
@@ -389,6 +493,20 @@ static int interface_read(void) {
   return 0;
 } /* int interface_read */
 
+static int interface_shutdown(void) {
+  if (if_series_tree != NULL) {
+    char *name;
+    if_series_t *entry;
+
+    while (c_avl_pick(if_series_tree, (void *)&name, (void *)&entry) == 0)
+      if_series_free(entry);
+    c_avl_destroy(if_series_tree);
+    if_series_tree = NULL;
+  }
+
+  return 0;
+} /* int interface_shutdown */
+
 void module_register(void) {
   plugin_register_config("interface", interface_config, config_keys,
                          config_keys_num);
@@ -396,4 +514,5 @@ void module_register(void) {
   plugin_register_init("interface", interface_init);
 #endif
   plugin_register_read("interface", interface_read);
+  plugin_register_shutdown("interface", interface_shutdown);
 } /* void module_register */
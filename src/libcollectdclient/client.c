@@ -900,6 +900,137 @@ int lcc_listval(lcc_connection_t *c, /* {{{ */
   return 0;
 } /* }}} int lcc_listval */
 
+/* Parses one line of a QUERYVAL response, "<time>:<value>[:...] <name>",
+ * into `vl'. The values are stored at `vl->values', which must have room for
+ * all of them. */
+static int lcc_queryval_parse(lcc_connection_t *c, /* {{{ */
+                              char *line, lcc_value_list_t *vl) {
+  char *ident_str = strchr(line, ' ');
+  if (ident_str == NULL) {
+    lcc_set_errno(c, EILSEQ);
+    return -1;
+  }
+  *ident_str = 0;
+  ident_str++;
+
+  char *ptr = line;
+  for (size_t i = 0; i <= vl->values_len; i++) {
+    char *endptr = NULL;
+    errno = 0;
+    double d = strtod(ptr, &endptr);
+    if ((endptr == ptr) || (errno != 0) ||
+        ((*endptr != ':') && (*endptr != 0))) {
+      lcc_set_errno(c, EILSEQ);
+      return -1;
+    }
+
+    if (i == 0) {
+      vl->time = d;
+    } else {
+      vl->values[i - 1].gauge = d;
+      vl->values_types[i - 1] = LCC_TYPE_GAUGE;
+    }
+    ptr = endptr + 1;
+  }
+
+  return lcc_string_to_identifier(c, &vl->identifier, ident_str);
+} /* }}} int lcc_queryval_parse */
+
+int lcc_queryval(lcc_connection_t *c, /* {{{ */
+                 const lcc_identifier_t *pattern, lcc_value_list_t **ret_vl,
+                 size_t *ret_vl_num) {
+  char command[1024] = "QUERYVAL";
+  lcc_response_t res;
+  int status;
+
+  if (c == NULL)
+    return -1;
+
+  if ((pattern == NULL) || (ret_vl == NULL) || (ret_vl_num == NULL)) {
+    lcc_set_errno(c, EINVAL);
+    return -1;
+  }
+
+  struct {
+    char const *key;
+    char const *value;
+  } fields[] = {
+      {"host", pattern->host},
+      {"plugin", pattern->plugin},
+      {"plugin_instance", pattern->plugin_instance},
+      {"type", pattern->type},
+      {"type_instance", pattern->type_instance},
+  };
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    char option[LCC_NAME_LEN + 32];
+    char option_esc[2 * sizeof(option)];
+
+    if (fields[i].value[0] == 0)
+      continue;
+
+    snprintf(option, sizeof(option), "%s=%s", fields[i].key, fields[i].value);
+    SSTRCATF(command, " %s",
+             lcc_strescape(option_esc, option, sizeof(option_esc)));
+  }
+
+  status = lcc_sendreceive(c, command, &res);
+  if (status != 0)
+    return status;
+
+  if (res.status != 0) {
+    LCC_SET_ERRSTR(c, "Server error: %s", res.message);
+    lcc_response_free(&res);
+    return -1;
+  }
+
+  /* Count the values first, so that the value lists and all values can be
+   * returned in a single allocation. */
+  size_t values_total = 0;
+  for (size_t i = 0; i < res.lines_num; i++)
+    for (char *ptr = res.lines[i]; (*ptr != ' ') && (*ptr != 0); ptr++)
+      if (*ptr == ':')
+        values_total++;
+
+  size_t vl_num = res.lines_num;
+  lcc_value_list_t *vl =
+      calloc(1, vl_num * sizeof(*vl) +
+                    values_total * (sizeof(value_t) + sizeof(int)));
+  if (vl == NULL) {
+    lcc_response_free(&res);
+    lcc_set_errno(c, ENOMEM);
+    return -1;
+  }
+
+  value_t *values = (value_t *)(vl + vl_num);
+  int *values_types = (int *)(values + values_total);
+  for (size_t i = 0; i < vl_num; i++) {
+    vl[i].values = values;
+    vl[i].values_types = values_types;
+    for (char *ptr = res.lines[i]; (*ptr != ' ') && (*ptr != 0); ptr++)
+      if (*ptr == ':')
+        vl[i].values_len++;
+
+    status = lcc_queryval_parse(c, res.lines[i], vl + i);
+    if (status != 0)
+      break;
+
+    values += vl[i].values_len;
+    values_types += vl[i].values_len;
+  }
+
+  lcc_response_free(&res);
+
+  if (status != 0) {
+    free(vl);
+    return -1;
+  }
+
+  *ret_vl = vl;
+  *ret_vl_num = vl_num;
+
+  return 0;
+} /* }}} int lcc_queryval */
+
 const char *lcc_strerror(lcc_connection_t *c) /* {{{ */
 {
   if (c == NULL)
@@ -72,6 +72,15 @@ int lcc_flush(lcc_connection_t *c, const char *plugin, lcc_identifier_t *ident,
 int lcc_listval(lcc_connection_t *c, lcc_identifier_t **ret_ident,
                 size_t *ret_ident_num);
 
+/* Returns all values whose identifier matches "pattern" with a single
+ * command. Empty fields of "pattern" match any value. Fields enclosed in
+ * slashes are extended regular expressions, all others are shell wildcard
+ * patterns. Like lcc_getval(), the values are rates and their type is
+ * LCC_TYPE_GAUGE. The value lists and their values are stored in a single
+ * allocation, which the caller has to free(). */
+int lcc_queryval(lcc_connection_t *c, const lcc_identifier_t *pattern,
+                 lcc_value_list_t **ret_vl, size_t *ret_vl_num);
+
 /* TODO: putnotif */
 
 const char *lcc_strerror(lcc_connection_t *c);
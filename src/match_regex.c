@@ -357,11 +357,19 @@ static int mr_match(const data_set_t __attribute__((unused)) * ds, /* {{{ */
   return match_value;
 } /* }}} int mr_match */
 
+static bool mr_identifier_only(void *user_data) /* {{{ */
+{
+  mr_match_t *m = user_data;
+
+  return (m != NULL) && (m->meta == NULL);
+} /* }}} bool mr_identifier_only */
+
 void module_register(void) {
   match_proc_t mproc = {0};
 
   mproc.create = mr_create;
   mproc.destroy = mr_destroy;
   mproc.match = mr_match;
+  mproc.identifier_only = mr_identifier_only;
   fc_register_match("regex", mproc);
 } /* module_register */
@@ -24,6 +24,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE /* For struct ip_mreq */
+#define _GNU_SOURCE /* For recvmmsg and sendmmsg */
 
 #include "collectd.h"
 
@@ -31,6 +32,7 @@
 #include "utils/common/common.h"
 #include "utils_cache.h"
 #include "utils_complain.h"
+#include "utils/slab/slab.h"
 #include "utils_fbhash.h"
 
 #include "network.h"
@@ -100,6 +102,19 @@ GCRY_THREAD_OPTION_PTHREAD_IMPL;
 #define SECURITY_LEVEL_SIGN 1
 #define SECURITY_LEVEL_ENCRYPT 2
 #endif
+/* Maximum number of packets received with one recvmmsg(2) call and sent with
+ * one sendmmsg(2) call. */
+#define NETWORK_RECEIVE_BATCH 64
+#define NETWORK_SEND_BATCH 16
+
+/* Complete packets waiting to be sent to one server. */
+struct send_batch_s {
+  char *packets; /* NETWORK_SEND_BATCH times network_config_packet_size */
+  size_t packets_size[NETWORK_SEND_BATCH];
+  size_t packets_num;
+};
+typedef struct send_batch_s send_batch_t;
+
 struct sockent_client {
   int fd;
   struct sockaddr_storage *addr;
@@ -114,6 +129,20 @@ struct sockent_client {
   cdtime_t next_resolve_reconnect;
   cdtime_t resolve_interval;
   struct sockaddr_storage *bind_addr;
+
+  /* Packets are built in `buffer' and collected in `batch' while holding
+   * `buffer_lock'. Full batches are signed or encrypted into `scratch' and
+   * sent while holding the lock of the sockent instead, so that other
+   * threads can keep adding values meanwhile. */
+  pthread_mutex_t buffer_lock;
+  char *buffer;
+  char *buffer_ptr;
+  int buffer_fill;
+  cdtime_t buffer_last_update;
+  value_list_t buffer_vl;
+  send_batch_t *batch;
+  send_batch_t *batch_spare;
+  char *scratch;
 };
 
 struct sockent_server {
@@ -252,12 +281,14 @@ struct part_encryption_aes256_s {
 };
 typedef struct part_encryption_aes256_s part_encryption_aes256_t;
 
+/* Entries are allocated from `receive_pool' together with room for one
+ * packet, so that they can be recycled by the dispatch thread. */
 struct receive_list_entry_s {
-  char *data;
   int data_len;
-  int fd;
+  sockent_t *se;
   struct sockaddr_storage sender;
   struct receive_list_entry_s *next;
+  char data[];
 };
 typedef struct receive_list_entry_s receive_list_entry_t;
 
@@ -277,39 +308,72 @@ static receive_list_entry_t *receive_list_tail;
 static pthread_mutex_t receive_list_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t receive_list_cond = PTHREAD_COND_INITIALIZER;
 static uint64_t receive_list_length;
+static slab_t *receive_pool;
+/* Number of packets to receive per system call. Only changed by the
+ * benchmark. */
+static size_t receive_batch_size = NETWORK_RECEIVE_BATCH;
 
 static sockent_t *listen_sockets;
 static struct pollfd *listen_sockets_pollfd;
+/* The socket entry each file descriptor in `listen_sockets_pollfd' belongs
+ * to. */
+static sockent_t **listen_sockets_se;
 static size_t listen_sockets_num;
 
+/* Number of receive threads. With more than one, each unicast address is bound
+ * once per thread with SO_REUSEPORT and the threads parse the packets they
+ * receive themselves instead of handing them to the dispatch thread. */
+static size_t network_config_receive_threads = 1;
+
+/* Values (not) dispatched by one thread parsing packets, see parse_packet().
+ * Only written by that thread and read without a lock by network_stats_read().
+ */
+struct parse_stats_s {
+  derive_t values_dispatched;
+  derive_t values_not_dispatched;
+};
+typedef struct parse_stats_s parse_stats_t;
+
+/* A receive thread and the sockets it polls. The counters are only written by
+ * the thread itself and read without a lock by network_stats_read(). */
+struct receive_worker_s {
+  size_t index;
+  struct pollfd *pollfd;
+  sockent_t **se;
+  /* Last SO_RXQ_OVFL counter seen on each socket. */
+  uint32_t *drops_seen;
+  size_t num;
+  /* Parse packets in this thread rather than queueing them. */
+  bool parse;
+  bool running;
+  pthread_t thread_id;
+  derive_t octets_rx;
+  derive_t packets_rx;
+  derive_t drops_rx;
+  parse_stats_t parse_stats;
+};
+typedef struct receive_worker_s receive_worker_t;
+
+static receive_worker_t *receive_workers;
+static size_t receive_workers_num;
+
 /* The receive and dispatch threads will run as long as `listen_loop' is set to
  * zero. */
 static int listen_loop;
-static int receive_thread_running;
-static pthread_t receive_thread_id;
 static int dispatch_thread_running;
 static pthread_t dispatch_thread_id;
 
-/* Buffer in which to-be-sent network packets are constructed. */
-static char *send_buffer;
-static char *send_buffer_ptr;
-static int send_buffer_fill;
-static cdtime_t send_buffer_last_update;
-static value_list_t send_buffer_vl = VALUE_LIST_INIT;
-static pthread_mutex_t send_buffer_lock = PTHREAD_MUTEX_INITIALIZER;
-
 /* XXX: These counters are incremented from one place only. The spot in which
- * the values are incremented is either only reachable by one thread (the
- * dispatch thread, for example) or locked by some lock (send_buffer_lock for
- * example). Only if neither is true, the stats_lock is acquired. The counters
- * are always read without holding a lock in the hope that writing 8 bytes to
- * memory is an atomic operation. */
-static derive_t stats_octets_rx;
+ * the values are incremented is either only reachable by one thread or locked
+ * by some lock. Only if neither is true, the stats_lock is acquired; this is
+ * the case for the sent packets and values, which are counted by all write
+ * threads. The counters are always read without
+ * holding a lock in the hope that writing 8 bytes to memory is an atomic
+ * operation. Received octets and packets and dispatched values are counted
+ * per receive thread, see receive_worker_t, and by the dispatch thread. */
 static derive_t stats_octets_tx;
-static derive_t stats_packets_rx;
 static derive_t stats_packets_tx;
-static derive_t stats_values_dispatched;
-static derive_t stats_values_not_dispatched;
+static parse_stats_t stats_dispatch_thread;
 static derive_t stats_values_sent;
 static derive_t stats_values_not_sent;
 static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -319,14 +383,14 @@ static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
  */
 static bool check_receive_okay(const value_list_t *vl) /* {{{ */
 {
-  uint64_t time_sent = 0;
+  cdtime_t time_sent = 0;
   int status;
 
-  status = uc_meta_data_get_unsigned_int(vl, "network:time_sent", &time_sent);
+  status = uc_get_time_sent(vl, &time_sent);
 
   /* This is a value we already sent. Don't allow it to be received again in
    * order to avoid looping. */
-  if ((status == 0) && (time_sent >= ((uint64_t)vl->time)))
+  if ((status == 0) && (time_sent >= vl->time))
     return 0;
 
   return 1;
@@ -395,7 +459,8 @@ static bool check_send_notify_okay(const notification_t *n) /* {{{ */
 
 static int network_dispatch_values(value_list_t *vl, /* {{{ */
                                    const char *username,
-                                   struct sockaddr_storage *address) {
+                                   struct sockaddr_storage *address,
+                                   parse_stats_t *stats) {
   int status;
 
   if ((vl->time == 0) || (strlen(vl->host) == 0) || (strlen(vl->plugin) == 0) ||
@@ -411,7 +476,7 @@ static int network_dispatch_values(value_list_t *vl, /* {{{ */
           "NOT dispatching %s.",
           name);
 #endif
-    stats_values_not_dispatched++;
+    stats->values_not_dispatched++;
     return 0;
   }
 
@@ -463,7 +528,7 @@ static int network_dispatch_values(value_list_t *vl, /* {{{ */
   }
 
   plugin_dispatch_values(vl);
-  stats_values_dispatched++;
+  stats->values_dispatched++;
 
   meta_data_destroy(vl->meta);
   vl->meta = NULL;
@@ -996,7 +1061,7 @@ static int parse_part_string(void **ret_buffer, size_t *ret_buffer_len,
 #define PP_ENCRYPTED 0x02
 static int parse_packet(sockent_t *se, void *buffer, size_t buffer_size,
                         int flags, const char *username,
-                        struct sockaddr_storage *sender);
+                        struct sockaddr_storage *sender, parse_stats_t *stats);
 
 #define BUFFER_READ(p, s)                                                      \
   do {                                                                         \
@@ -1007,7 +1072,8 @@ static int parse_packet(sockent_t *se, void *buffer, size_t buffer_size,
 #if HAVE_GCRYPT_H
 static int parse_part_sign_sha256(sockent_t *se, /* {{{ */
                                   void **ret_buffer, size_t *ret_buffer_len,
-                                  int flags, struct sockaddr_storage *sender) {
+                                  int flags, struct sockaddr_storage *sender,
+                                  parse_stats_t *stats) {
   static c_complain_t complain_no_users = C_COMPLAIN_INIT_STATIC;
 
   char *buffer;
@@ -1122,7 +1188,7 @@ static int parse_part_sign_sha256(sockent_t *se, /* {{{ */
             pss.username);
   } else {
     parse_packet(se, buffer + buffer_offset, buffer_len - buffer_offset,
-                 flags | PP_SIGNED, pss.username, sender);
+                 flags | PP_SIGNED, pss.username, sender, stats);
   }
 
   sfree(secret);
@@ -1138,7 +1204,8 @@ static int parse_part_sign_sha256(sockent_t *se, /* {{{ */
 #else  /* if !HAVE_GCRYPT_H */
 static int parse_part_sign_sha256(sockent_t *se, /* {{{ */
                                   void **ret_buffer, size_t *ret_buffer_size,
-                                  int flags, struct sockaddr_storage *sender) {
+                                  int flags, struct sockaddr_storage *sender,
+                                  parse_stats_t *stats) {
   static int warning_has_been_printed;
 
   char *buffer;
@@ -1170,7 +1237,7 @@ static int parse_part_sign_sha256(sockent_t *se, /* {{{ */
   }
 
   parse_packet(se, buffer + part_len, buffer_size - part_len, flags,
-               /* username = */ NULL, sender);
+               /* username = */ NULL, sender, stats);
 
   *ret_buffer = buffer + buffer_size;
   *ret_buffer_size = 0;
@@ -1182,7 +1249,8 @@ static int parse_part_sign_sha256(sockent_t *se, /* {{{ */
 #if HAVE_GCRYPT_H
 static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
                                   void **ret_buffer, size_t *ret_buffer_len,
-                                  int flags, struct sockaddr_storage *sender) {
+                                  int flags, struct sockaddr_storage *sender,
+                                  parse_stats_t *stats) {
   char *buffer = *ret_buffer;
   size_t buffer_len = *ret_buffer_len;
   size_t payload_len;
@@ -1241,8 +1309,11 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
   assert(buffer_offset ==
          (username_len + PART_ENCRYPTION_AES256_SIZE - sizeof(pea.hash)));
 
+  /* The cypher of the socket entry is shared by all receive threads. */
+  pthread_mutex_lock(&se->lock);
   cypher = network_get_aes256_cypher(se, pea.iv, sizeof(pea.iv), pea.username);
   if (cypher == NULL) {
+    pthread_mutex_unlock(&se->lock);
     ERROR("network plugin: Failed to get cypher. Username: %s", pea.username);
     sfree(pea.username);
     return -1;
@@ -1255,6 +1326,7 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
   err = gcry_cipher_decrypt(cypher, buffer + buffer_offset,
                             part_size - buffer_offset,
                             /* in = */ NULL, /* in len = */ 0);
+  pthread_mutex_unlock(&se->lock);
   if (err != 0) {
     ERROR("network plugin: gcry_cipher_decrypt returned: %s. Username: %s",
           gcry_strerror(err), pea.username);
@@ -1278,7 +1350,7 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
   }
 
   parse_packet(se, buffer + buffer_offset, payload_len, flags | PP_ENCRYPTED,
-               pea.username, sender);
+               pea.username, sender, stats);
 
   /* Update return values */
   *ret_buffer = buffer + part_size;
@@ -1293,7 +1365,8 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
 #else  /* if !HAVE_GCRYPT_H */
 static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
                                   void **ret_buffer, size_t *ret_buffer_size,
-                                  int flags, struct sockaddr_storage *sender) {
+                                  int flags, struct sockaddr_storage *sender,
+                                  parse_stats_t *stats) {
   static int warning_has_been_printed;
 
   char *buffer;
@@ -1338,8 +1411,8 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
 
 static int parse_packet(sockent_t *se, /* {{{ */
                         void *buffer, size_t buffer_size, int flags,
-                        const char *username,
-                        struct sockaddr_storage *address) {
+                        const char *username, struct sockaddr_storage *address,
+                        parse_stats_t *stats) {
   int status;
 
   value_list_t vl = VALUE_LIST_INIT;
@@ -1374,7 +1447,8 @@ static int parse_packet(sockent_t *se, /* {{{ */
 
     if (pkg_type == TYPE_ENCR_AES256) {
       status =
-          parse_part_encr_aes256(se, &buffer, &buffer_size, flags, address);
+          parse_part_encr_aes256(se, &buffer, &buffer_size, flags, address,
+                                 stats);
       if (status != 0) {
         ERROR("network plugin: Decrypting AES256 "
               "part failed "
@@ -1398,7 +1472,8 @@ static int parse_packet(sockent_t *se, /* {{{ */
 #endif /* HAVE_GCRYPT_H */
     else if (pkg_type == TYPE_SIGN_SHA256) {
       status =
-          parse_part_sign_sha256(se, &buffer, &buffer_size, flags, address);
+          parse_part_sign_sha256(se, &buffer, &buffer_size, flags, address,
+                                 stats);
       if (status != 0) {
         ERROR("network plugin: Verifying HMAC-SHA-256 "
               "signature failed "
@@ -1426,7 +1501,7 @@ static int parse_packet(sockent_t *se, /* {{{ */
       if (status != 0)
         break;
 
-      network_dispatch_values(&vl, username, address);
+      network_dispatch_values(&vl, username, address, stats);
 
       sfree(vl.values);
     } else if (pkg_type == TYPE_TIME) {
@@ -1523,6 +1598,30 @@ static int parse_packet(sockent_t *se, /* {{{ */
   return status;
 } /* }}} int parse_packet */
 
+static void send_batch_destroy(send_batch_t *b) /* {{{ */
+{
+  if (b == NULL)
+    return;
+
+  sfree(b->packets);
+  sfree(b);
+} /* }}} void send_batch_destroy */
+
+static send_batch_t *send_batch_create(void) /* {{{ */
+{
+  send_batch_t *b = calloc(1, sizeof(*b));
+  if (b == NULL)
+    return NULL;
+
+  b->packets = malloc(NETWORK_SEND_BATCH * network_config_packet_size);
+  if (b->packets == NULL) {
+    sfree(b);
+    return NULL;
+  }
+
+  return b;
+} /* }}} send_batch_t *send_batch_create */
+
 static void free_sockent_client(struct sockent_client *sec) /* {{{ */
 {
   if (sec->fd >= 0) {
@@ -1531,6 +1630,11 @@ static void free_sockent_client(struct sockent_client *sec) /* {{{ */
   }
   sfree(sec->addr);
   sfree(sec->bind_addr);
+  pthread_mutex_destroy(&sec->buffer_lock);
+  sfree(sec->buffer);
+  send_batch_destroy(sec->batch);
+  send_batch_destroy(sec->batch_spare);
+  sfree(sec->scratch);
 #if HAVE_GCRYPT_H
   sfree(sec->username);
   sfree(sec->password);
@@ -1750,8 +1854,22 @@ static int network_bind_socket_to_addr(sockent_t *se,
   return 0;
 } /* int network_bind_socket_to_addr */
 
+static bool network_addr_is_multicast(const struct addrinfo *ai) /* {{{ */
+{
+  if (ai->ai_family == AF_INET) {
+    struct sockaddr_in *addr = (struct sockaddr_in *)ai->ai_addr;
+    return IN_MULTICAST(ntohl(addr->sin_addr.s_addr));
+  } else if (ai->ai_family == AF_INET6) {
+    struct sockaddr_in6 *addr = (struct sockaddr_in6 *)ai->ai_addr;
+    return IN6_IS_ADDR_MULTICAST(&addr->sin6_addr);
+  }
+  return false;
+} /* }}} bool network_addr_is_multicast */
+
+/* If `reuse_port' is true, the kernel distributes the packets sent to the
+ * address among all sockets bound to it. */
 static int network_bind_socket(int fd, const struct addrinfo *ai,
-                               const int interface_idx) {
+                               const int interface_idx, bool reuse_port) {
 #if KERNEL_SOLARIS
   char loop = 0;
 #else
@@ -1764,6 +1882,23 @@ static int network_bind_socket(int fd, const struct addrinfo *ai,
     return -1;
   }
 
+#ifdef SO_REUSEPORT
+  if (reuse_port &&
+      (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &(int){1}, sizeof(int)) ==
+       -1)) {
+    ERROR("network plugin: setsockopt (reuseport): %s", STRERRNO);
+    return -1;
+  }
+#else
+  assert(!reuse_port);
+#endif
+
+#ifdef SO_RXQ_OVFL
+  /* Have the kernel report the number of dropped packets with each packet. */
+  if (setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){1}, sizeof(int)) == -1)
+    WARNING("network plugin: setsockopt (rxq-ovfl): %s", STRERRNO);
+#endif
+
   DEBUG("fd = %i; calling `bind'", fd);
 
   if (bind(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
@@ -1904,6 +2039,7 @@ static sockent_t *sockent_create(int type) /* {{{ */
     se->data.client.bind_addr = NULL;
     se->data.client.resolve_interval = 0;
     se->data.client.next_resolve_reconnect = 0;
+    pthread_mutex_init(&se->data.client.buffer_lock, NULL);
 #if HAVE_GCRYPT_H
     se->data.client.security_level = SECURITY_LEVEL_NONE;
     se->data.client.username = NULL;
@@ -2116,32 +2252,41 @@ static int sockent_server_listen(sockent_t *se) /* {{{ */
 
   for (struct addrinfo *ai_ptr = ai_list; ai_ptr != NULL;
        ai_ptr = ai_ptr->ai_next) {
-    int *tmp;
+    /* Open one socket per receive thread. Multicast packets are delivered to
+     * each socket bound to the group, so those are only opened once. */
+    size_t copies = network_config_receive_threads;
+    if (network_addr_is_multicast(ai_ptr))
+      copies = 1;
+
+    for (size_t i = 0; i < copies; i++) {
+      int *tmp;
+
+      tmp = realloc(se->data.server.fd,
+                    sizeof(*tmp) * (se->data.server.fd_num + 1));
+      if (tmp == NULL) {
+        ERROR("network plugin: realloc failed.");
+        continue;
+      }
+      se->data.server.fd = tmp;
+      tmp = se->data.server.fd + se->data.server.fd_num;
 
-    tmp = realloc(se->data.server.fd,
-                  sizeof(*tmp) * (se->data.server.fd_num + 1));
-    if (tmp == NULL) {
-      ERROR("network plugin: realloc failed.");
-      continue;
-    }
-    se->data.server.fd = tmp;
-    tmp = se->data.server.fd + se->data.server.fd_num;
+      *tmp =
+          socket(ai_ptr->ai_family, ai_ptr->ai_socktype, ai_ptr->ai_protocol);
+      if (*tmp < 0) {
+        ERROR("network plugin: socket(2) failed: %s", STRERRNO);
+        continue;
+      }
 
-    *tmp = socket(ai_ptr->ai_family, ai_ptr->ai_socktype, ai_ptr->ai_protocol);
-    if (*tmp < 0) {
-      ERROR("network plugin: socket(2) failed: %s", STRERRNO);
-      continue;
-    }
+      status = network_bind_socket(*tmp, ai_ptr, se->interface,
+                                   /* reuse_port = */ copies > 1);
+      if (status != 0) {
+        close(*tmp);
+        *tmp = -1;
+        continue;
+      }
 
-    status = network_bind_socket(*tmp, ai_ptr, se->interface);
-    if (status != 0) {
-      close(*tmp);
-      *tmp = -1;
-      continue;
+      se->data.server.fd_num++;
     }
-
-    se->data.server.fd_num++;
-    continue;
   } /* for (ai_list) */
 
   freeaddrinfo(ai_list);
@@ -2160,22 +2305,32 @@ static int sockent_add(sockent_t *se) /* {{{ */
     return -1;
 
   if (se->type == SOCKENT_TYPE_SERVER) {
+    size_t num = listen_sockets_num + se->data.server.fd_num;
     struct pollfd *tmp;
+    sockent_t **tmp_se;
+
+    tmp_se = realloc(listen_sockets_se, sizeof(*tmp_se) * num);
+    if (tmp_se == NULL) {
+      ERROR("network plugin: realloc failed.");
+      return -1;
+    }
+    listen_sockets_se = tmp_se;
 
-    tmp = realloc(listen_sockets_pollfd,
-                  sizeof(*tmp) * (listen_sockets_num + se->data.server.fd_num));
+    tmp = realloc(listen_sockets_pollfd, sizeof(*tmp) * num);
     if (tmp == NULL) {
       ERROR("network plugin: realloc failed.");
       return -1;
     }
     listen_sockets_pollfd = tmp;
     tmp = listen_sockets_pollfd + listen_sockets_num;
+    tmp_se = listen_sockets_se + listen_sockets_num;
 
     for (size_t i = 0; i < se->data.server.fd_num; i++) {
       memset(tmp + i, 0, sizeof(*tmp));
       tmp[i].fd = se->data.server.fd[i];
       tmp[i].events = POLLIN | POLLPRI;
       tmp[i].revents = 0;
+      tmp_se[i] = se;
     }
 
     listen_sockets_num += se->data.server.fd_num;
@@ -2201,22 +2356,36 @@ static int sockent_add(sockent_t *se) /* {{{ */
   return 0;
 } /* }}} int sockent_add */
 
+/* Parses the packets in `ent' and returns the entries to `receive_pool'.
+ * `stats' belongs to the calling thread. */
+static void receive_list_parse(receive_list_entry_t *ent, /* {{{ */
+                               parse_stats_t *stats) {
+  while (ent != NULL) {
+    receive_list_entry_t *next = ent->next;
+
+    parse_packet(ent->se, ent->data, ent->data_len, /* flags = */ 0,
+                 /* username = */ NULL, &ent->sender, stats);
+
+    slab_free(receive_pool, ent);
+    ent = next;
+  }
+} /* }}} void receive_list_parse */
+
 static void *dispatch_thread(void __attribute__((unused)) * arg) /* {{{ */
 {
   while (42) {
     receive_list_entry_t *ent;
-    sockent_t *se;
 
     /* Lock and wait for more data to come in */
     pthread_mutex_lock(&receive_list_lock);
     while ((listen_loop == 0) && (receive_list_head == NULL))
       pthread_cond_wait(&receive_list_cond, &receive_list_lock);
 
-    /* Remove the head entry and unlock */
+    /* Take the entire list and unlock */
     ent = receive_list_head;
-    if (ent != NULL)
-      receive_list_head = ent->next;
-    receive_list_length--;
+    receive_list_head = NULL;
+    receive_list_tail = NULL;
+    receive_list_length = 0;
     pthread_mutex_unlock(&receive_list_lock);
 
     /* Check whether we are supposed to exit. We do NOT check `listen_loop'
@@ -2224,178 +2393,336 @@ static void *dispatch_thread(void __attribute__((unused)) * arg) /* {{{ */
     if (ent == NULL)
       break;
 
-    /* Look for the correct `sockent_t' */
-    se = listen_sockets;
-    while (se != NULL) {
-      size_t i;
+    receive_list_parse(ent, &stats_dispatch_thread);
+  } /* while (42) */
+
+  return NULL;
+} /* }}} void *dispatch_thread */
+
+/* Packets received by a receive thread, which have not been parsed or handed
+ * to the dispatch thread yet. */
+struct receive_batch_s {
+  receive_list_entry_t *head;
+  receive_list_entry_t *tail;
+  uint64_t length;
+};
+typedef struct receive_batch_s receive_batch_t;
+
+static void receive_batch_append(receive_worker_t *w, /* {{{ */
+                                 receive_batch_t *b,
+                                 receive_list_entry_t *ent) {
+  ent->next = NULL;
+  if (b->head == NULL)
+    b->head = ent;
+  else
+    b->tail->next = ent;
+  b->tail = ent;
+  b->length++;
+
+  w->octets_rx += ((uint64_t)ent->data_len);
+  w->packets_rx++;
+} /* }}} void receive_batch_append */
+
+/* Moves the received packets to the receive list or, if the thread parses
+ * its packets itself, parses them. Unless `block' is true, gives up if the
+ * lock of the receive list is not available immediately. */
+static void receive_batch_submit(receive_worker_t *w, /* {{{ */
+                                 receive_batch_t *b, bool block) {
+  if (b->head == NULL)
+    return;
+
+  if (w->parse) {
+    receive_list_parse(b->head, &w->parse_stats);
+  } else {
+    if (block)
+      pthread_mutex_lock(&receive_list_lock);
+    else if (pthread_mutex_trylock(&receive_list_lock) != 0)
+      return;
+
+    assert(((receive_list_head == NULL) && (receive_list_length == 0)) ||
+           ((receive_list_head != NULL) && (receive_list_length != 0)));
+
+    if (receive_list_head == NULL)
+      receive_list_head = b->head;
+    else
+      receive_list_tail->next = b->head;
+    receive_list_tail = b->tail;
+    receive_list_length += b->length;
+
+    pthread_cond_signal(&receive_list_cond);
+    pthread_mutex_unlock(&receive_list_lock);
+  }
+
+  b->head = NULL;
+  b->tail = NULL;
+  b->length = 0;
+} /* }}} void receive_batch_submit */
+
+#ifdef SO_RXQ_OVFL
+#define RECEIVE_CONTROL_SIZE CMSG_SPACE(sizeof(uint32_t))
+
+/* Adds the packets the kernel dropped on socket `i' of `w' to the drop
+ * counter. The SO_RXQ_OVFL message holds the total since the socket was
+ * opened. */
+static void receive_worker_update_drops(receive_worker_t *w, /* {{{ */
+                                        size_t i, struct msghdr *msg) {
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+       cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if ((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SO_RXQ_OVFL))
+      continue;
+
+    uint32_t drops;
+    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+    w->drops_rx += (derive_t)(uint32_t)(drops - w->drops_seen[i]);
+    w->drops_seen[i] = drops;
+  }
+} /* }}} void receive_worker_update_drops */
+#endif /* SO_RXQ_OVFL */
+
+/* Receives one packet from socket `i' of `w'. */
+static int network_receive_one(receive_worker_t *w, size_t i, /* {{{ */
+                               receive_batch_t *b) {
+  receive_list_entry_t *ent = slab_alloc(receive_pool);
+  if (ent == NULL) {
+    ERROR("network plugin: slab_alloc failed.");
+    return ENOMEM;
+  }
+
+  struct iovec iov = {
+      .iov_base = ent->data,
+      .iov_len = network_config_packet_size,
+  };
+  struct msghdr msg = {
+      .msg_name = &ent->sender,
+      .msg_namelen = sizeof(ent->sender),
+      .msg_iov = &iov,
+      .msg_iovlen = 1,
+  };
+#ifdef SO_RXQ_OVFL
+  char control[RECEIVE_CONTROL_SIZE];
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+#endif
 
-      for (i = 0; i < se->data.server.fd_num; i++)
-        if (se->data.server.fd[i] == ent->fd)
-          break;
+  memset(&ent->sender, 0, sizeof(ent->sender));
+  ssize_t status = recvmsg(w->pollfd[i].fd, &msg, 0 /* no flags */);
+  if (status < 0) {
+    int err = (errno != 0) ? errno : -1;
+    ERROR("network plugin: recv(2) failed: %s", STRERRNO);
+    slab_free(receive_pool, ent);
+    return err;
+  }
+
+#ifdef SO_RXQ_OVFL
+  receive_worker_update_drops(w, i, &msg);
+#endif
 
-      if (i < se->data.server.fd_num)
+  ent->se = w->se[i];
+  ent->data_len = (int)status;
+  receive_batch_append(w, b, ent);
+  return 0;
+} /* }}} int network_receive_one */
+
+#if HAVE_RECVMMSG
+/* Receives up to `receive_batch_size' packets from socket `i' of `w' with one
+ * system call and repeats as long as all slots are filled, i.e. more packets
+ * are likely queued. */
+static int network_receive_many(receive_worker_t *w, size_t i, /* {{{ */
+                                receive_batch_t *b) {
+  receive_list_entry_t *ents[NETWORK_RECEIVE_BATCH];
+  struct mmsghdr msgs[NETWORK_RECEIVE_BATCH];
+  struct iovec iovs[NETWORK_RECEIVE_BATCH];
+#ifdef SO_RXQ_OVFL
+  char control[NETWORK_RECEIVE_BATCH][RECEIVE_CONTROL_SIZE];
+#endif
+  size_t ents_num = 0;
+  int ret = 0;
+
+  /* Limit the number of rounds, so that other sockets are not starved. */
+  for (int round = 0; round < 16; round++) {
+    while (ents_num < receive_batch_size) {
+      ents[ents_num] = slab_alloc(receive_pool);
+      if (ents[ents_num] == NULL)
         break;
+      ents_num++;
+    }
+    if (ents_num == 0) {
+      ERROR("network plugin: slab_alloc failed.");
+      ret = ENOMEM;
+      break;
+    }
 
-      se = se->next;
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t j = 0; j < ents_num; j++) {
+      iovs[j] = (struct iovec){
+          .iov_base = ents[j]->data,
+          .iov_len = network_config_packet_size,
+      };
+      msgs[j].msg_hdr.msg_name = &ents[j]->sender;
+      msgs[j].msg_hdr.msg_namelen = sizeof(ents[j]->sender);
+      msgs[j].msg_hdr.msg_iov = &iovs[j];
+      msgs[j].msg_hdr.msg_iovlen = 1;
+#ifdef SO_RXQ_OVFL
+      msgs[j].msg_hdr.msg_control = control[j];
+      msgs[j].msg_hdr.msg_controllen = sizeof(control[j]);
+#endif
     }
 
-    if (se == NULL) {
-      ERROR("network plugin: Got packet from FD %i, but can't "
-            "find an appropriate socket entry.",
-            ent->fd);
-      sfree(ent->data);
-      sfree(ent);
-      continue;
+    int status = recvmmsg(w->pollfd[i].fd, msgs, (unsigned int)ents_num,
+                          MSG_DONTWAIT, /* timeout = */ NULL);
+    if (status < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+        ret = (errno != 0) ? errno : -1;
+        ERROR("network plugin: recvmmsg(2) failed: %s", STRERRNO);
+      }
+      break;
     }
 
-    parse_packet(se, ent->data, ent->data_len, /* flags = */ 0,
-                 /* username = */ NULL, &ent->sender);
-    sfree(ent->data);
-    sfree(ent);
-  } /* while (42) */
+    size_t received = (size_t)status;
+    for (size_t j = 0; j < received; j++) {
+      ents[j]->se = w->se[i];
+      ents[j]->data_len = (int)msgs[j].msg_len;
+      receive_batch_append(w, b, ents[j]);
+    }
+#ifdef SO_RXQ_OVFL
+    /* The counter is cumulative, so the last packet is sufficient. */
+    if (received > 0)
+      receive_worker_update_drops(w, i, &msgs[received - 1].msg_hdr);
+#endif
 
-  return NULL;
-} /* }}} void *dispatch_thread */
+    /* Keep the unused entries for the next round. */
+    memmove(ents, ents + received, (ents_num - received) * sizeof(*ents));
+    ents_num -= received;
 
-static int network_receive(void) /* {{{ */
-{
-  char buffer[network_config_packet_size];
-  int buffer_len;
+    /* Do not block here. Blocking here has led to
+     * insufficient performance in the past. */
+    receive_batch_submit(w, b, /* block = */ false);
 
-  int status = 0;
+    if (received < receive_batch_size)
+      break;
+  }
 
-  receive_list_entry_t *private_list_head;
-  receive_list_entry_t *private_list_tail;
-  uint64_t private_list_length;
+  for (size_t j = 0; j < ents_num; j++)
+    slab_free(receive_pool, ents[j]);
 
-  assert(listen_sockets_num > 0);
+  return ret;
+} /* }}} int network_receive_many */
+#endif /* HAVE_RECVMMSG */
 
-  private_list_head = NULL;
-  private_list_tail = NULL;
-  private_list_length = 0;
+static int network_receive(receive_worker_t *w) /* {{{ */
+{
+  receive_batch_t batch = {0};
+  int status = 0;
+
+  assert(w->num > 0);
 
   while (listen_loop == 0) {
-    status = poll(listen_sockets_pollfd, listen_sockets_num, -1);
-    if (status <= 0) {
+    int ready = poll(w->pollfd, w->num, -1);
+    if (ready <= 0) {
       if (errno == EINTR)
         continue;
       ERROR("network plugin: poll(2) failed: %s", STRERRNO);
+      status = -1;
       break;
     }
 
-    for (size_t i = 0; (i < listen_sockets_num) && (status > 0); i++) {
-      receive_list_entry_t *ent;
-
-      if ((listen_sockets_pollfd[i].revents & (POLLIN | POLLPRI)) == 0)
+    for (size_t i = 0; (i < w->num) && (ready > 0); i++) {
+      if ((w->pollfd[i].revents & (POLLIN | POLLPRI)) == 0)
         continue;
-      status--;
-
-      struct sockaddr_storage address;
-      socklen_t length = sizeof(address);
-      memset(&address, 0, length);
-      buffer_len =
-          recvfrom(listen_sockets_pollfd[i].fd, buffer, sizeof(buffer),
-                   0 /* no flags */, (struct sockaddr *)&address, &length);
-      if (buffer_len < 0) {
-        status = (errno != 0) ? errno : -1;
-        ERROR("network plugin: recv(2) failed: %s", STRERRNO);
-        break;
-      }
-
-      stats_octets_rx += ((uint64_t)buffer_len);
-      stats_packets_rx++;
-
-      /* TODO: Possible performance enhancement: Do not free
-       * these entries in the dispatch thread but put them in
-       * another list, so we don't have to allocate more and
-       * more of these structures. */
-      ent = calloc(1, sizeof(*ent));
-      if (ent == NULL) {
-        ERROR("network plugin: calloc failed.");
-        status = ENOMEM;
-        break;
-      }
+      ready--;
 
-      ent->data = malloc(network_config_packet_size);
-      if (ent->data == NULL) {
-        sfree(ent);
-        ERROR("network plugin: malloc failed.");
-        status = ENOMEM;
-        break;
-      }
-      ent->fd = listen_sockets_pollfd[i].fd;
-      ent->next = NULL;
-
-      memcpy(ent->data, buffer, buffer_len);
-      ent->data_len = buffer_len;
-      memcpy(&ent->sender, &address, sizeof(ent->sender));
-
-      if (private_list_head == NULL)
-        private_list_head = ent;
+#if HAVE_RECVMMSG
+      if (receive_batch_size > 1)
+        status = network_receive_many(w, i, &batch);
       else
-        private_list_tail->next = ent;
-      private_list_tail = ent;
-      private_list_length++;
+#endif
+        status = network_receive_one(w, i, &batch);
+      if (status != 0)
+        break;
 
       /* Do not block here. Blocking here has led to
        * insufficient performance in the past. */
-      if (pthread_mutex_trylock(&receive_list_lock) == 0) {
-        assert(((receive_list_head == NULL) && (receive_list_length == 0)) ||
-               ((receive_list_head != NULL) && (receive_list_length != 0)));
-
-        if (receive_list_head == NULL)
-          receive_list_head = private_list_head;
-        else
-          receive_list_tail->next = private_list_head;
-        receive_list_tail = private_list_tail;
-        receive_list_length += private_list_length;
-
-        pthread_cond_signal(&receive_list_cond);
-        pthread_mutex_unlock(&receive_list_lock);
-
-        private_list_head = NULL;
-        private_list_tail = NULL;
-        private_list_length = 0;
-      }
-
-      status = 0;
-    } /* for (listen_sockets_pollfd) */
+      receive_batch_submit(w, &batch, /* block = */ false);
+    } /* for (w->pollfd) */
 
     if (status != 0)
       break;
   } /* while (listen_loop == 0) */
 
   /* Make sure everything is dispatched before exiting. */
-  if (private_list_head != NULL) {
-    pthread_mutex_lock(&receive_list_lock);
-
-    if (receive_list_head == NULL)
-      receive_list_head = private_list_head;
-    else
-      receive_list_tail->next = private_list_head;
-    receive_list_tail = private_list_tail;
-    receive_list_length += private_list_length;
-
-    pthread_cond_signal(&receive_list_cond);
-    pthread_mutex_unlock(&receive_list_lock);
-  }
+  receive_batch_submit(w, &batch, /* block = */ true);
 
   return status;
 } /* }}} int network_receive */
 
-static void *receive_thread(void __attribute__((unused)) * arg) {
-  return network_receive() ? (void *)1 : (void *)0;
+static void *receive_thread(void *arg) {
+  return network_receive(arg) ? (void *)1 : (void *)0;
 } /* void *receive_thread */
 
-static void network_init_buffer(void) {
-  memset(send_buffer, 0, network_config_packet_size);
-  send_buffer_ptr = send_buffer;
-  send_buffer_fill = 0;
-  send_buffer_last_update = 0;
+static void receive_workers_destroy(void) /* {{{ */
+{
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    receive_worker_t *w = receive_workers + i;
+    sfree(w->pollfd);
+    sfree(w->se);
+    sfree(w->drops_seen);
+  }
+  sfree(receive_workers);
+  receive_workers_num = 0;
+} /* }}} void receive_workers_destroy */
+
+/* Distributes the listening sockets among `num' receive threads: socket `i'
+ * is polled by thread `i % num'. Since sockent_server_listen() opens the
+ * sockets of an address consecutively, each thread gets one of them. With
+ * more than one thread, the threads parse their packets themselves. */
+static int receive_workers_create(size_t num) /* {{{ */
+{
+  assert(receive_workers == NULL);
+
+  receive_workers = calloc(num, sizeof(*receive_workers));
+  if (receive_workers == NULL) {
+    ERROR("network plugin: calloc failed.");
+    return ENOMEM;
+  }
+  receive_workers_num = num;
 
-  memset(&send_buffer_vl, 0, sizeof(send_buffer_vl));
-} /* int network_init_buffer */
+  for (size_t i = 0; i < num; i++) {
+    receive_worker_t *w = receive_workers + i;
+    size_t max = (listen_sockets_num + num - 1) / num;
 
+    w->index = i;
+    w->parse = (num > 1);
+    w->pollfd = calloc(max, sizeof(*w->pollfd));
+    w->se = calloc(max, sizeof(*w->se));
+    w->drops_seen = calloc(max, sizeof(*w->drops_seen));
+    if ((w->pollfd == NULL) || (w->se == NULL) || (w->drops_seen == NULL)) {
+      ERROR("network plugin: calloc failed.");
+      receive_workers_destroy();
+      return ENOMEM;
+    }
+  }
+
+  for (size_t i = 0; i < listen_sockets_num; i++) {
+    receive_worker_t *w = receive_workers + (i % num);
+    w->pollfd[w->num] = listen_sockets_pollfd[i];
+    w->se[w->num] = listen_sockets_se[i];
+    w->num++;
+  }
+
+  return 0;
+} /* }}} int receive_workers_create */
+
+/* NOTE: You must hold buffer_lock of `client' when calling this function! */
+static void network_client_init_buffer(struct sockent_client *client) {
+  memset(client->buffer, 0, network_config_packet_size);
+  client->buffer_ptr = client->buffer;
+  client->buffer_fill = 0;
+  client->buffer_last_update = 0;
+
+  memset(&client->buffer_vl, 0, sizeof(client->buffer_vl));
+} /* void network_client_init_buffer */
+
+#if !HAVE_SENDMMSG
 static void network_send_buffer_plain(sockent_t *se, /* {{{ */
                                       const char *buffer, size_t buffer_size) {
   int status;
@@ -2421,6 +2748,57 @@ static void network_send_buffer_plain(sockent_t *se, /* {{{ */
     break;
   } /* while (42) */
 } /* }}} void network_send_buffer_plain */
+#endif /* !HAVE_SENDMMSG */
+
+/* Sends `buffers_num' packets to `se', using as few system calls as
+ * possible. */
+static void network_send_buffers_plain(sockent_t *se, /* {{{ */
+                                       char *const *buffers,
+                                       const size_t *buffers_size,
+                                       size_t buffers_num) {
+#if HAVE_SENDMMSG
+  struct mmsghdr msgs[NETWORK_SEND_BATCH];
+  struct iovec iovs[NETWORK_SEND_BATCH];
+  size_t sent = 0;
+
+  assert(buffers_num <= NETWORK_SEND_BATCH);
+
+  while (sent < buffers_num) {
+    if (sockent_client_connect(se) != 0)
+      return;
+
+    size_t num = buffers_num - sent;
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t i = 0; i < num; i++) {
+      iovs[i] = (struct iovec){
+          .iov_base = buffers[sent + i],
+          .iov_len = buffers_size[sent + i],
+      };
+      msgs[i].msg_hdr.msg_name = se->data.client.addr;
+      msgs[i].msg_hdr.msg_namelen = se->data.client.addrlen;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int status = sendmmsg(se->data.client.fd, msgs, (unsigned int)num,
+                          /* flags = */ 0);
+    if (status < 0) {
+      if ((errno == EINTR) || (errno == EAGAIN))
+        continue;
+
+      ERROR("network plugin: sendmmsg failed: %s. Closing sending socket.",
+            STRERRNO);
+      sockent_client_disconnect(se);
+      return;
+    }
+
+    sent += (size_t)status;
+  } /* while (sent < buffers_num) */
+#else
+  for (size_t i = 0; i < buffers_num; i++)
+    network_send_buffer_plain(se, buffers[i], buffers_size[i]);
+#endif
+} /* }}} void network_send_buffers_plain */
 
 #if HAVE_GCRYPT_H
 #define BUFFER_ADD(p, s)                                                       \
@@ -2429,10 +2807,12 @@ static void network_send_buffer_plain(sockent_t *se, /* {{{ */
     buffer_offset += (s);                                                      \
   } while (0)
 
-static void network_send_buffer_signed(sockent_t *se, /* {{{ */
-                                       const char *in_buffer,
-                                       size_t in_buffer_size) {
-  char buffer[BUFF_SIG_SIZE + in_buffer_size];
+/* Writes the signed packet to `buffer', which must have room for
+ * BUFF_SIG_SIZE + in_buffer_size bytes, and returns its size or zero on
+ * failure. */
+static size_t network_sign_buffer(sockent_t *se, /* {{{ */
+                                  const char *in_buffer, size_t in_buffer_size,
+                                  char *buffer) {
   size_t buffer_offset;
   size_t username_len;
 
@@ -2445,7 +2825,7 @@ static void network_send_buffer_signed(sockent_t *se, /* {{{ */
   if (err != 0) {
     ERROR("network plugin: Creating HMAC object failed: %s",
           gcry_strerror(err));
-    return;
+    return 0;
   }
 
   err = gcry_md_setkey(hd, se->data.client.password,
@@ -2453,13 +2833,13 @@ static void network_send_buffer_signed(sockent_t *se, /* {{{ */
   if (err != 0) {
     ERROR("network plugin: gcry_md_setkey failed: %s", gcry_strerror(err));
     gcry_md_close(hd);
-    return;
+    return 0;
   }
 
   username_len = strlen(se->data.client.username);
   if (username_len > (BUFF_SIG_SIZE - PART_SIGNATURE_SHA256_SIZE)) {
     ERROR("network plugin: Username too long: %s", se->data.client.username);
-    return;
+    return 0;
   }
 
   memcpy(buffer + PART_SIGNATURE_SHA256_SIZE, se->data.client.username,
@@ -2479,7 +2859,7 @@ static void network_send_buffer_signed(sockent_t *se, /* {{{ */
   if (hash == NULL) {
     ERROR("network plugin: gcry_md_read failed.");
     gcry_md_close(hd);
-    return;
+    return 0;
   }
   memcpy(ps.hash, hash, sizeof(ps.hash));
 
@@ -2495,14 +2875,15 @@ static void network_send_buffer_signed(sockent_t *se, /* {{{ */
   gcry_md_close(hd);
   hd = NULL;
 
-  buffer_offset = PART_SIGNATURE_SHA256_SIZE + username_len + in_buffer_size;
-  network_send_buffer_plain(se, buffer, buffer_offset);
-} /* }}} void network_send_buffer_signed */
+  return PART_SIGNATURE_SHA256_SIZE + username_len + in_buffer_size;
+} /* }}} size_t network_sign_buffer */
 
-static void network_send_buffer_encrypted(sockent_t *se, /* {{{ */
-                                          const char *in_buffer,
-                                          size_t in_buffer_size) {
-  char buffer[BUFF_SIG_SIZE + in_buffer_size];
+/* Writes the encrypted packet to `buffer', which must have room for
+ * BUFF_SIG_SIZE + in_buffer_size bytes, and returns its size or zero on
+ * failure. */
+static size_t network_encrypt_buffer(sockent_t *se, /* {{{ */
+                                     const char *in_buffer,
+                                     size_t in_buffer_size, char *buffer) {
   size_t buffer_size;
   size_t buffer_offset;
   size_t header_size;
@@ -2517,14 +2898,14 @@ static void network_send_buffer_encrypted(sockent_t *se, /* {{{ */
   username_len = strlen(pea.username);
   if ((PART_ENCRYPTION_AES256_SIZE + username_len) > BUFF_SIG_SIZE) {
     ERROR("network plugin: Username too long: %s", pea.username);
-    return;
+    return 0;
   }
 
   buffer_size = PART_ENCRYPTION_AES256_SIZE + username_len + in_buffer_size;
   header_size = PART_ENCRYPTION_AES256_SIZE + username_len - sizeof(pea.hash);
 
-  assert(buffer_size <= sizeof(buffer));
-  DEBUG("network plugin: network_send_buffer_encrypted: "
+  assert(buffer_size <= BUFF_SIG_SIZE + in_buffer_size);
+  DEBUG("network plugin: network_encrypt_buffer: "
         "buffer_size = %" PRIsz ";",
         buffer_size);
 
@@ -2540,7 +2921,7 @@ static void network_send_buffer_encrypted(sockent_t *se, /* {{{ */
 
   /* Initialize the buffer */
   buffer_offset = 0;
-  memset(buffer, 0, sizeof(buffer));
+  memset(buffer, 0, buffer_size);
 
   BUFFER_ADD(&pea.head.type, sizeof(pea.head.type));
   BUFFER_ADD(&pea.head.length, sizeof(pea.head.length));
@@ -2556,7 +2937,7 @@ static void network_send_buffer_encrypted(sockent_t *se, /* {{{ */
   cypher = network_get_aes256_cypher(se, pea.iv, sizeof(pea.iv),
                                      se->data.client.password);
   if (cypher == NULL)
-    return;
+    return 0;
 
   /* Encrypt the buffer in-place */
   err = gcry_cipher_encrypt(cypher, buffer + header_size,
@@ -2565,32 +2946,67 @@ static void network_send_buffer_encrypted(sockent_t *se, /* {{{ */
   if (err != 0) {
     ERROR("network plugin: gcry_cipher_encrypt returned: %s",
           gcry_strerror(err));
-    return;
+    return 0;
   }
 
-  /* Send it out without further modifications */
-  network_send_buffer_plain(se, buffer, buffer_size);
-} /* }}} void network_send_buffer_encrypted */
+  return buffer_size;
+} /* }}} size_t network_encrypt_buffer */
 #undef BUFFER_ADD
 #endif /* HAVE_GCRYPT_H */
 
+/* Sends `buffers_num' packets to `se'. If signing or encryption is used, the
+ * packets are written to `scratch', which must have room for `buffers_num'
+ * times `scratch_size' bytes.
+ * NOTE: You must hold the lock of `se' when calling this function! */
+static void network_send_buffers_nolock(sockent_t *se, /* {{{ */
+                                        char *const *buffers,
+                                        const size_t *buffers_size,
+                                        size_t buffers_num, char *scratch,
+                                        size_t scratch_size) {
+  assert(buffers_num <= NETWORK_SEND_BATCH);
+
+#if HAVE_GCRYPT_H
+  if ((se->data.client.security_level == SECURITY_LEVEL_ENCRYPT) ||
+      (se->data.client.security_level == SECURITY_LEVEL_SIGN)) {
+    char *out[NETWORK_SEND_BATCH];
+    size_t out_size[NETWORK_SEND_BATCH];
+    size_t out_num = 0;
+
+    for (size_t i = 0; i < buffers_num; i++) {
+      assert(buffers_size[i] + BUFF_SIG_SIZE <= scratch_size);
+      out[out_num] = scratch + i * scratch_size;
+      if (se->data.client.security_level == SECURITY_LEVEL_ENCRYPT)
+        out_size[out_num] = network_encrypt_buffer(
+            se, buffers[i], buffers_size[i], out[out_num]);
+      else
+        out_size[out_num] = network_sign_buffer(se, buffers[i],
+                                                buffers_size[i], out[out_num]);
+      if (out_size[out_num] != 0)
+        out_num++;
+    }
+
+    network_send_buffers_plain(se, out, out_size, out_num);
+    return;
+  }
+#endif /* HAVE_GCRYPT_H */
+
+  network_send_buffers_plain(se, buffers, buffers_size, buffers_num);
+} /* }}} void network_send_buffers_nolock */
+
+/* Sends one packet to all servers. */
 static void network_send_buffer(char *buffer, size_t buffer_len) /* {{{ */
 {
+  char scratch[BUFF_SIG_SIZE + buffer_len];
+
   DEBUG("network plugin: network_send_buffer: buffer_len = %" PRIsz,
         buffer_len);
 
   for (sockent_t *se = sending_sockets; se != NULL; se = se->next) {
     pthread_mutex_lock(&se->lock);
-#if HAVE_GCRYPT_H
-    if (se->data.client.security_level == SECURITY_LEVEL_ENCRYPT)
-      network_send_buffer_encrypted(se, buffer, buffer_len);
-    else if (se->data.client.security_level == SECURITY_LEVEL_SIGN)
-      network_send_buffer_signed(se, buffer, buffer_len);
-    else /* if (se->data.client.security_level == SECURITY_LEVEL_NONE) */
-#endif   /* HAVE_GCRYPT_H */
-      network_send_buffer_plain(se, buffer, buffer_len);
+    network_send_buffers_nolock(se, &buffer, &buffer_len, 1, scratch,
+                                sizeof(scratch));
     pthread_mutex_unlock(&se->lock);
-  } /* for (sending_sockets) */
+  }
 } /* }}} void network_send_buffer */
 
 static int add_to_buffer(char *buffer, size_t buffer_size, /* {{{ */
@@ -2656,27 +3072,144 @@ static int add_to_buffer(char *buffer, size_t buffer_size, /* {{{ */
   return buffer - buffer_orig;
 } /* }}} int add_to_buffer */
 
-static void flush_buffer(void) {
-  DEBUG("network plugin: flush_buffer: send_buffer_fill = %i",
-        send_buffer_fill);
+/* Allocates the send buffers of `se'. */
+static int network_client_init(sockent_t *se) /* {{{ */
+{
+  struct sockent_client *client = &se->data.client;
 
-  network_send_buffer(send_buffer, (size_t)send_buffer_fill);
+  client->buffer = malloc(network_config_packet_size);
+  client->batch = send_batch_create();
+  client->batch_spare = send_batch_create();
+  if ((client->buffer == NULL) || (client->batch == NULL) ||
+      (client->batch_spare == NULL)) {
+    ERROR("network plugin: malloc failed.");
+    return ENOMEM;
+  }
 
-  stats_octets_tx += ((uint64_t)send_buffer_fill);
-  stats_packets_tx++;
+#if HAVE_GCRYPT_H
+  if (client->security_level > SECURITY_LEVEL_NONE) {
+    client->scratch = malloc(NETWORK_SEND_BATCH * network_config_packet_size);
+    if (client->scratch == NULL) {
+      ERROR("network plugin: malloc failed.");
+      return ENOMEM;
+    }
+  }
+#endif
 
-  network_init_buffer();
-}
+  network_client_init_buffer(client);
+  return 0;
+} /* }}} int network_client_init */
+
+/* Takes the complete packets of `client' and replaces them with an empty
+ * batch. Returns NULL if there are no complete packets.
+ * NOTE: You must hold buffer_lock of `client' when calling this function! */
+static send_batch_t * /* {{{ */
+network_client_take_batch_nolock(struct sockent_client *client) {
+  send_batch_t *b = client->batch;
+  if (b->packets_num == 0)
+    return NULL;
 
-static int network_write(const data_set_t *ds, const value_list_t *vl,
-                         user_data_t __attribute__((unused)) * user_data) {
-  int status;
+  send_batch_t *empty = client->batch_spare;
+  client->batch_spare = NULL;
+  if (empty == NULL)
+    empty = send_batch_create();
+  if (empty == NULL) {
+    ERROR("network plugin: send_batch_create failed. Dropping %" PRIsz
+          " packets.",
+          b->packets_num);
+    b->packets_num = 0;
+    return NULL;
+  }
 
-  /* listen_loop is set to non-zero in the shutdown callback, which is
-   * guaranteed to be called *after* all the write threads have been shut
-   * down. */
-  assert(listen_loop == 0);
+  empty->packets_num = 0;
+  client->batch = empty;
+  return b;
+} /* }}} send_batch_t *network_client_take_batch_nolock */
 
+/* Completes the packet under construction. If this fills the batch of
+ * complete packets, the batch is taken (see
+ * network_client_take_batch_nolock()) and returned; otherwise returns NULL.
+ * NOTE: You must hold buffer_lock of `client' when calling this function! */
+static send_batch_t * /* {{{ */
+network_client_flush_nolock(struct sockent_client *client) {
+  send_batch_t *b = client->batch;
+
+  DEBUG("network plugin: network_client_flush_nolock: buffer_fill = %i",
+        client->buffer_fill);
+
+  memcpy(b->packets + b->packets_num * network_config_packet_size,
+         client->buffer, (size_t)client->buffer_fill);
+  b->packets_size[b->packets_num] = (size_t)client->buffer_fill;
+  b->packets_num++;
+
+  pthread_mutex_lock(&stats_lock);
+  stats_octets_tx += ((uint64_t)client->buffer_fill);
+  stats_packets_tx++;
+  pthread_mutex_unlock(&stats_lock);
+
+  network_client_init_buffer(client);
+
+  if (b->packets_num >= NETWORK_SEND_BATCH)
+    return network_client_take_batch_nolock(client);
+  return NULL;
+} /* }}} send_batch_t *network_client_flush_nolock */
+
+/* Signs or encrypts the packets of `b' as configured and sends them to `se'
+ * with as few system calls as possible. Afterwards, `b' becomes the spare
+ * batch of `se' or is freed.
+ * Must not be called while holding buffer_lock of `se'. */
+static void network_client_send(sockent_t *se, send_batch_t *b) /* {{{ */
+{
+  struct sockent_client *client = &se->data.client;
+  char *buffers[NETWORK_SEND_BATCH];
+
+  for (size_t i = 0; i < b->packets_num; i++)
+    buffers[i] = b->packets + i * network_config_packet_size;
+
+  pthread_mutex_lock(&se->lock);
+  network_send_buffers_nolock(se, buffers, b->packets_size, b->packets_num,
+                              client->scratch, network_config_packet_size);
+  pthread_mutex_unlock(&se->lock);
+
+  pthread_mutex_lock(&client->buffer_lock);
+  if (client->batch_spare == NULL) {
+    client->batch_spare = b;
+    b = NULL;
+  }
+  pthread_mutex_unlock(&client->buffer_lock);
+
+  send_batch_destroy(b);
+} /* }}} void network_client_send */
+
+/* Sends the complete packets of `se'. If `flush' is true, the packet under
+ * construction is completed first, unless it has been updated less than
+ * `timeout' ago. */
+static void network_client_send_pending(sockent_t *se, /* {{{ */
+                                        bool flush, cdtime_t timeout) {
+  struct sockent_client *client = &se->data.client;
+  send_batch_t *b = NULL;
+
+  pthread_mutex_lock(&client->buffer_lock);
+  if (flush && (client->buffer_fill > 0) &&
+      ((timeout == 0) ||
+       ((client->buffer_last_update + timeout) <= cdtime())))
+    b = network_client_flush_nolock(client);
+  if (b == NULL)
+    b = network_client_take_batch_nolock(client);
+  pthread_mutex_unlock(&client->buffer_lock);
+
+  if (b != NULL)
+    network_client_send(se, b);
+} /* }}} void network_client_send_pending */
+
+/* Number of value lists of a batch which are checked before the send buffers
+ * are locked. */
+#define NETWORK_WRITE_CHUNK 64
+
+/* Returns true if `vl' should be sent and updates the "time sent" in the
+ * cache. Must be called without holding any buffer_lock. */
+static bool network_write_prepare(const value_list_t *vl) /* {{{ */
+{
   if (!check_send_okay(vl)) {
 #if COLLECT_DEBUG
     char name[6 * DATA_MAX_NAME_LEN];
@@ -2691,51 +3224,138 @@ static int network_write(const data_set_t *ds, const value_list_t *vl,
     pthread_mutex_lock(&stats_lock);
     stats_values_not_sent++;
     pthread_mutex_unlock(&stats_lock);
-    return 0;
-  }
+    return false;
+  }
+
+  uc_set_time_sent(vl, vl->time);
+  return true;
+} /* }}} bool network_write_prepare */
+
+/* Adds `vl' to the packet under construction for `se'. If this fills a batch
+ * of packets, the batch is returned in `ret_batch' and must be passed to
+ * network_client_send().
+ * NOTE: You must hold buffer_lock of `se' when calling this function! */
+static int network_client_write_nolock(sockent_t *se, /* {{{ */
+                                       const data_set_t *ds,
+                                       const value_list_t *vl,
+                                       send_batch_t **ret_batch) {
+  struct sockent_client *client = &se->data.client;
+  send_batch_t *full = NULL;
+  int status;
 
-  uc_meta_data_add_unsigned_int(vl, "network:time_sent", (uint64_t)vl->time);
+  status = add_to_buffer(client->buffer_ptr,
+                         network_config_packet_size -
+                             (client->buffer_fill + BUFF_SIG_SIZE),
+                         &client->buffer_vl, ds, vl);
+  if (status < 0) {
+    full = network_client_flush_nolock(client);
 
-  pthread_mutex_lock(&send_buffer_lock);
+    status = add_to_buffer(client->buffer_ptr,
+                           network_config_packet_size -
+                               (client->buffer_fill + BUFF_SIG_SIZE),
+                           &client->buffer_vl, ds, vl);
+  }
 
-  status = add_to_buffer(send_buffer_ptr,
-                         network_config_packet_size -
-                             (send_buffer_fill + BUFF_SIG_SIZE),
-                         &send_buffer_vl, ds, vl);
-  if (status >= 0) {
+  if (status < 0) {
+    ERROR("network plugin: Unable to append to the "
+          "buffer for some weird reason");
+  } else {
     /* status == bytes added to the buffer */
-    send_buffer_fill += status;
-    send_buffer_ptr += status;
-    send_buffer_last_update = cdtime();
+    client->buffer_fill += status;
+    client->buffer_ptr += status;
+    client->buffer_last_update = cdtime();
+
+    /* Only one batch can fill up here: flushing above replaced it with an
+     * empty one. */
+    if ((network_config_packet_size - client->buffer_fill) < 15) {
+      send_batch_t *tmp = network_client_flush_nolock(client);
+      if (tmp != NULL)
+        full = tmp;
+    }
+  }
 
-    stats_values_sent++;
-  } else {
-    flush_buffer();
+  *ret_batch = full;
+  return (status < 0) ? -1 : 0;
+} /* }}} int network_client_write_nolock */
+
+/* Adds the value lists of `entries' for which `send' is true to the packets
+ * for `se'. Full batches are sent right away, without holding buffer_lock. */
+static int network_client_write(sockent_t *se, /* {{{ */
+                                const write_batch_entry_t *entries,
+                                const bool *send, size_t entries_num) {
+  struct sockent_client *client = &se->data.client;
+  int status = 0;
 
-    status = add_to_buffer(send_buffer_ptr,
-                           network_config_packet_size -
-                               (send_buffer_fill + BUFF_SIG_SIZE),
-                           &send_buffer_vl, ds, vl);
+  pthread_mutex_lock(&client->buffer_lock);
+  for (size_t i = 0; i < entries_num; i++) {
+    send_batch_t *full = NULL;
 
-    if (status >= 0) {
-      send_buffer_fill += status;
-      send_buffer_ptr += status;
+    if (!send[i])
+      continue;
 
-      stats_values_sent++;
+    if (network_client_write_nolock(se, entries[i].ds, entries[i].vl,
+                                    &full) != 0)
+      status = -1;
+
+    if (full != NULL) {
+      pthread_mutex_unlock(&client->buffer_lock);
+      network_client_send(se, full);
+      pthread_mutex_lock(&client->buffer_lock);
     }
   }
+  pthread_mutex_unlock(&client->buffer_lock);
 
-  if (status < 0) {
-    ERROR("network plugin: Unable to append to the "
-          "buffer for some weird reason");
-  } else if ((network_config_packet_size - send_buffer_fill) < 15) {
-    flush_buffer();
+  return status;
+} /* }}} int network_client_write */
+
+static int network_write_batch(const write_batch_entry_t *entries, /* {{{ */
+                               size_t entries_num,
+                               user_data_t __attribute__((unused)) *
+                                   user_data) {
+  int status = 0;
+
+  /* listen_loop is set to non-zero in the shutdown callback, which is
+   * guaranteed to be called *after* all the write threads have been shut
+   * down. */
+  assert(listen_loop == 0);
+
+  /* The cache lookups in network_write_prepare() are done before any buffer
+   * is locked. Each server has its own buffer, so write threads only contend
+   * while adding to the same server's buffer, not while signing, encrypting
+   * or sending packets. */
+  for (size_t offset = 0; offset < entries_num; offset += NETWORK_WRITE_CHUNK) {
+    bool send[NETWORK_WRITE_CHUNK];
+    size_t chunk_num = entries_num - offset;
+    size_t send_num = 0;
+
+    if (chunk_num > NETWORK_WRITE_CHUNK)
+      chunk_num = NETWORK_WRITE_CHUNK;
+
+    for (size_t i = 0; i < chunk_num; i++) {
+      send[i] = network_write_prepare(entries[offset + i].vl);
+      if (send[i])
+        send_num++;
+    }
+
+    if (send_num == 0)
+      continue;
+
+    for (sockent_t *se = sending_sockets; se != NULL; se = se->next)
+      if (network_client_write(se, entries + offset, send, chunk_num) != 0)
+        status = -1;
+
+    pthread_mutex_lock(&stats_lock);
+    stats_values_sent += (derive_t)send_num;
+    pthread_mutex_unlock(&stats_lock);
   }
 
-  pthread_mutex_unlock(&send_buffer_lock);
+  /* Send the packets completed during this batch with as few system calls as
+   * possible. */
+  for (sockent_t *se = sending_sockets; se != NULL; se = se->next)
+    network_client_send_pending(se, /* flush = */ false, /* timeout = */ 0);
 
-  return (status < 0) ? -1 : 0;
-} /* int network_write */
+  return status;
+} /* }}} int network_write_batch */
 
 static int network_config_set_ttl(const oconfig_item_t *ci) /* {{{ */
 {
@@ -2833,6 +3453,29 @@ static int network_config_set_buffer_size(const oconfig_item_t *ci) /* {{{ */
   return 0;
 } /* }}} int network_config_set_buffer_size */
 
+static int network_config_set_receive_threads( /* {{{ */
+    const oconfig_item_t *ci) {
+  int tmp = 0;
+
+  if (cf_util_get_int(ci, &tmp) != 0)
+    return -1;
+  else if ((tmp < 1) || (tmp > 64)) {
+    WARNING("network plugin: The `ReceiveThreads' must be between 1 and 64.");
+    return -1;
+  }
+
+#ifndef SO_REUSEPORT
+  if (tmp > 1) {
+    WARNING("network plugin: `ReceiveThreads' requires SO_REUSEPORT, which is "
+            "not available on this system. Using one receive thread.");
+    tmp = 1;
+  }
+#endif
+
+  network_config_receive_threads = (size_t)tmp;
+  return 0;
+} /* }}} int network_config_set_receive_threads */
+
 #if HAVE_GCRYPT_H
 static int network_config_set_security_level(oconfig_item_t *ci, /* {{{ */
                                              int *retval) {
@@ -3024,6 +3667,8 @@ static int network_config(oconfig_item_t *ci) /* {{{ */
     oconfig_item_t *child = ci->children + i;
     if (strcasecmp("TimeToLive", child->key) == 0)
       network_config_set_ttl(child);
+    else if (strcasecmp("ReceiveThreads", child->key) == 0)
+      network_config_set_receive_threads(child);
   }
 
   for (int i = 0; i < ci->children_num; i++) {
@@ -3033,7 +3678,8 @@ static int network_config(oconfig_item_t *ci) /* {{{ */
       network_config_add_listen(child);
     else if (strcasecmp("Server", child->key) == 0)
       network_config_add_server(child);
-    else if (strcasecmp("TimeToLive", child->key) == 0) {
+    else if ((strcasecmp("TimeToLive", child->key) == 0) ||
+             (strcasecmp("ReceiveThreads", child->key) == 0)) {
       /* Handled earlier */
     } else if (strcasecmp("MaxPacketSize", child->key) == 0)
       network_config_set_buffer_size(child);
@@ -3120,13 +3766,15 @@ static int network_notification(const notification_t *n,
 static int network_shutdown(void) {
   listen_loop++;
 
-  /* Kill the listening thread */
-  if (receive_thread_running != 0) {
-    INFO("network plugin: Stopping receive thread.");
-    pthread_kill(receive_thread_id, SIGTERM);
-    pthread_join(receive_thread_id, NULL /* no return value */);
-    memset(&receive_thread_id, 0, sizeof(receive_thread_id));
-    receive_thread_running = 0;
+  /* Kill the listening threads */
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    receive_worker_t *w = receive_workers + i;
+    if (!w->running)
+      continue;
+    INFO("network plugin: Stopping receive thread %" PRIsz ".", i);
+    pthread_kill(w->thread_id, SIGTERM);
+    pthread_join(w->thread_id, NULL /* no return value */);
+    w->running = false;
   }
 
   /* Shutdown the dispatching thread */
@@ -3139,15 +3787,18 @@ static int network_shutdown(void) {
     dispatch_thread_running = 0;
   }
 
+  receive_workers_destroy();
+  sfree(listen_sockets_pollfd);
+  sfree(listen_sockets_se);
+  listen_sockets_num = 0;
   sockent_destroy(listen_sockets);
+  slab_destroy(receive_pool);
+  receive_pool = NULL;
 
-  if (send_buffer_fill > 0)
-    flush_buffer();
-
-  sfree(send_buffer);
-
-  for (sockent_t *se = sending_sockets; se != NULL; se = se->next)
+  for (sockent_t *se = sending_sockets; se != NULL; se = se->next) {
+    network_client_send_pending(se, /* flush = */ true, /* timeout = */ 0);
     sockent_client_disconnect(se);
+  }
   sockent_destroy(sending_sockets);
 
   plugin_unregister_config("network");
@@ -3160,9 +3811,9 @@ static int network_shutdown(void) {
 
 static int network_stats_read(void) /* {{{ */
 {
-  derive_t copy_octets_rx;
+  derive_t copy_octets_rx = 0;
   derive_t copy_octets_tx;
-  derive_t copy_packets_rx;
+  derive_t copy_packets_rx = 0;
   derive_t copy_packets_tx;
   derive_t copy_values_dispatched;
   derive_t copy_values_not_dispatched;
@@ -3172,12 +3823,19 @@ static int network_stats_read(void) /* {{{ */
   value_list_t vl = VALUE_LIST_INIT;
   value_t values[2];
 
-  copy_octets_rx = stats_octets_rx;
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    copy_octets_rx += receive_workers[i].octets_rx;
+    copy_packets_rx += receive_workers[i].packets_rx;
+  }
   copy_octets_tx = stats_octets_tx;
-  copy_packets_rx = stats_packets_rx;
   copy_packets_tx = stats_packets_tx;
-  copy_values_dispatched = stats_values_dispatched;
-  copy_values_not_dispatched = stats_values_not_dispatched;
+  copy_values_dispatched = stats_dispatch_thread.values_dispatched;
+  copy_values_not_dispatched = stats_dispatch_thread.values_not_dispatched;
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    copy_values_dispatched += receive_workers[i].parse_stats.values_dispatched;
+    copy_values_not_dispatched +=
+        receive_workers[i].parse_stats.values_not_dispatched;
+  }
   copy_values_sent = stats_values_sent;
   copy_values_not_sent = stats_values_not_sent;
   copy_receive_list_length = receive_list_length;
@@ -3226,6 +3884,21 @@ static int network_stats_read(void) /* {{{ */
   vl.type_instance[0] = 0;
   plugin_dispatch_values(&vl);
 
+  /* Packets received and dropped by the kernel, per receive thread */
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    receive_worker_t *w = receive_workers + i;
+    ssnprintf(vl.plugin_instance, sizeof(vl.plugin_instance),
+              "worker-%" PRIsz, w->index);
+
+    vl.values[0].derive = w->packets_rx;
+    sstrncpy(vl.type, "if_rx_packets", sizeof(vl.type));
+    plugin_dispatch_values(&vl);
+
+    vl.values[0].derive = w->drops_rx;
+    sstrncpy(vl.type, "if_rx_dropped", sizeof(vl.type));
+    plugin_dispatch_values(&vl);
+  }
+
   return 0;
 } /* }}} int network_stats_read */
 
@@ -3243,27 +3916,35 @@ static int network_init(void) {
 
   plugin_register_shutdown("network", network_shutdown);
 
-  send_buffer = malloc(network_config_packet_size);
-  if (send_buffer == NULL) {
-    ERROR("network plugin: malloc failed.");
-    return -1;
-  }
-  network_init_buffer();
+  for (sockent_t *se = sending_sockets; se != NULL; se = se->next)
+    if (network_client_init(se) != 0)
+      return -1;
 
   /* setup socket(s) and so on */
   if (sending_sockets != NULL) {
-    plugin_register_write("network", network_write,
-                          /* user_data = */ NULL);
+    plugin_register_write_batch("network", network_write_batch,
+                                /* user_data = */ NULL);
     plugin_register_notification("network", network_notification,
                                  /* user_data = */ NULL);
   }
 
   /* If no threads need to be started, return here. */
-  if ((listen_sockets_num == 0) ||
-      ((dispatch_thread_running != 0) && (receive_thread_running != 0)))
+  if (listen_sockets_num == 0)
     return 0;
 
-  if (dispatch_thread_running == 0) {
+  receive_pool =
+      slab_create(sizeof(receive_list_entry_t) + network_config_packet_size,
+                  /* cache_max = */ 2 * NETWORK_RECEIVE_BATCH);
+  if (receive_pool == NULL) {
+    ERROR("network plugin: slab_create failed.");
+    return -1;
+  }
+
+  if (receive_workers_create(network_config_receive_threads) != 0)
+    return -1;
+
+  /* A single receive thread leaves the parsing to the dispatch thread. */
+  if (!receive_workers[0].parse) {
     int status;
     status = plugin_thread_create(&dispatch_thread_id, dispatch_thread,
                                   NULL /* no argument */, "network disp");
@@ -3274,14 +3955,24 @@ static int network_init(void) {
     }
   }
 
-  if (receive_thread_running == 0) {
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    receive_worker_t *w = receive_workers + i;
+    char name[16];
     int status;
-    status = plugin_thread_create(&receive_thread_id, receive_thread,
-                                  NULL /* no argument */, "network recv");
+
+    if (w->num == 0)
+      continue;
+
+    if (receive_workers_num > 1)
+      ssnprintf(name, sizeof(name), "network recv%" PRIsz, i);
+    else
+      sstrncpy(name, "network recv", sizeof(name));
+
+    status = plugin_thread_create(&w->thread_id, receive_thread, w, name);
     if (status != 0) {
       ERROR("network: pthread_create failed: %s", STRERRNO);
     } else {
-      receive_thread_running = 1;
+      w->running = true;
     }
   }
 
@@ -3298,19 +3989,8 @@ static int network_init(void) {
 static int network_flush(cdtime_t timeout,
                          __attribute__((unused)) const char *identifier,
                          __attribute__((unused)) user_data_t *user_data) {
-  pthread_mutex_lock(&send_buffer_lock);
-
-  if (send_buffer_fill > 0) {
-    if (timeout > 0) {
-      cdtime_t now = cdtime();
-      if ((send_buffer_last_update + timeout) > now) {
-        pthread_mutex_unlock(&send_buffer_lock);
-        return 0;
-      }
-    }
-    flush_buffer();
-  }
-  pthread_mutex_unlock(&send_buffer_lock);
+  for (sockent_t *se = sending_sockets; se != NULL; se = se->next)
+    network_client_send_pending(se, /* flush = */ true, timeout);
 
   return 0;
 } /* int network_flush */
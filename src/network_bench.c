@@ -0,0 +1,402 @@
+/**
+ * collectd - src/network_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures how many packets per second the network plugin receives and parses
+ * over the loopback interface. Sender threads send packets of 20 value lists
+ * each. The first two runs use one receive thread, which hands the packets to
+ * the dispatch thread for parsing: once with one packet per system call and
+ * once with recvmmsg(2) and sendmmsg(2) batching, if available. The third run
+ * uses several receive threads with one SO_REUSEPORT socket and one sender
+ * each, which parse the packets themselves.
+ *
+ * Afterwards, the write path of a forwarding proxy is measured: how many
+ * received value lists per second network_write_batch() sends on, and how
+ * many check_receive_okay() can check for having been sent before.
+ *
+ * "received/s" counts packets read from the sockets, "parsed/s" packets which
+ * have been parsed. If parsing is slower than receiving, the difference
+ * queues up in the receive list.
+ *
+ * Usage: bench_plugin_network [seconds per run] [receive threads] */
+
+#include "network.c" /* (sic) */
+
+#define BENCH_VALUES_PER_PACKET 20
+#define BENCH_SERIES 1000
+
+typedef struct {
+  sockent_t *se;
+  char *packet;
+  size_t packet_size;
+  size_t batch_size;
+  bool stop;
+} bench_sender_t;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+static void *sender(void *arg) {
+  bench_sender_t *s = arg;
+  char *buffers[NETWORK_SEND_BATCH];
+  size_t buffers_size[NETWORK_SEND_BATCH];
+
+  for (size_t i = 0; i < NETWORK_SEND_BATCH; i++) {
+    buffers[i] = s->packet;
+    buffers_size[i] = s->packet_size;
+  }
+
+  while (!s->stop)
+    network_send_buffers_plain(s->se, buffers, buffers_size, s->batch_size);
+
+  return NULL;
+}
+
+/* Builds a packet like the ones the network plugin sends. */
+static size_t build_packet(char *buffer, size_t buffer_size) {
+  data_source_t dsrc[] = {
+      {"rx", DS_TYPE_DERIVE, 0, NAN},
+      {"tx", DS_TYPE_DERIVE, 0, NAN},
+  };
+  data_set_t ds = {"if_octets", STATIC_ARRAY_SIZE(dsrc), dsrc};
+  value_list_t vl_def = VALUE_LIST_INIT;
+  value_t values[] = {{.derive = 1}, {.derive = 2}};
+  size_t size = 0;
+
+  memset(buffer, 0, buffer_size);
+  for (int i = 0; i < BENCH_VALUES_PER_PACKET; i++) {
+    value_list_t vl = {
+        .values = values,
+        .values_len = STATIC_ARRAY_SIZE(values),
+        .time = TIME_T_TO_CDTIME_T(1700000000),
+        .interval = TIME_T_TO_CDTIME_T(10),
+        .host = "bench.example.com",
+        .plugin = "interface",
+        .type = "if_octets",
+    };
+    snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "eth%i", i);
+
+    int status =
+        add_to_buffer(buffer + size, buffer_size - size, &vl_def, &ds, &vl);
+    assert(status > 0);
+    size += (size_t)status;
+  }
+
+  return size;
+}
+
+static derive_t packets_received(void) {
+  derive_t sum = 0;
+  for (size_t i = 0; i < receive_workers_num; i++)
+    sum += receive_workers[i].packets_rx;
+  return sum;
+}
+
+static derive_t values_parsed(void) {
+  derive_t sum = stats_dispatch_thread.values_dispatched +
+                 stats_dispatch_thread.values_not_dispatched;
+  for (size_t i = 0; i < receive_workers_num; i++)
+    sum += receive_workers[i].parse_stats.values_dispatched +
+           receive_workers[i].parse_stats.values_not_dispatched;
+  return sum;
+}
+
+static int run(double seconds, size_t batch_size, size_t threads) {
+  struct sockaddr_in addr = {
+      .sin_family = AF_INET,
+      .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  socklen_t addrlen = sizeof(addr);
+  int server_fds[threads];
+  int client_fds[threads];
+
+  /* The first bind picks a port, the others share it. */
+  for (size_t i = 0; i < threads; i++) {
+    server_fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    client_fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((server_fds[i] < 0) || (client_fds[i] < 0)) {
+      fprintf(stderr, "socket: %s\n", STRERRNO);
+      return -1;
+    }
+
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(server_fds[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+#ifdef SO_REUSEPORT
+    if (threads > 1)
+      setsockopt(server_fds[i], SOL_SOCKET, SO_REUSEPORT, &(int){1},
+                 sizeof(int));
+#endif
+
+    if ((bind(server_fds[i], (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (getsockname(server_fds[i], (struct sockaddr *)&addr, &addrlen) !=
+         0)) {
+      fprintf(stderr, "bind: %s\n", STRERRNO);
+      return -1;
+    }
+  }
+
+  sockent_t *server = sockent_create(SOCKENT_TYPE_SERVER);
+  server->data.server.fd = server_fds;
+  server->data.server.fd_num = threads;
+
+  struct pollfd pfds[threads];
+  sockent_t *ses[threads];
+  for (size_t i = 0; i < threads; i++) {
+    pfds[i] = (struct pollfd){.fd = server_fds[i], .events = POLLIN | POLLPRI};
+    ses[i] = server;
+  }
+  listen_sockets = server;
+  listen_sockets_pollfd = pfds;
+  listen_sockets_se = ses;
+  listen_sockets_num = threads;
+  listen_loop = 0;
+  receive_batch_size = batch_size;
+  receive_pool =
+      slab_create(sizeof(receive_list_entry_t) + network_config_packet_size,
+                  2 * NETWORK_RECEIVE_BATCH);
+  if (receive_workers_create(threads) != 0)
+    return -1;
+
+  char packet[network_config_packet_size];
+  size_t packet_size = build_packet(packet, sizeof(packet));
+  bench_sender_t senders[threads];
+  for (size_t i = 0; i < threads; i++) {
+    sockent_t *client = sockent_create(SOCKENT_TYPE_CLIENT);
+    client->data.client.fd = client_fds[i];
+    client->data.client.addr = (struct sockaddr_storage *)&addr;
+    client->data.client.addrlen = addrlen;
+    senders[i] = (bench_sender_t){
+        .se = client,
+        .packet = packet,
+        .packet_size = packet_size,
+        .batch_size = (batch_size > 1) ? NETWORK_SEND_BATCH : 1,
+    };
+  }
+
+  pthread_t dispatch_tid, sender_tids[threads];
+  if (!receive_workers[0].parse)
+    pthread_create(&dispatch_tid, NULL, dispatch_thread, NULL);
+  for (size_t i = 0; i < threads; i++)
+    pthread_create(&receive_workers[i].thread_id, NULL, receive_thread,
+                   receive_workers + i);
+  for (size_t i = 0; i < threads; i++)
+    pthread_create(&sender_tids[i], NULL, sender, senders + i);
+
+  /* Warm up, then measure. */
+  struct timespec ts = {.tv_nsec = 200000000};
+  nanosleep(&ts, NULL);
+
+  derive_t packets_start = packets_received();
+  derive_t values_start = values_parsed();
+  double start = now_seconds();
+
+  ts = (struct timespec){.tv_sec = (time_t)seconds,
+                         .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9)};
+  nanosleep(&ts, NULL);
+
+  derive_t packets = packets_received() - packets_start;
+  derive_t values = values_parsed() - values_start;
+  double elapsed = now_seconds() - start;
+
+  for (size_t i = 0; i < threads; i++)
+    senders[i].stop = true;
+  for (size_t i = 0; i < threads; i++)
+    pthread_join(sender_tids[i], NULL);
+
+  listen_loop++;
+  for (size_t i = 0; i < threads; i++) {
+    pthread_kill(receive_workers[i].thread_id, SIGTERM);
+    pthread_join(receive_workers[i].thread_id, NULL);
+  }
+  if (!receive_workers[0].parse) {
+    pthread_mutex_lock(&receive_list_lock);
+    pthread_cond_broadcast(&receive_list_cond);
+    pthread_mutex_unlock(&receive_list_lock);
+    pthread_join(dispatch_tid, NULL);
+  }
+
+  char mode[32];
+  if (threads > 1)
+    snprintf(mode, sizeof(mode), "%zu threads", threads);
+  else
+    snprintf(mode, sizeof(mode), "%s", (batch_size > 1) ? "batched" : "single");
+  printf("%-12s %12.0f %12.0f %12.0f\n", mode, (double)packets / elapsed,
+         (double)values / (elapsed * BENCH_VALUES_PER_PACKET),
+         (double)values / elapsed);
+
+  receive_workers_destroy();
+  slab_destroy(receive_pool);
+  receive_pool = NULL;
+  listen_sockets = NULL;
+  listen_sockets_pollfd = NULL;
+  listen_sockets_se = NULL;
+  listen_sockets_num = 0;
+  server->data.server.fd = NULL;
+  server->data.server.fd_num = 0;
+  sockent_destroy(server);
+  for (size_t i = 0; i < threads; i++) {
+    senders[i].se->data.client.addr = NULL;
+    senders[i].se->data.client.fd = -1;
+    sockent_destroy(senders[i].se);
+    close(server_fds[i]);
+    close(client_fds[i]);
+  }
+
+  return 0;
+}
+
+/* Measures network_write_batch() and check_receive_okay() on a forwarding
+ * proxy: all value lists carry the "network:received" meta data and are sent
+ * on because "Forward" is enabled. The packets are sent to a socket nobody
+ * reads from. */
+static int run_forward(double seconds) {
+  struct sockaddr_in addr = {
+      .sin_family = AF_INET,
+      .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  socklen_t addrlen = sizeof(addr);
+
+  int server_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  int client_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if ((server_fd < 0) || (client_fd < 0) ||
+      (bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+      (getsockname(server_fd, (struct sockaddr *)&addr, &addrlen) != 0)) {
+    fprintf(stderr, "socket: %s\n", STRERRNO);
+    return -1;
+  }
+
+  sockent_t *client = sockent_create(SOCKENT_TYPE_CLIENT);
+  client->data.client.fd = client_fd;
+  client->data.client.addr = (struct sockaddr_storage *)&addr;
+  client->data.client.addrlen = addrlen;
+  sending_sockets = client;
+  network_config_forward = true;
+  listen_loop = 0;
+  if (network_init() != 0)
+    return -1;
+
+  data_source_t dsrc[] = {
+      {"rx", DS_TYPE_DERIVE, 0, NAN},
+      {"tx", DS_TYPE_DERIVE, 0, NAN},
+  };
+  data_set_t ds = {"if_octets", STATIC_ARRAY_SIZE(dsrc), dsrc};
+  value_t values[] = {{.derive = 1}, {.derive = 2}};
+  meta_data_t *meta = meta_data_create();
+  meta_data_add_boolean(meta, "network:received", true);
+
+  value_list_t vls[BENCH_SERIES];
+  write_batch_entry_t entries[BENCH_SERIES];
+  for (size_t i = 0; i < BENCH_SERIES; i++) {
+    vls[i] = (value_list_t){
+        .values = values,
+        .values_len = STATIC_ARRAY_SIZE(values),
+        .time = TIME_T_TO_CDTIME_T(1700000000),
+        .interval = TIME_T_TO_CDTIME_T(10),
+        .host = "bench.example.com",
+        .plugin = "interface",
+        .type = "if_octets",
+        .meta = meta,
+    };
+    snprintf(vls[i].plugin_instance, sizeof(vls[i].plugin_instance), "eth%zu",
+             i);
+    uc_update(&ds, vls + i);
+    entries[i] = (write_batch_entry_t){.ds = &ds, .vl = vls + i};
+  }
+
+  double written = 0, checked = 0;
+  double start = now_seconds();
+  double write_end = start + seconds / 2;
+  while (now_seconds() < write_end) {
+    for (size_t i = 0; i < BENCH_SERIES; i++)
+      vls[i].time += vls[i].interval;
+    network_write_batch(entries, BENCH_SERIES, /* user_data = */ NULL);
+    written += BENCH_SERIES;
+  }
+  double write_elapsed = now_seconds() - start;
+
+  start = now_seconds();
+  double check_end = start + seconds / 2;
+  bool okay = true;
+  while (now_seconds() < check_end) {
+    for (size_t i = 0; i < BENCH_SERIES; i++)
+      okay &= !check_receive_okay(vls + i);
+    checked += BENCH_SERIES;
+  }
+  double check_elapsed = now_seconds() - start;
+  if (!okay) {
+    fprintf(stderr, "check_receive_okay accepted a value that was sent.\n");
+    return -1;
+  }
+
+  printf("%-12s %12.0f\n", "write", written / write_elapsed);
+  printf("%-12s %12.0f\n", "check", checked / check_elapsed);
+
+  meta_data_destroy(meta);
+  sending_sockets = NULL;
+  client->data.client.addr = NULL;
+  client->data.client.fd = -1;
+  sockent_destroy(client);
+  close(server_fd);
+  close(client_fd);
+  return 0;
+}
+
+static void sigterm_handler(__attribute__((unused)) int signal) { /* nop */
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+  size_t threads = (argc > 2) ? (size_t)atoi(argv[2]) : 2;
+
+  /* The receive thread is interrupted with SIGTERM, like in the daemon. */
+  struct sigaction sa = {.sa_handler = sigterm_handler};
+  sigaction(SIGTERM, &sa, NULL);
+
+  if (uc_init() != 0)
+    return 1;
+
+#if !HAVE_RECVMMSG
+  printf("recvmmsg(2) is not available, both runs use recvfrom(2).\n");
+#endif
+  printf("%-12s %12s %12s %12s\n", "mode", "received/s", "parsed/s",
+         "values/s");
+  if (run(seconds, 1, 1) != 0)
+    return 1;
+  if (run(seconds, NETWORK_RECEIVE_BATCH, 1) != 0)
+    return 1;
+#ifdef SO_REUSEPORT
+  if ((threads > 1) && (run(seconds, NETWORK_RECEIVE_BATCH, threads) != 0))
+    return 1;
+#endif
+
+  printf("\n%-12s %12s\n", "forwarding", "values/s");
+  if (run_forward(seconds) != 0)
+    return 1;
+
+  return 0;
+}
@@ -225,6 +225,7 @@ static int decode_string(char const *in, uint8_t *out, size_t *out_size) {
 
 DEF_TEST(parse_packet) {
   sockent_t se = {0};
+  parse_stats_t stats = {0};
 
   for (size_t i = 0; i < sizeof(raw_packet_data) / sizeof(raw_packet_data[0]);
        i++) {
@@ -232,15 +233,59 @@ DEF_TEST(parse_packet) {
     size_t buffer_size = sizeof(buffer);
 
     EXPECT_EQ_INT(0, decode_string(raw_packet_data[i], buffer, &buffer_size));
-    EXPECT_EQ_INT(0, parse_packet(&se, buffer, buffer_size, 0, NULL, NULL));
+    EXPECT_EQ_INT(
+        0, parse_packet(&se, buffer, buffer_size, 0, NULL, NULL, &stats));
   }
-  EXPECT_EQ_INT(139, (int)stats_values_dispatched);
+  EXPECT_EQ_INT(139, (int)stats.values_dispatched);
 
   return 0;
 }
 
+DEF_TEST(receive_workers_create) {
+  /* Two addresses opened once per thread and one multicast address. */
+  sockent_t a = {0}, b = {0}, m = {0};
+  sockent_t *ses[] = {&a, &a, &a, &m, &b, &b, &b};
+  struct pollfd pfds[STATIC_ARRAY_SIZE(ses)] = {{0}};
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(pfds); i++)
+    pfds[i].fd = (int)i;
+
+  listen_sockets_pollfd = pfds;
+  listen_sockets_se = ses;
+  listen_sockets_num = STATIC_ARRAY_SIZE(ses);
+
+  EXPECT_EQ_INT(0, receive_workers_create(3));
+  EXPECT_EQ_INT(3, (int)receive_workers_num);
+  /* Each thread gets one socket of each unicast address. */
+  for (size_t i = 0; i < receive_workers_num; i++) {
+    receive_worker_t *w = receive_workers + i;
+    size_t num_a = 0, num_b = 0;
+
+    EXPECT_EQ_INT(1, w->parse);
+    for (size_t j = 0; j < w->num; j++) {
+      EXPECT_EQ_PTR(ses[w->pollfd[j].fd], w->se[j]);
+      num_a += (w->se[j] == &a);
+      num_b += (w->se[j] == &b);
+    }
+    EXPECT_EQ_INT(1, (int)num_a);
+    EXPECT_EQ_INT(1, (int)num_b);
+  }
+  receive_workers_destroy();
+
+  /* A single thread hands the packets to the dispatch thread. */
+  EXPECT_EQ_INT(0, receive_workers_create(1));
+  EXPECT_EQ_INT(0, receive_workers[0].parse);
+  EXPECT_EQ_INT(STATIC_ARRAY_SIZE(ses), (int)receive_workers[0].num);
+  receive_workers_destroy();
+
+  listen_sockets_pollfd = NULL;
+  listen_sockets_se = NULL;
+  listen_sockets_num = 0;
+  return 0;
+}
+
 int main() {
   RUN_TEST(parse_packet);
+  RUN_TEST(receive_workers_create);
 
   END_TEST;
 }
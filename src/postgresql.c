@@ -706,7 +706,8 @@ static char *values_to_sqlarray(const data_set_t *ds, const value_list_t *vl,
   char *str_ptr;
   size_t str_len;
 
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
+  bool have_rates = false;
 
   str_ptr = string;
   str_len = string_len;
@@ -719,7 +720,6 @@ static char *values_to_sqlarray(const data_set_t *ds, const value_list_t *vl,
         (ds->ds[i].type != DS_TYPE_DERIVE) &&
         (ds->ds[i].type != DS_TYPE_ABSOLUTE)) {
       log_err("c_psql_write: Unknown data source type: %i", ds->ds[i].type);
-      sfree(rates);
       return NULL;
     }
 
@@ -727,12 +727,12 @@ static char *values_to_sqlarray(const data_set_t *ds, const value_list_t *vl,
       status =
           ssnprintf(str_ptr, str_len, "," GAUGE_FORMAT, vl->values[i].gauge);
     else if (store_rates) {
-      if (rates == NULL)
-        rates = uc_get_rate(ds, vl);
-
-      if (rates == NULL) {
-        log_err("c_psql_write: Failed to determine rate");
-        return NULL;
+      if (!have_rates) {
+        if (uc_get_rate_buffer(ds, vl, rates) != 0) {
+          log_err("c_psql_write: Failed to determine rate");
+          return NULL;
+        }
+        have_rates = true;
       }
 
       status = ssnprintf(str_ptr, str_len, ",%lf", rates[i]);
@@ -756,8 +756,6 @@ static char *values_to_sqlarray(const data_set_t *ds, const value_list_t *vl,
     }
   }
 
-  sfree(rates);
-
   if (str_len <= 2) {
     log_err("c_psql_write: Failed to stringify value list");
     return NULL;
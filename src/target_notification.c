@@ -214,6 +214,7 @@ static int tn_invoke(const data_set_t *ds, value_list_t *vl, /* {{{ */
   REPLACE_FIELD("%{type}", n.type);
   REPLACE_FIELD("%{type_instance}", n.type_instance);
 
+  gauge_t rates_buffer[ds->ds_num];
   rates_failed = 0;
   rates = NULL;
 
@@ -227,8 +228,9 @@ static int tn_invoke(const data_set_t *ds, value_list_t *vl, /* {{{ */
 
     if (ds->ds[i].type != DS_TYPE_GAUGE) {
       if ((rates == NULL) && (rates_failed == 0)) {
-        rates = uc_get_rate(ds, vl);
-        if (rates == NULL)
+        if (uc_get_rate_buffer(ds, vl, rates_buffer) == 0)
+          rates = rates_buffer;
+        else
           rates_failed = 1;
       }
     }
@@ -247,18 +249,24 @@ static int tn_invoke(const data_set_t *ds, value_list_t *vl, /* {{{ */
 
     REPLACE_FIELD(template, value_str);
   }
-  sfree(rates);
 
   plugin_dispatch_notification(&n);
 
   return FC_TARGET_CONTINUE;
 } /* }}} int tn_invoke */
 
+static bool tn_keeps_identifier(void __attribute__((unused)) *
+                                user_data) /* {{{ */
+{
+  return true;
+} /* }}} bool tn_keeps_identifier */
+
 void module_register(void) {
   target_proc_t tproc = {0};
 
   tproc.create = tn_create;
   tproc.destroy = tn_destroy;
   tproc.invoke = tn_invoke;
+  tproc.keeps_identifier = tn_keeps_identifier;
   fc_register_target("notification", tproc);
 } /* module_register */
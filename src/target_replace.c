@@ -555,11 +555,20 @@ static int tr_invoke(const data_set_t *ds, value_list_t *vl, /* {{{ */
   return FC_TARGET_CONTINUE;
 } /* }}} int tr_invoke */
 
+static bool tr_keeps_identifier(void *user_data) /* {{{ */
+{
+  tr_data_t *data = user_data;
+
+  return (data != NULL) && (data->host == NULL) && (data->plugin == NULL) &&
+         (data->plugin_instance == NULL) && (data->type_instance == NULL);
+} /* }}} bool tr_keeps_identifier */
+
 void module_register(void) {
   target_proc_t tproc = {0};
 
   tproc.create = tr_create;
   tproc.destroy = tr_destroy;
   tproc.invoke = tr_invoke;
+  tproc.keeps_identifier = tr_keeps_identifier;
   fc_register_target("replace", tproc);
 } /* module_register */
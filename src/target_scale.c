@@ -449,11 +449,19 @@ static int ts_invoke(const data_set_t *ds, value_list_t *vl, /* {{{ */
   return FC_TARGET_CONTINUE;
 } /* }}} int ts_invoke */
 
+/* Only the values are changed. */
+static bool ts_keeps_identifier(void __attribute__((unused)) *
+                                user_data) /* {{{ */
+{
+  return true;
+} /* }}} bool ts_keeps_identifier */
+
 void module_register(void) {
   target_proc_t tproc = {0};
 
   tproc.create = ts_create;
   tproc.destroy = ts_destroy;
   tproc.invoke = ts_invoke;
+  tproc.keeps_identifier = ts_keeps_identifier;
   fc_register_target("scale", tproc);
 } /* module_register */
@@ -419,11 +419,20 @@ static int ts_invoke(const data_set_t *ds, value_list_t *vl, /* {{{ */
   return FC_TARGET_CONTINUE;
 } /* }}} int ts_invoke */
 
+static bool ts_keeps_identifier(void *user_data) /* {{{ */
+{
+  ts_data_t *data = user_data;
+
+  return (data != NULL) && (data->host == NULL) && (data->plugin == NULL) &&
+         (data->plugin_instance == NULL) && (data->type_instance == NULL);
+} /* }}} bool ts_keeps_identifier */
+
 void module_register(void) {
   target_proc_t tproc = {0};
 
   tproc.create = ts_create;
   tproc.destroy = ts_destroy;
   tproc.invoke = ts_invoke;
+  tproc.keeps_identifier = ts_keeps_identifier;
   fc_register_target("set", tproc);
 } /* module_register */
@@ -610,7 +610,7 @@ static int ut_check_threshold(const data_set_t *ds, const value_list_t *vl,
                               __attribute__((unused))
                               user_data_t *ud) { /* {{{ */
   threshold_t *th;
-  gauge_t *values;
+  gauge_t values[ds->ds_num];
   int status;
 
   int worst_state = -1;
@@ -620,8 +620,7 @@ static int ut_check_threshold(const data_set_t *ds, const value_list_t *vl,
   if (threshold_tree == NULL)
     return 0;
 
-  /* Is this lock really necessary? So far, thresholds are only inserted at
-   * startup. -octo */
+  /* threshold_search() memorizes the threshold of this series. */
   pthread_mutex_lock(&threshold_lock);
   th = threshold_search(vl);
   pthread_mutex_unlock(&threshold_lock);
@@ -630,8 +629,7 @@ static int ut_check_threshold(const data_set_t *ds, const value_list_t *vl,
 
   DEBUG("ut_check_threshold: Found matching threshold(s)");
 
-  values = uc_get_rate(ds, vl);
-  if (values == NULL)
+  if (uc_get_rate_buffer(ds, vl, values) != 0)
     return 0;
 
   while (th != NULL) {
@@ -640,7 +638,6 @@ static int ut_check_threshold(const data_set_t *ds, const value_list_t *vl,
     status = ut_check_one_threshold(ds, vl, th, values, &ds_index);
     if (status < 0) {
       ERROR("ut_check_threshold: ut_check_one_threshold failed.");
-      sfree(values);
       return -1;
     }
 
@@ -657,12 +654,9 @@ static int ut_check_threshold(const data_set_t *ds, const value_list_t *vl,
       ut_report_state(ds, vl, worst_th, values, worst_ds_index, worst_state);
   if (status != 0) {
     ERROR("ut_check_threshold: ut_report_state failed.");
-    sfree(values);
     return -1;
   }
 
-  sfree(values);
-
   return 0;
 } /* }}} int ut_check_threshold */
 
@@ -682,7 +676,9 @@ static int ut_missing(const value_list_t *vl,
   if (threshold_tree == NULL)
     return 0;
 
+  pthread_mutex_lock(&threshold_lock);
   th = threshold_search(vl);
+  pthread_mutex_unlock(&threshold_lock);
   /* dispatch notifications for "interesting" values only */
   if ((th == NULL) || ((th->flags & UT_FLAG_INTERESTING) == 0))
     return 0;
@@ -24,6 +24,9 @@
  *   Florian octo Forster <octo at collectd.org>
  **/
 
+/* _GNU_SOURCE is needed in Linux to use fopencookie */
+#define _GNU_SOURCE
+
 #include "collectd.h"
 
 #include "plugin.h"
@@ -33,12 +36,24 @@
 #include "utils/cmds/getthreshold.h"
 #include "utils/cmds/getval.h"
 #include "utils/cmds/listval.h"
+#include "utils/cmds/putbin.h"
 #include "utils/cmds/putnotif.h"
 #include "utils/cmds/putval.h"
+#include "utils/cmds/queryval.h"
+#include "utils/cmds/stats.h"
 
 #include <sys/stat.h>
 #include <sys/un.h>
 
+/* for ntohl */
+#if HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #include <grp.h>
 
 #ifndef UNIX_PATH_MAX
@@ -47,12 +62,71 @@
 
 #define US_DEFAULT_PATH LOCALSTATEDIR "/run/" PACKAGE_NAME "-unixsock"
 
+#define US_DEFAULT_THREADS 4
+#define US_EPOLL_EVENTS 64
+
+/* Size of the input buffer of each connection. Text lines and binary frames,
+ * including their length field, have to fit into it. */
+#define US_BUFFER_SIZE 65536
+
+/* Number of queued reply bytes at which a connection stops handling commands
+ * until the peer has read some of them. A single reply, e.g. of LISTVAL, may
+ * still be larger. */
+#define US_OUTPUT_MAX (1024 * 1024)
+
+/*
+ * Private data structures
+ */
+typedef struct us_conn_s us_conn_t;
+struct us_conn_s {
+  int fd;
+  FILE *fhout;
+
+  /* In binary mode the input consists of frames, each a 32 bit length in
+   * network byte order followed by a packet in the network plugin's binary
+   * format. An empty frame reports the result and ends binary mode. */
+  bool binary;
+  size_t frames_num;
+  size_t frames_failed;
+  size_t values_num;
+  char error[256];
+
+  char buffer[US_BUFFER_SIZE];
+  size_t buffer_fill;
+
+#if HAVE_SYS_EPOLL_H
+  /* Replies written to fhout are queued here and sent without blocking, see
+   * us_conn_send(). */
+  char *out;
+  size_t out_size;
+  size_t out_fill;
+  size_t out_sent;
+  uint32_t events;
+  /* Commands are left in `buffer' because the output is full. */
+  bool paused;
+
+  us_conn_t *prev;
+  us_conn_t *next;
+#endif
+};
+
+#if HAVE_SYS_EPOLL_H
+/* Each worker waits for input on its share of the connections. */
+typedef struct {
+  pthread_t thread;
+  int epoll_fd;
+
+  pthread_mutex_t lock;
+  us_conn_t *conns;
+} us_worker_t;
+#endif
+
 /*
  * Private variables
  */
 /* valid configuration file keys */
 static const char *config_keys[] = {"SocketFile", "SocketGroup", "SocketPerms",
-                                    "DeleteSocket"};
+                                    "DeleteSocket", "Threads"};
 static int config_keys_num = STATIC_ARRAY_SIZE(config_keys);
 
 static int loop;
@@ -66,6 +140,15 @@ static bool delete_socket;
 
 static pthread_t listen_thread = (pthread_t)0;
 
+static size_t threads_num = US_DEFAULT_THREADS;
+#if HAVE_SYS_EPOLL_H
+static us_worker_t *workers;
+static size_t workers_num;
+static size_t workers_next;
+/* Closing the write end wakes up all workers on shutdown. */
+static int wakeup_pipe[2] = {-1, -1};
+#endif
+
 /*
  * Functions
  */
@@ -158,122 +241,520 @@ static int us_open_socket(void) {
   return 0;
 } /* int us_open_socket */
 
-static void *us_handle_client(void *arg) {
-  int fdin;
-  int fdout;
-  FILE *fhin, *fhout;
+#if HAVE_SYS_EPOLL_H
+/* Sends as much of the queued replies as the socket accepts without blocking.
+ * Returns non-zero if the connection should be closed. */
+static int us_conn_drain(us_conn_t *conn) {
+  while (conn->out_sent < conn->out_fill) {
+    ssize_t status =
+        send(conn->fd, conn->out + conn->out_sent,
+             conn->out_fill - conn->out_sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (status < 0) {
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        break;
 
-  fdin = *((int *)arg);
-  free(arg);
-  arg = NULL;
+      WARNING("unixsock plugin: failed to write to socket #%i: %s", conn->fd,
+              STRERRNO);
+      return -1;
+    }
+    conn->out_sent += (size_t)status;
+  }
 
-  DEBUG("unixsock plugin: us_handle_client: Reading from fd #%i", fdin);
+  /* Move what is left to the front once it is no more than what has been
+   * sent, so the queue does not keep growing and each byte is moved rarely. */
+  size_t left = conn->out_fill - conn->out_sent;
+  if ((left == 0) || (left <= conn->out_sent)) {
+    if (left > 0)
+      memmove(conn->out, conn->out + conn->out_sent, left);
+    conn->out_fill = left;
+    conn->out_sent = 0;
+  }
+  return 0;
+} /* int us_conn_drain */
 
-  fdout = dup(fdin);
-  if (fdout < 0) {
-    ERROR("unixsock plugin: dup failed: %s", STRERRNO);
-    close(fdin);
-    pthread_exit((void *)1);
+/* Write function of the output stream: appends to the queue of replies. If
+ * that would exceed US_OUTPUT_MAX, some of the queue is sent first. */
+static ssize_t us_conn_queue(void *cookie, const char *data, size_t size) {
+  us_conn_t *conn = cookie;
+
+  if ((conn->out_fill - conn->out_sent + size > US_OUTPUT_MAX) &&
+      (us_conn_drain(conn) != 0))
+    return -1;
+
+  if (conn->out_fill + size > conn->out_size) {
+    size_t new_size = (conn->out_size > 0) ? conn->out_size : 4096;
+    while (new_size < conn->out_fill + size)
+      new_size *= 2;
+
+    char *tmp = realloc(conn->out, new_size);
+    if (tmp == NULL) {
+      ERROR("unixsock plugin: realloc failed.");
+      errno = ENOMEM;
+      return -1;
+    }
+    conn->out = tmp;
+    conn->out_size = new_size;
   }
 
-  fhin = fdopen(fdin, "r");
-  if (fhin == NULL) {
-    ERROR("unixsock plugin: fdopen failed: %s", STRERRNO);
-    close(fdin);
-    close(fdout);
-    pthread_exit((void *)1);
-    return (void *)1;
+  memcpy(conn->out + conn->out_fill, data, size);
+  conn->out_fill += size;
+  return (ssize_t)size;
+} /* ssize_t us_conn_queue */
+
+/* Flushes the output stream and sends the queued replies without blocking.
+ * Returns non-zero if the connection should be closed. */
+static int us_conn_send(us_conn_t *conn) {
+  if (fflush(conn->fhout) != 0)
+    return -1;
+
+  return us_conn_drain(conn);
+} /* int us_conn_send */
+
+static bool us_conn_output_full(us_conn_t *conn) {
+  fflush(conn->fhout);
+  return conn->out_fill - conn->out_sent >= US_OUTPUT_MAX;
+} /* bool us_conn_output_full */
+#endif
+
+static us_conn_t *us_conn_create(int fd) {
+  us_conn_t *conn = calloc(1, sizeof(*conn));
+  if (conn == NULL) {
+    ERROR("unixsock plugin: calloc failed.");
+    return NULL;
+  }
+  conn->fd = fd;
+
+#if HAVE_SYS_EPOLL_H
+  conn->fhout = fopencookie(conn, "w",
+                            (cookie_io_functions_t){.write = us_conn_queue});
+  if (conn->fhout == NULL) {
+    ERROR("unixsock plugin: fopencookie failed: %s", STRERRNO);
+    sfree(conn);
+    return NULL;
+  }
+#else
+  int fdout = dup(fd);
+  if (fdout < 0) {
+    ERROR("unixsock plugin: dup failed: %s", STRERRNO);
+    sfree(conn);
+    return NULL;
   }
 
-  fhout = fdopen(fdout, "w");
-  if (fhout == NULL) {
+  conn->fhout = fdopen(fdout, "w");
+  if (conn->fhout == NULL) {
     ERROR("unixsock plugin: fdopen failed: %s", STRERRNO);
-    fclose(fhin); /* this closes fdin as well */
     close(fdout);
-    pthread_exit((void *)1);
-    return (void *)1;
+    sfree(conn);
+    return NULL;
   }
 
   /* change output buffer to line buffered mode */
-  if (setvbuf(fhout, NULL, _IOLBF, 0) != 0) {
+  if (setvbuf(conn->fhout, NULL, _IOLBF, 0) != 0) {
     ERROR("unixsock plugin: setvbuf failed: %s", STRERRNO);
-    fclose(fhin);
-    fclose(fhout);
-    pthread_exit((void *)1);
-    return (void *)0;
+    fclose(conn->fhout);
+    sfree(conn);
+    return NULL;
   }
+#endif
 
-  while (42) {
-    char buffer[1024];
-    char buffer_copy[1024];
-    char *fields[128];
-    int fields_num;
+  return conn;
+} /* us_conn_t *us_conn_create */
 
-    errno = 0;
-    if (fgets(buffer, sizeof(buffer), fhin) == NULL) {
-      if ((errno == EINTR) || (errno == EAGAIN))
+static void us_conn_destroy(us_conn_t *conn) {
+  if (conn == NULL)
+    return;
+
+  DEBUG("unixsock plugin: Closing connection on fd #%i", conn->fd);
+  fclose(conn->fhout);
+  close(conn->fd);
+#if HAVE_SYS_EPOLL_H
+  sfree(conn->out);
+#endif
+  sfree(conn);
+} /* void us_conn_destroy */
+
+/* Remembers the first error reported while handling binary frames, so it can
+ * be returned when the client synchronizes. */
+static void us_conn_error(void *ud, cmd_status_t status, const char *format,
+                          va_list ap) {
+  us_conn_t *conn = ud;
+
+  if ((status == CMD_OK) || (conn->error[0] != 0))
+    return;
+
+  vsnprintf(conn->error, sizeof(conn->error), format, ap);
+} /* void us_conn_error */
+
+static void us_handle_frame(us_conn_t *conn, void const *data, size_t size) {
+  cmd_error_handler_t err = {us_conn_error, conn};
+  size_t vl_num = 0;
+
+  conn->frames_num++;
+  if (cmd_handle_putbin(data, size, &vl_num, &err) != CMD_OK)
+    conn->frames_failed++;
+  conn->values_num += vl_num;
+} /* void us_handle_frame */
+
+/* Handles the empty frame, which reports the result of all frames since
+ * binary mode was enabled and switches back to text mode. */
+static void us_handle_sync(us_conn_t *conn) {
+  cmd_error_handler_t err = {cmd_error_fh, conn->fhout};
+
+  if (conn->frames_failed == 0)
+    cmd_error(CMD_OK, &err, "Success: %" PRIsz " %s been dispatched.",
+              conn->values_num,
+              (conn->values_num == 1) ? "value has" : "values have");
+  else
+    cmd_error(CMD_ERROR, &err, "%" PRIsz " of %" PRIsz " frames failed: %s",
+              conn->frames_failed, conn->frames_num, conn->error);
+
+  conn->binary = false;
+} /* void us_handle_sync */
+
+/* Handles one text command. Returns non-zero if the connection should be
+ * closed. */
+static int us_handle_command(us_conn_t *conn, char *buffer) {
+  FILE *fhout = conn->fhout;
+  char buffer_copy[1024];
+  char *fields[128];
+  int fields_num;
+
+  sstrncpy(buffer_copy, buffer, sizeof(buffer_copy));
+
+  fields_num =
+      strsplit(buffer_copy, fields, sizeof(fields) / sizeof(fields[0]));
+  if (fields_num < 1) {
+    fprintf(fhout, "-1 Internal error\n");
+    return -1;
+  }
+
+  if (strcasecmp(fields[0], "getval") == 0) {
+    cmd_handle_getval(fhout, buffer);
+  } else if (strcasecmp(fields[0], "getthreshold") == 0) {
+    handle_getthreshold(fhout, buffer);
+  } else if (strcasecmp(fields[0], "putval") == 0) {
+    cmd_handle_putval(fhout, buffer);
+  } else if (strcasecmp(fields[0], "listval") == 0) {
+    cmd_handle_listval(fhout, buffer);
+  } else if (strcasecmp(fields[0], "queryval") == 0) {
+    cmd_handle_queryval(fhout, buffer);
+  } else if (strcasecmp(fields[0], "putnotif") == 0) {
+    handle_putnotif(fhout, buffer);
+  } else if (strcasecmp(fields[0], "flush") == 0) {
+    cmd_handle_flush(fhout, buffer);
+  } else if (strcasecmp(fields[0], "stats") == 0) {
+    cmd_handle_stats(fhout, buffer);
+  } else if (strcasecmp(fields[0], "binary") == 0) {
+    conn->binary = true;
+    conn->frames_num = 0;
+    conn->frames_failed = 0;
+    conn->values_num = 0;
+    conn->error[0] = 0;
+    fprintf(fhout, "0 Binary mode enabled\n");
+  } else {
+    if (fprintf(fhout, "-1 Unknown command: %s\n", fields[0]) < 0) {
+      WARNING("unixsock plugin: failed to write to socket #%i: %s",
+              fileno(fhout), STRERRNO);
+      return -1;
+    }
+  }
+
+  return 0;
+} /* int us_handle_command */
+
+/* Handles all complete lines and frames in the input buffer and moves the
+ * remainder to its beginning. Returns non-zero if the connection should be
+ * closed. */
+static int us_conn_process(us_conn_t *conn) {
+  size_t offset = 0;
+  int status = 0;
+
+#if HAVE_SYS_EPOLL_H
+  conn->paused = false;
+#endif
+
+  while ((status == 0) && (offset < conn->buffer_fill)) {
+    char *data = conn->buffer + offset;
+    size_t size = conn->buffer_fill - offset;
+
+#if HAVE_SYS_EPOLL_H
+    /* The remaining commands are handled once the peer has read some of the
+     * replies. */
+    if (us_conn_output_full(conn)) {
+      conn->paused = true;
+      break;
+    }
+#endif
+
+    if (conn->binary) {
+      uint32_t frame_size;
+      if (size < sizeof(frame_size))
+        break;
+
+      memcpy(&frame_size, data, sizeof(frame_size));
+      frame_size = ntohl(frame_size);
+      if (frame_size == 0) {
+        us_handle_sync(conn);
+        offset += sizeof(frame_size);
         continue;
+      } else if (frame_size > sizeof(conn->buffer) - sizeof(frame_size)) {
+        fprintf(conn->fhout, "-1 Frame too large: %" PRIu32 " bytes\n",
+                frame_size);
+        status = -1;
+        break;
+      } else if (size - sizeof(frame_size) < frame_size) {
+        break;
+      }
 
-      if (errno != 0) {
-        WARNING("unixsock plugin: failed to read from socket #%i: %s",
-                fileno(fhin), STRERRNO);
+      us_handle_frame(conn, data + sizeof(frame_size), frame_size);
+      offset += sizeof(frame_size) + frame_size;
+      continue;
+    }
+
+    char *end = memchr(data, '\n', size);
+    if (end == NULL) {
+      if (size == sizeof(conn->buffer)) {
+        fprintf(conn->fhout, "-1 Line too long\n");
+        status = -1;
       }
       break;
     }
+    offset += (size_t)(end - data) + 1;
 
-    size_t len = strlen(buffer);
-    while ((len > 0) &&
-           ((buffer[len - 1] == '\n') || (buffer[len - 1] == '\r')))
-      buffer[--len] = '\0';
+    size_t len = (size_t)(end - data);
+    *end = '\0';
+    while ((len > 0) && (data[len - 1] == '\r'))
+      data[--len] = '\0';
 
-    if (len == 0)
-      continue;
+    if (len > 0)
+      status = us_handle_command(conn, data);
+  }
 
-    sstrncpy(buffer_copy, buffer, sizeof(buffer_copy));
+  conn->buffer_fill -= offset;
+  if ((offset > 0) && (conn->buffer_fill > 0))
+    memmove(conn->buffer, conn->buffer + offset, conn->buffer_fill);
 
-    fields_num =
-        strsplit(buffer_copy, fields, sizeof(fields) / sizeof(fields[0]));
-    if (fields_num < 1) {
-      fprintf(fhout, "-1 Internal error\n");
-      fclose(fhin);
-      fclose(fhout);
-      pthread_exit((void *)1);
-      return (void *)1;
+  return status;
+} /* int us_conn_process */
+
+/* Reads from the connection and handles what has been received. Returns
+ * non-zero if the connection should be closed. */
+static int us_conn_read(us_conn_t *conn, int flags) {
+  ssize_t status = recv(conn->fd, conn->buffer + conn->buffer_fill,
+                        sizeof(conn->buffer) - conn->buffer_fill, flags);
+  if (status < 0) {
+    if ((errno == EINTR) || (errno == EAGAIN) || (errno == EWOULDBLOCK))
+      return 0;
+
+    WARNING("unixsock plugin: failed to read from socket #%i: %s", conn->fd,
+            STRERRNO);
+    return -1;
+  } else if (status == 0) {
+    return -1;
+  }
+
+  conn->buffer_fill += (size_t)status;
+  return us_conn_process(conn);
+} /* int us_conn_read */
+
+#if HAVE_SYS_EPOLL_H
+static void us_worker_remove(us_worker_t *w, us_conn_t *conn) {
+  epoll_ctl(w->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+
+  pthread_mutex_lock(&w->lock);
+  if (conn->prev != NULL)
+    conn->prev->next = conn->next;
+  else
+    w->conns = conn->next;
+  if (conn->next != NULL)
+    conn->next->prev = conn->prev;
+  pthread_mutex_unlock(&w->lock);
+
+  us_conn_destroy(conn);
+} /* void us_worker_remove */
+
+static int us_worker_add(us_worker_t *w, us_conn_t *conn) {
+  pthread_mutex_lock(&w->lock);
+  conn->prev = NULL;
+  conn->next = w->conns;
+  if (w->conns != NULL)
+    w->conns->prev = conn;
+  w->conns = conn;
+  pthread_mutex_unlock(&w->lock);
+
+  conn->events = EPOLLIN;
+  struct epoll_event ev = {.events = conn->events, .data.ptr = conn};
+  if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) != 0) {
+    ERROR("unixsock plugin: epoll_ctl failed: %s", STRERRNO);
+    us_worker_remove(w, conn);
+    return -1;
+  }
+
+  return 0;
+} /* int us_worker_add */
+
+/* Waits for the socket to become writable while replies are queued and for
+ * input otherwise. A peer that does not read its replies is not read from
+ * either, so it only holds up itself and not the worker. */
+static int us_worker_update(us_worker_t *w, us_conn_t *conn) {
+  uint32_t events = (conn->out_sent < conn->out_fill) ? EPOLLOUT : EPOLLIN;
+  if (events == conn->events)
+    return 0;
+
+  struct epoll_event ev = {.events = events, .data.ptr = conn};
+  if (epoll_ctl(w->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) != 0) {
+    ERROR("unixsock plugin: epoll_ctl failed: %s", STRERRNO);
+    return -1;
+  }
+
+  conn->events = events;
+  return 0;
+} /* int us_worker_update */
+
+static void *us_worker_thread(void *arg) {
+  us_worker_t *w = arg;
+  bool running = true;
+
+  while (running) {
+    struct epoll_event events[US_EPOLL_EVENTS];
+
+    int events_num = epoll_wait(w->epoll_fd, events,
+                                STATIC_ARRAY_SIZE(events), /* timeout = */ -1);
+    if (events_num < 0) {
+      if (errno == EINTR)
+        continue;
+
+      ERROR("unixsock plugin: epoll_wait failed: %s", STRERRNO);
+      break;
     }
 
-    if (strcasecmp(fields[0], "getval") == 0) {
-      cmd_handle_getval(fhout, buffer);
-    } else if (strcasecmp(fields[0], "getthreshold") == 0) {
-      handle_getthreshold(fhout, buffer);
-    } else if (strcasecmp(fields[0], "putval") == 0) {
-      cmd_handle_putval(fhout, buffer);
-    } else if (strcasecmp(fields[0], "listval") == 0) {
-      cmd_handle_listval(fhout, buffer);
-    } else if (strcasecmp(fields[0], "putnotif") == 0) {
-      handle_putnotif(fhout, buffer);
-    } else if (strcasecmp(fields[0], "flush") == 0) {
-      cmd_handle_flush(fhout, buffer);
-    } else {
-      if (fprintf(fhout, "-1 Unknown command: %s\n", fields[0]) < 0) {
-        WARNING("unixsock plugin: failed to write to socket #%i: %s",
-                fileno(fhout), STRERRNO);
-        break;
+    for (int i = 0; i < events_num; i++) {
+      us_conn_t *conn = events[i].data.ptr;
+
+      /* The wake-up pipe has been closed. */
+      if (conn == NULL) {
+        running = false;
+        continue;
+      }
+
+      int status = 0;
+      if ((conn->events == EPOLLIN) && !conn->paused)
+        status = us_conn_read(conn, MSG_DONTWAIT);
+      if (status == 0)
+        status = us_conn_send(conn);
+      /* Handle the commands left in the buffer while the output was full. */
+      while ((status == 0) && conn->paused && !us_conn_output_full(conn)) {
+        status = us_conn_process(conn);
+        if (status == 0)
+          status = us_conn_send(conn);
       }
+      if (status == 0)
+        status = us_worker_update(w, conn);
+
+      if (status != 0) {
+        /* Try to get the last error message out before closing. */
+        us_conn_send(conn);
+        us_worker_remove(w, conn);
+      }
+    }
+  }
+
+  while (w->conns != NULL)
+    us_worker_remove(w, w->conns);
+
+  return (void *)0;
+} /* void *us_worker_thread */
+
+static void us_workers_destroy(void) {
+  if (wakeup_pipe[1] >= 0) {
+    close(wakeup_pipe[1]);
+    wakeup_pipe[1] = -1;
+  }
+
+  for (size_t i = 0; i < workers_num; i++) {
+    us_worker_t *w = workers + i;
+
+    if (w->thread != (pthread_t)0)
+      pthread_join(w->thread, NULL);
+    if (w->epoll_fd >= 0)
+      close(w->epoll_fd);
+    pthread_mutex_destroy(&w->lock);
+  }
+  sfree(workers);
+  workers_num = 0;
+
+  if (wakeup_pipe[0] >= 0) {
+    close(wakeup_pipe[0]);
+    wakeup_pipe[0] = -1;
+  }
+} /* void us_workers_destroy */
+
+static int us_workers_create(void) {
+  if (pipe(wakeup_pipe) != 0) {
+    ERROR("unixsock plugin: pipe failed: %s", STRERRNO);
+    return -1;
+  }
+
+  workers = calloc(threads_num, sizeof(*workers));
+  if (workers == NULL) {
+    ERROR("unixsock plugin: calloc failed.");
+    us_workers_destroy();
+    return -1;
+  }
+
+  for (size_t i = 0; i < threads_num; i++) {
+    us_worker_t *w = workers + i;
+
+    pthread_mutex_init(&w->lock, NULL);
+    workers_num++;
+
+    w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epoll_fd < 0) {
+      ERROR("unixsock plugin: epoll_create1 failed: %s", STRERRNO);
+      us_workers_destroy();
+      return -1;
     }
-  } /* while (fgets) */
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, wakeup_pipe[0], &ev) != 0) {
+      ERROR("unixsock plugin: epoll_ctl failed: %s", STRERRNO);
+      us_workers_destroy();
+      return -1;
+    }
+
+    int status =
+        plugin_thread_create(&w->thread, us_worker_thread, w, "unixsock conn");
+    if (status != 0) {
+      ERROR("unixsock plugin: pthread_create failed: %s", STRERROR(status));
+      w->thread = (pthread_t)0;
+      us_workers_destroy();
+      return -1;
+    }
+  }
+
+  return 0;
+} /* int us_workers_create */
+#else  /* !HAVE_SYS_EPOLL_H */
+static void *us_handle_client(void *arg) {
+  us_conn_t *conn = arg;
+
+  DEBUG("unixsock plugin: us_handle_client: Reading from fd #%i", conn->fd);
+
+  while (us_conn_read(conn, 0) == 0)
+    /* continue */;
 
   DEBUG("unixsock plugin: us_handle_client: Exiting..");
-  fclose(fhin);
-  fclose(fhout);
+  us_conn_destroy(conn);
 
   pthread_exit((void *)0);
   return (void *)0;
 } /* void *us_handle_client */
+#endif /* HAVE_SYS_EPOLL_H */
 
 static void *us_server_thread(void __attribute__((unused)) * arg) {
   int status;
-  int *remote_fd;
-  pthread_t th;
 
   if (us_open_socket() != 0)
     pthread_exit((void *)1);
@@ -292,26 +773,32 @@ static void *us_server_thread(void __attribute__((unused)) * arg) {
       pthread_exit((void *)1);
     }
 
-    remote_fd = malloc(sizeof(*remote_fd));
-    if (remote_fd == NULL) {
-      WARNING("unixsock plugin: malloc failed: %s", STRERRNO);
+    us_conn_t *conn = us_conn_create(status);
+    if (conn == NULL) {
       close(status);
       continue;
     }
-    *remote_fd = status;
 
-    DEBUG("Spawning child to handle connection on fd #%i", *remote_fd);
+#if HAVE_SYS_EPOLL_H
+    us_worker_t *w = workers + (workers_next++ % workers_num);
+    DEBUG("Handing connection on fd #%i to worker %" PRIsz, conn->fd,
+          (size_t)(w - workers));
+    us_worker_add(w, conn);
+#else
+    pthread_t th;
+
+    DEBUG("Spawning child to handle connection on fd #%i", conn->fd);
 
-    status = plugin_thread_create(&th, us_handle_client, (void *)remote_fd,
+    status = plugin_thread_create(&th, us_handle_client, (void *)conn,
                                   "unixsock conn");
     if (status == 0) {
       pthread_detach(th);
     } else {
       WARNING("unixsock plugin: pthread_create failed: %s", STRERRNO);
-      close(*remote_fd);
-      free(remote_fd);
+      us_conn_destroy(conn);
       continue;
     }
+#endif
   } /* while (loop) */
 
   close(sock_fd);
@@ -348,6 +835,15 @@ static int us_config(const char *key, const char *val) {
       delete_socket = true;
     else
       delete_socket = false;
+  } else if (strcasecmp(key, "Threads") == 0) {
+    int tmp = atoi(val);
+    if (tmp < 1) {
+      WARNING("unixsock plugin: Threads must be at least 1, "
+              "using the default of %i.",
+              US_DEFAULT_THREADS);
+      tmp = US_DEFAULT_THREADS;
+    }
+    threads_num = (size_t)tmp;
   } else {
     return -1;
   }
@@ -367,6 +863,11 @@ static int us_init(void) {
 
   loop = 1;
 
+#if HAVE_SYS_EPOLL_H
+  if (us_workers_create() != 0)
+    return -1;
+#endif
+
   status = plugin_thread_create(&listen_thread, us_server_thread, NULL,
                                 "unixsock listen");
   if (status != 0) {
@@ -388,6 +889,10 @@ static int us_shutdown(void) {
     listen_thread = (pthread_t)0;
   }
 
+#if HAVE_SYS_EPOLL_H
+  us_workers_destroy();
+#endif
+
   plugin_unregister_init("unixsock");
   plugin_unregister_shutdown("unixsock");
 
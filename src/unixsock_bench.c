@@ -0,0 +1,278 @@
+/**
+ * collectd - src/unixsock_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures how many values per second the unixsock plugin receives over a
+ * single connection, first as PUTVAL commands and then as binary frames of
+ * BENCH_VALUES_PER_FRAME value lists each. The values are parsed, but
+ * plugin_dispatch_values() is the mock's no-op, so this measures the protocol
+ * and not the daemon's write path.
+ *
+ * Usage: bench_plugin_unixsock [seconds per run] */
+
+#include "unixsock.c" /* (sic) */
+
+#include "network.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#define BENCH_VALUES_PER_FRAME 100
+#define BENCH_SERIES 1000
+
+typedef struct {
+  int fd;
+  char *data;
+  size_t data_size;
+  /* Number of times "data" has been written. */
+  size_t sent;
+  bool stop;
+} bench_writer_t;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+static int write_all(int fd, char const *data, size_t size) {
+  while (size > 0) {
+    ssize_t status = write(fd, data, size);
+    if (status < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    data += status;
+    size -= (size_t)status;
+  }
+  return 0;
+}
+
+static void *writer(void *arg) {
+  bench_writer_t *w = arg;
+
+  while (!w->stop) {
+    if (write_all(w->fd, w->data, w->data_size) != 0)
+      break;
+    w->sent++;
+  }
+
+  return NULL;
+}
+
+/* Reads one line from "fd" into "buffer". */
+static int read_line(int fd, char *buffer, size_t buffer_size) {
+  size_t len = 0;
+
+  while (len < buffer_size - 1) {
+    ssize_t status = read(fd, buffer + len, 1);
+    if (status <= 0)
+      return -1;
+    if (buffer[len] == '\n')
+      break;
+    len++;
+  }
+  buffer[len] = 0;
+  return 0;
+}
+
+static size_t put_header(char *buffer, uint16_t type, size_t size) {
+  uint16_t tmp[2] = {htons(type), htons((uint16_t)size)};
+  memcpy(buffer, tmp, sizeof(tmp));
+  return sizeof(tmp);
+}
+
+static size_t put_string(char *buffer, uint16_t type, char const *str) {
+  size_t len = strlen(str) + 1;
+  size_t size = put_header(buffer, type, 4 + len);
+  memcpy(buffer + size, str, len);
+  return size + len;
+}
+
+static size_t put_number(char *buffer, uint16_t type, uint64_t n) {
+  size_t size = put_header(buffer, type, 4 + sizeof(n));
+  n = htonll(n);
+  memcpy(buffer + size, &n, sizeof(n));
+  return size + sizeof(n);
+}
+
+static size_t put_derive(char *buffer, derive_t d) {
+  size_t size = put_header(buffer, TYPE_VALUES, 4 + 2 + 1 + sizeof(d));
+  uint16_t num = htons(1);
+  memcpy(buffer + size, &num, sizeof(num));
+  size += sizeof(num);
+  buffer[size++] = DS_TYPE_DERIVE;
+  uint64_t tmp = htonll((uint64_t)d);
+  memcpy(buffer + size, &tmp, sizeof(tmp));
+  return size + sizeof(tmp);
+}
+
+/* Builds one frame with BENCH_VALUES_PER_FRAME value lists, in the same
+ * format as lcc_network_buffer_add_value() and the network plugin. */
+static size_t build_frame(char *buffer) {
+  size_t size = sizeof(uint32_t);
+
+  size += put_string(buffer + size, TYPE_HOST, "bench.example.com");
+  size += put_number(buffer + size, TYPE_TIME_HR,
+                     TIME_T_TO_CDTIME_T(1700000000));
+  size += put_number(buffer + size, TYPE_INTERVAL_HR, TIME_T_TO_CDTIME_T(10));
+  size += put_string(buffer + size, TYPE_PLUGIN, "bench");
+  size += put_string(buffer + size, TYPE_TYPE, "MAGIC");
+  for (int i = 0; i < BENCH_VALUES_PER_FRAME; i++) {
+    char instance[16];
+    snprintf(instance, sizeof(instance), "%i", i);
+    size += put_string(buffer + size, TYPE_TYPE_INSTANCE, instance);
+    size += put_derive(buffer + size, i);
+  }
+
+  uint32_t frame_size = htonl((uint32_t)(size - sizeof(frame_size)));
+  memcpy(buffer, &frame_size, sizeof(frame_size));
+  return size;
+}
+
+/* Starts handling the server end of the connection the way us_init() would,
+ * without going through plugin_thread_create(). */
+static int server_start(us_conn_t *conn) {
+#if HAVE_SYS_EPOLL_H
+  if ((pipe(wakeup_pipe) != 0) ||
+      ((workers = calloc(1, sizeof(*workers))) == NULL))
+    return -1;
+  workers_num = 1;
+  pthread_mutex_init(&workers->lock, NULL);
+  workers->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+  if ((workers->epoll_fd < 0) ||
+      (epoll_ctl(workers->epoll_fd, EPOLL_CTL_ADD, wakeup_pipe[0], &ev) != 0))
+    return -1;
+  pthread_create(&workers->thread, NULL, us_worker_thread, workers);
+  return us_worker_add(workers, conn);
+#else
+  pthread_t tid;
+  return pthread_create(&tid, NULL, us_handle_client, conn);
+#endif
+}
+
+static void server_stop(void) {
+#if HAVE_SYS_EPOLL_H
+  us_workers_destroy();
+#endif
+}
+
+static int run(double seconds, bool binary) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    fprintf(stderr, "socketpair: %s\n", STRERRNO);
+    return -1;
+  }
+
+  us_conn_t *conn = us_conn_create(fds[0]);
+  if ((conn == NULL) || (server_start(conn) != 0)) {
+    fprintf(stderr, "Starting the server failed.\n");
+    return -1;
+  }
+
+  char line[1024];
+  char *data;
+  size_t data_size = 0;
+  size_t values_per_write;
+  if (binary) {
+    data = malloc(US_BUFFER_SIZE);
+    data_size = build_frame(data);
+    values_per_write = BENCH_VALUES_PER_FRAME;
+
+    write_all(fds[1], "BINARY\n", strlen("BINARY\n"));
+    read_line(fds[1], line, sizeof(line));
+  } else {
+    data = malloc(BENCH_SERIES * 128);
+    for (int i = 0; i < BENCH_SERIES; i++)
+      data_size += (size_t)snprintf(data + data_size, 128,
+                                    "PUTVAL bench.example.com/bench/MAGIC-%i "
+                                    "interval=10 1700000000:%i\n",
+                                    i, i);
+    values_per_write = BENCH_SERIES;
+  }
+
+  bench_writer_t w = {.fd = fds[1], .data = data, .data_size = data_size};
+  pthread_t tid;
+  double start = now_seconds();
+  pthread_create(&tid, NULL, writer, &w);
+
+  /* PUTVAL answers each command, which has to be read while writing. */
+  size_t received = 0;
+  double end = start + seconds;
+  if (!binary) {
+    while (now_seconds() < end) {
+      if (read_line(fds[1], line, sizeof(line)) != 0)
+        break;
+      received++;
+    }
+  } else {
+    struct timespec ts = {.tv_sec = (time_t)seconds,
+                          .tv_nsec =
+                              (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&ts, NULL);
+  }
+
+  w.stop = true;
+  if (!binary) {
+    /* Drain the answers, so that the writer can finish. */
+    while (true) {
+      struct pollfd pfd = {.fd = fds[1], .events = POLLIN};
+      if (poll(&pfd, 1, 100) <= 0)
+        break;
+      if (read_line(fds[1], line, sizeof(line)) != 0)
+        break;
+      received++;
+    }
+    pthread_join(tid, NULL);
+  } else {
+    pthread_join(tid, NULL);
+    /* The empty frame returns the number of dispatched values. */
+    write_all(fds[1], "\0\0\0\0", 4);
+    read_line(fds[1], line, sizeof(line));
+    sscanf(line, "0 Success: %zu", &received);
+  }
+  double elapsed = now_seconds() - start;
+
+  printf("%-8s %10.0f values/s (%zu values per write)\n",
+         binary ? "binary" : "PUTVAL", (double)received / elapsed,
+         values_per_write);
+
+  close(fds[1]);
+  server_stop();
+  free(data);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+
+  if (run(seconds, /* binary = */ false) != 0)
+    return 1;
+  if (run(seconds, /* binary = */ true) != 0)
+    return 1;
+  return 0;
+}
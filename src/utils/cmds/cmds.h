@@ -37,6 +37,7 @@ typedef enum {
   CMD_GETVAL = 2,
   CMD_LISTVAL = 3,
   CMD_PUTVAL = 4,
+  CMD_QUERYVAL = 5,
 } cmd_type_t;
 #define CMD_TO_STRING(type)                                                    \
   ((type) == CMD_FLUSH)                                                        \
@@ -45,7 +46,9 @@ typedef enum {
             ? "GETVAL"                                                         \
             : ((type) == CMD_LISTVAL)                                          \
                   ? "LISTVAL"                                                  \
-                  : ((type) == CMD_PUTVAL) ? "PUTVAL" : "UNKNOWN"
+                  : ((type) == CMD_PUTVAL)                                     \
+                        ? "PUTVAL"                                             \
+                        : ((type) == CMD_QUERYVAL) ? "QUERYVAL" : "UNKNOWN"
 
 typedef struct {
   double timeout;
@@ -71,6 +74,13 @@ typedef struct {
   size_t vl_num;
 } cmd_putval_t;
 
+typedef struct {
+  /* Patterns for the identifier fields. NULL matches any value. Patterns
+   * enclosed in slashes are extended regular expressions, all others are
+   * shell wildcard patterns. */
+  identifier_t pattern;
+} cmd_queryval_t;
+
 /*
  * NAME
  *   cmd_t
@@ -84,6 +94,7 @@ typedef struct {
     cmd_flush_t flush;
     cmd_getval_t getval;
     cmd_putval_t putval;
+    cmd_queryval_t queryval;
   } cmd;
 } cmd_t;
 
@@ -115,8 +126,20 @@ typedef enum {
 
   /* Not necessarily fatal errors. */
   CMD_NO_OPTION = 1,
+  CMD_UNSUPPORTED = 2,
 } cmd_status_t;
 
+/*
+ * NAME
+ *   cmd_values_callback_t
+ *
+ * DESCRIPTION
+ *   Called by parsers which hand out value lists one by one instead of
+ *   returning them, such as cmd_parse_putbin(). The value list and its values
+ *   are only valid during the call. A non-zero return value aborts parsing.
+ */
+typedef int (*cmd_values_callback_t)(value_list_t const *vl, void *user_data);
+
 /*
  * NAME
  *   cmd_error_handler_t
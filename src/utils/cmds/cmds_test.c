@@ -32,8 +32,16 @@
 #include "utils/common/common.h"
 #include "testing.h"
 #include "utils/cmds/cmds.h"
+#include "utils/cmds/putbin.h"
+#include "utils/cmds/putval.h"
+#include "network.h"
 // clang-format on
 
+/* for htons */
+#if HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
 static void error_cb(void *ud, cmd_status_t status, const char *format,
                      va_list ap) {
   if (status == CMD_OK)
@@ -167,6 +175,50 @@ static struct {
         CMD_UNKNOWN,
     },
 
+    /* Valid QUERYVAL commands. */
+    {
+        "QUERYVAL",
+        NULL,
+        CMD_OK,
+        CMD_QUERYVAL,
+    },
+    {
+        "QUERYVAL host=\"web*\" plugin=cpu type_instance=/^(user|system)$/",
+        NULL,
+        CMD_OK,
+        CMD_QUERYVAL,
+    },
+
+    /* Invalid QUERYVAL commands. */
+    {
+        /* Not an option. */
+        "QUERYVAL myhost/magic/MAGIC",
+        NULL,
+        CMD_PARSE_ERROR,
+        CMD_UNKNOWN,
+    },
+    {
+        /* Unknown field. */
+        "QUERYVAL invalid=option",
+        NULL,
+        CMD_PARSE_ERROR,
+        CMD_UNKNOWN,
+    },
+    {
+        /* Field given twice. */
+        "QUERYVAL plugin=cpu plugin=memory",
+        NULL,
+        CMD_PARSE_ERROR,
+        CMD_UNKNOWN,
+    },
+    {
+        /* Invalid regular expression. */
+        "QUERYVAL plugin=/(cpu/",
+        NULL,
+        CMD_PARSE_ERROR,
+        CMD_UNKNOWN,
+    },
+
     /* Valid PUTVAL commands. */
     {
         "PUTVAL magic/MAGIC N:42",
@@ -330,7 +382,299 @@ DEF_TEST(parse) {
   return test_result;
 }
 
+static size_t putbin_header(uint8_t *buffer, uint16_t type, size_t size) {
+  uint16_t tmp[2] = {htons(type), htons((uint16_t)size)};
+  memcpy(buffer, tmp, sizeof(tmp));
+  return sizeof(tmp);
+}
+
+static size_t putbin_string(uint8_t *buffer, uint16_t type, char const *str) {
+  size_t size = putbin_header(buffer, type, 4 + strlen(str) + 1);
+  memcpy(buffer + size, str, strlen(str) + 1);
+  return size + strlen(str) + 1;
+}
+
+static size_t putbin_number(uint8_t *buffer, uint16_t type, uint64_t n) {
+  size_t size = putbin_header(buffer, type, 4 + sizeof(n));
+  n = htonll(n);
+  memcpy(buffer + size, &n, sizeof(n));
+  return size + sizeof(n);
+}
+
+static size_t putbin_values(uint8_t *buffer, gauge_t g, derive_t d) {
+  size_t size = putbin_header(buffer, TYPE_VALUES, 4 + 2 + 2 * 9);
+  uint16_t num = htons(2);
+  memcpy(buffer + size, &num, sizeof(num));
+  size += sizeof(num);
+  buffer[size++] = DS_TYPE_GAUGE;
+  buffer[size++] = DS_TYPE_DERIVE;
+
+  double tmp_g = htond(g);
+  memcpy(buffer + size, &tmp_g, sizeof(tmp_g));
+  size += sizeof(tmp_g);
+  uint64_t tmp_d = htonll((uint64_t)d);
+  memcpy(buffer + size, &tmp_d, sizeof(tmp_d));
+  return size + sizeof(tmp_d);
+}
+
+typedef struct {
+  size_t calls;
+  value_list_t last;
+  gauge_t gauge;
+  derive_t derive;
+} putbin_result_t;
+
+static int putbin_cb(value_list_t const *vl, void *user_data) {
+  putbin_result_t *r = user_data;
+  r->calls++;
+  r->last = *vl;
+  r->last.values = NULL;
+  r->gauge = vl->values[0].gauge;
+  r->derive = vl->values[1].derive;
+  return (vl->values[1].derive < 0) ? -1 : 0;
+}
+
+DEF_TEST(putbin) {
+  cmd_error_handler_t err = {error_cb, NULL};
+  uint8_t buffer[512];
+  size_t size = 0;
+
+  size += putbin_string(buffer + size, TYPE_HOST, "example.com");
+  size += putbin_number(buffer + size, TYPE_TIME_HR,
+                        TIME_T_TO_CDTIME_T(1700000000));
+  size += putbin_number(buffer + size, TYPE_INTERVAL, 10);
+  size += putbin_string(buffer + size, TYPE_PLUGIN, "test");
+  size += putbin_string(buffer + size, TYPE_TYPE, "example");
+  size += putbin_values(buffer + size, 1.5, 42);
+  /* Parts are inherited by the following value lists. */
+  size += putbin_string(buffer + size, TYPE_TYPE_INSTANCE, "second");
+  size += putbin_header(buffer + size, TYPE_SIGN_SHA256, 4);
+  size += putbin_values(buffer + size, -2.0, 23);
+
+  putbin_result_t r = {0};
+  size_t vl_num = 0;
+  EXPECT_EQ_INT(CMD_OK, cmd_parse_putbin(buffer, size, putbin_cb, &r, &vl_num,
+                                         &err));
+  EXPECT_EQ_UINT64(2, vl_num);
+  EXPECT_EQ_UINT64(2, r.calls);
+  EXPECT_EQ_STR("example.com", r.last.host);
+  EXPECT_EQ_STR("test", r.last.plugin);
+  EXPECT_EQ_STR("", r.last.plugin_instance);
+  EXPECT_EQ_STR("example", r.last.type);
+  EXPECT_EQ_STR("second", r.last.type_instance);
+  EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(1700000000), r.last.time);
+  EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(10), r.last.interval);
+  EXPECT_EQ_UINT64(2, r.last.values_len);
+  EXPECT_EQ_DOUBLE(-2.0, r.gauge);
+  EXPECT_EQ_INT(23, (int)r.derive);
+
+  /* Every truncation of the packet is either rejected or ends at a part
+   * boundary. */
+  for (size_t i = 0; i < size; i++) {
+    cmd_status_t status = cmd_parse_putbin(buffer, i, putbin_cb, &r, NULL,
+                                           &(cmd_error_handler_t){0});
+    OK(status == CMD_OK || status == CMD_PARSE_ERROR);
+  }
+
+  /* Strings must be terminated and fit into the value list. */
+  size = putbin_header(buffer, TYPE_HOST, 4 + 3);
+  memcpy(buffer + size, "abc", 3);
+  EXPECT_EQ_INT(CMD_PARSE_ERROR, cmd_parse_putbin(buffer, size + 3, putbin_cb,
+                                                  &r, NULL, &err));
+  char long_name[DATA_MAX_NAME_LEN + 1];
+  memset(long_name, 'x', sizeof(long_name) - 1);
+  long_name[sizeof(long_name) - 1] = 0;
+  size = putbin_string(buffer, TYPE_PLUGIN, long_name);
+  EXPECT_EQ_INT(CMD_PARSE_ERROR,
+                cmd_parse_putbin(buffer, size, putbin_cb, &r, NULL, &err));
+
+  /* Unknown data source types. */
+  size = putbin_values(buffer, 1.0, 1);
+  buffer[7] = 42;
+  EXPECT_EQ_INT(CMD_PARSE_ERROR,
+                cmd_parse_putbin(buffer, size, putbin_cb, &r, NULL, &err));
+
+  /* Part sizes beyond the end of the packet. */
+  size = putbin_number(buffer, TYPE_TIME, 1);
+  EXPECT_EQ_INT(CMD_PARSE_ERROR,
+                cmd_parse_putbin(buffer, size - 1, putbin_cb, &r, NULL, &err));
+
+  /* Errors of the callback abort parsing. */
+  r.calls = 0;
+  size = putbin_values(buffer, 1.0, -1);
+  size += putbin_values(buffer + size, 1.0, 1);
+  vl_num = 1;
+  EXPECT_EQ_INT(CMD_ERROR, cmd_parse_putbin(buffer, size, putbin_cb, &r,
+                                            &vl_num, &err));
+  EXPECT_EQ_UINT64(1, r.calls);
+  EXPECT_EQ_UINT64(0, vl_num);
+
+  return 0;
+}
+
+#define PUTVAL_FUZZ_VL_MAX 16
+#define PUTVAL_FUZZ_VALUES_MAX 4
+
+typedef struct {
+  size_t vl_num;
+  value_list_t vl[PUTVAL_FUZZ_VL_MAX];
+  value_t values[PUTVAL_FUZZ_VL_MAX][PUTVAL_FUZZ_VALUES_MAX];
+} putval_result_t;
+
+static int putval_collect(value_list_t const *vl, void *user_data) {
+  putval_result_t *r = user_data;
+  if ((r->vl_num >= PUTVAL_FUZZ_VL_MAX) ||
+      (vl->values_len > PUTVAL_FUZZ_VALUES_MAX))
+    return -1;
+
+  r->vl[r->vl_num] = *vl;
+  memcpy(r->values[r->vl_num], vl->values,
+         vl->values_len * sizeof(*vl->values));
+  r->vl[r->vl_num].values = r->values[r->vl_num];
+  r->vl_num++;
+  return 0;
+}
+
+static bool value_list_equal(value_list_t const *a, value_list_t const *b) {
+  const data_set_t *ds = plugin_get_ds(a->type);
+
+  if ((ds == NULL) || (strcmp(a->host, b->host) != 0) ||
+      (strcmp(a->plugin, b->plugin) != 0) ||
+      (strcmp(a->plugin_instance, b->plugin_instance) != 0) ||
+      (strcmp(a->type, b->type) != 0) ||
+      (strcmp(a->type_instance, b->type_instance) != 0) ||
+      (a->time != b->time) || (a->interval != b->interval) ||
+      (a->values_len != b->values_len) || (a->values_len != ds->ds_num))
+    return false;
+
+  for (size_t i = 0; i < a->values_len; i++) {
+    value_t x = a->values[i];
+    value_t y = b->values[i];
+    if (ds->ds[i].type == DS_TYPE_GAUGE) {
+      if (!(isnan(x.gauge) && isnan(y.gauge)) && (x.gauge != y.gauge))
+        return false;
+    } else if (memcmp(&x, &y, sizeof(x)) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Compares cmd_parse_putval_fast() with the generic parser. Returns false if
+ * the fast parser accepted "line" with a different result. */
+static bool putval_compare(char const *line, cmd_options_t *opts,
+                           cmd_status_t *ret_status) {
+  putval_result_t fast = {0};
+  *ret_status =
+      cmd_parse_putval_fast(line, opts, putval_collect, &fast, NULL);
+  if (*ret_status != CMD_OK)
+    return true;
+
+  char *copy = strdup(line);
+  cmd_t cmd = {0};
+  cmd_status_t status = cmd_parse(copy, &cmd, opts, NULL);
+  bool equal = (status == CMD_OK) && (cmd.type == CMD_PUTVAL) &&
+               (cmd.cmd.putval.vl_num == fast.vl_num);
+  for (size_t i = 0; equal && (i < fast.vl_num); i++)
+    equal = value_list_equal(fast.vl + i, cmd.cmd.putval.vl + i);
+
+  if (!equal)
+    printf("# cmd_parse_putval_fast and cmd_parse disagree on \"%s\"\n",
+           line);
+  cmd_destroy(&cmd);
+  free(copy);
+  return equal;
+}
+
+DEF_TEST(putval_fast) {
+  struct {
+    char const *line;
+    cmd_status_t want;
+  } cases[] = {
+      {"PUTVAL myhost/magic/MAGIC 1700000000:42", CMD_OK},
+      {"putval myhost/magic-a-b/MAGIC-c-d interval=10 1.5:-42 2:43", CMD_OK},
+      {"PUTVAL h/p/MAGIC_MIXED 1700000000.125:U:-1:2:3", CMD_OK},
+      {"PUTVAL h/p/MAGIC_MIXED 17e8:.5:+1:0:3 17e8:-1.25e-3:0:1:2", CMD_OK},
+      {"  PUTVAL\th/p/MAGIC\t1:1  ", CMD_OK},
+      {"PUTVAL magic/MAGIC 1:1", CMD_OK},
+      /* Handled by the generic parser. */
+      {"PUTVAL \"h/p/MAGIC\" 1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC meta:key=\"value\" 1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC 1:0x10", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC 1:010", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC 1:1:2", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC 0:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC 1:1garbage", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC_MIXED 1:1.2345678901234567:1:1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC_MIXED 1:1e300:1:1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC_MIXED 1:nan:1:1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC_MIXED 1:1:1:-1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/UNKNOWN 1:1", CMD_UNSUPPORTED},
+      {"PUTVAL h/p/MAGIC interval=10", CMD_UNSUPPORTED},
+      {"GETVAL h/p/MAGIC", CMD_UNSUPPORTED},
+  };
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cases); i++) {
+    cmd_status_t status;
+    OK1(putval_compare(cases[i].line, &default_host_opts, &status),
+        cases[i].line);
+    EXPECT_EQ_INT(cases[i].want, status);
+  }
+
+  /* "N" is the current time. */
+  putval_result_t r = {0};
+  cdtime_t before = cdtime();
+  EXPECT_EQ_INT(CMD_OK, cmd_parse_putval_fast("PUTVAL h/p/MAGIC N:1", NULL,
+                                              putval_collect, &r, NULL));
+  OK(r.vl[0].time >= before);
+
+  /* Random mutations of valid lines. Whenever the fast parser accepts a line,
+   * the generic parser must return the same value lists. */
+  char const *alphabet = "0123456789.-+eEU:/= \"xh";
+  unsigned int seed = 1;
+  size_t accepted = 0;
+  for (size_t i = 0; i < 50000; i++) {
+    char line[256];
+    sstrncpy(line, cases[(size_t)rand_r(&seed) % 6].line, sizeof(line));
+
+    int mutations = 1 + rand_r(&seed) % 3;
+    for (int j = 0; j < mutations; j++) {
+      size_t len = strlen(line);
+      size_t pos = (size_t)rand_r(&seed) % (len + 1);
+      char c = alphabet[(size_t)rand_r(&seed) % strlen(alphabet)];
+
+      switch (rand_r(&seed) % 3) {
+      case 0: /* replace */
+        if (pos < len)
+          line[pos] = c;
+        break;
+      case 1: /* insert */
+        if (len + 1 < sizeof(line)) {
+          memmove(line + pos + 1, line + pos, len - pos + 1);
+          line[pos] = c;
+        }
+        break;
+      case 2: /* delete */
+        if (pos < len)
+          memmove(line + pos, line + pos + 1, len - pos);
+        break;
+      }
+    }
+
+    cmd_status_t status;
+    if (!putval_compare(line, &default_host_opts, &status))
+      OK1(false, line);
+    if (status == CMD_OK)
+      accepted++;
+  }
+  OK(accepted > 0);
+
+  return 0;
+}
+
 int main(int argc, char **argv) {
   RUN_TEST(parse);
+  RUN_TEST(putbin);
+  RUN_TEST(putval_fast);
   END_TEST;
 }
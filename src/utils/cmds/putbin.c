@@ -0,0 +1,232 @@
+/**
+ * collectd - src/utils/cmds/putbin.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "plugin.h"
+#include "utils/common/common.h"
+
+#include "network.h"
+#include "utils/cmds/putbin.h"
+
+/* for ntohs */
+#if HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+/* Size of the type and length fields preceding each part. */
+#define PUTBIN_HEADER_SIZE 4
+
+static uint16_t putbin_uint16(uint8_t const *p) {
+  uint16_t tmp;
+  memcpy(&tmp, p, sizeof(tmp));
+  return ntohs(tmp);
+} /* uint16_t putbin_uint16 */
+
+static int putbin_number(uint8_t const *payload, size_t payload_size,
+                         uint64_t *ret) {
+  uint64_t tmp;
+
+  if (payload_size != sizeof(tmp))
+    return -1;
+
+  memcpy(&tmp, payload, sizeof(tmp));
+  *ret = ntohll(tmp);
+  return 0;
+} /* int putbin_number */
+
+static int putbin_string(uint8_t const *payload, size_t payload_size,
+                         char *buffer, size_t buffer_size) {
+  /* The string, including its null byte, has to fit into the buffer. */
+  if ((payload_size == 0) || (payload_size > buffer_size) ||
+      (payload[payload_size - 1] != 0))
+    return -1;
+
+  memcpy(buffer, payload, payload_size);
+  return 0;
+} /* int putbin_string */
+
+/* Decodes "values_num" types and values. The caller has checked the size of
+ * the payload. */
+static int putbin_values(uint8_t const *payload, size_t values_num,
+                         value_t *values) {
+  uint8_t const *types = payload;
+  uint8_t const *raw = payload + values_num;
+
+  for (size_t i = 0; i < values_num; i++) {
+    uint64_t tmp;
+    memcpy(&tmp, raw + i * sizeof(tmp), sizeof(tmp));
+
+    switch (types[i]) {
+    case DS_TYPE_COUNTER:
+      values[i].counter = (counter_t)ntohll(tmp);
+      break;
+    case DS_TYPE_GAUGE: {
+      double d;
+      memcpy(&d, &tmp, sizeof(d));
+      values[i].gauge = (gauge_t)ntohd(d);
+      break;
+    }
+    case DS_TYPE_DERIVE:
+      values[i].derive = (derive_t)ntohll(tmp);
+      break;
+    case DS_TYPE_ABSOLUTE:
+      values[i].absolute = (absolute_t)ntohll(tmp);
+      break;
+    default:
+      return -1;
+    }
+  }
+
+  return 0;
+} /* int putbin_values */
+
+cmd_status_t cmd_parse_putbin(void const *data, size_t data_size,
+                              cmd_values_callback_t callback, void *user_data,
+                              size_t *ret_vl_num, cmd_error_handler_t *err) {
+  uint8_t const *buffer = data;
+  value_list_t vl = VALUE_LIST_INIT;
+  size_t vl_num = 0;
+  cmd_status_t status = CMD_OK;
+
+  while ((data_size > 0) && (status == CMD_OK)) {
+    if (data_size < PUTBIN_HEADER_SIZE) {
+      cmd_error(CMD_PARSE_ERROR, err, "Truncated part header.");
+      status = CMD_PARSE_ERROR;
+      break;
+    }
+
+    uint16_t type = putbin_uint16(buffer);
+    size_t part_size = (size_t)putbin_uint16(buffer + 2);
+    if ((part_size < PUTBIN_HEADER_SIZE) || (part_size > data_size)) {
+      cmd_error(CMD_PARSE_ERROR, err,
+                "Invalid size of part 0x%04" PRIx16 ": %" PRIsz " bytes.",
+                type, part_size);
+      status = CMD_PARSE_ERROR;
+      break;
+    }
+
+    uint8_t const *payload = buffer + PUTBIN_HEADER_SIZE;
+    size_t payload_size = part_size - PUTBIN_HEADER_SIZE;
+    buffer += part_size;
+    data_size -= part_size;
+
+    int failed = 0;
+    uint64_t number = 0;
+    switch (type) {
+    case TYPE_HOST:
+      failed = putbin_string(payload, payload_size, vl.host, sizeof(vl.host));
+      break;
+    case TYPE_PLUGIN:
+      failed =
+          putbin_string(payload, payload_size, vl.plugin, sizeof(vl.plugin));
+      break;
+    case TYPE_PLUGIN_INSTANCE:
+      failed = putbin_string(payload, payload_size, vl.plugin_instance,
+                             sizeof(vl.plugin_instance));
+      break;
+    case TYPE_TYPE:
+      failed = putbin_string(payload, payload_size, vl.type, sizeof(vl.type));
+      break;
+    case TYPE_TYPE_INSTANCE:
+      failed = putbin_string(payload, payload_size, vl.type_instance,
+                             sizeof(vl.type_instance));
+      break;
+    case TYPE_TIME:
+      failed = putbin_number(payload, payload_size, &number);
+      vl.time = TIME_T_TO_CDTIME_T(number);
+      break;
+    case TYPE_TIME_HR:
+      failed = putbin_number(payload, payload_size, &number);
+      vl.time = (cdtime_t)number;
+      break;
+    case TYPE_INTERVAL:
+      failed = putbin_number(payload, payload_size, &number);
+      vl.interval = TIME_T_TO_CDTIME_T(number);
+      break;
+    case TYPE_INTERVAL_HR:
+      failed = putbin_number(payload, payload_size, &number);
+      vl.interval = (cdtime_t)number;
+      break;
+    case TYPE_VALUES: {
+      size_t values_num = (payload_size >= 2) ? putbin_uint16(payload) : 0;
+      if ((values_num == 0) ||
+          (payload_size != 2 + values_num * (1 + sizeof(value_t)))) {
+        failed = 1;
+        break;
+      }
+
+      value_t values[values_num];
+      if (putbin_values(payload + 2, values_num, values) != 0) {
+        failed = 1;
+        break;
+      }
+
+      vl.values = values;
+      vl.values_len = values_num;
+      if (callback(&vl, user_data) != 0) {
+        cmd_error(CMD_ERROR, err, "Handling value list %" PRIsz " failed.",
+                  vl_num);
+        status = CMD_ERROR;
+      } else {
+        vl_num++;
+      }
+      vl.values = NULL;
+      vl.values_len = 0;
+      break;
+    }
+    case TYPE_ENCR_AES256:
+      cmd_error(CMD_PARSE_ERROR, err, "Encrypted parts are not supported.");
+      status = CMD_PARSE_ERROR;
+      break;
+    default:
+      /* Signatures, notifications and unknown parts are skipped. */
+      break;
+    }
+
+    if (failed) {
+      cmd_error(CMD_PARSE_ERROR, err, "Malformed part 0x%04" PRIx16 ".", type);
+      status = CMD_PARSE_ERROR;
+    }
+  }
+
+  if (ret_vl_num != NULL)
+    *ret_vl_num = vl_num;
+  return status;
+} /* cmd_status_t cmd_parse_putbin */
+
+static int putbin_dispatch(value_list_t const *vl,
+                           void __attribute__((unused)) * user_data) {
+  /* Like PUTVAL, failures to dispatch are only logged by the daemon. */
+  plugin_dispatch_values(vl);
+  return 0;
+} /* int putbin_dispatch */
+
+cmd_status_t cmd_handle_putbin(void const *data, size_t data_size,
+                               size_t *ret_vl_num, cmd_error_handler_t *err) {
+  return cmd_parse_putbin(data, data_size, putbin_dispatch, NULL, ret_vl_num,
+                          err);
+} /* cmd_status_t cmd_handle_putbin */
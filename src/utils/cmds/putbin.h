@@ -0,0 +1,64 @@
+/**
+ * collectd - src/utils/cmds/putbin.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#ifndef UTILS_CMD_PUTBIN_H
+#define UTILS_CMD_PUTBIN_H 1
+
+#include "plugin.h"
+#include "utils/cmds/cmds.h"
+
+/*
+ * NAME
+ *   cmd_parse_putbin
+ *
+ * DESCRIPTION
+ *   Parses a packet in the binary protocol of the network plugin, as created
+ *   by lcc_network_buffer_add_value(), and calls "callback" for each value
+ *   list. The packet is parsed in place, without allocating memory.
+ *   Signatures are ignored and encrypted parts are rejected, notifications are
+ *   skipped.
+ *
+ * RETURN VALUE
+ *   CMD_OK on success, CMD_PARSE_ERROR if the packet is malformed and
+ *   CMD_ERROR if "callback" failed. The number of value lists passed to
+ *   "callback" is stored in "ret_vl_num", if not NULL.
+ */
+cmd_status_t cmd_parse_putbin(void const *data, size_t data_size,
+                              cmd_values_callback_t callback, void *user_data,
+                              size_t *ret_vl_num, cmd_error_handler_t *err);
+
+/*
+ * NAME
+ *   cmd_handle_putbin
+ *
+ * DESCRIPTION
+ *   Parses a packet like cmd_parse_putbin() and dispatches the value lists
+ *   using plugin_dispatch_values().
+ */
+cmd_status_t cmd_handle_putbin(void const *data, size_t data_size,
+                               size_t *ret_vl_num, cmd_error_handler_t *err);
+
+#endif /* UTILS_CMD_PUTBIN_H */
@@ -91,6 +91,282 @@ static int set_option(value_list_t *vl, const char *key, const char *value,
   return CMD_OK;
 } /* int set_option */
 
+/*
+ * Helpers of cmd_parse_putval_fast(). They work on the unmodified line and
+ * return NULL for anything they don't handle exactly like the generic parser,
+ * which is then used instead.
+ */
+
+/* Maximum number of value lists cmd_parse_putval_fast() handles per line. */
+#define PUTVAL_FAST_VL_MAX 16
+/* Times from this number of seconds on don't fit into cdtime_t. */
+#define PUTVAL_FAST_TIME_MAX 17179869184.0
+
+static bool putval_is_space(char c) { return isspace((int)(unsigned char)c); }
+
+static bool putval_is_digit(char c) { return (c >= '0') && (c <= '9'); }
+
+/* Returns true if "c" ends a number within a value list. */
+static bool putval_is_end(char c) {
+  return (c == 0) || (c == ':') || putval_is_space(c);
+}
+
+/* Parses decimal numbers with at most 15 significant digits and a small
+ * exponent, which is what collectd and most scripts print. These are converted
+ * exactly, because both the mantissa and the power of ten are exact doubles
+ * (Clinger's fast path). */
+static char const *putval_parse_double(char const *ptr, double *ret) {
+  static double const powers_of_ten[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  bool negative = false;
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool have_digits = false;
+
+  if ((*ptr == '-') || (*ptr == '+')) {
+    negative = (*ptr == '-');
+    ptr++;
+  }
+
+  for (; putval_is_digit(*ptr); ptr++) {
+    have_digits = true;
+    if ((mantissa == 0) && (*ptr == '0'))
+      continue;
+    if (++digits > 15)
+      return NULL;
+    mantissa = 10 * mantissa + (uint64_t)(*ptr - '0');
+  }
+
+  if (*ptr == '.') {
+    for (ptr++; putval_is_digit(*ptr); ptr++) {
+      have_digits = true;
+      exponent--;
+      if ((mantissa == 0) && (*ptr == '0'))
+        continue;
+      if (++digits > 15)
+        return NULL;
+      mantissa = 10 * mantissa + (uint64_t)(*ptr - '0');
+    }
+  }
+
+  if (!have_digits)
+    return NULL;
+
+  if ((*ptr == 'e') || (*ptr == 'E')) {
+    bool exp_negative = false;
+    int exp_value = 0;
+    int exp_digits = 0;
+
+    ptr++;
+    if ((*ptr == '-') || (*ptr == '+')) {
+      exp_negative = (*ptr == '-');
+      ptr++;
+    }
+    for (; putval_is_digit(*ptr); ptr++) {
+      if (++exp_digits > 3)
+        return NULL;
+      exp_value = 10 * exp_value + (*ptr - '0');
+    }
+    if (exp_digits == 0)
+      return NULL;
+    exponent += exp_negative ? -exp_value : exp_value;
+  }
+
+  if (!putval_is_end(*ptr))
+    return NULL;
+
+  double value = (double)mantissa;
+  if (mantissa != 0) {
+    if ((exponent < -22) || (exponent > 22))
+      return NULL;
+    if (exponent < 0)
+      value /= powers_of_ten[-exponent];
+    else
+      value *= powers_of_ten[exponent];
+  }
+
+  *ret = negative ? -value : value;
+  return ptr;
+} /* char const *putval_parse_double */
+
+/* Parses decimal integers which fit into 63 bits. strtoll(3) and
+ * strtoull(3) are called with base zero by parse_value(), so leading zeros and
+ * hexadecimal numbers are left to them. */
+static char const *putval_parse_integer(char const *ptr, bool is_signed,
+                                        uint64_t *ret) {
+  bool negative = false;
+  uint64_t value = 0;
+  int digits = 0;
+
+  if ((*ptr == '-') && is_signed) {
+    negative = true;
+    ptr++;
+  } else if (*ptr == '+') {
+    ptr++;
+  }
+
+  if ((ptr[0] == '0') && !putval_is_end(ptr[1]))
+    return NULL;
+
+  for (; putval_is_digit(*ptr); ptr++) {
+    if (++digits > 18)
+      return NULL;
+    value = 10 * value + (uint64_t)(*ptr - '0');
+  }
+
+  if ((digits == 0) || !putval_is_end(*ptr))
+    return NULL;
+
+  *ret = negative ? (uint64_t)(-(int64_t)value) : value;
+  return ptr;
+} /* char const *putval_parse_integer */
+
+/* Parses "<time>:<value>[:<value>...]" with exactly as many values as the
+ * data set has data sources. */
+static char const *putval_parse_values(char const *ptr, value_list_t *vl,
+                                       const data_set_t *ds) {
+  if ((ptr[0] == 'N') && (ptr[1] == ':')) {
+    vl->time = cdtime();
+    ptr++;
+  } else {
+    double time = 0.0;
+    ptr = putval_parse_double(ptr, &time);
+    if ((ptr == NULL) || (*ptr != ':') || !(time > 0.0) ||
+        (time >= PUTVAL_FAST_TIME_MAX))
+      return NULL;
+    /* A time of zero makes parse_values() read the next field as time. */
+    vl->time = DOUBLE_TO_CDTIME_T(time);
+    if (vl->time == 0)
+      return NULL;
+  }
+
+  for (size_t i = 0; i < ds->ds_num; i++) {
+    if (*ptr != ':')
+      return NULL;
+    ptr++;
+
+    int type = ds->ds[i].type;
+    if ((ptr[0] == 'U') && putval_is_end(ptr[1])) {
+      if (type != DS_TYPE_GAUGE)
+        return NULL;
+      vl->values[i].gauge = NAN;
+      ptr++;
+      continue;
+    }
+
+    uint64_t tmp = 0;
+    switch (type) {
+    case DS_TYPE_GAUGE:
+      ptr = putval_parse_double(ptr, &vl->values[i].gauge);
+      break;
+    case DS_TYPE_DERIVE:
+      ptr = putval_parse_integer(ptr, /* is_signed = */ true, &tmp);
+      vl->values[i].derive = (derive_t)tmp;
+      break;
+    case DS_TYPE_COUNTER:
+      ptr = putval_parse_integer(ptr, /* is_signed = */ false, &tmp);
+      vl->values[i].counter = (counter_t)tmp;
+      break;
+    case DS_TYPE_ABSOLUTE:
+      ptr = putval_parse_integer(ptr, /* is_signed = */ false, &tmp);
+      vl->values[i].absolute = (absolute_t)tmp;
+      break;
+    default:
+      return NULL;
+    }
+    if (ptr == NULL)
+      return NULL;
+  }
+
+  return putval_is_space(*ptr) || (*ptr == 0) ? ptr : NULL;
+} /* char const *putval_parse_values */
+
+/* Copies the "len" bytes at "ptr" into "buffer", if they fit. */
+static int putval_copy(char *buffer, size_t buffer_size, char const *ptr,
+                       size_t len) {
+  if (len >= buffer_size)
+    return -1;
+  memcpy(buffer, ptr, len);
+  buffer[len] = 0;
+  return 0;
+} /* int putval_copy */
+
+/* Splits "<name>[-<instance>]" at the first hyphen, like parse_identifier(). */
+static int putval_copy_pair(char *name, size_t name_size, char *instance,
+                            size_t instance_size, char const *ptr, size_t len) {
+  char const *hyphen = memchr(ptr, '-', len);
+  if (hyphen == NULL)
+    return putval_copy(name, name_size, ptr, len);
+
+  size_t name_len = (size_t)(hyphen - ptr);
+  if ((putval_copy(name, name_size, ptr, name_len) != 0) ||
+      (putval_copy(instance, instance_size, hyphen + 1,
+                   len - name_len - 1) != 0))
+    return -1;
+  return 0;
+} /* int putval_copy_pair */
+
+/* Parses the identifier the same way as parse_identifier(). */
+static int putval_parse_identifier(char const *ptr, size_t len,
+                                   value_list_t *vl,
+                                   const cmd_options_t *opts) {
+  char const *end = ptr + len;
+  char const *plugin;
+  char const *type;
+
+  char const *slash = memchr(ptr, '/', len);
+  if (slash == NULL)
+    return -1;
+
+  char const *slash2 = memchr(slash + 1, '/', (size_t)(end - slash - 1));
+  if (slash2 == NULL) {
+    if ((opts == NULL) || (opts->identifier_default_host == NULL))
+      return -1;
+    if (putval_copy(vl->host, sizeof(vl->host), opts->identifier_default_host,
+                    strlen(opts->identifier_default_host)) != 0)
+      return -1;
+    plugin = ptr;
+    type = slash + 1;
+  } else {
+    if (putval_copy(vl->host, sizeof(vl->host), ptr, (size_t)(slash - ptr)) !=
+        0)
+      return -1;
+    plugin = slash + 1;
+    slash = slash2;
+    type = slash2 + 1;
+  }
+
+  if ((putval_copy_pair(vl->plugin, sizeof(vl->plugin), vl->plugin_instance,
+                        sizeof(vl->plugin_instance), plugin,
+                        (size_t)(slash - plugin)) != 0) ||
+      (putval_copy_pair(vl->type, sizeof(vl->type), vl->type_instance,
+                        sizeof(vl->type_instance), type,
+                        (size_t)(end - type)) != 0))
+    return -1;
+
+  return 0;
+} /* int putval_parse_identifier */
+
+/* Returns the length of the token starting at "ptr", or zero if the token
+ * needs the quoting rules of the generic parser. */
+static size_t putval_token_len(char const *ptr) {
+  size_t len = 0;
+  while ((ptr[len] != 0) && !putval_is_space(ptr[len])) {
+    if ((ptr[len] == '"') || (ptr[len] == '\\'))
+      return 0;
+    len++;
+  }
+  return len;
+} /* size_t putval_token_len */
+
+static int putval_dispatch(value_list_t const *vl,
+                           void __attribute__((unused)) * user_data) {
+  plugin_dispatch_values(vl);
+  return 0;
+} /* int putval_dispatch */
+
 /*
  * public API
  */
@@ -255,6 +531,102 @@ cmd_status_t cmd_parse_putval(size_t argc, char **argv,
   return result;
 } /* cmd_status_t cmd_parse_putval */
 
+cmd_status_t cmd_parse_putval_fast(char const *buffer,
+                                   const cmd_options_t *opts,
+                                   cmd_values_callback_t callback,
+                                   void *user_data, size_t *ret_vl_num) {
+  value_list_t vl = VALUE_LIST_INIT;
+  /* The value lists of one line only differ in these. */
+  cdtime_t times[PUTVAL_FAST_VL_MAX];
+  cdtime_t intervals[PUTVAL_FAST_VL_MAX];
+  size_t vl_num = 0;
+
+  if (buffer == NULL)
+    return CMD_UNSUPPORTED;
+
+  char const *ptr = buffer;
+  while (putval_is_space(*ptr))
+    ptr++;
+  size_t len = putval_token_len(ptr);
+  if ((len != strlen("PUTVAL")) || (strncasecmp(ptr, "PUTVAL", len) != 0))
+    return CMD_UNSUPPORTED;
+  ptr += len;
+
+  while (putval_is_space(*ptr))
+    ptr++;
+  len = putval_token_len(ptr);
+  if ((len == 0) || (putval_parse_identifier(ptr, len, &vl, opts) != 0))
+    return CMD_UNSUPPORTED;
+  ptr += len;
+
+  const data_set_t *ds = plugin_get_ds(vl.type);
+  if (ds == NULL)
+    return CMD_UNSUPPORTED;
+
+  value_t values[PUTVAL_FAST_VL_MAX * ds->ds_num];
+
+  while (42) {
+    while (putval_is_space(*ptr))
+      ptr++;
+    if (*ptr == 0)
+      break;
+
+    len = putval_token_len(ptr);
+    if (len == 0)
+      return CMD_UNSUPPORTED;
+
+    if (strncasecmp(ptr, "interval=", strlen("interval=")) == 0) {
+      double interval = 0.0;
+      char const *end =
+          putval_parse_double(ptr + strlen("interval="), &interval);
+      if ((end == NULL) || (end != ptr + len) ||
+          (interval >= PUTVAL_FAST_TIME_MAX))
+        return CMD_UNSUPPORTED;
+      /* Like set_option(), ignore intervals which aren't positive. */
+      if (interval > 0.0)
+        vl.interval = DOUBLE_TO_CDTIME_T(interval);
+      ptr += len;
+      continue;
+    } else if (memchr(ptr, '=', len) != NULL) {
+      return CMD_UNSUPPORTED;
+    }
+
+    if (vl_num >= PUTVAL_FAST_VL_MAX)
+      return CMD_UNSUPPORTED;
+
+    vl.values = values + vl_num * ds->ds_num;
+    vl.values_len = ds->ds_num;
+    char const *end = putval_parse_values(ptr, &vl, ds);
+    if (end != ptr + len)
+      return CMD_UNSUPPORTED;
+
+    times[vl_num] = vl.time;
+    intervals[vl_num] = vl.interval;
+    vl_num++;
+    ptr += len;
+  }
+
+  /* Like the generic parser, a line needs at least one value list. */
+  if (vl_num == 0)
+    return CMD_UNSUPPORTED;
+
+  cmd_status_t status = CMD_OK;
+  size_t i;
+  for (i = 0; i < vl_num; i++) {
+    vl.values = values + i * ds->ds_num;
+    vl.time = times[i];
+    vl.interval = intervals[i];
+    if (callback(&vl, user_data) != 0) {
+      status = CMD_ERROR;
+      break;
+    }
+  }
+
+  if (ret_vl_num != NULL)
+    *ret_vl_num = i;
+  return status;
+} /* cmd_status_t cmd_parse_putval_fast */
+
 void cmd_destroy_putval(cmd_putval_t *putval) {
   if (putval == NULL)
     return;
@@ -280,6 +652,15 @@ cmd_status_t cmd_handle_putval(FILE *fh, char *buffer) {
   DEBUG("utils_cmd_putval: cmd_handle_putval (fh = %p, buffer = %s);",
         (void *)fh, buffer);
 
+  size_t vl_num = 0;
+  if (cmd_parse_putval_fast(buffer, NULL, putval_dispatch, NULL, &vl_num) ==
+      CMD_OK) {
+    if (fh != stdout)
+      cmd_error(CMD_OK, &err, "Success: %i %s been dispatched.", (int)vl_num,
+                (vl_num == 1) ? "value has" : "values have");
+    return CMD_OK;
+  }
+
   if ((status = cmd_parse(buffer, &cmd, NULL, &err)) != CMD_OK)
     return status;
   if (cmd.type != CMD_PUTVAL) {
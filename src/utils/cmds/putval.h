@@ -37,6 +37,28 @@ cmd_status_t cmd_parse_putval(size_t argc, char **argv,
                               const cmd_options_t *opts,
                               cmd_error_handler_t *err);
 
+/*
+ * NAME
+ *   cmd_parse_putval_fast
+ *
+ * DESCRIPTION
+ *   Parses a complete PUTVAL line, including the command, in a single pass
+ *   without modifying it or allocating memory, and calls "callback" for each
+ *   value list once the whole line has been parsed. Only the common case is
+ *   handled: no quoting, no options other than "interval", numbers in plain
+ *   decimal notation and exactly one value per data source.
+ *
+ * RETURN VALUE
+ *   CMD_OK on success and CMD_ERROR if "callback" failed. The number of value
+ *   lists passed to "callback" is stored in "ret_vl_num", if not NULL.
+ *   CMD_UNSUPPORTED if the line, valid or not, has to be parsed by cmd_parse()
+ *   instead. "callback" has not been called in that case.
+ */
+cmd_status_t cmd_parse_putval_fast(char const *buffer,
+                                   const cmd_options_t *opts,
+                                   cmd_values_callback_t callback,
+                                   void *user_data, size_t *ret_vl_num);
+
 cmd_status_t cmd_handle_putval(FILE *fh, char *buffer);
 
 void cmd_destroy_putval(cmd_putval_t *putval);
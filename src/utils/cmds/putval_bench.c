@@ -0,0 +1,150 @@
+/**
+ * collectd - src/utils/cmds/putval_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures how many PUTVAL lines per second the generic parser, cmd_parse(),
+ * and cmd_parse_putval_fast() parse. The corpus is generated to look like the
+ * output of exec plugin scripts: gauges with a few decimals, counters and
+ * multi-value types, with and without an "interval" option.
+ *
+ * Usage: bench_utils_cmds [number of lines] */
+
+#include "collectd.h"
+
+#include "utils/cmds/cmds.h"
+#include "utils/cmds/putval.h"
+#include "utils/common/common.h"
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+static int count_values(value_list_t const *vl, void *user_data) {
+  size_t *count = user_data;
+  *count += vl->values_len;
+  return 0;
+}
+
+/* Returns "lines_num" null-terminated lines, stored back to back. Their
+ * offsets are stored in "offsets". */
+static char *generate_corpus(size_t lines_num, size_t *offsets,
+                             size_t *ret_size) {
+  size_t size = lines_num * 128;
+  char *corpus = malloc(size);
+  size_t offset = 0;
+  unsigned int seed = 42;
+
+  for (size_t i = 0; i < lines_num; i++) {
+    int host = rand_r(&seed) % 100;
+    int instance = rand_r(&seed) % 16;
+    int time = 1700000000 + (int)i / 100;
+    char *line = corpus + offset;
+    int len;
+
+    offsets[i] = offset;
+
+    switch (i % 3) {
+    case 0:
+      len = snprintf(line, size - offset,
+                     "PUTVAL host%i.example.com/exec-%i/MAGIC_MIXED "
+                     "interval=10 %i:%.3f:%i:%i:%i",
+                     host, instance, time,
+                     (double)rand_r(&seed) / 1000.0, rand_r(&seed),
+                     rand_r(&seed), rand_r(&seed) % 1000);
+      break;
+    case 1:
+      len = snprintf(line, size - offset,
+                     "PUTVAL host%i.example.com/exec-%i/MAGIC-value "
+                     "%i.%03i:%i",
+                     host, instance, time, rand_r(&seed) % 1000,
+                     rand_r(&seed));
+      break;
+    default:
+      len = snprintf(line, size - offset,
+                     "PUTVAL host%i.example.com/exec-%i/MAGIC_MIXED "
+                     "%i:U:-%i:%i:0",
+                     host, instance, time, rand_r(&seed), rand_r(&seed));
+      break;
+    }
+    offset += (size_t)len + 1;
+  }
+
+  *ret_size = offset;
+  return corpus;
+}
+
+int main(int argc, char **argv) {
+  size_t lines_num = (argc > 1) ? (size_t)atol(argv[1]) : 1000000;
+  size_t *offsets = calloc(lines_num, sizeof(*offsets));
+  size_t corpus_size = 0;
+  char *corpus = generate_corpus(lines_num, offsets, &corpus_size);
+  char *copy = malloc(corpus_size);
+
+  /* The generic parser modifies the line, so it works on a copy. Copying is
+   * timed separately and subtracted. */
+  double start = now_seconds();
+  memcpy(copy, corpus, corpus_size);
+  double copy_time = now_seconds() - start;
+
+  size_t values = 0;
+  start = now_seconds();
+  for (size_t i = 0; i < lines_num; i++) {
+    char *line = copy + offsets[i];
+    cmd_t cmd;
+    if (cmd_parse(line, &cmd, NULL, NULL) != CMD_OK) {
+      fprintf(stderr, "cmd_parse(\"%s\") failed\n", line);
+      return 1;
+    }
+    for (size_t j = 0; j < cmd.cmd.putval.vl_num; j++)
+      values += cmd.cmd.putval.vl[j].values_len;
+    cmd_destroy(&cmd);
+  }
+  double elapsed = now_seconds() - start + copy_time;
+  printf("cmd_parse             %10.0f lines/s %8.1f MB/s (%zu values)\n",
+         (double)lines_num / elapsed, (double)corpus_size / elapsed / 1e6,
+         values);
+
+  values = 0;
+  start = now_seconds();
+  for (size_t i = 0; i < lines_num; i++) {
+    char const *line = corpus + offsets[i];
+    if (cmd_parse_putval_fast(line, NULL, count_values, &values, NULL) !=
+        CMD_OK) {
+      fprintf(stderr, "cmd_parse_putval_fast(\"%s\") failed\n", line);
+      return 1;
+    }
+  }
+  elapsed = now_seconds() - start;
+  printf("cmd_parse_putval_fast %10.0f lines/s %8.1f MB/s (%zu values)\n",
+         (double)lines_num / elapsed, (double)corpus_size / elapsed / 1e6,
+         values);
+
+  free(copy);
+  free(corpus);
+  free(offsets);
+  return 0;
+}
@@ -0,0 +1,275 @@
+/**
+ * collectd - src/utils/cmds/queryval.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "plugin.h"
+#include "utils/common/common.h"
+
+#include "utils/cmds/queryval.h"
+#include "utils_cache.h"
+
+#if HAVE_FNMATCH_H
+#include <fnmatch.h>
+#endif /* HAVE_FNMATCH_H */
+#include <regex.h>
+
+#define QUERYVAL_FIELDS 5
+
+static char const *const queryval_keys[QUERYVAL_FIELDS] = {
+    "host", "plugin", "plugin_instance", "type", "type_instance",
+};
+
+typedef struct {
+  char const *pattern; /* NULL matches any value */
+  bool is_regex;
+  regex_t regex;
+} queryval_match_t;
+
+static char **queryval_field(identifier_t *ident, size_t index) {
+  switch (index) {
+  case 0:
+    return &ident->host;
+  case 1:
+    return &ident->plugin;
+  case 2:
+    return &ident->plugin_instance;
+  case 3:
+    return &ident->type;
+  default:
+    return &ident->type_instance;
+  }
+} /* char **queryval_field */
+
+static bool queryval_is_regex(char const *pattern) {
+  size_t len = strlen(pattern);
+  return (len >= 2) && (pattern[0] == '/') && (pattern[len - 1] == '/');
+} /* bool queryval_is_regex */
+
+cmd_status_t cmd_parse_queryval(size_t argc, char **argv,
+                                cmd_queryval_t *ret_queryval,
+                                const cmd_options_t *opts
+                                __attribute__((unused)),
+                                cmd_error_handler_t *err) {
+  if (ret_queryval == NULL) {
+    errno = EINVAL;
+    cmd_error(CMD_ERROR, err, "Invalid arguments to cmd_parse_queryval.");
+    return CMD_ERROR;
+  }
+
+  for (size_t i = 0; i < argc; i++) {
+    char *key = NULL;
+    char *value = NULL;
+
+    cmd_status_t status = cmd_parse_option(argv[i], &key, &value, err);
+    if (status != CMD_OK) {
+      if (status == CMD_NO_OPTION)
+        cmd_error(CMD_PARSE_ERROR, err, "Invalid option string `%s'.",
+                  argv[i]);
+      cmd_destroy_queryval(ret_queryval);
+      return CMD_PARSE_ERROR;
+    }
+
+    char **field = NULL;
+    for (size_t j = 0; j < QUERYVAL_FIELDS; j++)
+      if (strcasecmp(queryval_keys[j], key) == 0)
+        field = queryval_field(&ret_queryval->pattern, j);
+
+    if (field == NULL) {
+      cmd_error(CMD_PARSE_ERROR, err, "Invalid option `%s'.", key);
+      cmd_destroy_queryval(ret_queryval);
+      return CMD_PARSE_ERROR;
+    }
+    if (*field != NULL) {
+      cmd_error(CMD_PARSE_ERROR, err, "Option `%s' given more than once.",
+                key);
+      cmd_destroy_queryval(ret_queryval);
+      return CMD_PARSE_ERROR;
+    }
+
+    if (queryval_is_regex(value)) {
+      /* Only check the syntax here, see cmd_handle_queryval(). */
+      regex_t re;
+      char *tmp = sstrndup(value + 1, strlen(value) - 2);
+      int re_status = regcomp(&re, tmp, REG_EXTENDED | REG_NOSUB);
+      sfree(tmp);
+      if (re_status != 0) {
+        cmd_error(CMD_PARSE_ERROR, err, "Invalid regular expression `%s'.",
+                  value);
+        cmd_destroy_queryval(ret_queryval);
+        return CMD_PARSE_ERROR;
+      }
+      regfree(&re);
+    }
+
+    *field = sstrdup(value);
+  }
+
+  return CMD_OK;
+} /* cmd_status_t cmd_parse_queryval */
+
+static bool queryval_match(queryval_match_t const *m, char const *value) {
+  if (m->pattern == NULL)
+    return true;
+  if (m->is_regex)
+    return regexec(&m->regex, value, 0, NULL, 0) == 0;
+#if HAVE_FNMATCH_H
+  return fnmatch(m->pattern, value, 0) == 0;
+#else
+  return strcmp(m->pattern, value) == 0;
+#endif
+} /* bool queryval_match */
+
+/* Called by the cache for each entry, see uc_get_iterator_filtered(). */
+static bool queryval_filter(identifier_t const *ident, void *user_data) {
+  queryval_match_t const *m = user_data;
+
+  return queryval_match(m + 0, ident->host) &&
+         queryval_match(m + 1, ident->plugin) &&
+         queryval_match(m + 2, ident->plugin_instance) &&
+         queryval_match(m + 3, ident->type) &&
+         queryval_match(m + 4, ident->type_instance);
+} /* bool queryval_filter */
+
+static void queryval_match_destroy(queryval_match_t *m) {
+  for (size_t i = 0; i < QUERYVAL_FIELDS; i++)
+    if (m[i].is_regex)
+      regfree(&m[i].regex);
+} /* void queryval_match_destroy */
+
+static int queryval_match_init(queryval_match_t *m, cmd_queryval_t *q) {
+  memset(m, 0, QUERYVAL_FIELDS * sizeof(*m));
+
+  for (size_t i = 0; i < QUERYVAL_FIELDS; i++) {
+    char const *pattern = *queryval_field(&q->pattern, i);
+    m[i].pattern = pattern;
+    if ((pattern == NULL) || !queryval_is_regex(pattern))
+      continue;
+
+    char *tmp = sstrndup(pattern + 1, strlen(pattern) - 2);
+    int status = regcomp(&m[i].regex, tmp, REG_EXTENDED | REG_NOSUB);
+    sfree(tmp);
+    if (status != 0) {
+      queryval_match_destroy(m);
+      return status;
+    }
+    m[i].is_regex = true;
+  }
+
+  return 0;
+} /* int queryval_match_init */
+
+/* Does not flush, so that large responses are written in few system calls. */
+#define print_to_socket(fh, ...)                                               \
+  do {                                                                         \
+    if (fprintf(fh, __VA_ARGS__) < 0) {                                        \
+      WARNING("cmd_handle_queryval: failed to write to socket #%i: %s",        \
+              fileno(fh), STRERRNO);                                           \
+      status = CMD_ERROR;                                                      \
+      goto out;                                                                \
+    }                                                                          \
+  } while (0)
+
+cmd_status_t cmd_handle_queryval(FILE *fh, char *buffer) {
+  cmd_error_handler_t err = {cmd_error_fh, fh};
+  cmd_status_t status;
+  cmd_t cmd;
+
+  if ((fh == NULL) || (buffer == NULL))
+    return -1;
+
+  DEBUG("utils_cmd_queryval: cmd_handle_queryval (fh = %p, buffer = %s);",
+        (void *)fh, buffer);
+
+  if ((status = cmd_parse(buffer, &cmd, NULL, &err)) != CMD_OK)
+    return status;
+  if (cmd.type != CMD_QUERYVAL) {
+    cmd_error(CMD_UNKNOWN_COMMAND, &err, "Unexpected command: `%s'.",
+              CMD_TO_STRING(cmd.type));
+    cmd_destroy(&cmd);
+    return CMD_UNKNOWN_COMMAND;
+  }
+
+  queryval_match_t match[QUERYVAL_FIELDS];
+  if (queryval_match_init(match, &cmd.cmd.queryval) != 0) {
+    cmd_error(CMD_ERROR, &err, "Compiling the patterns failed.");
+    cmd_destroy(&cmd);
+    return CMD_ERROR;
+  }
+
+  /* The patterns are evaluated against the fields stored in the cache; the
+   * names are neither formatted nor parsed. */
+  uc_iter_t *iter = uc_get_iterator_filtered(queryval_filter, match);
+  if (iter == NULL) {
+    cmd_error(CMD_ERROR, &err, "Querying the cache failed.");
+    queryval_match_destroy(match);
+    cmd_destroy(&cmd);
+    return CMD_ERROR;
+  }
+
+  queryval_match_destroy(match);
+  cmd_destroy(&cmd);
+
+  status = CMD_OK;
+  size_t number = uc_iterator_size(iter);
+  print_to_socket(fh, "%" PRIsz " Value%s found\n", number,
+                  (number == 1) ? "" : "s");
+
+  char *name = NULL;
+  while (uc_iterator_next(iter, &name) == 0) {
+    cdtime_t t = 0;
+    gauge_t const *rates = NULL;
+    size_t rates_num = 0;
+
+    if ((uc_iterator_get_time(iter, &t) != 0) ||
+        (uc_iterator_get_rates(iter, &rates, &rates_num) != 0)) {
+      status = CMD_ERROR;
+      goto out;
+    }
+
+    print_to_socket(fh, "%.3f", CDTIME_T_TO_DOUBLE(t));
+    for (size_t i = 0; i < rates_num; i++) {
+      if (isnan(rates[i]))
+        print_to_socket(fh, ":NaN");
+      else
+        print_to_socket(fh, ":" GAUGE_FORMAT, rates[i]);
+    }
+    print_to_socket(fh, " %s\n", name);
+  }
+
+out:
+  uc_iterator_destroy(iter);
+  fflush(fh);
+  return status;
+} /* cmd_status_t cmd_handle_queryval */
+
+void cmd_destroy_queryval(cmd_queryval_t *queryval) {
+  if (queryval == NULL)
+    return;
+
+  for (size_t i = 0; i < QUERYVAL_FIELDS; i++)
+    sfree(*queryval_field(&queryval->pattern, i));
+} /* void cmd_destroy_queryval */
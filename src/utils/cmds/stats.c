@@ -0,0 +1,171 @@
+/**
+ * collectd - src/utils/cmds/stats.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "plugin.h"
+#include "utils/common/common.h"
+
+#include "utils/cmds/cmds.h"
+#include "utils/cmds/parse_option.h" /* for `parse_string' */
+#include "utils/cmds/stats.h"
+
+typedef struct {
+  char **lines;
+  size_t lines_num;
+  size_t lines_size;
+  int status;
+} stats_lines_t;
+
+/* Formats one statistic as "identifier=value". The identifier contains the
+ * names of plugins and callbacks and is quoted like the identifiers of PUTVAL
+ * if necessary. */
+static void stats_format(value_list_t const *vl, void *user_data) /* {{{ */
+{
+  stats_lines_t *sl = user_data;
+  char name[6 * DATA_MAX_NAME_LEN];
+  char value[64];
+
+  if (sl->status != 0)
+    return;
+
+  if (vl->host[0] == 0) {
+    value_list_t copy = *vl;
+    sstrncpy(copy.host, hostname_g, sizeof(copy.host));
+    FORMAT_VL(name, sizeof(name), &copy);
+  } else {
+    FORMAT_VL(name, sizeof(name), vl);
+  }
+  escape_string(name, sizeof(name));
+
+  const data_set_t *ds = plugin_get_ds(vl->type);
+  if ((ds == NULL) || (ds->ds_num != 1) || (vl->values_len != 1))
+    return;
+
+  switch (ds->ds[0].type) {
+  case DS_TYPE_GAUGE:
+    snprintf(value, sizeof(value), GAUGE_FORMAT, vl->values[0].gauge);
+    break;
+  case DS_TYPE_DERIVE:
+    snprintf(value, sizeof(value), "%" PRIi64, vl->values[0].derive);
+    break;
+  case DS_TYPE_COUNTER:
+    snprintf(value, sizeof(value), "%llu", vl->values[0].counter);
+    break;
+  case DS_TYPE_ABSOLUTE:
+    snprintf(value, sizeof(value), "%" PRIu64, vl->values[0].absolute);
+    break;
+  default:
+    return;
+  }
+
+  if (sl->lines_num == sl->lines_size) {
+    size_t new_size = (sl->lines_size > 0) ? 2 * sl->lines_size : 64;
+    char **tmp = realloc(sl->lines, new_size * sizeof(*sl->lines));
+    if (tmp == NULL) {
+      sl->status = ENOMEM;
+      return;
+    }
+    sl->lines = tmp;
+    sl->lines_size = new_size;
+  }
+
+  size_t line_size = strlen(name) + strlen(value) + 2;
+  char *line = malloc(line_size);
+  if (line == NULL) {
+    sl->status = ENOMEM;
+    return;
+  }
+  snprintf(line, line_size, "%s=%s", name, value);
+  sl->lines[sl->lines_num++] = line;
+} /* }}} void stats_format */
+
+/* Prints the statistics and stops at the first line that cannot be written. */
+static int stats_print(FILE *fh, stats_lines_t const *sl) /* {{{ */
+{
+  int status = fprintf(fh, "%" PRIsz " Statistics found\n", sl->lines_num);
+
+  for (size_t i = 0; (status >= 0) && (i < sl->lines_num); i++)
+    status = fprintf(fh, "%s\n", sl->lines[i]);
+
+  if (status < 0) {
+    WARNING("handle_stats: failed to write to socket #%i: %s", fileno(fh),
+            STRERRNO);
+    return -1;
+  }
+
+  return 0;
+} /* }}} int stats_print */
+
+cmd_status_t cmd_handle_stats(FILE *fh, char *buffer) /* {{{ */
+{
+  cmd_error_handler_t err = {cmd_error_fh, fh};
+  char *command = NULL;
+  cmd_status_t status = CMD_OK;
+
+  if ((fh == NULL) || (buffer == NULL))
+    return CMD_ERROR;
+
+  DEBUG("utils_cmd_stats: cmd_handle_stats (fh = %p, buffer = %s);",
+        (void *)fh, buffer);
+
+  if (parse_string(&buffer, &command) != 0) {
+    cmd_error(CMD_PARSE_ERROR, &err, "Cannot parse command.");
+    return CMD_PARSE_ERROR;
+  }
+  assert(command != NULL);
+
+  if (strcasecmp("STATS", command) != 0) {
+    cmd_error(CMD_UNKNOWN_COMMAND, &err, "Unexpected command: `%s'.", command);
+    return CMD_UNKNOWN_COMMAND;
+  }
+
+  if (*buffer != 0) {
+    cmd_error(CMD_PARSE_ERROR, &err, "Garbage after end of command: `%s'.",
+              buffer);
+    return CMD_PARSE_ERROR;
+  }
+
+  stats_lines_t sl = {.lines = NULL};
+
+  int read_status = plugin_stats_read(stats_format, &sl);
+  if (read_status == ENOTSUP) {
+    cmd_error(CMD_ERROR, &err, "Internal statistics are not collected. "
+                               "Enable CollectInternalStats.");
+    status = CMD_ERROR;
+  } else if ((read_status != 0) || (sl.status != 0)) {
+    cmd_error(CMD_ERROR, &err, "Reading the statistics failed.");
+    status = CMD_ERROR;
+  } else if (stats_print(fh, &sl) != 0) {
+    status = CMD_ERROR;
+  }
+
+  for (size_t i = 0; i < sl.lines_num; i++)
+    sfree(sl.lines[i]);
+  sfree(sl.lines);
+
+  return status;
+} /* }}} cmd_status_t cmd_handle_stats */
@@ -907,7 +907,8 @@ int format_values(char *ret, size_t ret_len, /* {{{ */
                   bool store_rates) {
   size_t offset = 0;
   int status;
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
+  bool have_rates = false;
 
   assert(0 == strcmp(ds->type, vl->type));
 
@@ -916,13 +917,11 @@ int format_values(char *ret, size_t ret_len, /* {{{ */
 #define BUFFER_ADD(...)                                                        \
   do {                                                                         \
     status = snprintf(ret + offset, ret_len - offset, __VA_ARGS__);            \
-    if (status < 1) {                                                          \
-      sfree(rates);                                                            \
+    if (status < 1)                                                            \
       return -1;                                                               \
-    } else if (((size_t)status) >= (ret_len - offset)) {                       \
-      sfree(rates);                                                            \
+    else if (((size_t)status) >= (ret_len - offset))                           \
       return -1;                                                               \
-    } else                                                                     \
+    else                                                                       \
       offset += ((size_t)status);                                              \
   } while (0)
 
@@ -932,11 +931,12 @@ int format_values(char *ret, size_t ret_len, /* {{{ */
     if (ds->ds[i].type == DS_TYPE_GAUGE)
       BUFFER_ADD(":" GAUGE_FORMAT, vl->values[i].gauge);
     else if (store_rates) {
-      if (rates == NULL)
-        rates = uc_get_rate(ds, vl);
-      if (rates == NULL) {
-        WARNING("format_values: uc_get_rate failed.");
-        return -1;
+      if (!have_rates) {
+        if (uc_get_rate_buffer(ds, vl, rates) != 0) {
+          WARNING("format_values: uc_get_rate_buffer failed.");
+          return -1;
+        }
+        have_rates = true;
       }
       BUFFER_ADD(":" GAUGE_FORMAT, rates[i]);
     } else if (ds->ds[i].type == DS_TYPE_COUNTER)
@@ -947,14 +947,12 @@ int format_values(char *ret, size_t ret_len, /* {{{ */
       BUFFER_ADD(":%" PRIu64, vl->values[i].absolute);
     else {
       ERROR("format_values: Unknown data source type: %i", ds->ds[i].type);
-      sfree(rates);
       return -1;
     }
   } /* for ds->ds_num */
 
 #undef BUFFER_ADD
 
-  sfree(rates);
   return 0;
 } /* }}} int format_values */
 
@@ -301,13 +301,14 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
   int status = 0;
   int buffer_pos = 0;
 
+  gauge_t rates_buffer[ds->ds_num];
   gauge_t *rates = NULL;
   if (flags & GRAPHITE_STORE_RATES) {
-    rates = uc_get_rate(ds, vl);
-    if (rates == NULL) {
-      P_ERROR("format_graphite: error with uc_get_rate");
+    if (uc_get_rate_buffer(ds, vl, rates_buffer) != 0) {
+      P_ERROR("format_graphite: error with uc_get_rate_buffer");
       return -1;
     }
+    rates = rates_buffer;
   }
 
   for (size_t i = 0; i < ds->ds_num; i++) {
@@ -326,7 +327,6 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
                                      postfix, escape_char, flags);
       if (status != 0) {
         P_ERROR("format_graphite: error with gr_format_name_tagged");
-        sfree(rates);
         return status;
       }
     } else {
@@ -334,7 +334,6 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
                               escape_char, flags);
       if (status != 0) {
         P_ERROR("format_graphite: error with gr_format_name");
-        sfree(rates);
         return status;
       }
     }
@@ -346,7 +345,6 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
     status = gr_format_values(values, sizeof(values), i, ds, vl, rates);
     if (status != 0) {
       P_ERROR("format_graphite: error with gr_format_values");
-      sfree(rates);
       return status;
     }
 
@@ -358,20 +356,17 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
       P_ERROR("format_graphite: message buffer too small: "
               "Need %" PRIsz " bytes.",
               message_len + 1);
-      sfree(rates);
       return -ENOMEM;
     }
 
     /* Append it in case we got multiple data set */
     if ((buffer_pos + message_len) >= buffer_size) {
       P_ERROR("format_graphite: target buffer too small");
-      sfree(rates);
       return -ENOMEM;
     }
     memcpy((void *)(buffer + buffer_pos), message, message_len);
     buffer_pos += message_len;
     buffer[buffer_pos] = '\0';
   }
-  sfree(rates);
   return status;
 } /* int format_graphite */
@@ -88,7 +88,8 @@ static int values_to_json(char *buffer, size_t buffer_size, /* {{{ */
                           const data_set_t *ds, const value_list_t *vl,
                           int store_rates) {
   size_t offset = 0;
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
+  bool have_rates = false;
 
   memset(buffer, 0, buffer_size);
 
@@ -96,13 +97,11 @@ static int values_to_json(char *buffer, size_t buffer_size, /* {{{ */
   do {                                                                         \
     int status;                                                                \
     status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1) {                                                          \
-      sfree(rates);                                                            \
+    if (status < 1)                                                            \
       return -1;                                                               \
-    } else if (((size_t)status) >= (buffer_size - offset)) {                   \
-      sfree(rates);                                                            \
+    else if (((size_t)status) >= (buffer_size - offset))                       \
       return -ENOMEM;                                                          \
-    } else                                                                     \
+    else                                                                       \
       offset += ((size_t)status);                                              \
   } while (0)
 
@@ -117,12 +116,12 @@ static int values_to_json(char *buffer, size_t buffer_size, /* {{{ */
       else
         BUFFER_ADD("null");
     } else if (store_rates) {
-      if (rates == NULL)
-        rates = uc_get_rate(ds, vl);
-      if (rates == NULL) {
-        WARNING("utils_format_json: uc_get_rate failed.");
-        sfree(rates);
-        return -1;
+      if (!have_rates) {
+        if (uc_get_rate_buffer(ds, vl, rates) != 0) {
+          WARNING("utils_format_json: uc_get_rate_buffer failed.");
+          return -1;
+        }
+        have_rates = true;
       }
 
       if (isfinite(rates[i]))
@@ -137,7 +136,6 @@ static int values_to_json(char *buffer, size_t buffer_size, /* {{{ */
       BUFFER_ADD("%" PRIu64, vl->values[i].absolute);
     else {
       ERROR("format_json: Unknown data source type: %i", ds->ds[i].type);
-      sfree(rates);
       return -1;
     }
   } /* for ds->ds_num */
@@ -145,7 +143,6 @@ static int values_to_json(char *buffer, size_t buffer_size, /* {{{ */
 
 #undef BUFFER_ADD
 
-  sfree(rates);
   return 0;
 } /* }}} int values_to_json */
 
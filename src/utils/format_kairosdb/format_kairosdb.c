@@ -96,7 +96,7 @@ static int values_to_kairosdb(char *buffer, size_t buffer_size, /* {{{ */
                               const data_set_t *ds, const value_list_t *vl,
                               int store_rates, size_t ds_idx) {
   size_t offset = 0;
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
 
   memset(buffer, 0, buffer_size);
 
@@ -104,13 +104,11 @@ static int values_to_kairosdb(char *buffer, size_t buffer_size, /* {{{ */
   do {                                                                         \
     int status;                                                                \
     status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1) {                                                          \
-      sfree(rates);                                                            \
+    if (status < 1)                                                            \
       return -1;                                                               \
-    } else if (((size_t)status) >= (buffer_size - offset)) {                   \
-      sfree(rates);                                                            \
+    else if (((size_t)status) >= (buffer_size - offset))                       \
       return -ENOMEM;                                                          \
-    } else                                                                     \
+    else                                                                       \
       offset += ((size_t)status);                                              \
   } while (0)
 
@@ -128,10 +126,9 @@ static int values_to_kairosdb(char *buffer, size_t buffer_size, /* {{{ */
       return -1;
     }
   } else if (store_rates) {
-    if (rates == NULL)
-      rates = uc_get_rate(ds, vl);
-    if (rates == NULL) {
-      WARNING("utils_format_kairosdb: uc_get_rate failed for %s|%s|%s|%s|%s",
+    if (uc_get_rate_buffer(ds, vl, rates) != 0) {
+      WARNING("utils_format_kairosdb: uc_get_rate_buffer failed for "
+              "%s|%s|%s|%s|%s",
               vl->plugin, vl->plugin_instance, vl->type, vl->type_instance,
               ds->ds[ds_idx].name);
 
@@ -147,7 +144,6 @@ static int values_to_kairosdb(char *buffer, size_t buffer_size, /* {{{ */
       WARNING("utils_format_kairosdb: invalid rates[ds_idx] for %s|%s|%s|%s|%s",
               vl->plugin, vl->plugin_instance, vl->type, vl->type_instance,
               ds->ds[ds_idx].name);
-      sfree(rates);
       return -1;
     }
   } else if (ds->ds[ds_idx].type == DS_TYPE_COUNTER) {
@@ -167,7 +163,6 @@ static int values_to_kairosdb(char *buffer, size_t buffer_size, /* {{{ */
     BUFFER_ADD("%" PRIu64, vl->values[ds_idx].absolute);
   } else {
     ERROR("format_kairosdb: Unknown data source type: %i", ds->ds[ds_idx].type);
-    sfree(rates);
     return -1;
   }
   BUFFER_ADD("]]");
@@ -175,7 +170,6 @@ static int values_to_kairosdb(char *buffer, size_t buffer_size, /* {{{ */
 #undef BUFFER_ADD
 
   DEBUG("format_kairosdb: values_to_kairosdb: buffer = %s;", buffer);
-  sfree(rates);
   return 0;
 } /* }}} int values_to_kairosdb */
 
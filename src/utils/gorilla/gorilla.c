@@ -0,0 +1,300 @@
+/**
+ * collectd - src/utils/gorilla/gorilla.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "utils/gorilla/gorilla.h"
+
+/* Bits needed for one value in the worst case: two control bits, the number
+ * of leading zeros, the number of meaningful bits and the bits themselves. */
+#define GORILLA_LEADING_BITS 5
+#define GORILLA_MEANINGFUL_BITS 6
+#define GORILLA_VALUE_BITS_MAX                                                 \
+  (2 + GORILLA_LEADING_BITS + GORILLA_MEANINGFUL_BITS + 64)
+#define GORILLA_LEADING_MAX ((1 << GORILLA_LEADING_BITS) - 1)
+
+typedef struct {
+  uint64_t prev;
+  /* Position of the meaningful bits of the previous XOR. `meaningful' is zero
+   * until the first non-zero XOR has been stored. */
+  uint8_t leading;
+  uint8_t meaningful;
+} gorilla_column_t;
+
+struct gorilla_s {
+  size_t columns;
+  size_t rows;
+
+  uint8_t *data;
+  size_t data_size; /* in bytes */
+  size_t bits;      /* number of bits used */
+
+  /* `columns' states for the encoder, followed by `columns' states for the
+   * decoder. */
+  gorilla_column_t state[];
+};
+
+static int leading_zeros(uint64_t v) {
+#if defined(__GNUC__)
+  return (v == 0) ? 64 : __builtin_clzll(v);
+#else
+  int n = 0;
+  for (uint64_t mask = UINT64_C(1) << 63; (mask != 0) && !(v & mask);
+       mask >>= 1)
+    n++;
+  return n;
+#endif
+} /* int leading_zeros */
+
+static int trailing_zeros(uint64_t v) {
+#if defined(__GNUC__)
+  return (v == 0) ? 64 : __builtin_ctzll(v);
+#else
+  int n = 0;
+  for (uint64_t mask = 1; (mask != 0) && !(v & mask); mask <<= 1)
+    n++;
+  return n;
+#endif
+} /* int trailing_zeros */
+
+static uint64_t gauge_to_bits(gauge_t v) {
+  uint64_t ret;
+  memcpy(&ret, &v, sizeof(ret));
+  return ret;
+} /* uint64_t gauge_to_bits */
+
+static gauge_t bits_to_gauge(uint64_t v) {
+  gauge_t ret;
+  memcpy(&ret, &v, sizeof(ret));
+  return ret;
+} /* gauge_t bits_to_gauge */
+
+/* Writes the `n' lowest bits of `v', most significant bit first. The buffer
+ * must be large enough and zeroed beyond `g->bits'. */
+static void write_bits(gorilla_t *g, uint64_t v, int n) {
+  while (n > 0) {
+    int used = (int)(g->bits % 8);
+    int take = (n < 8 - used) ? n : 8 - used;
+    uint8_t chunk = (uint8_t)((v >> (n - take)) & ((1u << take) - 1));
+
+    g->data[g->bits / 8] |= (uint8_t)(chunk << (8 - used - take));
+    g->bits += (size_t)take;
+    n -= take;
+  }
+} /* void write_bits */
+
+static uint64_t read_bits(gorilla_t const *g, size_t *pos, int n) {
+  uint64_t ret = 0;
+
+  while (n > 0) {
+    int used = (int)(*pos % 8);
+    int take = (n < 8 - used) ? n : 8 - used;
+    uint8_t byte = g->data[*pos / 8];
+
+    ret = (ret << take) | ((byte >> (8 - used - take)) & ((1u << take) - 1));
+    *pos += (size_t)take;
+    n -= take;
+  }
+
+  return ret;
+} /* uint64_t read_bits */
+
+static void encode_value(gorilla_t *g, gorilla_column_t *c, gauge_t value) {
+  uint64_t v = gauge_to_bits(value);
+  uint64_t xor = v ^ c->prev;
+  c->prev = v;
+
+  if (xor == 0) {
+    write_bits(g, 0, 1);
+    return;
+  }
+
+  int leading = leading_zeros(xor);
+  int trailing = trailing_zeros(xor);
+  if (leading > GORILLA_LEADING_MAX)
+    leading = GORILLA_LEADING_MAX;
+
+  /* Reuse the position of the previous XOR if the meaningful bits fit. */
+  if ((c->meaningful != 0) && (leading >= c->leading) &&
+      (trailing >= 64 - c->leading - c->meaningful)) {
+    write_bits(g, 2, 2);
+    write_bits(g, xor >> (64 - c->leading - c->meaningful), c->meaningful);
+    return;
+  }
+
+  int meaningful = 64 - leading - trailing;
+  write_bits(g, 3, 2);
+  write_bits(g, (uint64_t)leading, GORILLA_LEADING_BITS);
+  write_bits(g, (uint64_t)(meaningful - 1), GORILLA_MEANINGFUL_BITS);
+  write_bits(g, xor >> trailing, meaningful);
+
+  c->leading = (uint8_t)leading;
+  c->meaningful = (uint8_t)meaningful;
+} /* void encode_value */
+
+static gauge_t decode_value(gorilla_t const *g, size_t *pos,
+                            gorilla_column_t *c) {
+  if (read_bits(g, pos, 1) != 0) {
+    if (read_bits(g, pos, 1) != 0) {
+      c->leading = (uint8_t)read_bits(g, pos, GORILLA_LEADING_BITS);
+      c->meaningful = (uint8_t)(read_bits(g, pos, GORILLA_MEANINGFUL_BITS) + 1);
+    }
+
+    uint64_t xor = read_bits(g, pos, c->meaningful);
+    c->prev ^= xor << (64 - c->leading - c->meaningful);
+  }
+
+  return bits_to_gauge(c->prev);
+} /* gauge_t decode_value */
+
+gorilla_t *gorilla_create(size_t columns) {
+  if (columns == 0)
+    return NULL;
+
+  gorilla_t *g = calloc(1, sizeof(*g) + 2 * columns * sizeof(g->state[0]));
+  if (g == NULL)
+    return NULL;
+
+  g->columns = columns;
+  return g;
+} /* gorilla_t *gorilla_create */
+
+void gorilla_destroy(gorilla_t *g) {
+  if (g == NULL)
+    return;
+
+  free(g->data);
+  free(g);
+} /* void gorilla_destroy */
+
+int gorilla_append(gorilla_t *g, gauge_t const *values) {
+  if ((g == NULL) || (values == NULL))
+    return EINVAL;
+
+  size_t need = (g->bits + g->columns * GORILLA_VALUE_BITS_MAX + 7) / 8;
+  if (need > g->data_size) {
+    size_t size = (g->data_size == 0) ? 64 : g->data_size;
+    while (size < need)
+      size *= 2;
+
+    uint8_t *tmp = realloc(g->data, size);
+    if (tmp == NULL)
+      return ENOMEM;
+    memset(tmp + g->data_size, 0, size - g->data_size);
+
+    g->data = tmp;
+    g->data_size = size;
+  }
+
+  for (size_t i = 0; i < g->columns; i++) {
+    gorilla_column_t *c = g->state + i;
+
+    /* The first row is stored as is. */
+    if (g->rows == 0) {
+      c->prev = gauge_to_bits(values[i]);
+      write_bits(g, c->prev, 64);
+      continue;
+    }
+
+    encode_value(g, c, values[i]);
+  }
+
+  g->rows++;
+  return 0;
+} /* int gorilla_append */
+
+size_t gorilla_decode(gorilla_t *g, gauge_t *ret_values, size_t rows_num) {
+  if ((g == NULL) || (ret_values == NULL) || (g->rows == 0))
+    return 0;
+
+  gorilla_column_t *state = g->state + g->columns;
+  size_t skip = (g->rows > rows_num) ? g->rows - rows_num : 0;
+  size_t pos = 0;
+
+  memset(state, 0, g->columns * sizeof(*state));
+  for (size_t i = 0; i < g->columns; i++)
+    state[i].prev = read_bits(g, &pos, 64);
+
+  for (size_t r = 0; r < g->rows; r++) {
+    /* Skipped rows are decoded into the first row of the output, which is
+     * overwritten later. */
+    gauge_t *row = ret_values;
+    if (r >= skip)
+      row += (r - skip) * g->columns;
+
+    for (size_t i = 0; i < g->columns; i++)
+      row[i] = (r == 0) ? bits_to_gauge(state[i].prev)
+                        : decode_value(g, &pos, state + i);
+  }
+
+  return g->rows - skip;
+} /* size_t gorilla_decode */
+
+int gorilla_truncate(gorilla_t *g, size_t rows_num) {
+  if (g == NULL)
+    return EINVAL;
+  if (g->rows <= rows_num)
+    return 0;
+
+  gorilla_t *tmp = gorilla_create(g->columns);
+  gauge_t *values = calloc(rows_num * g->columns, sizeof(*values));
+  if ((tmp == NULL) || ((values == NULL) && (rows_num > 0))) {
+    gorilla_destroy(tmp);
+    free(values);
+    return ENOMEM;
+  }
+
+  gorilla_decode(g, values, rows_num);
+  for (size_t r = 0; r < rows_num; r++) {
+    if (gorilla_append(tmp, values + r * g->columns) != 0) {
+      gorilla_destroy(tmp);
+      free(values);
+      return ENOMEM;
+    }
+  }
+  free(values);
+
+  free(g->data);
+  g->rows = tmp->rows;
+  g->data = tmp->data;
+  g->data_size = tmp->data_size;
+  g->bits = tmp->bits;
+  memcpy(g->state, tmp->state, g->columns * sizeof(g->state[0]));
+
+  tmp->data = NULL;
+  gorilla_destroy(tmp);
+  return 0;
+} /* int gorilla_truncate */
+
+size_t gorilla_rows(gorilla_t const *g) {
+  return (g == NULL) ? 0 : g->rows;
+} /* size_t gorilla_rows */
+
+size_t gorilla_memory(gorilla_t const *g) {
+  if (g == NULL)
+    return 0;
+  return sizeof(*g) + 2 * g->columns * sizeof(g->state[0]) + g->data_size;
+} /* size_t gorilla_memory */
@@ -0,0 +1,128 @@
+/**
+ * collectd - src/utils/gorilla/gorilla.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#ifndef UTILS_GORILLA_H
+#define UTILS_GORILLA_H 1
+
+#include "plugin.h"
+
+/*
+ * A compressed table of gauge values, stored row by row. Each value is
+ * XOR-ed with the previous value of its column and only the bits which
+ * differ are stored, as described in "Gorilla: A Fast, Scalable, In-Memory
+ * Time Series Database" (Pelkonen et al., 2015). Values which do not change
+ * take one bit, slowly changing values usually take a few bits instead of
+ * 64.
+ *
+ * Rows can only be appended. The table does not lock; callers must serialize
+ * all calls for one table.
+ */
+struct gorilla_s;
+typedef struct gorilla_s gorilla_t;
+
+/*
+ * NAME
+ *   gorilla_create
+ *
+ * DESCRIPTION
+ *   Allocates a new, empty table with `columns' values per row.
+ *
+ * RETURN VALUE
+ *   A gorilla_t-pointer upon success or NULL upon failure.
+ */
+gorilla_t *gorilla_create(size_t columns);
+
+/*
+ * NAME
+ *   gorilla_destroy
+ *
+ * DESCRIPTION
+ *   Frees the table and all memory associated with it.
+ */
+void gorilla_destroy(gorilla_t *g);
+
+/*
+ * NAME
+ *   gorilla_append
+ *
+ * DESCRIPTION
+ *   Appends one row, i.e. `columns' values, to the table.
+ *
+ * RETURN VALUE
+ *   Zero upon success or ENOMEM if the table could not be grown. The table is
+ *   not modified upon failure.
+ */
+int gorilla_append(gorilla_t *g, gauge_t const *values);
+
+/*
+ * NAME
+ *   gorilla_decode
+ *
+ * DESCRIPTION
+ *   Decodes the newest `rows_num' rows into `ret_values', which must have
+ *   room for `rows_num * columns' values. The oldest of these rows is stored
+ *   first. If the table has fewer rows, only those are decoded. The table
+ *   itself is not changed, but the function uses state stored in it.
+ *
+ * RETURN VALUE
+ *   The number of rows stored in `ret_values'.
+ */
+size_t gorilla_decode(gorilla_t *g, gauge_t *ret_values, size_t rows_num);
+
+/*
+ * NAME
+ *   gorilla_truncate
+ *
+ * DESCRIPTION
+ *   Drops all but the newest `rows_num' rows. The remaining rows have to be
+ *   encoded again, so this takes time linear in the size of the table. Call
+ *   it when the table has grown to a multiple of the rows needed.
+ *
+ * RETURN VALUE
+ *   Zero upon success or ENOMEM upon failure. The table is not modified upon
+ *   failure.
+ */
+int gorilla_truncate(gorilla_t *g, size_t rows_num);
+
+/*
+ * NAME
+ *   gorilla_rows
+ *
+ * RETURN VALUE
+ *   The number of rows stored in the table.
+ */
+size_t gorilla_rows(gorilla_t const *g);
+
+/*
+ * NAME
+ *   gorilla_memory
+ *
+ * RETURN VALUE
+ *   The number of bytes allocated for the table.
+ */
+size_t gorilla_memory(gorilla_t const *g);
+
+#endif /* UTILS_GORILLA_H */
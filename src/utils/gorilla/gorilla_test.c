@@ -0,0 +1,130 @@
+/**
+ * collectd - src/utils/gorilla/gorilla_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "collectd.h"
+
+#include "testing.h"
+#include "utils/gorilla/gorilla.h"
+
+#define ROWS 1000
+
+static void make_row(size_t r, gauge_t *row) {
+  row[0] = 42.0;                      /* constant */
+  row[1] = (gauge_t)(r / 10);         /* slowly increasing */
+  row[2] = sin((double)r / 7.0) * 1e6; /* noisy */
+  row[3] = ((r % 97) == 0) ? NAN : -(gauge_t)r * 0.125;
+}
+
+static bool same_value(gauge_t a, gauge_t b) {
+  return (isnan(a) && isnan(b)) || (a == b);
+}
+
+DEF_TEST(round_trip) {
+  gorilla_t *g;
+  gauge_t want[4];
+  gauge_t *got = calloc(ROWS * 4, sizeof(*got));
+
+  CHECK_NOT_NULL(got);
+  CHECK_NOT_NULL(g = gorilla_create(4));
+  EXPECT_EQ_INT(0, gorilla_decode(g, got, ROWS));
+
+  for (size_t r = 0; r < ROWS; r++) {
+    make_row(r, want);
+    CHECK_ZERO(gorilla_append(g, want));
+  }
+  EXPECT_EQ_INT(ROWS, gorilla_rows(g));
+
+  /* Ask for more rows than are stored. */
+  EXPECT_EQ_INT(ROWS, gorilla_decode(g, got, 2 * ROWS));
+  for (size_t r = 0; r < ROWS; r++) {
+    make_row(r, want);
+    for (size_t i = 0; i < 4; i++)
+      OK(same_value(want[i], got[4 * r + i]));
+  }
+
+  /* Only the newest rows, oldest first. */
+  EXPECT_EQ_INT(3, gorilla_decode(g, got, 3));
+  for (size_t r = 0; r < 3; r++) {
+    make_row(ROWS - 3 + r, want);
+    for (size_t i = 0; i < 4; i++)
+      OK(same_value(want[i], got[4 * r + i]));
+  }
+
+  gorilla_destroy(g);
+  free(got);
+  return 0;
+}
+
+DEF_TEST(truncate) {
+  gorilla_t *g;
+  gauge_t want[4];
+  gauge_t got[4 * 10];
+
+  CHECK_NOT_NULL(g = gorilla_create(4));
+  for (size_t r = 0; r < ROWS; r++) {
+    make_row(r, want);
+    CHECK_ZERO(gorilla_append(g, want));
+  }
+
+  CHECK_ZERO(gorilla_truncate(g, 10));
+  EXPECT_EQ_INT(10, gorilla_rows(g));
+
+  /* Appending continues after the remaining rows. */
+  make_row(ROWS, want);
+  CHECK_ZERO(gorilla_append(g, want));
+  EXPECT_EQ_INT(10, gorilla_decode(g, got, 10));
+  for (size_t r = 0; r < 10; r++) {
+    make_row(ROWS - 9 + r, want);
+    for (size_t i = 0; i < 4; i++)
+      OK(same_value(want[i], got[4 * r + i]));
+  }
+
+  gorilla_destroy(g);
+  return 0;
+}
+
+DEF_TEST(compression) {
+  gorilla_t *g;
+  gauge_t v = 1.5;
+
+  CHECK_NOT_NULL(g = gorilla_create(1));
+  for (size_t r = 0; r < ROWS; r++)
+    CHECK_ZERO(gorilla_append(g, &v));
+
+  /* A constant value takes one bit per row, far less than a plain array. */
+  OK(gorilla_memory(g) < ROWS * sizeof(gauge_t) / 8);
+
+  gorilla_destroy(g);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(round_trip);
+  RUN_TEST(truncate);
+  RUN_TEST(compression);
+
+  END_TEST;
+}
@@ -51,8 +51,9 @@ DEF_TEST(simple) {
 
   for (int i = 0; i < 5; i++) {
     int *ret = NULL;
-    CHECK_NOT_NULL(ret = c_heap_get_root(h));
+    CHECK_NOT_NULL(ret = c_heap_peek_root(h));
     OK(*ret == i);
+    EXPECT_EQ_PTR(ret, c_heap_get_root(h));
   }
 
   CHECK_ZERO(c_heap_insert(h, &values[6] /* = 0 */));
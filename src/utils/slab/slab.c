@@ -0,0 +1,309 @@
+/**
+ * collectd - src/utils/slab/slab.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "utils/slab/slab.h"
+
+#include <pthread.h>
+
+/* Number of objects the shared depot holds per object a thread may cache. */
+#define SLAB_DEPOT_FACTOR 16
+
+/* Free objects are linked through their first bytes. */
+struct slab_obj_s;
+typedef struct slab_obj_s slab_obj_t;
+struct slab_obj_s {
+  slab_obj_t *next;
+};
+
+struct slab_cache_s;
+typedef struct slab_cache_s slab_cache_t;
+struct slab_cache_s {
+  slab_t *slab;
+
+  slab_obj_t *free_list;
+  size_t free_num;
+
+  /* Only written by the owning thread. */
+  uint64_t hits;
+  uint64_t misses;
+
+  slab_cache_t *next;
+};
+
+struct slab_s {
+  pthread_key_t key;
+  size_t obj_size;
+  size_t cache_max;
+
+  /* Protects everything below. */
+  pthread_mutex_t lock;
+
+  slab_obj_t *depot;
+  size_t depot_num;
+
+  /* Caches of all threads which have used this pool. */
+  slab_cache_t *caches;
+
+  /* Counters of threads which have exited. */
+  uint64_t hits;
+  uint64_t misses;
+
+  /* Set by slab_destroy(). The pool is freed together with the last cache. */
+  bool destroyed;
+};
+
+/* Moves up to `num' objects from `*list' to the depot and frees the objects
+ * which do not fit. Must be called with the pool lock held. */
+static void depot_put(slab_t *s, slab_obj_t **list, size_t num) /* {{{ */
+{
+  for (size_t i = 0; (i < num) && (*list != NULL); i++) {
+    slab_obj_t *o = *list;
+    *list = o->next;
+
+    if (s->depot_num < SLAB_DEPOT_FACTOR * s->cache_max) {
+      o->next = s->depot;
+      s->depot = o;
+      s->depot_num++;
+    } else {
+      free(o);
+    }
+  }
+} /* }}} void depot_put */
+
+static void free_objs(slab_obj_t *o) /* {{{ */
+{
+  while (o != NULL) {
+    slab_obj_t *next = o->next;
+    free(o);
+    o = next;
+  }
+} /* }}} void free_objs */
+
+/* Removes `c' from the list of caches. Must be called with the pool lock
+ * held. */
+static void cache_unlink(slab_t *s, slab_cache_t *c) /* {{{ */
+{
+  for (slab_cache_t **prev = &s->caches; *prev != NULL;
+       prev = &(*prev)->next) {
+    if (*prev == c) {
+      *prev = c->next;
+      return;
+    }
+  }
+} /* }}} void cache_unlink */
+
+static void slab_free_pool(slab_t *s) /* {{{ */
+{
+  pthread_key_delete(s->key);
+  pthread_mutex_destroy(&s->lock);
+  free(s);
+} /* }}} void slab_free_pool */
+
+/* Called when a thread which has used the pool exits. */
+static void cache_destructor(void *arg) /* {{{ */
+{
+  slab_cache_t *c = arg;
+  slab_t *s = c->slab;
+
+  pthread_mutex_lock(&s->lock);
+
+  if (s->destroyed)
+    free_objs(c->free_list);
+  else
+    depot_put(s, &c->free_list, c->free_num);
+  s->hits += c->hits;
+  s->misses += c->misses;
+  cache_unlink(s, c);
+
+  bool last = s->destroyed && (s->caches == NULL);
+
+  pthread_mutex_unlock(&s->lock);
+  free(c);
+
+  if (last)
+    slab_free_pool(s);
+} /* }}} void cache_destructor */
+
+static slab_cache_t *cache_get(slab_t *s) /* {{{ */
+{
+  slab_cache_t *c = pthread_getspecific(s->key);
+  if (c != NULL)
+    return c;
+
+  c = calloc(1, sizeof(*c));
+  if (c == NULL)
+    return NULL;
+  c->slab = s;
+
+  if (pthread_setspecific(s->key, c) != 0) {
+    free(c);
+    return NULL;
+  }
+
+  pthread_mutex_lock(&s->lock);
+  c->next = s->caches;
+  s->caches = c;
+  pthread_mutex_unlock(&s->lock);
+
+  return c;
+} /* }}} slab_cache_t *cache_get */
+
+slab_t *slab_create(size_t obj_size, size_t cache_max) /* {{{ */
+{
+  if ((obj_size == 0) || (cache_max == 0))
+    return NULL;
+
+  slab_t *s = calloc(1, sizeof(*s));
+  if (s == NULL)
+    return NULL;
+
+  if (pthread_key_create(&s->key, cache_destructor) != 0) {
+    free(s);
+    return NULL;
+  }
+
+  s->obj_size = (obj_size < sizeof(slab_obj_t)) ? sizeof(slab_obj_t) : obj_size;
+  s->cache_max = cache_max;
+  pthread_mutex_init(&s->lock, /* attr = */ NULL);
+
+  return s;
+} /* }}} slab_t *slab_create */
+
+void slab_destroy(slab_t *s) /* {{{ */
+{
+  if (s == NULL)
+    return;
+
+  /* The caches of other threads are only reachable through their
+   * thread-specific data, so they are left to cache_destructor(). */
+  slab_cache_t *own = pthread_getspecific(s->key);
+  if (own != NULL)
+    pthread_setspecific(s->key, NULL);
+
+  pthread_mutex_lock(&s->lock);
+
+  if (own != NULL) {
+    cache_unlink(s, own);
+    free_objs(own->free_list);
+    free(own);
+  }
+
+  free_objs(s->depot);
+  s->depot = NULL;
+  s->depot_num = 0;
+  s->destroyed = true;
+
+  bool last = (s->caches == NULL);
+
+  pthread_mutex_unlock(&s->lock);
+
+  if (last)
+    slab_free_pool(s);
+} /* }}} void slab_destroy */
+
+void *slab_alloc(slab_t *s) /* {{{ */
+{
+  slab_cache_t *c = cache_get(s);
+  if (c == NULL)
+    return malloc(s->obj_size);
+
+  if (c->free_list == NULL) {
+    /* Refill half of the cache from the depot. */
+    pthread_mutex_lock(&s->lock);
+    size_t num = (s->cache_max + 1) / 2;
+    for (size_t i = 0; (i < num) && (s->depot != NULL); i++) {
+      slab_obj_t *o = s->depot;
+      s->depot = o->next;
+      s->depot_num--;
+
+      o->next = c->free_list;
+      c->free_list = o;
+      c->free_num++;
+    }
+    pthread_mutex_unlock(&s->lock);
+  }
+
+  slab_obj_t *o = c->free_list;
+  if (o == NULL) {
+    c->misses++;
+    return malloc(s->obj_size);
+  }
+
+  c->free_list = o->next;
+  c->free_num--;
+  c->hits++;
+  return o;
+} /* }}} void *slab_alloc */
+
+void slab_free(slab_t *s, void *obj) /* {{{ */
+{
+  if (obj == NULL)
+    return;
+
+  slab_cache_t *c = cache_get(s);
+  if (c == NULL) {
+    free(obj);
+    return;
+  }
+
+  slab_obj_t *o = obj;
+  o->next = c->free_list;
+  c->free_list = o;
+  c->free_num++;
+
+  if (c->free_num > s->cache_max) {
+    /* Hand half of the cache to the depot, so that threads which only free
+     * objects, e.g. the write threads, return them to the allocating ones. */
+    size_t num = (c->free_num + 1) / 2;
+
+    pthread_mutex_lock(&s->lock);
+    depot_put(s, &c->free_list, num);
+    pthread_mutex_unlock(&s->lock);
+
+    c->free_num -= num;
+  }
+} /* }}} void slab_free */
+
+void slab_stats(slab_t *s, uint64_t *hits, uint64_t *misses) /* {{{ */
+{
+  pthread_mutex_lock(&s->lock);
+
+  uint64_t h = s->hits;
+  uint64_t m = s->misses;
+  for (slab_cache_t *c = s->caches; c != NULL; c = c->next) {
+    h += c->hits;
+    m += c->misses;
+  }
+
+  pthread_mutex_unlock(&s->lock);
+
+  if (hits != NULL)
+    *hits = h;
+  if (misses != NULL)
+    *misses = m;
+} /* }}} void slab_stats */
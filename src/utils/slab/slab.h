@@ -0,0 +1,109 @@
+/**
+ * collectd - src/utils/slab/slab.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#ifndef UTILS_SLAB_H
+#define UTILS_SLAB_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A pool of fixed-size objects. Each thread has its own cache of free objects,
+ * so allocating and freeing usually does not take any lock. Objects may be
+ * freed by a different thread than the one that allocated them: when a
+ * thread's cache is full, half of it is moved to a shared depot, from which
+ * threads with an empty cache refill theirs, one batch per lock.
+ *
+ * Objects are plain malloc(3) blocks, so objects of the right size which were
+ * allocated with malloc(3) may be returned to the pool and vice versa.
+ */
+struct slab_s;
+typedef struct slab_s slab_t;
+
+/*
+ * NAME
+ *   slab_create
+ *
+ * DESCRIPTION
+ *   Allocates a new pool of objects of `obj_size' bytes. Each thread caches up
+ *   to `cache_max' free objects; the shared depot holds up to 16 times as
+ *   many. Free objects beyond that are returned to the system.
+ *
+ * RETURN VALUE
+ *   A slab_t-pointer upon success or NULL upon failure.
+ */
+slab_t *slab_create(size_t obj_size, size_t cache_max);
+
+/*
+ * NAME
+ *   slab_destroy
+ *
+ * DESCRIPTION
+ *   Frees the shared depot and the calling thread's cache. The caches of
+ *   other threads which have used the pool are freed when these threads exit,
+ *   and the pool itself with the last of them, so threads need not be joined
+ *   first. Objects which are still in use must be freed with free(3). No
+ *   thread may use the pool while or after it is destroyed.
+ */
+void slab_destroy(slab_t *s);
+
+/*
+ * NAME
+ *   slab_alloc
+ *
+ * DESCRIPTION
+ *   Returns an uninitialized object, taken from the calling thread's cache,
+ *   the shared depot or malloc(3), in that order.
+ *
+ * RETURN VALUE
+ *   A pointer to the object or NULL if it could not be allocated.
+ */
+void *slab_alloc(slab_t *s);
+
+/*
+ * NAME
+ *   slab_free
+ *
+ * DESCRIPTION
+ *   Returns `obj' to the calling thread's cache. `obj' must have been
+ *   allocated by `slab_alloc', possibly in another thread, or with malloc(3)
+ *   and the object size of the pool.
+ */
+void slab_free(slab_t *s, void *obj);
+
+/*
+ * NAME
+ *   slab_stats
+ *
+ * DESCRIPTION
+ *   Returns the number of allocations served from a cache or the depot
+ *   (`hits') and from malloc(3) (`misses') since the pool was created. The
+ *   per-thread counters are read without locking, so the values may be
+ *   slightly stale.
+ */
+void slab_stats(slab_t *s, uint64_t *hits, uint64_t *misses);
+
+#endif /* UTILS_SLAB_H */
@@ -0,0 +1,174 @@
+/**
+ * collectd - src/utils/slab/slab_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "collectd.h"
+
+#include "testing.h"
+#include "utils/slab/slab.h"
+
+#include <pthread.h>
+
+DEF_TEST(reuse) {
+  slab_t *s;
+  uint64_t hits = 0, misses = 0;
+
+  CHECK_NOT_NULL(s = slab_create(64, 4));
+
+  void *a = slab_alloc(s);
+  CHECK_NOT_NULL(a);
+  slab_stats(s, &hits, &misses);
+  EXPECT_EQ_UINT64(0, hits);
+  EXPECT_EQ_UINT64(1, misses);
+
+  /* A freed object is handed out again by the same thread. */
+  slab_free(s, a);
+  EXPECT_EQ_PTR(a, slab_alloc(s));
+  slab_stats(s, &hits, &misses);
+  EXPECT_EQ_UINT64(1, hits);
+  EXPECT_EQ_UINT64(1, misses);
+
+  /* Objects allocated with malloc(3) may be returned to the pool. */
+  void *b = malloc(64);
+  CHECK_NOT_NULL(b);
+  slab_free(s, b);
+  EXPECT_EQ_PTR(b, slab_alloc(s));
+
+  free(a);
+  free(b);
+  slab_destroy(s);
+  return 0;
+}
+
+#define OBJ_NUM 32
+
+typedef struct {
+  slab_t *s;
+  void *objs[OBJ_NUM];
+} alloc_args_t;
+
+static void *alloc_thread(void *arg) {
+  alloc_args_t *args = arg;
+
+  for (size_t i = 0; i < OBJ_NUM; i++)
+    args->objs[i] = slab_alloc(args->s);
+
+  return NULL;
+}
+
+DEF_TEST(cross_thread) {
+  slab_t *s;
+  pthread_t t;
+  uint64_t hits = 0, misses = 0;
+
+  CHECK_NOT_NULL(s = slab_create(64, 8));
+
+  /* Another thread allocates the objects ... */
+  alloc_args_t args = {.s = s};
+  CHECK_ZERO(pthread_create(&t, NULL, alloc_thread, &args));
+  CHECK_ZERO(pthread_join(t, NULL));
+  slab_stats(s, &hits, &misses);
+  EXPECT_EQ_UINT64(0, hits);
+  EXPECT_EQ_UINT64(OBJ_NUM, misses);
+
+  /* ... and this thread frees them. Everything beyond its own cache ends up
+   * in the depot. */
+  for (size_t i = 0; i < OBJ_NUM; i++)
+    slab_free(s, args.objs[i]);
+
+  /* A new thread gets all objects from the depot. */
+  CHECK_ZERO(pthread_create(&t, NULL, alloc_thread, &args));
+  CHECK_ZERO(pthread_join(t, NULL));
+  slab_stats(s, &hits, &misses);
+  OK(hits > 0);
+  EXPECT_EQ_UINT64(2 * OBJ_NUM, hits + misses);
+
+  for (size_t i = 0; i < OBJ_NUM; i++)
+    free(args.objs[i]);
+
+  slab_destroy(s);
+  return 0;
+}
+
+typedef struct {
+  slab_t *s;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool cached;
+  bool destroyed;
+} running_args_t;
+
+static void *running_thread(void *arg) {
+  running_args_t *args = arg;
+
+  /* Leaves an object in this thread's cache. */
+  slab_free(args->s, slab_alloc(args->s));
+
+  pthread_mutex_lock(&args->lock);
+  args->cached = true;
+  pthread_cond_broadcast(&args->cond);
+  while (!args->destroyed)
+    pthread_cond_wait(&args->cond, &args->lock);
+  pthread_mutex_unlock(&args->lock);
+
+  return NULL;
+}
+
+DEF_TEST(destroy_running) {
+  running_args_t args = {
+      .lock = PTHREAD_MUTEX_INITIALIZER,
+      .cond = PTHREAD_COND_INITIALIZER,
+  };
+  pthread_t t;
+
+  CHECK_NOT_NULL(args.s = slab_create(64, 4));
+  slab_free(args.s, slab_alloc(args.s));
+
+  CHECK_ZERO(pthread_create(&t, NULL, running_thread, &args));
+  pthread_mutex_lock(&args.lock);
+  while (!args.cached)
+    pthread_cond_wait(&args.cond, &args.lock);
+  pthread_mutex_unlock(&args.lock);
+
+  /* The pool is destroyed while the other thread still holds its cache. That
+   * cache and the pool are freed when the thread exits. */
+  slab_destroy(args.s);
+
+  pthread_mutex_lock(&args.lock);
+  args.destroyed = true;
+  pthread_cond_broadcast(&args.cond);
+  pthread_mutex_unlock(&args.lock);
+  CHECK_ZERO(pthread_join(t, NULL));
+
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(reuse);
+  RUN_TEST(cross_thread);
+  RUN_TEST(destroy_running);
+
+  END_TEST;
+}
@@ -0,0 +1,344 @@
+/**
+ * collectd - src/utils/squeue/squeue.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "utils/squeue/squeue.h"
+
+#include <pthread.h>
+
+/* Maximum number of unused nodes kept per shard for recycling. */
+#define SQUEUE_FREE_MAX 1024
+
+struct squeue_node_s;
+typedef struct squeue_node_s squeue_node_t;
+struct squeue_node_s {
+  squeue_node_t *next;
+  unsigned char data[];
+};
+
+typedef struct squeue_shard_s {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  squeue_node_t *head;
+  squeue_node_t *tail;
+  long length;
+
+  squeue_node_t *free_list;
+  size_t free_num;
+
+  /* Number of nodes taken from `free_list' and allocated, respectively. */
+  uint64_t nodes_recycled;
+  uint64_t nodes_allocated;
+
+  /* Set by squeue_merge_shard(): pushes go to this shard instead. */
+  struct squeue_shard_s *merged_into;
+} squeue_shard_t;
+
+struct squeue_s {
+  squeue_shard_t *shards;
+  size_t shards_num;
+  size_t item_size;
+  bool shutdown;
+};
+
+static void free_nodes(squeue_node_t *n) /* {{{ */
+{
+  while (n != NULL) {
+    squeue_node_t *next = n->next;
+    free(n);
+    n = next;
+  }
+} /* }}} void free_nodes */
+
+squeue_t *squeue_create(size_t shards_num, size_t item_size) /* {{{ */
+{
+  if ((shards_num == 0) || (item_size == 0))
+    return NULL;
+
+  squeue_t *q = calloc(1, sizeof(*q));
+  if (q == NULL)
+    return NULL;
+
+  q->shards = calloc(shards_num, sizeof(*q->shards));
+  if (q->shards == NULL) {
+    free(q);
+    return NULL;
+  }
+  q->shards_num = shards_num;
+  q->item_size = item_size;
+
+  for (size_t i = 0; i < shards_num; i++) {
+    pthread_mutex_init(&q->shards[i].lock, /* attr = */ NULL);
+    pthread_cond_init(&q->shards[i].cond, /* attr = */ NULL);
+  }
+
+  return q;
+} /* }}} squeue_t *squeue_create */
+
+void squeue_destroy(squeue_t *q) /* {{{ */
+{
+  if (q == NULL)
+    return;
+
+  for (size_t i = 0; i < q->shards_num; i++) {
+    squeue_shard_t *s = q->shards + i;
+
+    free_nodes(s->head);
+    free_nodes(s->free_list);
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+  }
+
+  free(q->shards);
+  free(q);
+} /* }}} void squeue_destroy */
+
+int squeue_push(squeue_t *q, uint32_t key, void const *item) /* {{{ */
+{
+  squeue_shard_t *s = q->shards + (key % q->shards_num);
+
+  pthread_mutex_lock(&s->lock);
+
+  /* A shard is merged at most once and never into a merged shard, so one
+   * step is enough. */
+  if (s->merged_into != NULL) {
+    squeue_shard_t *into = s->merged_into;
+    pthread_mutex_unlock(&s->lock);
+    s = into;
+    pthread_mutex_lock(&s->lock);
+  }
+
+  squeue_node_t *n = s->free_list;
+  if (n != NULL) {
+    s->free_list = n->next;
+    s->free_num--;
+    s->nodes_recycled++;
+  } else {
+    /* Don't hold the lock while calling into the allocator. */
+    pthread_mutex_unlock(&s->lock);
+    n = malloc(sizeof(*n) + q->item_size);
+    if (n == NULL)
+      return ENOMEM;
+    pthread_mutex_lock(&s->lock);
+    s->nodes_allocated++;
+  }
+
+  n->next = NULL;
+  memcpy(n->data, item, q->item_size);
+
+  if (s->tail == NULL)
+    s->head = n;
+  else
+    s->tail->next = n;
+  s->tail = n;
+  s->length++;
+
+  pthread_cond_signal(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+
+  return 0;
+} /* }}} int squeue_push */
+
+/* Must be called with the shard lock held and a non-empty shard. */
+static void shard_take(squeue_t *q, squeue_shard_t *s, void *ret_item) /* {{{ */
+{
+  squeue_node_t *n = s->head;
+
+  s->head = n->next;
+  if (s->head == NULL)
+    s->tail = NULL;
+  s->length--;
+
+  memcpy(ret_item, n->data, q->item_size);
+
+  if (s->free_num < SQUEUE_FREE_MAX) {
+    n->next = s->free_list;
+    s->free_list = n;
+    s->free_num++;
+  } else {
+    free(n);
+  }
+} /* }}} void shard_take */
+
+int squeue_pop(squeue_t *q, size_t shard, void *ret_item) /* {{{ */
+{
+  squeue_shard_t *s = q->shards + (shard % q->shards_num);
+
+  pthread_mutex_lock(&s->lock);
+
+  while (!q->shutdown && (s->head == NULL))
+    pthread_cond_wait(&s->cond, &s->lock);
+
+  if (q->shutdown) {
+    pthread_mutex_unlock(&s->lock);
+    return ESHUTDOWN;
+  }
+
+  shard_take(q, s, ret_item);
+  pthread_mutex_unlock(&s->lock);
+
+  return 0;
+} /* }}} int squeue_pop */
+
+size_t squeue_pop_batch(squeue_t *q, size_t shard, void *ret_items, /* {{{ */
+                        size_t items_max) {
+  squeue_shard_t *s = q->shards + (shard % q->shards_num);
+  unsigned char *dst = ret_items;
+  size_t num = 0;
+
+  if (items_max == 0)
+    return 0;
+
+  pthread_mutex_lock(&s->lock);
+
+  while (!q->shutdown && (s->head == NULL))
+    pthread_cond_wait(&s->cond, &s->lock);
+
+  if (q->shutdown) {
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+  }
+
+  while ((s->head != NULL) && (num < items_max)) {
+    shard_take(q, s, dst + (num * q->item_size));
+    num++;
+  }
+  pthread_mutex_unlock(&s->lock);
+
+  return num;
+} /* }}} size_t squeue_pop_batch */
+
+int squeue_try_pop(squeue_t *q, size_t shard, void *ret_item) /* {{{ */
+{
+  squeue_shard_t *s = q->shards + (shard % q->shards_num);
+
+  pthread_mutex_lock(&s->lock);
+
+  if (s->head == NULL) {
+    pthread_mutex_unlock(&s->lock);
+    return EAGAIN;
+  }
+
+  shard_take(q, s, ret_item);
+  pthread_mutex_unlock(&s->lock);
+
+  return 0;
+} /* }}} int squeue_try_pop */
+
+int squeue_merge_shard(squeue_t *q, size_t shard, size_t into) /* {{{ */
+{
+  if ((shard >= q->shards_num) || (into >= q->shards_num) || (shard == into))
+    return EINVAL;
+
+  squeue_shard_t *s = q->shards + shard;
+  squeue_shard_t *t = q->shards + into;
+
+  /* Lock the shards in index order. */
+  pthread_mutex_lock(&q->shards[(shard < into) ? shard : into].lock);
+  pthread_mutex_lock(&q->shards[(shard < into) ? into : shard].lock);
+
+  if ((s->merged_into != NULL) || (t->merged_into != NULL)) {
+    pthread_mutex_unlock(&s->lock);
+    pthread_mutex_unlock(&t->lock);
+    return EINVAL;
+  }
+
+  /* Appending the items keeps the order of each key, since later pushes to
+   * `shard' end up behind them. */
+  if (s->head != NULL) {
+    if (t->tail == NULL)
+      t->head = s->head;
+    else
+      t->tail->next = s->head;
+    t->tail = s->tail;
+    t->length += s->length;
+
+    s->head = NULL;
+    s->tail = NULL;
+    s->length = 0;
+  }
+  s->merged_into = t;
+
+  pthread_cond_broadcast(&t->cond);
+  pthread_mutex_unlock(&s->lock);
+  pthread_mutex_unlock(&t->lock);
+
+  return 0;
+} /* }}} int squeue_merge_shard */
+
+void squeue_shutdown(squeue_t *q) /* {{{ */
+{
+  /* `shutdown' is only ever read with a shard lock held, so set it while
+   * holding all of them. */
+  for (size_t i = 0; i < q->shards_num; i++)
+    pthread_mutex_lock(&q->shards[i].lock);
+
+  q->shutdown = true;
+
+  for (size_t i = 0; i < q->shards_num; i++) {
+    pthread_cond_broadcast(&q->shards[i].cond);
+    pthread_mutex_unlock(&q->shards[i].lock);
+  }
+} /* }}} void squeue_shutdown */
+
+long squeue_length(squeue_t *q) /* {{{ */
+{
+  long sum = 0;
+
+  for (size_t i = 0; i < q->shards_num; i++) {
+    squeue_shard_t *s = q->shards + i;
+
+    pthread_mutex_lock(&s->lock);
+    sum += s->length;
+    pthread_mutex_unlock(&s->lock);
+  }
+
+  return sum;
+} /* }}} long squeue_length */
+
+void squeue_stats(squeue_t *q, uint64_t *recycled, /* {{{ */
+                  uint64_t *allocated) {
+  uint64_t r = 0;
+  uint64_t a = 0;
+
+  for (size_t i = 0; i < q->shards_num; i++) {
+    squeue_shard_t *s = q->shards + i;
+
+    pthread_mutex_lock(&s->lock);
+    r += s->nodes_recycled;
+    a += s->nodes_allocated;
+    pthread_mutex_unlock(&s->lock);
+  }
+
+  if (recycled != NULL)
+    *recycled = r;
+  if (allocated != NULL)
+    *allocated = a;
+} /* }}} void squeue_stats */
+
+size_t squeue_shards_num(squeue_t *q) { return q->shards_num; }
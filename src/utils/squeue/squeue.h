@@ -0,0 +1,175 @@
+/**
+ * collectd - src/utils/squeue/squeue.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#ifndef UTILS_SQUEUE_H
+#define UTILS_SQUEUE_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A sharded, blocking FIFO queue. Producers pick a shard by hashing a key, so
+ * items with the same key always end up in the same shard and are dequeued in
+ * the order in which they were enqueued. Each shard has its own lock,
+ * condition variable and list of recycled nodes, so producers and consumers
+ * working on different shards never contend with each other.
+ *
+ * Items are fixed-size blobs which are copied into and out of the queue, i.e.
+ * the queue never allocates memory for the item itself.
+ */
+struct squeue_s;
+typedef struct squeue_s squeue_t;
+
+/*
+ * NAME
+ *   squeue_create
+ *
+ * DESCRIPTION
+ *   Allocates a new queue with `shards_num' shards, each holding items of
+ *   `item_size' bytes.
+ *
+ * RETURN VALUE
+ *   A squeue_t-pointer upon success or NULL upon failure.
+ */
+squeue_t *squeue_create(size_t shards_num, size_t item_size);
+
+/*
+ * NAME
+ *   squeue_destroy
+ *
+ * DESCRIPTION
+ *   Deallocates a queue. Items which are still stored in the queue are lost;
+ *   use `squeue_try_pop' to drain the queue first if they hold references to
+ *   other memory.
+ */
+void squeue_destroy(squeue_t *q);
+
+/*
+ * NAME
+ *   squeue_push
+ *
+ * DESCRIPTION
+ *   Copies `item' to the tail of the shard selected by `key' and wakes up one
+ *   consumer waiting on that shard.
+ *
+ * RETURN VALUE
+ *   Zero upon success, ENOMEM if no node could be allocated.
+ */
+int squeue_push(squeue_t *q, uint32_t key, void const *item);
+
+/*
+ * NAME
+ *   squeue_pop
+ *
+ * DESCRIPTION
+ *   Removes the item at the head of `shard' and copies it to `ret_item'. If the
+ *   shard is empty, blocks until an item becomes available or the queue is
+ *   shut down.
+ *
+ * RETURN VALUE
+ *   Zero upon success, ESHUTDOWN if the queue has been shut down.
+ */
+int squeue_pop(squeue_t *q, size_t shard, void *ret_item);
+
+/*
+ * NAME
+ *   squeue_pop_batch
+ *
+ * DESCRIPTION
+ *   Same as `squeue_pop', but removes up to `items_max' items from the head of
+ *   `shard' while holding the shard lock once. `ret_items' must have room for
+ *   `items_max' items. Blocks until at least one item is available or the
+ *   queue is shut down.
+ *
+ * RETURN VALUE
+ *   The number of items copied to `ret_items' or zero if the queue has been
+ *   shut down.
+ */
+size_t squeue_pop_batch(squeue_t *q, size_t shard, void *ret_items,
+                        size_t items_max);
+
+/*
+ * NAME
+ *   squeue_try_pop
+ *
+ * DESCRIPTION
+ *   Same as `squeue_pop', but returns immediately if `shard' is empty.
+ *
+ * RETURN VALUE
+ *   Zero upon success, EAGAIN if the shard is empty.
+ */
+int squeue_try_pop(squeue_t *q, size_t shard, void *ret_item);
+
+/*
+ * NAME
+ *   squeue_merge_shard
+ *
+ * DESCRIPTION
+ *   Moves all items of `shard' to the tail of `into' and makes all further
+ *   pushes to `shard' go to `into'. This is used if no consumer is left for
+ *   `shard'. Items with the same key are still dequeued in order.
+ *
+ * RETURN VALUE
+ *   Zero upon success, EINVAL if either shard does not exist, if they are the
+ *   same or if either of them has already been merged.
+ */
+int squeue_merge_shard(squeue_t *q, size_t shard, size_t into);
+
+/*
+ * NAME
+ *   squeue_shutdown
+ *
+ * DESCRIPTION
+ *   Wakes up all consumers blocked in `squeue_pop' and makes all further calls
+ *   to `squeue_pop' return ESHUTDOWN. Items remaining in the queue can still
+ *   be removed with `squeue_try_pop'.
+ */
+void squeue_shutdown(squeue_t *q);
+
+/*
+ * NAME
+ *   squeue_length
+ *
+ * DESCRIPTION
+ *   Returns the number of items in all shards. Each shard is counted under
+ *   its own lock, so the sum may be slightly stale if other threads are
+ *   modifying the queue concurrently.
+ */
+long squeue_length(squeue_t *q);
+
+/*
+ * NAME
+ *   squeue_stats
+ *
+ * DESCRIPTION
+ *   Returns the number of pushed items which used a recycled node
+ *   (`recycled') and a newly allocated one (`allocated').
+ */
+void squeue_stats(squeue_t *q, uint64_t *recycled, uint64_t *allocated);
+
+size_t squeue_shards_num(squeue_t *q);
+
+#endif /* UTILS_SQUEUE_H */
@@ -0,0 +1,133 @@
+/**
+ * collectd - src/utils/squeue/squeue_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures enqueue/dequeue throughput of the write queue with 1 to 64
+ * producer and consumer threads. Each run is done twice: once with a single
+ * shard, which is equivalent to the old global write_lock queue, and once with
+ * one shard per consumer, which is what the daemon uses.
+ *
+ * Usage: bench_utils_squeue [items per producer] */
+
+#include "collectd.h"
+
+#include "utils/squeue/squeue.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+typedef struct {
+  void *vl;
+  char ctx[32]; /* roughly the size of plugin_ctx_t */
+} bench_item_t;
+
+typedef struct {
+  squeue_t *q;
+  size_t index;
+  long items;
+} bench_thread_t;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+static void *producer(void *arg) {
+  bench_thread_t *t = arg;
+  uint32_t key = (uint32_t)t->index * 2654435761u;
+
+  for (long i = 0; i < t->items; i++) {
+    bench_item_t item = {.vl = (void *)(uintptr_t)i};
+    /* cycle through a few hundred "series" per producer */
+    squeue_push(t->q, key + (uint32_t)(i % 509), &item);
+  }
+
+  return NULL;
+}
+
+static void *consumer(void *arg) {
+  bench_thread_t *t = arg;
+  bench_item_t item;
+
+  while (squeue_pop(t->q, t->index, &item) == 0)
+    t->items++;
+
+  return NULL;
+}
+
+static double run(size_t threads_num, size_t shards_num, long items) {
+  squeue_t *q = squeue_create(shards_num, sizeof(bench_item_t));
+  bench_thread_t prod[threads_num];
+  bench_thread_t cons[threads_num];
+  pthread_t prod_tid[threads_num];
+  pthread_t cons_tid[threads_num];
+
+  assert(q != NULL);
+
+  double start = now_seconds();
+
+  for (size_t i = 0; i < threads_num; i++) {
+    cons[i] = (bench_thread_t){.q = q, .index = i};
+    pthread_create(cons_tid + i, NULL, consumer, cons + i);
+  }
+  for (size_t i = 0; i < threads_num; i++) {
+    prod[i] = (bench_thread_t){.q = q, .index = i, .items = items};
+    pthread_create(prod_tid + i, NULL, producer, prod + i);
+  }
+
+  for (size_t i = 0; i < threads_num; i++)
+    pthread_join(prod_tid[i], NULL);
+  while (squeue_length(q) > 0)
+    sched_yield();
+  squeue_shutdown(q);
+  for (size_t i = 0; i < threads_num; i++)
+    pthread_join(cons_tid[i], NULL);
+
+  double elapsed = now_seconds() - start;
+
+  long consumed = 0;
+  for (size_t i = 0; i < threads_num; i++)
+    consumed += cons[i].items;
+  assert(consumed == items * (long)threads_num);
+
+  squeue_destroy(q);
+  return ((double)consumed) / elapsed;
+}
+
+int main(int argc, char **argv) {
+  long items = 200000;
+  if (argc > 1)
+    items = atol(argv[1]);
+
+  printf("%8s %16s %16s\n", "threads", "1 shard [op/s]", "N shards [op/s]");
+  for (size_t n = 1; n <= 64; n *= 2) {
+    double single = run(n, 1, items);
+    double sharded = run(n, n, items);
+    printf("%8" PRIsz " %16.0f %16.0f\n", n, single, sharded);
+  }
+
+  return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * collectd - src/utils/squeue/squeue_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "collectd.h"
+
+#include "testing.h"
+#include "utils/squeue/squeue.h"
+
+#include <pthread.h>
+
+typedef struct {
+  uint32_t key;
+  int seq;
+} item_t;
+
+DEF_TEST(fifo) {
+  squeue_t *q;
+  item_t item;
+
+  CHECK_NOT_NULL(q = squeue_create(1, sizeof(item_t)));
+  EXPECT_EQ_INT(EAGAIN, squeue_try_pop(q, 0, &item));
+
+  for (int i = 0; i < 10; i++)
+    CHECK_ZERO(squeue_push(q, 0, &(item_t){.seq = i}));
+  EXPECT_EQ_INT(10, squeue_length(q));
+
+  for (int i = 0; i < 10; i++) {
+    CHECK_ZERO(squeue_pop(q, 0, &item));
+    EXPECT_EQ_INT(i, item.seq);
+  }
+  EXPECT_EQ_INT(0, squeue_length(q));
+  EXPECT_EQ_INT(EAGAIN, squeue_try_pop(q, 0, &item));
+
+  /* Nodes of removed items are recycled. */
+  uint64_t recycled = 0, allocated = 0;
+  CHECK_ZERO(squeue_push(q, 0, &(item_t){.seq = 10}));
+  squeue_stats(q, &recycled, &allocated);
+  EXPECT_EQ_UINT64(1, recycled);
+  EXPECT_EQ_UINT64(10, allocated);
+  CHECK_ZERO(squeue_pop(q, 0, &item));
+
+  squeue_destroy(q);
+  return 0;
+}
+
+DEF_TEST(sharding) {
+  squeue_t *q;
+  item_t item;
+
+  CHECK_NOT_NULL(q = squeue_create(4, sizeof(item_t)));
+  EXPECT_EQ_INT(4, squeue_shards_num(q));
+
+  /* The same key always maps to the same shard. */
+  for (int i = 0; i < 8; i++)
+    CHECK_ZERO(squeue_push(q, 6, &(item_t){.key = 6, .seq = i}));
+  CHECK_ZERO(squeue_push(q, 1, &(item_t){.key = 1, .seq = 0}));
+  EXPECT_EQ_INT(9, squeue_length(q));
+
+  EXPECT_EQ_INT(EAGAIN, squeue_try_pop(q, 0, &item));
+  EXPECT_EQ_INT(EAGAIN, squeue_try_pop(q, 3, &item));
+
+  CHECK_ZERO(squeue_try_pop(q, 1, &item));
+  EXPECT_EQ_INT(1, item.key);
+
+  for (int i = 0; i < 8; i++) {
+    CHECK_ZERO(squeue_try_pop(q, 2, &item));
+    EXPECT_EQ_INT(6, item.key);
+    EXPECT_EQ_INT(i, item.seq);
+  }
+  EXPECT_EQ_INT(0, squeue_length(q));
+
+  squeue_destroy(q);
+  return 0;
+}
+
+DEF_TEST(batch) {
+  squeue_t *q;
+  item_t items[4];
+
+  CHECK_NOT_NULL(q = squeue_create(1, sizeof(item_t)));
+
+  for (int i = 0; i < 6; i++)
+    CHECK_ZERO(squeue_push(q, 0, &(item_t){.seq = i}));
+
+  EXPECT_EQ_INT(4, squeue_pop_batch(q, 0, items, 4));
+  for (int i = 0; i < 4; i++)
+    EXPECT_EQ_INT(i, items[i].seq);
+
+  EXPECT_EQ_INT(2, squeue_pop_batch(q, 0, items, 4));
+  EXPECT_EQ_INT(4, items[0].seq);
+  EXPECT_EQ_INT(5, items[1].seq);
+  EXPECT_EQ_INT(0, squeue_length(q));
+
+  squeue_shutdown(q);
+  EXPECT_EQ_INT(0, squeue_pop_batch(q, 0, items, 4));
+
+  squeue_destroy(q);
+  return 0;
+}
+
+DEF_TEST(merge) {
+  squeue_t *q;
+  item_t item;
+
+  CHECK_NOT_NULL(q = squeue_create(3, sizeof(item_t)));
+  CHECK_ZERO(squeue_push(q, 0, &(item_t){.key = 0, .seq = 0}));
+  CHECK_ZERO(squeue_push(q, 2, &(item_t){.key = 2, .seq = 0}));
+  CHECK_ZERO(squeue_push(q, 2, &(item_t){.key = 2, .seq = 1}));
+
+  CHECK_ZERO(squeue_merge_shard(q, 2, 0));
+  EXPECT_EQ_INT(EINVAL, squeue_merge_shard(q, 2, 1));
+  EXPECT_EQ_INT(EINVAL, squeue_merge_shard(q, 1, 2));
+  EXPECT_EQ_INT(EINVAL, squeue_merge_shard(q, 1, 1));
+  EXPECT_EQ_INT(EINVAL, squeue_merge_shard(q, 1, 3));
+  EXPECT_EQ_INT(3, squeue_length(q));
+
+  /* Later pushes to the merged shard end up behind the moved items. */
+  CHECK_ZERO(squeue_push(q, 2, &(item_t){.key = 2, .seq = 2}));
+  EXPECT_EQ_INT(EAGAIN, squeue_try_pop(q, 2, &item));
+
+  CHECK_ZERO(squeue_try_pop(q, 0, &item));
+  EXPECT_EQ_INT(0, item.key);
+  for (int i = 0; i < 3; i++) {
+    CHECK_ZERO(squeue_try_pop(q, 0, &item));
+    EXPECT_EQ_INT(2, item.key);
+    EXPECT_EQ_INT(i, item.seq);
+  }
+  EXPECT_EQ_INT(0, squeue_length(q));
+
+  squeue_destroy(q);
+  return 0;
+}
+
+static void *pop_thread(void *arg) {
+  squeue_t *q = arg;
+  item_t item;
+
+  return (void *)(intptr_t)squeue_pop(q, 0, &item);
+}
+
+DEF_TEST(shutdown) {
+  squeue_t *q;
+  pthread_t t;
+  void *ret = NULL;
+  item_t item;
+
+  CHECK_NOT_NULL(q = squeue_create(2, sizeof(item_t)));
+  CHECK_ZERO(pthread_create(&t, NULL, pop_thread, q));
+
+  squeue_shutdown(q);
+  CHECK_ZERO(pthread_join(t, &ret));
+  EXPECT_EQ_INT(ESHUTDOWN, (intptr_t)ret);
+
+  /* Remaining items can still be drained. */
+  CHECK_ZERO(squeue_push(q, 0, &(item_t){.seq = 42}));
+  EXPECT_EQ_INT(ESHUTDOWN, squeue_pop(q, 0, &item));
+  CHECK_ZERO(squeue_try_pop(q, 0, &item));
+  EXPECT_EQ_INT(42, item.seq);
+
+  squeue_destroy(q);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(fifo);
+  RUN_TEST(sharding);
+  RUN_TEST(batch);
+  RUN_TEST(merge);
+  RUN_TEST(shutdown);
+
+  END_TEST;
+}
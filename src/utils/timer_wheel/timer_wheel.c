@@ -0,0 +1,251 @@
+/**
+ * collectd - src/utils/timer_wheel/timer_wheel.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#include "collectd.h"
+
+#include "utils/timer_wheel/timer_wheel.h"
+
+/* One tick is 2^20 cdtime_t units, i.e. 2^-10 seconds. */
+#define TW_TICK_BITS 20
+
+/* Each level has 256 slots and each slot of a level spans one full rotation of
+ * the level below. With four levels, the wheel covers 2^32 ticks, about 48
+ * days. Entries due later are parked in the last slot and re-sorted when it
+ * is reached. */
+#define TW_LEVEL_BITS 8
+#define TW_LEVEL_SIZE (1 << TW_LEVEL_BITS)
+#define TW_LEVEL_MASK ((uint64_t)(TW_LEVEL_SIZE - 1))
+#define TW_LEVELS 4
+#define TW_SPAN ((uint64_t)1 << (TW_LEVELS * TW_LEVEL_BITS))
+
+#define TW_SHIFT(level) ((level)*TW_LEVEL_BITS)
+
+struct timer_wheel_s {
+  /* The first tick which has not been processed yet. */
+  uint64_t tick;
+
+  timer_wheel_entry_t *slots[TW_LEVELS][TW_LEVEL_SIZE];
+  size_t level_num[TW_LEVELS];
+
+  /* Entries whose tick has been processed, in order. */
+  timer_wheel_entry_t *expired_head;
+  timer_wheel_entry_t *expired_tail;
+  size_t expired_num;
+};
+
+static void tw_expire(timer_wheel_t *w, timer_wheel_entry_t *e) /* {{{ */
+{
+  e->next = NULL;
+  if (w->expired_tail == NULL)
+    w->expired_head = e;
+  else
+    w->expired_tail->next = e;
+  w->expired_tail = e;
+  w->expired_num++;
+} /* }}} void tw_expire */
+
+/* Sorts `e' into the slot matching its distance from the current tick. */
+static void tw_place(timer_wheel_t *w, timer_wheel_entry_t *e) /* {{{ */
+{
+  uint64_t tick = e->due >> TW_TICK_BITS;
+  if (tick < w->tick) {
+    tw_expire(w, e);
+    return;
+  }
+
+  uint64_t delta = tick - w->tick;
+  if (delta >= TW_SPAN) {
+    tick = w->tick + TW_SPAN - 1;
+    delta = TW_SPAN - 1;
+  }
+
+  size_t level = 0;
+  while ((level < TW_LEVELS - 1) &&
+         (delta >= ((uint64_t)1 << TW_SHIFT(level + 1))))
+    level++;
+
+  size_t index = (size_t)((tick >> TW_SHIFT(level)) & TW_LEVEL_MASK);
+  e->next = w->slots[level][index];
+  w->slots[level][index] = e;
+  w->level_num[level]++;
+} /* }}} void tw_place */
+
+/* Called when `w->tick' has reached the start of a level 1 slot. Moves the
+ * entries of that slot, and of higher level slots starting at the same tick,
+ * to the lower levels. */
+static void tw_cascade(timer_wheel_t *w) /* {{{ */
+{
+  for (size_t level = 1; level < TW_LEVELS; level++) {
+    size_t index = (size_t)((w->tick >> TW_SHIFT(level)) & TW_LEVEL_MASK);
+
+    timer_wheel_entry_t *e = w->slots[level][index];
+    w->slots[level][index] = NULL;
+    while (e != NULL) {
+      timer_wheel_entry_t *next = e->next;
+      w->level_num[level]--;
+      tw_place(w, e);
+      e = next;
+    }
+
+    if (index != 0)
+      break;
+  }
+} /* }}} void tw_cascade */
+
+/* Processes all ticks before `end'. */
+static void tw_advance(timer_wheel_t *w, uint64_t end) /* {{{ */
+{
+  while (w->tick < end) {
+    size_t level = 0;
+    while ((level < TW_LEVELS) && (w->level_num[level] == 0))
+      level++;
+
+    if (level == TW_LEVELS) {
+      w->tick = end;
+      return;
+    }
+
+    if (level == 0) {
+      size_t index = (size_t)(w->tick & TW_LEVEL_MASK);
+
+      timer_wheel_entry_t *e = w->slots[0][index];
+      w->slots[0][index] = NULL;
+      while (e != NULL) {
+        timer_wheel_entry_t *next = e->next;
+        w->level_num[0]--;
+        tw_expire(w, e);
+        e = next;
+      }
+
+      w->tick++;
+    } else {
+      /* All lower levels are empty, so nothing happens before the current
+       * slot of `level' ends. */
+      uint64_t next = ((w->tick >> TW_SHIFT(level)) + 1) << TW_SHIFT(level);
+      if (next > end) {
+        w->tick = end;
+        return;
+      }
+      w->tick = next;
+    }
+
+    if ((w->tick & TW_LEVEL_MASK) == 0)
+      tw_cascade(w);
+  }
+} /* }}} void tw_advance */
+
+timer_wheel_t *timer_wheel_create(cdtime_t now) /* {{{ */
+{
+  timer_wheel_t *w = calloc(1, sizeof(*w));
+  if (w == NULL)
+    return NULL;
+
+  w->tick = now >> TW_TICK_BITS;
+  return w;
+} /* }}} timer_wheel_t *timer_wheel_create */
+
+void timer_wheel_destroy(timer_wheel_t *w) /* {{{ */
+{
+  free(w);
+} /* }}} void timer_wheel_destroy */
+
+int timer_wheel_insert(timer_wheel_t *w, timer_wheel_entry_t *e) /* {{{ */
+{
+  if ((w == NULL) || (e == NULL))
+    return EINVAL;
+
+  tw_place(w, e);
+  return 0;
+} /* }}} int timer_wheel_insert */
+
+void *timer_wheel_get(timer_wheel_t *w, cdtime_t now) /* {{{ */
+{
+  if (w == NULL)
+    return NULL;
+
+  tw_advance(w, now >> TW_TICK_BITS);
+
+  timer_wheel_entry_t *e = w->expired_head;
+  if (e == NULL)
+    return NULL;
+
+  w->expired_head = e->next;
+  if (w->expired_head == NULL)
+    w->expired_tail = NULL;
+  w->expired_num--;
+
+  e->next = NULL;
+  return e->data;
+} /* }}} void *timer_wheel_get */
+
+int timer_wheel_next(timer_wheel_t *w, cdtime_t *ret_time) /* {{{ */
+{
+  if ((w == NULL) || (ret_time == NULL))
+    return EINVAL;
+
+  if (w->expired_head != NULL) {
+    *ret_time = w->expired_head->due;
+    return 0;
+  }
+
+  /* The earliest non-empty slot of each level. A level 0 slot expires at the
+   * end of its tick, higher level slots are cascaded at their start. */
+  uint64_t next = UINT64_MAX;
+  for (size_t level = 0; level < TW_LEVELS; level++) {
+    if (w->level_num[level] == 0)
+      continue;
+
+    uint64_t base = w->tick >> TW_SHIFT(level);
+    for (uint64_t i = (level == 0) ? 0 : 1; i <= TW_LEVEL_SIZE; i++) {
+      if (w->slots[level][(base + i) & TW_LEVEL_MASK] == NULL)
+        continue;
+
+      uint64_t tick = (base + i) << TW_SHIFT(level);
+      if (level == 0)
+        tick++;
+      if (tick < next)
+        next = tick;
+      break;
+    }
+  }
+
+  if (next == UINT64_MAX)
+    return ENOENT;
+
+  *ret_time = (cdtime_t)(next << TW_TICK_BITS);
+  return 0;
+} /* }}} int timer_wheel_next */
+
+size_t timer_wheel_size(timer_wheel_t *w) /* {{{ */
+{
+  if (w == NULL)
+    return 0;
+
+  size_t num = w->expired_num;
+  for (size_t level = 0; level < TW_LEVELS; level++)
+    num += w->level_num[level];
+  return num;
+} /* }}} size_t timer_wheel_size */
@@ -0,0 +1,131 @@
+/**
+ * collectd - src/utils/timer_wheel/timer_wheel.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ **/
+
+#ifndef UTILS_TIMER_WHEEL_H
+#define UTILS_TIMER_WHEEL_H 1
+
+#include "utils_time.h"
+
+/*
+ * A hierarchical timer wheel. Inserting an entry and taking an expired one are
+ * O(1), independent of the number of entries. Time is divided into ticks of
+ * 2^-10 seconds (about one millisecond); entries are returned no earlier than
+ * their due time and at most one tick after it. Entries which are due in the
+ * same tick are returned together.
+ *
+ * Entries are embedded into the caller's data structures, so the wheel never
+ * allocates memory after it has been created. The wheel does not lock; callers
+ * must serialize all calls for one wheel.
+ */
+struct timer_wheel_s;
+typedef struct timer_wheel_s timer_wheel_t;
+
+struct timer_wheel_entry_s;
+typedef struct timer_wheel_entry_s timer_wheel_entry_t;
+struct timer_wheel_entry_s {
+  /* Set by the caller before inserting the entry. */
+  cdtime_t due;
+  void *data;
+
+  /* Private to the wheel. */
+  timer_wheel_entry_t *next;
+};
+
+/*
+ * NAME
+ *   timer_wheel_create
+ *
+ * DESCRIPTION
+ *   Allocates a new, empty timer wheel whose current time is `now'.
+ *
+ * RETURN VALUE
+ *   A timer_wheel_t-pointer upon success or NULL upon failure.
+ */
+timer_wheel_t *timer_wheel_create(cdtime_t now);
+
+/*
+ * NAME
+ *   timer_wheel_destroy
+ *
+ * DESCRIPTION
+ *   Frees the timer wheel. Entries still stored in the wheel are lost, but of
+ *   course not freed.
+ */
+void timer_wheel_destroy(timer_wheel_t *w);
+
+/*
+ * NAME
+ *   timer_wheel_insert
+ *
+ * DESCRIPTION
+ *   Stores the entry `e' in the wheel. The caller must set `e->due' and
+ *   `e->data' beforehand and must not modify or free the entry until it has
+ *   been returned by `timer_wheel_get'. Entries which are already due are
+ *   returned by the next call to `timer_wheel_get'.
+ *
+ * RETURN VALUE
+ *   Zero upon success or EINVAL if an argument is NULL.
+ */
+int timer_wheel_insert(timer_wheel_t *w, timer_wheel_entry_t *e);
+
+/*
+ * NAME
+ *   timer_wheel_get
+ *
+ * DESCRIPTION
+ *   Advances the wheel to `now' and removes one entry which has expired by
+ *   then. Entries are returned in the order of the ticks they are due in.
+ *
+ * RETURN VALUE
+ *   The `data' member of the removed entry or NULL if no entry has expired.
+ */
+void *timer_wheel_get(timer_wheel_t *w, cdtime_t now);
+
+/*
+ * NAME
+ *   timer_wheel_next
+ *
+ * DESCRIPTION
+ *   Stores the time at which `timer_wheel_get' should be called next in
+ *   `ret_time'. Entries which are far in the future are only sorted into their
+ *   final tick on the way, so the returned time may be earlier than the due
+ *   time of any entry. It is never later than the earliest one.
+ *
+ * RETURN VALUE
+ *   Zero upon success or ENOENT if the wheel is empty.
+ */
+int timer_wheel_next(timer_wheel_t *w, cdtime_t *ret_time);
+
+/*
+ * NAME
+ *   timer_wheel_size
+ *
+ * RETURN VALUE
+ *   The number of entries stored in the wheel.
+ */
+size_t timer_wheel_size(timer_wheel_t *w);
+
+#endif /* UTILS_TIMER_WHEEL_H */
@@ -0,0 +1,147 @@
+/**
+ * collectd - src/utils/timer_wheel/timer_wheel_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+#include "collectd.h"
+
+#include "testing.h"
+#include "utils/timer_wheel/timer_wheel.h"
+
+/* One tick of the wheel. */
+#define TICK ((cdtime_t)1 << 20)
+
+DEF_TEST(basic) {
+  cdtime_t start = TIME_T_TO_CDTIME_T(1000);
+  timer_wheel_t *w;
+  cdtime_t next = 0;
+
+  CHECK_NOT_NULL(w = timer_wheel_create(start));
+  EXPECT_EQ_INT(ENOENT, timer_wheel_next(w, &next));
+
+  int a = 1, b = 2, c = 3;
+  timer_wheel_entry_t ea = {.due = start + TIME_T_TO_CDTIME_T(10), .data = &a};
+  timer_wheel_entry_t eb = {.due = start + MS_TO_CDTIME_T(5), .data = &b};
+  /* Already due when inserted. */
+  timer_wheel_entry_t ec = {.due = start - TIME_T_TO_CDTIME_T(1), .data = &c};
+
+  CHECK_ZERO(timer_wheel_insert(w, &ea));
+  CHECK_ZERO(timer_wheel_insert(w, &eb));
+  CHECK_ZERO(timer_wheel_insert(w, &ec));
+  EXPECT_EQ_INT(3, timer_wheel_size(w));
+
+  CHECK_ZERO(timer_wheel_next(w, &next));
+  OK(next <= start);
+  EXPECT_EQ_PTR(&c, timer_wheel_get(w, start));
+  EXPECT_EQ_PTR(NULL, timer_wheel_get(w, start));
+
+  CHECK_ZERO(timer_wheel_next(w, &next));
+  OK(next >= eb.due);
+  OK(next <= eb.due + TICK);
+  EXPECT_EQ_PTR(NULL, timer_wheel_get(w, eb.due - 1));
+  EXPECT_EQ_PTR(&b, timer_wheel_get(w, eb.due + TICK));
+
+  /* `a' is on a higher level; the next time may be earlier than its due
+   * time, but calling get then must not return it too early. */
+  CHECK_ZERO(timer_wheel_next(w, &next));
+  OK(next <= ea.due + TICK);
+  EXPECT_EQ_PTR(NULL, timer_wheel_get(w, ea.due - 1));
+  EXPECT_EQ_PTR(&a, timer_wheel_get(w, ea.due + TICK));
+  EXPECT_EQ_INT(0, timer_wheel_size(w));
+
+  timer_wheel_destroy(w);
+  return 0;
+}
+
+#define ENTRY_NUM 10000
+
+/* Inserts entries due within a wide range of times, then steps through time
+ * following timer_wheel_next() and checks that every entry is returned exactly
+ * once, not before it is due and no later than one tick after. */
+DEF_TEST(random) {
+  static timer_wheel_entry_t entries[ENTRY_NUM];
+  static bool returned[ENTRY_NUM];
+  cdtime_t now = TIME_T_TO_CDTIME_T(1700000000);
+  timer_wheel_t *w;
+
+  CHECK_NOT_NULL(w = timer_wheel_create(now));
+
+  int status = 0;
+  srand(42);
+  for (size_t i = 0; i < ENTRY_NUM; i++) {
+    /* Up to about 100 days ahead, so that some entries are beyond the range
+     * covered by the wheel. */
+    int exponent = rand() % 43;
+    cdtime_t delta = ((cdtime_t)rand() << 20 | (cdtime_t)rand()) %
+                     ((cdtime_t)1 << exponent);
+    entries[i] = (timer_wheel_entry_t){
+        .due = now + delta,
+        .data = &returned[i],
+    };
+    status |= timer_wheel_insert(w, &entries[i]);
+  }
+  CHECK_ZERO(status);
+  EXPECT_EQ_INT(ENTRY_NUM, timer_wheel_size(w));
+
+  size_t returned_num = 0;
+  size_t twice_num = 0;
+  size_t early_num = 0;
+  size_t late_num = 0;
+  cdtime_t next;
+  while (timer_wheel_next(w, &next) == 0) {
+    if (next > now)
+      now = next;
+
+    bool *r;
+    while ((r = timer_wheel_get(w, now)) != NULL) {
+      size_t i = (size_t)(r - returned);
+      if (*r)
+        twice_num++;
+      else
+        returned_num++;
+      *r = true;
+
+      if (entries[i].due > now)
+        early_num++;
+      if (entries[i].due + TICK < now)
+        late_num++;
+    }
+  }
+
+  EXPECT_EQ_INT(ENTRY_NUM, returned_num);
+  EXPECT_EQ_INT(0, twice_num);
+  EXPECT_EQ_INT(0, early_num);
+  EXPECT_EQ_INT(0, late_num);
+  EXPECT_EQ_INT(0, timer_wheel_size(w));
+
+  timer_wheel_destroy(w);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(basic);
+  RUN_TEST(random);
+
+  END_TEST;
+}
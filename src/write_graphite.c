@@ -339,31 +339,27 @@ static int wg_flush(cdtime_t timeout,
   return status;
 }
 
-static int wg_send_message(char const *message, struct wg_callback *cb) {
+/* NOTE: You must hold cb->send_lock when calling this function! */
+static int wg_send_message_nolock(char const *message, struct wg_callback *cb) {
   int status;
   size_t message_len;
 
   message_len = strlen(message);
 
-  pthread_mutex_lock(&cb->send_lock);
-
   wg_force_reconnect_check(cb);
 
   if (cb->sock_fd < 0) {
     status = wg_callback_init(cb);
     if (status != 0) {
       /* An error message has already been printed. */
-      pthread_mutex_unlock(&cb->send_lock);
       return -1;
     }
   }
 
   if (message_len >= cb->send_buf_free) {
     status = wg_flush_nolock(/* timeout = */ 0, cb);
-    if (status != 0) {
-      pthread_mutex_unlock(&cb->send_lock);
+    if (status != 0)
       return status;
-    }
   }
 
   /* Assert that we have enough space for this message. */
@@ -382,38 +378,39 @@ static int wg_send_message(char const *message, struct wg_callback *cb) {
         100.0 * ((double)cb->send_buf_fill) / ((double)sizeof(cb->send_buf)),
         message);
 
-  pthread_mutex_unlock(&cb->send_lock);
-
   return 0;
 }
 
-static int wg_write_messages(const data_set_t *ds, const value_list_t *vl,
-                             struct wg_callback *cb) {
-  char buffer[WG_SEND_BUF_SIZE] = {0};
-  int status;
+static int wg_send_message(char const *message, struct wg_callback *cb) {
+  pthread_mutex_lock(&cb->send_lock);
+  int status = wg_send_message_nolock(message, cb);
+  pthread_mutex_unlock(&cb->send_lock);
+
+  return status;
+}
 
+static int wg_format_messages(char *buffer, size_t buffer_size,
+                              const data_set_t *ds, const value_list_t *vl,
+                              struct wg_callback *cb) {
   if (0 != strcmp(ds->type, vl->type)) {
     ERROR("write_graphite plugin: DS type does not match "
           "value list type");
     return -1;
   }
 
-  status = format_graphite(buffer, sizeof(buffer), ds, vl, cb->prefix,
-                           cb->postfix, cb->escape_char, cb->format_flags);
-  if (status != 0) /* error message has been printed already. */
-    return status;
-
-  /* Send the message to graphite */
-  status = wg_send_message(buffer, cb);
-  if (status != 0) /* error message has been printed already. */
-    return status;
-
-  return 0;
-} /* int wg_write_messages */
+  return format_graphite(buffer, buffer_size, ds, vl, cb->prefix, cb->postfix,
+                         cb->escape_char, cb->format_flags);
+} /* int wg_format_messages */
 
-static int wg_write(const data_set_t *ds, const value_list_t *vl,
-                    user_data_t *user_data) {
+/* Formats the value lists of a batch without holding the send lock, which
+ * format_graphite() may need for looking up rates. The messages are collected
+ * and appended to the send buffer up to WG_SEND_BUF_SIZE bytes at a time. */
+static int wg_write_batch(const write_batch_entry_t *entries,
+                          size_t entries_num, user_data_t *user_data) {
   struct wg_callback *cb;
+  char pending[WG_SEND_BUF_SIZE] = {0};
+  size_t pending_len = 0;
+  int ret = 0;
   int status;
 
   if (user_data == NULL)
@@ -421,10 +418,36 @@ static int wg_write(const data_set_t *ds, const value_list_t *vl,
 
   cb = user_data->data;
 
-  status = wg_write_messages(ds, vl, cb);
+  for (size_t i = 0; i < entries_num; i++) {
+    char buffer[WG_SEND_BUF_SIZE] = {0};
 
-  return status;
-}
+    status = wg_format_messages(buffer, sizeof(buffer), entries[i].ds,
+                                entries[i].vl, cb);
+    if (status != 0) { /* error message has been printed already. */
+      ret = status;
+      continue;
+    }
+
+    size_t buffer_len = strlen(buffer);
+    if (pending_len + buffer_len >= sizeof(pending)) {
+      status = wg_send_message(pending, cb);
+      if (status != 0) /* error message has been printed already. */
+        ret = status;
+      pending_len = 0;
+    }
+
+    memcpy(pending + pending_len, buffer, buffer_len + 1);
+    pending_len += buffer_len;
+  }
+
+  if (pending_len > 0) {
+    status = wg_send_message(pending, cb);
+    if (status != 0) /* error message has been printed already. */
+      ret = status;
+  }
+
+  return ret;
+} /* int wg_write_batch */
 
 static int config_set_char(char *dest, oconfig_item_t *ci) {
   char buffer[4] = {0};
@@ -550,11 +573,11 @@ static int wg_config_node(oconfig_item_t *ci) {
     snprintf(callback_name, sizeof(callback_name), "write_graphite/%s",
              cb->name);
 
-  plugin_register_write(callback_name, wg_write,
-                        &(user_data_t){
-                            .data = cb,
-                            .free_func = wg_callback_free,
-                        });
+  plugin_register_write_batch(callback_name, wg_write_batch,
+                              &(user_data_t){
+                                  .data = cb,
+                                  .free_func = wg_callback_free,
+                              });
 
   plugin_register_flush(callback_name, wg_flush, &(user_data_t){.data = cb});
 
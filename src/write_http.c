@@ -399,9 +399,10 @@ static void wh_callback_free(void *data) /* {{{ */
   sfree(cb);
 } /* }}} void wh_callback_free */
 
-static int wh_write_command(const data_set_t *ds,
-                            const value_list_t *vl, /* {{{ */
-                            wh_callback_t *cb) {
+/* must hold cb->send_lock when calling */
+static int wh_write_command_nolock(const data_set_t *ds,
+                                   const value_list_t *vl, /* {{{ */
+                                   wh_callback_t *cb) {
   char key[10 * DATA_MAX_NAME_LEN];
   char values[512];
   char command[1024];
@@ -446,19 +447,15 @@ static int wh_write_command(const data_set_t *ds,
     return -1;
   }
 
-  pthread_mutex_lock(&cb->send_lock);
   if (wh_callback_init(cb) != 0) {
     ERROR("write_http plugin: wh_callback_init failed.");
-    pthread_mutex_unlock(&cb->send_lock);
     return -1;
   }
 
   if (command_len >= cb->send_buffer_free) {
     status = wh_flush_nolock(/* timeout = */ 0, cb);
-    if (status != 0) {
-      pthread_mutex_unlock(&cb->send_lock);
+    if (status != 0)
       return status;
-    }
   }
   assert(command_len < cb->send_buffer_free);
 
@@ -476,20 +473,17 @@ static int wh_write_command(const data_set_t *ds,
         100.0 * ((double)cb->send_buffer_fill) / ((double)cb->send_buffer_size),
         command);
 
-  /* Check if we have enough space for this command. */
-  pthread_mutex_unlock(&cb->send_lock);
-
   return 0;
-} /* }}} int wh_write_command */
+} /* }}} int wh_write_command_nolock */
 
-static int wh_write_json(const data_set_t *ds, const value_list_t *vl, /* {{{ */
-                         wh_callback_t *cb) {
+/* must hold cb->send_lock when calling */
+static int wh_write_json_nolock(const data_set_t *ds,
+                                const value_list_t *vl, /* {{{ */
+                                wh_callback_t *cb) {
   int status;
 
-  pthread_mutex_lock(&cb->send_lock);
   if (wh_callback_init(cb) != 0) {
     ERROR("write_http plugin: wh_callback_init failed.");
-    pthread_mutex_unlock(&cb->send_lock);
     return -1;
   }
 
@@ -500,7 +494,6 @@ static int wh_write_json(const data_set_t *ds, const value_list_t *vl, /* {{{ */
     status = wh_flush_nolock(/* timeout = */ 0, cb);
     if (status != 0) {
       wh_reset_buffer(cb);
-      pthread_mutex_unlock(&cb->send_lock);
       return status;
     }
 
@@ -508,34 +501,27 @@ static int wh_write_json(const data_set_t *ds, const value_list_t *vl, /* {{{ */
         format_json_value_list(cb->send_buffer, &cb->send_buffer_fill,
                                &cb->send_buffer_free, ds, vl, cb->store_rates);
   }
-  if (status != 0) {
-    pthread_mutex_unlock(&cb->send_lock);
+  if (status != 0)
     return status;
-  }
 
   DEBUG("write_http plugin: <%s> buffer %" PRIsz "/%" PRIsz " (%g%%)",
         cb->location, cb->send_buffer_fill, cb->send_buffer_size,
         100.0 * ((double)cb->send_buffer_fill) /
             ((double)cb->send_buffer_size));
 
-  /* Check if we have enough space for this command. */
-  pthread_mutex_unlock(&cb->send_lock);
-
   return 0;
-} /* }}} int wh_write_json */
+} /* }}} int wh_write_json_nolock */
 
-static int wh_write_kairosdb(const data_set_t *ds,
-                             const value_list_t *vl, /* {{{ */
-                             wh_callback_t *cb) {
+/* must hold cb->send_lock when calling */
+static int wh_write_kairosdb_nolock(const data_set_t *ds,
+                                    const value_list_t *vl, /* {{{ */
+                                    wh_callback_t *cb) {
   int status;
 
-  pthread_mutex_lock(&cb->send_lock);
-
   if (cb->curl == NULL) {
     status = wh_callback_init(cb);
     if (status != 0) {
       ERROR("write_http plugin: wh_callback_init failed.");
-      pthread_mutex_unlock(&cb->send_lock);
       return -1;
     }
   }
@@ -548,7 +534,6 @@ static int wh_write_kairosdb(const data_set_t *ds,
     status = wh_flush_nolock(/* timeout = */ 0, cb);
     if (status != 0) {
       wh_reset_buffer(cb);
-      pthread_mutex_unlock(&cb->send_lock);
       return status;
     }
 
@@ -557,26 +542,21 @@ static int wh_write_kairosdb(const data_set_t *ds,
         cb->store_rates, (char const *const *)http_attrs, http_attrs_num,
         cb->data_ttl, cb->metrics_prefix);
   }
-  if (status != 0) {
-    pthread_mutex_unlock(&cb->send_lock);
+  if (status != 0)
     return status;
-  }
 
   DEBUG("write_http plugin: <%s> buffer %" PRIsz "/%" PRIsz " (%g%%)",
         cb->location, cb->send_buffer_fill, cb->send_buffer_size,
         100.0 * ((double)cb->send_buffer_fill) /
             ((double)cb->send_buffer_size));
 
-  /* Check if we have enough space for this command. */
-  pthread_mutex_unlock(&cb->send_lock);
-
   return 0;
-} /* }}} int wh_write_kairosdb */
+} /* }}} int wh_write_kairosdb_nolock */
 
-static int wh_write(const data_set_t *ds, const value_list_t *vl, /* {{{ */
-                    user_data_t *user_data) {
+static int wh_write_batch(const write_batch_entry_t *entries, /* {{{ */
+                          size_t entries_num, user_data_t *user_data) {
   wh_callback_t *cb;
-  int status;
+  int ret = 0;
 
   if (user_data == NULL)
     return -EINVAL;
@@ -584,19 +564,31 @@ static int wh_write(const data_set_t *ds, const value_list_t *vl, /* {{{ */
   cb = user_data->data;
   assert(cb->send_metrics);
 
-  switch (cb->format) {
-  case WH_FORMAT_JSON:
-    status = wh_write_json(ds, vl, cb);
-    break;
-  case WH_FORMAT_KAIROSDB:
-    status = wh_write_kairosdb(ds, vl, cb);
-    break;
-  default:
-    status = wh_write_command(ds, vl, cb);
-    break;
+  /* Take the lock once for the whole batch rather than once per value list. */
+  pthread_mutex_lock(&cb->send_lock);
+  for (size_t i = 0; i < entries_num; i++) {
+    const data_set_t *ds = entries[i].ds;
+    const value_list_t *vl = entries[i].vl;
+    int status;
+
+    switch (cb->format) {
+    case WH_FORMAT_JSON:
+      status = wh_write_json_nolock(ds, vl, cb);
+      break;
+    case WH_FORMAT_KAIROSDB:
+      status = wh_write_kairosdb_nolock(ds, vl, cb);
+      break;
+    default:
+      status = wh_write_command_nolock(ds, vl, cb);
+      break;
+    }
+    if (status != 0)
+      ret = status;
   }
-  return status;
-} /* }}} int wh_write */
+  pthread_mutex_unlock(&cb->send_lock);
+
+  return ret;
+} /* }}} int wh_write_batch */
 
 static int wh_notify(notification_t const *n, user_data_t *ud) /* {{{ */
 {
@@ -887,7 +879,7 @@ static int wh_config_node(oconfig_item_t *ci) /* {{{ */
   };
 
   if (cb->send_metrics) {
-    plugin_register_write(callback_name, wh_write, &user_data);
+    plugin_register_write_batch(callback_name, wh_write_batch, &user_data);
     user_data.free_func = NULL;
 
     plugin_register_flush(callback_name, wh_flush, &user_data);
@@ -368,7 +368,8 @@ static int write_influxdb_point(char *buffer, int buffer_len,
                                 const data_set_t *ds, const value_list_t *vl) {
   int status;
   int offset = 0;
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
+  bool have_rates = false;
   bool have_values = false;
 
   assert(0 == strcmp(ds->type, vl->type));
@@ -385,10 +386,8 @@ static int write_influxdb_point(char *buffer, int buffer_len,
 #define BUFFER_ADD(...)                                                        \
   do {                                                                         \
     status = snprintf(buffer + offset, buffer_len - offset, __VA_ARGS__);      \
-    if ((status < 0) || (status >= (buffer_len - offset))) {                   \
-      sfree(rates);                                                            \
+    if ((status < 0) || (status >= (buffer_len - offset)))                     \
       return -1;                                                               \
-    }                                                                          \
     offset += status;                                                          \
   } while (0)
 
@@ -413,10 +412,8 @@ static int write_influxdb_point(char *buffer, int buffer_len,
     if ((ds->ds[i].type != DS_TYPE_COUNTER) &&
         (ds->ds[i].type != DS_TYPE_GAUGE) &&
         (ds->ds[i].type != DS_TYPE_DERIVE) &&
-        (ds->ds[i].type != DS_TYPE_ABSOLUTE)) {
-      sfree(rates);
+        (ds->ds[i].type != DS_TYPE_ABSOLUTE))
       return -1;
-    }
 
     if (ds->ds[i].type == DS_TYPE_GAUGE) {
       if (isnan(vl->values[i].gauge))
@@ -426,12 +423,13 @@ static int write_influxdb_point(char *buffer, int buffer_len,
       BUFFER_ADD("%s=%lf", ds->ds[i].name, vl->values[i].gauge);
       have_values = true;
     } else if (wifxudp_config_store_rates) {
-      if (rates == NULL)
-        rates = uc_get_rate(ds, vl);
-      if (rates == NULL) {
-        WARNING("write_influxdb_udp plugin: "
-                "uc_get_rate failed.");
-        return -1;
+      if (!have_rates) {
+        if (uc_get_rate_buffer(ds, vl, rates) != 0) {
+          WARNING("write_influxdb_udp plugin: "
+                  "uc_get_rate_buffer failed.");
+          return -1;
+        }
+        have_rates = true;
       }
       if (isnan(rates[i]))
         continue;
@@ -458,7 +456,6 @@ static int write_influxdb_point(char *buffer, int buffer_len,
     }
 
   } /* for ds->ds_num */
-  sfree(rates);
 
   if (!have_values)
     return 0;
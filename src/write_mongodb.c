@@ -66,7 +66,7 @@ static bson_t *wm_create_bson(const data_set_t *ds, /* {{{ */
                               const value_list_t *vl, bool store_rates) {
   bson_t *ret;
   bson_t subarray;
-  gauge_t *rates;
+  gauge_t rates[ds->ds_num];
 
   ret = bson_new();
   if (!ret) {
@@ -74,15 +74,10 @@ static bson_t *wm_create_bson(const data_set_t *ds, /* {{{ */
     return NULL;
   }
 
-  if (store_rates) {
-    rates = uc_get_rate(ds, vl);
-    if (rates == NULL) {
-      ERROR("write_mongodb plugin: uc_get_rate() failed.");
-      bson_destroy(ret);
-      return NULL;
-    }
-  } else {
-    rates = NULL;
+  if (store_rates && (uc_get_rate_buffer(ds, vl, rates) != 0)) {
+    ERROR("write_mongodb plugin: uc_get_rate_buffer() failed.");
+    bson_destroy(ret);
+    return NULL;
   }
 
   BSON_APPEND_DATE_TIME(ret, "timestamp", CDTIME_T_TO_MS(vl->time));
@@ -139,8 +134,6 @@ static bson_t *wm_create_bson(const data_set_t *ds, /* {{{ */
   }
   bson_append_array_end(ret, &subarray); /* }}} dsnames */
 
-  sfree(rates);
-
   size_t error_location;
   if (!bson_validate(ret, BSON_VALIDATE_UTF8, &error_location)) {
     ERROR("write_mongodb plugin: Error in generated BSON document "
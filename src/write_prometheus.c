@@ -36,6 +36,10 @@
 
 #include <microhttpd.h>
 
+#if HAVE_LIBZ
+#include <zlib.h>
+#endif
+
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -57,9 +61,102 @@
 #define MHD_RESULT int
 #endif
 
+#ifndef MHD_SIZE_UNKNOWN
+#define MHD_SIZE_UNKNOWN ((uint64_t)-1)
+#endif
+#ifndef MHD_CONTENT_READER_END_OF_STREAM
+#define MHD_CONTENT_READER_END_OF_STREAM ((ssize_t)-1)
+#endif
+#ifndef MHD_CONTENT_READER_END_WITH_ERROR
+#define MHD_CONTENT_READER_END_WITH_ERROR ((ssize_t)-2)
+#endif
+
+/* Preferred size of the chunks a response is sent in. */
+#define SCRAPE_BLOCK_SIZE 32768
+
+/* Initial number of metrics and hash buckets of a metric family. */
+#define METRIC_SIZE_INIT 16
+
+/* Number of hash buckets of the metric family name cache. */
+#define NAME_CACHE_SIZE 1024
+
+/* prom_metric_t is a metric together with its entry in the hash table of its
+ * family. "pb" must be the first member, because the "metric" array of a
+ * family points to it. */
+typedef struct prom_metric_s {
+  Io__Prometheus__Client__Metric pb;
+  uint32_t hash;
+  /* position in the "metric" array of the family. */
+  size_t index;
+  struct prom_metric_s *next;
+
+  /* the beginning of the metric's line in the plain text format, which
+   * doesn't change, e.g. 'name{key0="value0",key1="value1"}'. */
+  size_t prefix_len;
+  char prefix[];
+} prom_metric_t;
+
+/* prom_family_t is a metric family together with the lock protecting its
+ * metrics. "metrics_lock" protects the "metrics" tree and the reference counts
+ * of the families and is only held to look up families. That way a scrape,
+ * which locks one family at a time, doesn't block writes to other families.
+ * Writers and scrapes hold a reference while using a family, so that
+ * prom_missing() can remove it from the tree without freeing it from under
+ * them. A family's "lock" must be acquired before "metrics_lock". */
+typedef struct {
+  Io__Prometheus__Client__MetricFamily pb;
+  pthread_mutex_t lock;
+  /* protected by "metrics_lock"; the tree holds one reference. */
+  size_t refs;
+  /* set once the family has been removed from the tree. */
+  bool removed;
+
+  /* hash table of the metrics, indexed by metric_hash(). There are as many
+   * buckets as there is room in the "metric" array. */
+  prom_metric_t **buckets;
+  size_t metric_size;
+} prom_family_t;
+
+/* prom_name_t caches the names of the metric families of a plugin and type,
+ * one per data source, so that they are not built for every value. */
+typedef struct prom_name_s {
+  uint32_t hash;
+  struct prom_name_s *next;
+  char plugin[DATA_MAX_NAME_LEN];
+  char type[DATA_MAX_NAME_LEN];
+  size_t names_num;
+  char *names[];
+} prom_name_t;
+
+/* prom_scrape_t is the state of one HTTP response. The metric families are
+ * rendered into "buffer" one at a time while the response is being sent, so
+ * that neither the complete exposition is held in memory nor a lock is held
+ * for the duration of a scrape. */
+typedef struct {
+  prom_family_t **families;
+  size_t families_num;
+  size_t families_pos;
+
+  bool want_proto;
+  bool trailer_pending;
+
+  ProtobufCBufferSimple buffer;
+  size_t buffer_pos;
+  uint8_t scratch[4096];
+
+  bool gzip;
+#if HAVE_LIBZ
+  bool gzip_done;
+  z_stream z;
+#endif
+} prom_scrape_t;
+
 static c_avl_tree_t *metrics;
 static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* protected by "metrics_lock". */
+static prom_name_t *name_cache[NAME_CACHE_SIZE];
+
 static char *httpd_host = NULL;
 static unsigned short httpd_port = 9103;
 static struct MHD_Daemon *httpd;
@@ -83,30 +180,21 @@ static size_t varint(uint8_t buffer[static VARINT_UINT32_BYTES],
   return 0;
 }
 
-/* format_protobuf iterates over all metric families in "metrics" and adds them
- * to a buffer in ProtoBuf format. It prefixes each protobuf with its encoded
- * size, the so called "delimited" format. */
-static void format_protobuf(ProtobufCBuffer *buffer) {
-  pthread_mutex_lock(&metrics_lock);
-
-  char *unused_name;
-  Io__Prometheus__Client__MetricFamily *fam;
-  c_avl_iterator_t *iter = c_avl_get_iterator(metrics);
-  while (c_avl_iterator_next(iter, (void *)&unused_name, (void *)&fam) == 0) {
-    /* Prometheus uses a message length prefix to determine where one
-     * MetricFamily ends and the next begins. This delimiter is encoded as a
-     * "varint", which is common in Protobufs. */
-    uint8_t delim[VARINT_UINT32_BYTES] = {0};
-    size_t delim_len = varint(
-        delim,
-        (uint32_t)io__prometheus__client__metric_family__get_packed_size(fam));
-    buffer->append(buffer, delim_len, delim);
-
-    io__prometheus__client__metric_family__pack_to_buffer(fam, buffer);
-  }
-  c_avl_iterator_destroy(iter);
-
-  pthread_mutex_unlock(&metrics_lock);
+/* format_protobuf adds a metric family to a buffer in ProtoBuf format. It
+ * prefixes the protobuf with its encoded size, the so called "delimited"
+ * format. */
+static void format_protobuf(ProtobufCBuffer *buffer,
+                            Io__Prometheus__Client__MetricFamily const *fam) {
+  /* Prometheus uses a message length prefix to determine where one
+   * MetricFamily ends and the next begins. This delimiter is encoded as a
+   * "varint", which is common in Protobufs. */
+  uint8_t delim[VARINT_UINT32_BYTES] = {0};
+  size_t delim_len = varint(
+      delim,
+      (uint32_t)io__prometheus__client__metric_family__get_packed_size(fam));
+  buffer->append(buffer, delim_len, delim);
+
+  io__prometheus__client__metric_family__pack_to_buffer(fam, buffer);
 }
 
 static char const *escape_label_value(char *buffer, size_t buffer_size,
@@ -179,107 +267,96 @@ static char *format_labels(char *buffer, size_t buffer_size,
   return buffer;
 }
 
-/* format_protobuf iterates over all metric families in "metrics" and adds them
- * to a buffer in plain text format. */
-static void format_text(ProtobufCBuffer *buffer) {
-  pthread_mutex_lock(&metrics_lock);
+/* format_int writes the decimal representation of v to buffer, which must
+ * have room for 20 characters, and returns its length. */
+static size_t format_int(char *buffer, int64_t v) {
+  char digits[20];
+  size_t digits_num = 0;
+
+  uint64_t u = (v < 0) ? -(uint64_t)v : (uint64_t)v;
+  do {
+    digits[digits_num] = (char)('0' + (u % 10));
+    digits_num++;
+    u /= 10;
+  } while (u != 0);
+
+  size_t len = 0;
+  if (v < 0) {
+    buffer[len] = '-';
+    len++;
+  }
+  while (digits_num > 0) {
+    digits_num--;
+    buffer[len] = digits[digits_num];
+    len++;
+  }
 
-  char *unused_name;
-  Io__Prometheus__Client__MetricFamily *fam;
-  c_avl_iterator_t *iter = c_avl_get_iterator(metrics);
-  while (c_avl_iterator_next(iter, (void *)&unused_name, (void *)&fam) == 0) {
-    char line[1024]; /* 4x DATA_MAX_NAME_LEN? */
+  return len;
+}
+
+/* format_value writes a value to buffer the way GAUGE_FORMAT does for gauges
+ * and "%.0f" does for counters, and returns its length. Both print integral
+ * values, which are by far the most common, like integers as long as the
+ * value stays below the limit, so these are formatted by format_int(). */
+static size_t format_value(char *buffer, size_t buffer_size, double value,
+                           bool gauge) {
+  double limit = gauge ? 1e15 : 9e18;
+  if ((value > -limit) && (value < limit) &&
+      (value == (double)(int64_t)value) && ((value != 0) || !signbit(value)))
+    return format_int(buffer, (int64_t)value);
+
+  ssnprintf(buffer, buffer_size, gauge ? GAUGE_FORMAT : "%.0f", value);
+  return strlen(buffer);
+}
+
+/* format_text adds a metric family to a buffer in plain text format. */
+static void format_text(ProtobufCBuffer *buffer,
+                        Io__Prometheus__Client__MetricFamily const *fam) {
+  char line[1024]; /* 4x DATA_MAX_NAME_LEN? */
 
-    ssnprintf(line, sizeof(line), "# HELP %s %s\n", fam->name, fam->help);
-    buffer->append(buffer, strlen(line), (uint8_t *)line);
+  ssnprintf(line, sizeof(line), "# HELP %s %s\n", fam->name, fam->help);
+  buffer->append(buffer, strlen(line), (uint8_t *)line);
 
-    ssnprintf(line, sizeof(line), "# TYPE %s %s\n", fam->name,
-              (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
-                  ? "gauge"
-                  : "counter");
-    buffer->append(buffer, strlen(line), (uint8_t *)line);
+  ssnprintf(line, sizeof(line), "# TYPE %s %s\n", fam->name,
+            (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
+                ? "gauge"
+                : "counter");
+  buffer->append(buffer, strlen(line), (uint8_t *)line);
 
-    for (size_t i = 0; i < fam->n_metric; i++) {
-      Io__Prometheus__Client__Metric *m = fam->metric[i];
+  bool gauge = (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE);
 
-      char labels[1024];
+  for (size_t i = 0; i < fam->n_metric; i++) {
+    prom_metric_t const *m = (prom_metric_t const *)fam->metric[i];
 
-      char timestamp_ms[24] = "";
-      if (m->has_timestamp_ms)
-        ssnprintf(timestamp_ms, sizeof(timestamp_ms), " %" PRIi64,
-                  m->timestamp_ms);
+    /* The name and labels have been rendered by metric_clone(), only the value
+     * and the timestamp are formatted here. */
+    buffer->append(buffer, m->prefix_len, (uint8_t *)m->prefix);
 
-      if (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
-        ssnprintf(line, sizeof(line), "%s{%s} " GAUGE_FORMAT "%s\n", fam->name,
-                  format_labels(labels, sizeof(labels), m), m->gauge->value,
-                  timestamp_ms);
-      else /* if (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__COUNTER) */
-        ssnprintf(line, sizeof(line), "%s{%s} %.0f%s\n", fam->name,
-                  format_labels(labels, sizeof(labels), m), m->counter->value,
-                  timestamp_ms);
+    size_t len = 0;
+    line[len] = ' ';
+    len++;
+    len += format_value(line + len, sizeof(line) - len,
+                        gauge ? m->pb.gauge->value : m->pb.counter->value,
+                        gauge);
 
-      buffer->append(buffer, strlen(line), (uint8_t *)line);
+    if (m->pb.has_timestamp_ms) {
+      line[len] = ' ';
+      len++;
+      len += format_int(line + len, m->pb.timestamp_ms);
     }
+
+    line[len] = '\n';
+    len++;
+    buffer->append(buffer, len, (uint8_t *)line);
   }
-  c_avl_iterator_destroy(iter);
+}
 
+/* format_text_trailer adds the comment ending the plain text format. */
+static void format_text_trailer(ProtobufCBuffer *buffer) {
   char server[1024];
   ssnprintf(server, sizeof(server), "\n# collectd/write_prometheus %s at %s\n",
             PACKAGE_VERSION, hostname_g);
   buffer->append(buffer, strlen(server), (uint8_t *)server);
-
-  pthread_mutex_unlock(&metrics_lock);
-}
-
-/* http_handler is the callback called by the microhttpd library. It essentially
- * handles all HTTP request aspects and creates an HTTP response. */
-static MHD_RESULT http_handler(void *cls, struct MHD_Connection *connection,
-                               const char *url, const char *method,
-                               const char *version, const char *upload_data,
-                               size_t *upload_data_size,
-                               void **connection_state) {
-  if (strcmp(method, MHD_HTTP_METHOD_GET) != 0) {
-    return MHD_NO;
-  }
-
-  /* On the first call for each connection, return without anything further.
-   * Apparently not everything has been initialized yet or so; the docs are not
-   * very specific on the issue. */
-  if (*connection_state == NULL) {
-    /* set to a random non-NULL pointer. */
-    *connection_state = &(int){42};
-    return MHD_YES;
-  }
-
-  char const *accept = MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
-                                                   MHD_HTTP_HEADER_ACCEPT);
-  bool want_proto = (accept != NULL) &&
-                    (strstr(accept, "application/vnd.google.protobuf") != NULL);
-
-  uint8_t scratch[4096] = {0};
-  ProtobufCBufferSimple simple = PROTOBUF_C_BUFFER_SIMPLE_INIT(scratch);
-  ProtobufCBuffer *buffer = (ProtobufCBuffer *)&simple;
-
-  if (want_proto)
-    format_protobuf(buffer);
-  else
-    format_text(buffer);
-
-#if defined(MHD_VERSION) && MHD_VERSION >= 0x00090500
-  struct MHD_Response *res = MHD_create_response_from_buffer(
-      simple.len, simple.data, MHD_RESPMEM_MUST_COPY);
-#else
-  struct MHD_Response *res = MHD_create_response_from_data(
-      simple.len, simple.data, /* must_free = */ 0, /* must_copy = */ 1);
-#endif
-  MHD_add_response_header(res, MHD_HTTP_HEADER_CONTENT_TYPE,
-                          want_proto ? CONTENT_TYPE_PROTO : CONTENT_TYPE_TEXT);
-
-  MHD_RESULT status = MHD_queue_response(connection, MHD_HTTP_OK, res);
-
-  MHD_destroy_response(res);
-  PROTOBUF_C_BUFFER_SIMPLE_CLEAR(&simple);
-  return status;
 }
 
 /*
@@ -328,10 +405,12 @@ label_pair_clone(Io__Prometheus__Client__LabelPair const *orig) {
 }
 
 /* metric_destroy frees the memory used by a metric. */
-static void metric_destroy(Io__Prometheus__Client__Metric *msg) {
-  if (msg == NULL)
+static void metric_destroy(prom_metric_t *m) {
+  if (m == NULL)
     return;
 
+  Io__Prometheus__Client__Metric *msg = &m->pb;
+
   for (size_t i = 0; i < msg->n_label; i++) {
     label_pair_destroy(msg->label[i]);
   }
@@ -340,11 +419,12 @@ static void metric_destroy(Io__Prometheus__Client__Metric *msg) {
   sfree(msg->gauge);
   sfree(msg->counter);
 
-  sfree(msg);
+  sfree(m);
 }
 
 /* metric_cmp compares two metrics. It's prototype makes it easy to use with
- * qsort(3) and bsearch(3). */
+ * qsort(3) and bsearch(3). Two metrics of a family are the same if it returns
+ * zero. */
 static int metric_cmp(void const *a, void const *b) {
   Io__Prometheus__Client__Metric const *m_a =
       *((Io__Prometheus__Client__Metric **)a);
@@ -393,6 +473,26 @@ static int metric_cmp(void const *a, void const *b) {
   return 0;
 }
 
+static uint32_t hash_update(uint32_t hash, char const *str) {
+  /* FNV-1a, including the terminating null byte to separate the fields. */
+  do {
+    hash ^= (uint8_t)*str;
+    hash *= 16777619u;
+  } while (*str++ != 0);
+
+  return hash;
+}
+
+/* metric_hash hashes the label values of a metric, which identify the metric
+ * within its family, see metric_cmp(). */
+static uint32_t metric_hash(Io__Prometheus__Client__Metric const *m) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < m->n_label; i++)
+    hash = hash_update(hash, m->label[i]->value);
+
+  return hash;
+}
+
 #define METRIC_INIT                                                            \
   &(Io__Prometheus__Client__Metric) {                                          \
     .label =                                                                   \
@@ -431,30 +531,43 @@ static int metric_cmp(void const *a, void const *b) {
     (m)->n_label++;                                                            \
   } while (0)
 
-/* metric_clone allocates and initializes a new metric based on orig. */
-static Io__Prometheus__Client__Metric *
-metric_clone(Io__Prometheus__Client__Metric const *orig) {
-  Io__Prometheus__Client__Metric *copy = calloc(1, sizeof(*copy));
-  if (copy == NULL)
+/* metric_clone allocates and initializes a new metric of the family "name"
+ * based on orig. */
+static prom_metric_t *metric_clone(char const *name,
+                                   Io__Prometheus__Client__Metric const *orig,
+                                   uint32_t hash) {
+  char labels[1024];
+  char prefix[1024];
+  ssnprintf(prefix, sizeof(prefix), "%s{%s}", name,
+            format_labels(labels, sizeof(labels), orig));
+  size_t prefix_len = strlen(prefix);
+
+  prom_metric_t *m = calloc(1, sizeof(*m) + prefix_len + 1);
+  if (m == NULL)
     return NULL;
+  m->hash = hash;
+  m->prefix_len = prefix_len;
+  memcpy(m->prefix, prefix, prefix_len + 1);
+
+  Io__Prometheus__Client__Metric *copy = &m->pb;
   io__prometheus__client__metric__init(copy);
 
   copy->n_label = orig->n_label;
   copy->label = calloc(copy->n_label, sizeof(*copy->label));
   if (copy->label == NULL) {
-    sfree(copy);
+    sfree(m);
     return NULL;
   }
 
   for (size_t i = 0; i < copy->n_label; i++) {
     copy->label[i] = label_pair_clone(orig->label[i]);
     if (copy->label[i] == NULL) {
-      metric_destroy(copy);
+      metric_destroy(m);
       return NULL;
     }
   }
 
-  return copy;
+  return m;
 }
 
 /* metric_update stores the new value and timestamp in m. */
@@ -517,56 +630,100 @@ static int metric_update(Io__Prometheus__Client__Metric *m, value_t value,
   return 0;
 }
 
-/* metric_family_add_metric adds m to the metric list of fam. */
-static int metric_family_add_metric(Io__Prometheus__Client__MetricFamily *fam,
-                                    Io__Prometheus__Client__Metric *m) {
+/* metric_family_grow doubles the room in the metric array of a family and the
+ * number of its hash buckets. */
+static int metric_family_grow(prom_family_t *fam) {
+  size_t size =
+      (fam->metric_size == 0) ? METRIC_SIZE_INIT : 2 * fam->metric_size;
+
+  prom_metric_t **buckets = calloc(size, sizeof(*buckets));
+  if (buckets == NULL)
+    return ENOMEM;
+
   Io__Prometheus__Client__Metric **tmp =
-      realloc(fam->metric, (fam->n_metric + 1) * sizeof(*fam->metric));
-  if (tmp == NULL)
+      realloc(fam->pb.metric, size * sizeof(*fam->pb.metric));
+  if (tmp == NULL) {
+    sfree(buckets);
     return ENOMEM;
-  fam->metric = tmp;
+  }
+  fam->pb.metric = tmp;
+
+  for (size_t i = 0; i < fam->pb.n_metric; i++) {
+    prom_metric_t *m = (prom_metric_t *)fam->pb.metric[i];
+    m->next = buckets[m->hash & (size - 1)];
+    buckets[m->hash & (size - 1)] = m;
+  }
 
-  fam->metric[fam->n_metric] = m;
-  fam->n_metric++;
+  sfree(fam->buckets);
+  fam->buckets = buckets;
+  fam->metric_size = size;
+  return 0;
+}
 
-  /* Sort the metrics so that lookup is fast. */
-  qsort(fam->metric, fam->n_metric, sizeof(*fam->metric), metric_cmp);
+/* metric_family_add_metric adds m to the metric list of fam. */
+static int metric_family_add_metric(prom_family_t *fam, prom_metric_t *m) {
+  if (fam->pb.n_metric >= fam->metric_size) {
+    int status = metric_family_grow(fam);
+    if (status != 0)
+      return status;
+  }
+
+  m->index = fam->pb.n_metric;
+  fam->pb.metric[fam->pb.n_metric] = &m->pb;
+  fam->pb.n_metric++;
+
+  m->next = fam->buckets[m->hash & (fam->metric_size - 1)];
+  fam->buckets[m->hash & (fam->metric_size - 1)] = m;
 
   return 0;
 }
 
+/* metric_family_find returns a pointer to the hash table entry of the metric
+ * matching key, or to the end of the bucket's chain if there is no such
+ * metric. */
+static prom_metric_t **
+metric_family_find(prom_family_t *fam,
+                   Io__Prometheus__Client__Metric const *key, uint32_t hash) {
+  prom_metric_t **m = &fam->buckets[hash & (fam->metric_size - 1)];
+  for (; *m != NULL; m = &(*m)->next) {
+    Io__Prometheus__Client__Metric const *pb = &(*m)->pb;
+    if (((*m)->hash == hash) && (metric_cmp(&key, &pb) == 0))
+      break;
+  }
+
+  return m;
+}
+
 /* metric_family_delete_metric looks up and deletes the metric corresponding to
  * vl. */
-static int
-metric_family_delete_metric(Io__Prometheus__Client__MetricFamily *fam,
-                            value_list_t const *vl) {
+static int metric_family_delete_metric(prom_family_t *fam,
+                                       value_list_t const *vl) {
   Io__Prometheus__Client__Metric *key = METRIC_INIT;
   METRIC_ADD_LABELS(key, vl);
 
-  size_t i;
-  for (i = 0; i < fam->n_metric; i++) {
-    if (metric_cmp(&key, &fam->metric[i]) == 0)
-      break;
-  }
-
-  if (i >= fam->n_metric)
+  if (fam->pb.n_metric == 0)
     return ENOENT;
 
-  metric_destroy(fam->metric[i]);
-  if ((fam->n_metric - 1) > i)
-    memmove(&fam->metric[i], &fam->metric[i + 1],
-            ((fam->n_metric - 1) - i) * sizeof(fam->metric[i]));
-  fam->n_metric--;
-
-  if (fam->n_metric == 0) {
-    sfree(fam->metric);
-    return 0;
+  prom_metric_t **entry = metric_family_find(fam, key, metric_hash(key));
+  prom_metric_t *m = *entry;
+  if (m == NULL)
+    return ENOENT;
+  *entry = m->next;
+
+  /* Fill the gap in the metric array with the last metric. */
+  fam->pb.n_metric--;
+  if (m->index != fam->pb.n_metric) {
+    prom_metric_t *last = (prom_metric_t *)fam->pb.metric[fam->pb.n_metric];
+    last->index = m->index;
+    fam->pb.metric[last->index] = &last->pb;
   }
+  metric_destroy(m);
 
-  Io__Prometheus__Client__Metric **tmp =
-      realloc(fam->metric, fam->n_metric * sizeof(*fam->metric));
-  if (tmp != NULL)
-    fam->metric = tmp;
+  if (fam->pb.n_metric == 0) {
+    sfree(fam->pb.metric);
+    sfree(fam->buckets);
+    fam->metric_size = 0;
+  }
 
   return 0;
 }
@@ -574,21 +731,18 @@ metric_family_delete_metric(Io__Prometheus__Client__MetricFamily *fam,
 /* metric_family_get_metric looks up the matching metric in a metric family,
  * allocating it if necessary. */
 static Io__Prometheus__Client__Metric *
-metric_family_get_metric(Io__Prometheus__Client__MetricFamily *fam,
-                         value_list_t const *vl) {
+metric_family_get_metric(prom_family_t *fam, value_list_t const *vl) {
   Io__Prometheus__Client__Metric *key = METRIC_INIT;
   METRIC_ADD_LABELS(key, vl);
 
-  /* Metrics are sorted in metric_family_add_metric() so that we can do a binary
-   * search here. */
-  Io__Prometheus__Client__Metric **m = bsearch(
-      &key, fam->metric, fam->n_metric, sizeof(*fam->metric), metric_cmp);
-
-  if (m != NULL) {
-    return *m;
+  uint32_t hash = metric_hash(key);
+  if (fam->pb.n_metric > 0) {
+    prom_metric_t *m = *metric_family_find(fam, key, hash);
+    if (m != NULL)
+      return &m->pb;
   }
 
-  Io__Prometheus__Client__Metric *new_metric = metric_clone(key);
+  prom_metric_t *new_metric = metric_clone(fam->pb.name, key, hash);
   if (new_metric == NULL)
     return NULL;
 
@@ -599,14 +753,13 @@ metric_family_get_metric(Io__Prometheus__Client__MetricFamily *fam,
     return NULL;
   }
 
-  return new_metric;
+  return &new_metric->pb;
 }
 
 /* metric_family_update looks up the matching metric in a metric family,
  * allocating it if necessary, and updates the metric to the latest value. */
-static int metric_family_update(Io__Prometheus__Client__MetricFamily *fam,
-                                data_set_t const *ds, value_list_t const *vl,
-                                size_t ds_index) {
+static int metric_family_update(prom_family_t *fam, data_set_t const *ds,
+                                value_list_t const *vl, size_t ds_index) {
   Io__Prometheus__Client__Metric *m = metric_family_get_metric(fam, vl);
   if (m == NULL)
     return -1;
@@ -616,28 +769,35 @@ static int metric_family_update(Io__Prometheus__Client__MetricFamily *fam,
 }
 
 /* metric_family_destroy frees the memory used by a metric family. */
-static void metric_family_destroy(Io__Prometheus__Client__MetricFamily *msg) {
-  if (msg == NULL)
+static void metric_family_destroy(prom_family_t *fam) {
+  if (fam == NULL)
     return;
 
+  Io__Prometheus__Client__MetricFamily *msg = &fam->pb;
+
   sfree(msg->name);
   sfree(msg->help);
 
   for (size_t i = 0; i < msg->n_metric; i++) {
-    metric_destroy(msg->metric[i]);
+    metric_destroy((prom_metric_t *)msg->metric[i]);
   }
   sfree(msg->metric);
+  sfree(fam->buckets);
 
-  sfree(msg);
+  pthread_mutex_destroy(&fam->lock);
+  sfree(fam);
 }
 
 /* metric_family_create allocates and initializes a new metric family. */
-static Io__Prometheus__Client__MetricFamily *
-metric_family_create(char *name, data_set_t const *ds, value_list_t const *vl,
-                     size_t ds_index) {
-  Io__Prometheus__Client__MetricFamily *msg = calloc(1, sizeof(*msg));
-  if (msg == NULL)
+static prom_family_t *metric_family_create(char *name, data_set_t const *ds,
+                                           value_list_t const *vl,
+                                           size_t ds_index) {
+  prom_family_t *fam = calloc(1, sizeof(*fam));
+  if (fam == NULL)
     return NULL;
+  pthread_mutex_init(&fam->lock, /* attr = */ NULL);
+
+  Io__Prometheus__Client__MetricFamily *msg = &fam->pb;
   io__prometheus__client__metric_family__init(msg);
 
   msg->name = name;
@@ -655,7 +815,7 @@ metric_family_create(char *name, data_set_t const *ds, value_list_t const *vl,
                   : IO__PROMETHEUS__CLIENT__METRIC_TYPE__COUNTER;
   msg->has_type = 1;
 
-  return msg;
+  return fam;
 }
 
 /* metric_family_name creates a metric family's name from a data source. This is
@@ -693,26 +853,81 @@ static char *metric_family_name(data_set_t const *ds, value_list_t const *vl,
   return strdup(name);
 }
 
+/* metric_family_name_cached returns the same name as metric_family_name(),
+ * looking it up in "name_cache". The caller must hold "metrics_lock". The name
+ * is valid until prom_shutdown(). */
+static char const *metric_family_name_cached(data_set_t const *ds,
+                                             value_list_t const *vl,
+                                             size_t ds_index) {
+  uint32_t hash = hash_update(hash_update(2166136261u, vl->plugin), vl->type);
+  prom_name_t **bucket = &name_cache[hash % NAME_CACHE_SIZE];
+
+  for (prom_name_t *n = *bucket; n != NULL; n = n->next) {
+    if ((n->hash == hash) && (n->names_num == ds->ds_num) &&
+        (strcmp(n->plugin, vl->plugin) == 0) &&
+        (strcmp(n->type, vl->type) == 0))
+      return n->names[ds_index];
+  }
+
+  prom_name_t *n = calloc(1, sizeof(*n) + ds->ds_num * sizeof(*n->names));
+  if (n == NULL)
+    return NULL;
+
+  n->hash = hash;
+  sstrncpy(n->plugin, vl->plugin, sizeof(n->plugin));
+  sstrncpy(n->type, vl->type, sizeof(n->type));
+  for (; n->names_num < ds->ds_num; n->names_num++) {
+    n->names[n->names_num] = metric_family_name(ds, vl, n->names_num);
+    if (n->names[n->names_num] == NULL) {
+      for (size_t i = 0; i < n->names_num; i++)
+        sfree(n->names[i]);
+      sfree(n);
+      return NULL;
+    }
+  }
+
+  n->next = *bucket;
+  *bucket = n;
+  return n->names[ds_index];
+}
+
+/* name_cache_destroy frees all entries of "name_cache". */
+static void name_cache_destroy(void) {
+  for (size_t i = 0; i < NAME_CACHE_SIZE; i++) {
+    while (name_cache[i] != NULL) {
+      prom_name_t *n = name_cache[i];
+      name_cache[i] = n->next;
+
+      for (size_t j = 0; j < n->names_num; j++)
+        sfree(n->names[j]);
+      sfree(n);
+    }
+  }
+}
+
 /* metric_family_get looks up the matching metric family, allocating it if
- * necessary. */
-static Io__Prometheus__Client__MetricFamily *
-metric_family_get(data_set_t const *ds, value_list_t const *vl, size_t ds_index,
-                  bool allocate) {
-  char *name = metric_family_name(ds, vl, ds_index);
-  if (name == NULL) {
+ * necessary. The caller must hold "metrics_lock". */
+static prom_family_t *metric_family_get(data_set_t const *ds,
+                                        value_list_t const *vl, size_t ds_index,
+                                        bool allocate) {
+  char const *cached_name = metric_family_name_cached(ds, vl, ds_index);
+  if (cached_name == NULL) {
     ERROR("write_prometheus plugin: Allocating metric family name failed.");
     return NULL;
   }
 
-  Io__Prometheus__Client__MetricFamily *fam = NULL;
-  if (c_avl_get(metrics, name, (void *)&fam) == 0) {
-    sfree(name);
+  prom_family_t *fam = NULL;
+  if (c_avl_get(metrics, cached_name, (void *)&fam) == 0) {
     assert(fam != NULL);
     return fam;
   }
 
-  if (!allocate) {
-    sfree(name);
+  if (!allocate)
+    return NULL;
+
+  char *name = strdup(cached_name);
+  if (name == NULL) {
+    ERROR("write_prometheus plugin: Allocating metric family name failed.");
     return NULL;
   }
 
@@ -728,15 +943,303 @@ metric_family_get(data_set_t const *ds, value_list_t const *vl, size_t ds_index,
         name);
   name = NULL;
 
-  int status = c_avl_insert(metrics, fam->name, fam);
+  int status = c_avl_insert(metrics, fam->pb.name, fam);
   if (status != 0) {
-    ERROR("write_prometheus plugin: Adding \"%s\" failed.", fam->name);
+    ERROR("write_prometheus plugin: Adding \"%s\" failed.", fam->pb.name);
     metric_family_destroy(fam);
     return NULL;
   }
+  fam->refs = 1;
 
   return fam;
 }
+
+/* metric_family_release drops a reference to each of the metric families,
+ * freeing those which are not referenced anymore. */
+static void metric_family_release(prom_family_t **fams, size_t fams_num) {
+  pthread_mutex_lock(&metrics_lock);
+  for (size_t i = 0; i < fams_num; i++) {
+    assert(fams[i]->refs > 0);
+    fams[i]->refs--;
+    if (fams[i]->refs == 0)
+      metric_family_destroy(fams[i]);
+  }
+  pthread_mutex_unlock(&metrics_lock);
+}
+
+/* metric_family_lock looks up the matching metric family, allocating it if
+ * requested, and returns it locked and referenced. Release it with
+ * metric_family_unlock(). */
+static prom_family_t *metric_family_lock(data_set_t const *ds,
+                                         value_list_t const *vl,
+                                         size_t ds_index, bool allocate) {
+  while (true) {
+    pthread_mutex_lock(&metrics_lock);
+    prom_family_t *fam = metric_family_get(ds, vl, ds_index, allocate);
+    if (fam != NULL)
+      fam->refs++;
+    pthread_mutex_unlock(&metrics_lock);
+
+    if (fam == NULL)
+      return NULL;
+
+    pthread_mutex_lock(&fam->lock);
+    if (!fam->removed)
+      return fam;
+
+    /* prom_missing() has removed the family after it was looked up. */
+    pthread_mutex_unlock(&fam->lock);
+    metric_family_release(&fam, 1);
+  }
+}
+
+/* metric_family_unlock unlocks and releases a metric family returned by
+ * metric_family_lock(). */
+static void metric_family_unlock(prom_family_t *fam) {
+  pthread_mutex_unlock(&fam->lock);
+  metric_family_release(&fam, 1);
+}
+/* }}} */
+
+/*
+ * Functions for sending metrics to Prometheus. A scrape takes a reference to
+ * all metric families that exist when the request arrives and renders them one
+ * by one, each under its own lock, as microhttpd asks for more data.
+ * {{{ */
+/* prom_scrape_destroy releases the metric families of a scrape and frees its
+ * memory. It is also the microhttpd callback called when a response is done. */
+static void prom_scrape_destroy(void *cls) {
+  prom_scrape_t *s = cls;
+  if (s == NULL)
+    return;
+
+  metric_family_release(s->families, s->families_num);
+  sfree(s->families);
+
+  PROTOBUF_C_BUFFER_SIMPLE_CLEAR(&s->buffer);
+
+#if HAVE_LIBZ
+  if (s->gzip)
+    deflateEnd(&s->z);
+#endif
+
+  sfree(s);
+}
+
+/* prom_scrape_create allocates a scrape and takes a reference to all metric
+ * families. */
+static prom_scrape_t *prom_scrape_create(bool want_proto,
+                                         __attribute__((unused))
+                                         bool want_gzip) {
+  prom_scrape_t *s = calloc(1, sizeof(*s));
+  if (s == NULL)
+    return NULL;
+
+  s->want_proto = want_proto;
+  s->trailer_pending = !want_proto;
+  s->buffer = (ProtobufCBufferSimple)PROTOBUF_C_BUFFER_SIMPLE_INIT(s->scratch);
+
+  pthread_mutex_lock(&metrics_lock);
+
+  int families_num = c_avl_size(metrics);
+  if (families_num > 0) {
+    s->families = calloc((size_t)families_num, sizeof(*s->families));
+    if (s->families == NULL) {
+      pthread_mutex_unlock(&metrics_lock);
+      prom_scrape_destroy(s);
+      return NULL;
+    }
+  }
+
+  char *unused_name;
+  prom_family_t *fam;
+  c_avl_iterator_t *iter = c_avl_get_iterator(metrics);
+  while (c_avl_iterator_next(iter, (void *)&unused_name, (void *)&fam) == 0) {
+    assert(s->families_num < (size_t)families_num);
+    fam->refs++;
+    s->families[s->families_num] = fam;
+    s->families_num++;
+  }
+  c_avl_iterator_destroy(iter);
+
+  pthread_mutex_unlock(&metrics_lock);
+
+#if HAVE_LIBZ
+  /* A window size of 15 + 16 makes deflate() write a gzip header. If
+   * initialization fails, the response is simply sent uncompressed. */
+  if (want_gzip)
+    s->gzip = (deflateInit2(&s->z, Z_BEST_SPEED, Z_DEFLATED, 15 + 16,
+                            /* memLevel = */ 8, Z_DEFAULT_STRATEGY) == Z_OK);
+#endif
+
+  return s;
+}
+
+/* prom_scrape_fill renders the next metric family into the (drained) buffer.
+ * Returns false once everything has been rendered. */
+static bool prom_scrape_fill(prom_scrape_t *s) {
+  ProtobufCBuffer *buffer = (ProtobufCBuffer *)&s->buffer;
+
+  s->buffer.len = 0;
+  s->buffer_pos = 0;
+
+  while ((s->buffer.len == 0) && (s->families_pos < s->families_num)) {
+    prom_family_t *fam = s->families[s->families_pos];
+    s->families_pos++;
+
+    pthread_mutex_lock(&fam->lock);
+    if (fam->pb.n_metric > 0) {
+      if (s->want_proto)
+        format_protobuf(buffer, &fam->pb);
+      else
+        format_text(buffer, &fam->pb);
+    }
+    pthread_mutex_unlock(&fam->lock);
+  }
+
+  if ((s->buffer.len == 0) && s->trailer_pending) {
+    format_text_trailer(buffer);
+    s->trailer_pending = false;
+  }
+
+  return s->buffer.len > 0;
+}
+
+#if HAVE_LIBZ
+/* prom_scrape_read_gzip is prom_scrape_read() for gzip encoded responses. */
+static ssize_t prom_scrape_read_gzip(prom_scrape_t *s, char *buf, size_t max) {
+  s->z.next_out = (Bytef *)buf;
+  s->z.avail_out = (uInt)max;
+
+  while ((s->z.avail_out > 0) && !s->gzip_done) {
+    bool more = true;
+    if (s->z.avail_in == 0) {
+      more = prom_scrape_fill(s);
+      s->z.next_in = s->buffer.data;
+      s->z.avail_in = (uInt)s->buffer.len;
+    }
+
+    int status = deflate(&s->z, more ? Z_NO_FLUSH : Z_FINISH);
+    if (status == Z_STREAM_END) {
+      s->gzip_done = true;
+    } else if ((status != Z_OK) && (status != Z_BUF_ERROR)) {
+      ERROR("write_prometheus plugin: deflate failed with status %d.",
+            status);
+      return MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+  }
+
+  size_t buf_len = max - s->z.avail_out;
+  if (buf_len == 0)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+
+  return (ssize_t)buf_len;
+}
+#endif
+
+/* prom_scrape_read is the microhttpd callback providing the response body. It
+ * copies up to "max" bytes to "buf", rendering metric families as needed. */
+static ssize_t prom_scrape_read(void *cls,
+                                __attribute__((unused)) uint64_t pos,
+                                char *buf, size_t max) {
+  prom_scrape_t *s = cls;
+
+#if HAVE_LIBZ
+  if (s->gzip)
+    return prom_scrape_read_gzip(s, buf, max);
+#endif
+
+  size_t buf_len = 0;
+  while (buf_len < max) {
+    if ((s->buffer_pos >= s->buffer.len) && !prom_scrape_fill(s))
+      break;
+
+    size_t n = s->buffer.len - s->buffer_pos;
+    if (n > (max - buf_len))
+      n = max - buf_len;
+
+    memcpy(buf + buf_len, s->buffer.data + s->buffer_pos, n);
+    buf_len += n;
+    s->buffer_pos += n;
+  }
+
+  if (buf_len == 0)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+
+  return (ssize_t)buf_len;
+}
+
+/* http_handler is the callback called by the microhttpd library. It essentially
+ * handles all HTTP request aspects and creates an HTTP response. */
+static MHD_RESULT http_handler(void *cls, struct MHD_Connection *connection,
+                               const char *url, const char *method,
+                               const char *version, const char *upload_data,
+                               size_t *upload_data_size,
+                               void **connection_state) {
+  if (strcmp(method, MHD_HTTP_METHOD_GET) != 0) {
+    return MHD_NO;
+  }
+
+  /* On the first call for each connection, return without anything further.
+   * Apparently not everything has been initialized yet or so; the docs are not
+   * very specific on the issue. */
+  if (*connection_state == NULL) {
+    /* set to a random non-NULL pointer. */
+    *connection_state = &(int){42};
+    return MHD_YES;
+  }
+
+  char const *accept = MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                   MHD_HTTP_HEADER_ACCEPT);
+  bool want_proto = (accept != NULL) &&
+                    (strstr(accept, "application/vnd.google.protobuf") != NULL);
+
+  char const *encoding = MHD_lookup_connection_value(
+      connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  bool want_gzip = (encoding != NULL) && (strstr(encoding, "gzip") != NULL);
+
+  prom_scrape_t *s = prom_scrape_create(want_proto, want_gzip);
+  if (s == NULL) {
+    ERROR("write_prometheus plugin: Allocating scrape failed.");
+    return MHD_NO;
+  }
+  bool gzip = s->gzip;
+
+#if defined(MHD_VERSION) && MHD_VERSION >= 0x00090000
+  /* The response takes ownership of "s" and frees it when it's done. */
+  struct MHD_Response *res = MHD_create_response_from_callback(
+      MHD_SIZE_UNKNOWN, SCRAPE_BLOCK_SIZE, prom_scrape_read, s,
+      prom_scrape_destroy);
+  if (res == NULL) {
+    prom_scrape_destroy(s);
+    return MHD_NO;
+  }
+#else
+  /* The callback of older versions has a different prototype. Render the
+   * complete response up front instead. */
+  uint8_t scratch[4096] = {0};
+  ProtobufCBufferSimple simple = PROTOBUF_C_BUFFER_SIMPLE_INIT(scratch);
+
+  char block[SCRAPE_BLOCK_SIZE];
+  ssize_t block_len;
+  while ((block_len = prom_scrape_read(s, 0, block, sizeof(block))) > 0)
+    simple.base.append(&simple.base, (size_t)block_len, (uint8_t *)block);
+  prom_scrape_destroy(s);
+
+  struct MHD_Response *res = MHD_create_response_from_data(
+      simple.len, simple.data, /* must_free = */ 0, /* must_copy = */ 1);
+  PROTOBUF_C_BUFFER_SIMPLE_CLEAR(&simple);
+#endif
+  MHD_add_response_header(res, MHD_HTTP_HEADER_CONTENT_TYPE,
+                          want_proto ? CONTENT_TYPE_PROTO : CONTENT_TYPE_TEXT);
+  if (gzip)
+    MHD_add_response_header(res, MHD_HTTP_HEADER_CONTENT_ENCODING, "gzip");
+
+  MHD_RESULT status = MHD_queue_response(connection, MHD_HTTP_OK, res);
+
+  MHD_destroy_response(res);
+  return status;
+}
 /* }}} */
 
 static void prom_logger(__attribute__((unused)) void *arg, char const *fmt,
@@ -916,11 +1419,8 @@ static int prom_init() {
 
 static int prom_write(data_set_t const *ds, value_list_t const *vl,
                       __attribute__((unused)) user_data_t *ud) {
-  pthread_mutex_lock(&metrics_lock);
-
   for (size_t i = 0; i < ds->ds_num; i++) {
-    Io__Prometheus__Client__MetricFamily *fam =
-        metric_family_get(ds, vl, i, /* allocate = */ true);
+    prom_family_t *fam = metric_family_lock(ds, vl, i, /* allocate = */ true);
     if (fam == NULL)
       continue;
 
@@ -928,12 +1428,12 @@ static int prom_write(data_set_t const *ds, value_list_t const *vl,
     if (status != 0) {
       ERROR("write_prometheus plugin: Updating metric \"%s\" failed with "
             "status %d",
-            fam->name, status);
-      continue;
+            fam->pb.name, status);
     }
+
+    metric_family_unlock(fam);
   }
 
-  pthread_mutex_unlock(&metrics_lock);
   return 0;
 }
 
@@ -943,11 +1443,8 @@ static int prom_missing(value_list_t const *vl,
   if (ds == NULL)
     return ENOENT;
 
-  pthread_mutex_lock(&metrics_lock);
-
   for (size_t i = 0; i < ds->ds_num; i++) {
-    Io__Prometheus__Client__MetricFamily *fam =
-        metric_family_get(ds, vl, i, /* allocate = */ false);
+    prom_family_t *fam = metric_family_lock(ds, vl, i, /* allocate = */ false);
     if (fam == NULL)
       continue;
 
@@ -955,24 +1452,32 @@ static int prom_missing(value_list_t const *vl,
     if (status != 0) {
       ERROR("write_prometheus plugin: Deleting a metric in family \"%s\" "
             "failed with status %d",
-            fam->name, status);
+            fam->pb.name, status);
 
+      metric_family_unlock(fam);
       continue;
     }
 
-    if (fam->n_metric == 0) {
-      int status = c_avl_remove(metrics, fam->name, NULL, NULL);
-      if (status != 0) {
+    if (fam->pb.n_metric == 0) {
+      /* The family is freed by metric_family_unlock() unless a scrape still
+       * references it. */
+      pthread_mutex_lock(&metrics_lock);
+      int status = c_avl_remove(metrics, fam->pb.name, NULL, NULL);
+      if (status == 0) {
+        fam->removed = true;
+        fam->refs--;
+      }
+      pthread_mutex_unlock(&metrics_lock);
+
+      if (status != 0)
         ERROR("write_prometheus plugin: Deleting metric family \"%s\" failed "
               "with status %d",
-              fam->name, status);
-        continue;
-      }
-      metric_family_destroy(fam);
+              fam->pb.name, status);
     }
+
+    metric_family_unlock(fam);
   }
 
-  pthread_mutex_unlock(&metrics_lock);
   return 0;
 }
 
@@ -985,9 +1490,9 @@ static int prom_shutdown() {
   pthread_mutex_lock(&metrics_lock);
   if (metrics != NULL) {
     char *name;
-    Io__Prometheus__Client__MetricFamily *fam;
+    prom_family_t *fam;
     while (c_avl_pick(metrics, (void *)&name, (void *)&fam) == 0) {
-      assert(name == fam->name);
+      assert(name == fam->pb.name);
       name = NULL;
 
       metric_family_destroy(fam);
@@ -995,6 +1500,7 @@ static int prom_shutdown() {
     c_avl_destroy(metrics);
     metrics = NULL;
   }
+  name_cache_destroy();
   pthread_mutex_unlock(&metrics_lock);
 
   sfree(httpd_host);
@@ -0,0 +1,172 @@
+/**
+ * collectd - src/write_prometheus_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *   collectd contributors
+ */
+
+/* Measures how long the write_prometheus plugin takes to render a scrape of
+ * one million series (by default) in the plain text format. The response is
+ * read the way microhttpd reads it, in blocks of SCRAPE_BLOCK_SIZE bytes, and
+ * discarded. For comparison, the same metrics are rendered by formatting and
+ * escaping the labels of each metric again, as format_text() used to do. If
+ * zlib is available, a gzip encoded scrape is measured as well.
+ *
+ * Before that, the series are written with prom_write(), once creating and
+ * once updating the metrics. These times include building the value lists.
+ *
+ * Usage: bench_plugin_write_prometheus [series] [scrapes] */
+
+#include "write_prometheus.c" /* (sic) */
+
+#define BENCH_FAMILIES 100
+
+static data_source_t bench_dsrc[] = {
+    {"value", DS_TYPE_GAUGE, NAN, NAN},
+};
+static data_set_t bench_ds = {"gauge", 1, bench_dsrc};
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + ((double)ts.tv_nsec) / 1e9;
+}
+
+/* Writes "series" series, spread over BENCH_FAMILIES metric families with
+ * three labels each. Every other value is not integral. */
+static double bench_write(size_t series, gauge_t value) {
+  value_t v;
+  value_list_t vl = {
+      .values = &v,
+      .values_len = 1,
+      .time = TIME_T_TO_CDTIME_T(1700000000),
+      .interval = TIME_T_TO_CDTIME_T(10),
+  };
+  sstrncpy(vl.host, "bench.example.com", sizeof(vl.host));
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+
+  double start = now_seconds();
+  for (size_t i = 0; i < series; i++) {
+    v.gauge = value + (double)(i % 2) / 3.0;
+    snprintf(vl.plugin, sizeof(vl.plugin), "bench%zu", i % BENCH_FAMILIES);
+    snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%zu",
+             (i / BENCH_FAMILIES) % 1000);
+    snprintf(vl.type_instance, sizeof(vl.type_instance), "instance%zu",
+             i / (BENCH_FAMILIES * 1000));
+    prom_write(&bench_ds, &vl, /* user data = */ NULL);
+  }
+
+  return now_seconds() - start;
+}
+
+static double bench_scrape(bool want_gzip, size_t *ret_size) {
+  char block[SCRAPE_BLOCK_SIZE];
+  size_t size = 0;
+
+  double start = now_seconds();
+  prom_scrape_t *s = prom_scrape_create(/* want_proto = */ false, want_gzip);
+  if (s == NULL)
+    return NAN;
+
+  ssize_t status;
+  while ((status = prom_scrape_read(s, size, block, sizeof(block))) > 0)
+    size += (size_t)status;
+  prom_scrape_destroy(s);
+
+  *ret_size = size;
+  return now_seconds() - start;
+}
+
+/* Renders the metrics into the same blocks, formatting the labels of each
+ * metric with format_labels(). */
+static double bench_render_labels(size_t *ret_size) {
+  uint8_t scratch[SCRAPE_BLOCK_SIZE];
+  ProtobufCBufferSimple simple = PROTOBUF_C_BUFFER_SIMPLE_INIT(scratch);
+  size_t size = 0;
+
+  double start = now_seconds();
+  prom_scrape_t *s = prom_scrape_create(/* want_proto = */ false, false);
+  if (s == NULL)
+    return NAN;
+
+  for (size_t i = 0; i < s->families_num; i++) {
+    Io__Prometheus__Client__MetricFamily const *fam = &s->families[i]->pb;
+    pthread_mutex_lock(&s->families[i]->lock);
+    for (size_t j = 0; j < fam->n_metric; j++) {
+      Io__Prometheus__Client__Metric const *m = fam->metric[j];
+      char labels[1024];
+      char line[1024];
+
+      ssnprintf(line, sizeof(line), "%s{%s} " GAUGE_FORMAT " %" PRIi64 "\n",
+                fam->name, format_labels(labels, sizeof(labels), m),
+                m->gauge->value, m->timestamp_ms);
+      simple.base.append(&simple.base, strlen(line), (uint8_t *)line);
+
+      if (simple.len >= SCRAPE_BLOCK_SIZE) {
+        size += simple.len;
+        simple.len = 0;
+      }
+    }
+    pthread_mutex_unlock(&s->families[i]->lock);
+  }
+  size += simple.len;
+  prom_scrape_destroy(s);
+  PROTOBUF_C_BUFFER_SIMPLE_CLEAR(&simple);
+
+  *ret_size = size;
+  return now_seconds() - start;
+}
+
+int main(int argc, char **argv) {
+  size_t series = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+  int scrapes = (argc > 2) ? atoi(argv[2]) : 3;
+
+  metrics = c_avl_create((void *)strcmp);
+  if (metrics == NULL)
+    return 1;
+
+  double t = bench_write(series, 1.0);
+  printf("prom_write, new series:      %10.0f values/s\n", series / t);
+  t = bench_write(series, 2.0);
+  printf("prom_write, existing series: %10.0f values/s\n", series / t);
+
+  for (int i = 0; i < scrapes; i++) {
+    size_t size;
+
+    t = bench_render_labels(&size);
+    printf("scrape %d: formatting labels %6.3f s (%5.1f MB)\n", i, t,
+           size / 1e6);
+
+    t = bench_scrape(/* want_gzip = */ false, &size);
+    printf("scrape %d: text              %6.3f s (%5.1f MB)\n", i, t,
+           size / 1e6);
+
+#if HAVE_LIBZ
+    t = bench_scrape(/* want_gzip = */ true, &size);
+    printf("scrape %d: text, gzip        %6.3f s (%5.1f MB)\n", i, t,
+           size / 1e6);
+#endif
+  }
+
+  prom_shutdown();
+  return 0;
+}
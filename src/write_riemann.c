@@ -423,6 +423,7 @@ wrr_value_list_to_message(struct riemann_host const *host, /* {{{ */
                           int *statuses) {
   riemann_message_t *msg;
   size_t i;
+  gauge_t rates_buffer[ds->ds_num];
   gauge_t *rates = NULL;
 
   /* Initialize the Msg structure. */
@@ -433,12 +434,12 @@ wrr_value_list_to_message(struct riemann_host const *host, /* {{{ */
   }
 
   if (host->store_rates) {
-    rates = uc_get_rate(ds, vl);
-    if (rates == NULL) {
-      ERROR("write_riemann plugin: uc_get_rate failed.");
+    if (uc_get_rate_buffer(ds, vl, rates_buffer) != 0) {
+      ERROR("write_riemann plugin: uc_get_rate_buffer failed.");
       riemann_message_free(msg);
       return NULL;
     }
+    rates = rates_buffer;
   }
 
   for (i = 0; i < vl->values_len; i++) {
@@ -447,13 +448,11 @@ wrr_value_list_to_message(struct riemann_host const *host, /* {{{ */
     event = wrr_value_to_event(host, ds, vl, (int)i, rates, statuses[i]);
     if (event == NULL) {
       riemann_message_free(msg);
-      sfree(rates);
       return NULL;
     }
     riemann_message_append_events(msg, event, NULL);
   }
 
-  sfree(rates);
   return msg;
 } /* }}} riemann_message_t *wrr_value_list_to_message */
 
@@ -323,7 +323,7 @@ static int ws_format_values(char *ret, size_t ret_len, int ds_num,
                             bool store_rates) {
   size_t offset = 0;
   int status;
-  gauge_t *rates = NULL;
+  gauge_t rates[ds->ds_num];
 
   assert(strcmp(ds->type, vl->type) == 0);
 
@@ -332,24 +332,20 @@ static int ws_format_values(char *ret, size_t ret_len, int ds_num,
 #define BUFFER_ADD(...)                                                        \
   do {                                                                         \
     status = snprintf(ret + offset, ret_len - offset, __VA_ARGS__);            \
-    if (status < 1) {                                                          \
-      sfree(rates);                                                            \
+    if (status < 1)                                                            \
       return -1;                                                               \
-    } else if (((size_t)status) >= (ret_len - offset)) {                       \
-      sfree(rates);                                                            \
+    else if (((size_t)status) >= (ret_len - offset))                           \
       return -1;                                                               \
-    } else                                                                     \
+    else                                                                       \
       offset += ((size_t)status);                                              \
   } while (0)
 
   if (ds->ds[ds_num].type == DS_TYPE_GAUGE)
     BUFFER_ADD(GAUGE_FORMAT, vl->values[ds_num].gauge);
   else if (store_rates) {
-    if (rates == NULL)
-      rates = uc_get_rate(ds, vl);
-    if (rates == NULL) {
+    if (uc_get_rate_buffer(ds, vl, rates) != 0) {
       WARNING("format_values: "
-              "uc_get_rate failed.");
+              "uc_get_rate_buffer failed.");
       return -1;
     }
     BUFFER_ADD(GAUGE_FORMAT, rates[ds_num]);
@@ -362,13 +358,11 @@ static int ws_format_values(char *ret, size_t ret_len, int ds_num,
   else {
     ERROR("format_values plugin: Unknown data source type: %i",
           ds->ds[ds_num].type);
-    sfree(rates);
     return -1;
   }
 
 #undef BUFFER_ADD
 
-  sfree(rates);
   return 0;
 }
 